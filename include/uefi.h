@@ -1,29 +1,75 @@
 #pragma once
 
+#include "uefi/acpi.h"
+#include "uefi/allocation_profiler.h"
+#include "uefi/block_cache.h"
+#include "uefi/block_io_protocol.h"
+#include "uefi/boot_info.h"
+#include "uefi/boot_info_builder.h"
 #include "uefi/boot_services.h"
+#include "uefi/buffered_file_writer.h"
+#include "uefi/capsule.h"
+#include "uefi/clock.h"
 #include "uefi/configuration_table.h"
 #include "uefi/console_color.h"
 #include "uefi/crc32.h"
 #include "uefi/detail/bit_flags.h"
+#include "uefi/device_path_protocol.h"
+#include "uefi/directory.h"
+#include "uefi/disk_io_protocol.h"
+#include "uefi/elf.h"
+#include "uefi/elf_loader.h"
+#include "uefi/event.h"
 #include "uefi/file_protocol.h"
+#include "uefi/flat_map.h"
+#include "uefi/format.h"
+#include "uefi/framebuffer_console.h"
+#include "uefi/gpt.h"
+#include "uefi/graphics_output_protocol.h"
 #include "uefi/guid.h"
 #include "uefi/handle.h"
+#include "uefi/hashing_file.h"
+#include "uefi/log_ring.h"
+#include "uefi/lz4.h"
 #include "uefi/memory_attribute.h"
 #include "uefi/memory_map.h"
+#include "uefi/memory_scrubber.h"
 #include "uefi/memory_type.h"
+#include "uefi/mp_services_protocol.h"
 #include "uefi/non_copyable.h"
+#include "uefi/page_arena.h"
+#include "uefi/page_table_builder.h"
+#include "uefi/path.h"
+#include "uefi/path_index.h"
+#include "uefi/pci.h"
+#include "uefi/pci_io_protocol.h"
+#include "uefi/ram_disk.h"
+#include "uefi/ram_disk_protocol.h"
+#include "uefi/result.h"
 #include "uefi/revision.h"
 #include "uefi/runtime_services.h"
+#include "uefi/serial_console.h"
+#include "uefi/serial_io_protocol.h"
+#include "uefi/sha2.h"
 #include "uefi/signature.h"
 #include "uefi/signed_table.h"
 #include "uefi/simple_file_system_protocol.h"
 #include "uefi/simple_text_input_protocol.h"
 #include "uefi/simple_text_output_protocol.h"
+#include "uefi/smbios.h"
+#include "uefi/span.h"
+#include "uefi/static_string.h"
+#include "uefi/static_vector.h"
 #include "uefi/status.h"
+#include "uefi/strided_span.h"
 #include "uefi/system_table.h"
 #include "uefi/table.h"
 #include "uefi/table_header.h"
 #include "uefi/task_priority_level.h"
 #include "uefi/text_input_stream.h"
 #include "uefi/text_output_stream.h"
+#include "uefi/text_screen.h"
 #include "uefi/time.h"
+#include "uefi/topology.h"
+#include "uefi/ucs2.h"
+#include "uefi/vector.h"
@@ -0,0 +1,517 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "detail/checksum.h"
+#include "detail/memory.h"
+#include "status.h"
+
+namespace Uefi {
+    // The parts of ACPI needed to find the tables and to read the processor and memory topology.
+    // See https://uefi.org/specs/ACPI/6.5/05_ACPI_Software_Programming_Model.html
+    // The structures are read in place, in the firmware's memory. They are packed, since the firmware lays them out
+    // back to back: their 64-bit fields are often misaligned.
+
+    /// The signature of a table, as the 32-bit value of its 4 characters in memory.
+    constexpr uint32_t makeAcpiSignature(const char (&name)[5]) noexcept {
+        return static_cast<uint32_t>(static_cast<uint8_t>(name[0])) | (static_cast<uint32_t>(static_cast<uint8_t>(name[1])) << 8) |
+            (static_cast<uint32_t>(static_cast<uint8_t>(name[2])) << 16) | (static_cast<uint32_t>(static_cast<uint8_t>(name[3])) << 24);
+    }
+
+    /// Root System Description Pointer: what the firmware installs as acpi2_guid (or acpi1_guid).
+    struct [[gnu::packed]] AcpiRsdp {
+        /// "RSD PTR ".
+        static constexpr uint64_t expected_signature = 0x2052545020445352;
+
+        uint64_t signature;
+        /// Covers the first 20 bytes.
+        uint8_t checksum;
+        char oem_id[6];
+        /// 0 for ACPI 1.0, which only has the fields up to rsdt_address, 2 for later versions.
+        uint8_t revision;
+        uint32_t rsdt_address;
+
+        uint32_t length;
+        uint64_t xsdt_address;
+        /// Covers the whole structure.
+        uint8_t extended_checksum;
+        uint8_t reserved[3];
+    };
+
+    static_assert(sizeof(AcpiRsdp) == 36);
+
+    /// The header all the tables start with, except the RSDP and the FACS.
+    struct [[gnu::packed]] AcpiTableHeader {
+        uint32_t signature;
+        /// Size of the whole table, header included.
+        uint32_t length;
+        uint8_t revision;
+        uint8_t checksum;
+        char oem_id[6];
+        char oem_table_id[8];
+        uint32_t oem_revision;
+        uint32_t creator_id;
+        uint32_t creator_revision;
+    };
+
+    static_assert(sizeof(AcpiTableHeader) == 36);
+
+    /// An entry of the MADT or the SRAT: a type and a length, followed by the fields of this type.
+    struct [[gnu::packed]] AcpiSubtable {
+        uint8_t type;
+        uint8_t length;
+
+        /// The entry as one of the structures deriving from AcpiSubtable.
+        /// @return nullptr The entry has another type, or is too short.
+        template <typename T>
+        [[nodiscard]] const T* as() const noexcept {
+            if (type != T::subtable_type || length < sizeof(T))
+                return nullptr;
+
+            return static_cast<const T*>(this);
+        }
+    };
+
+    /// The entries following the fixed part of a table. Iterating stops at the first entry which is truncated or
+    /// overflows the table, instead of reading past it.
+    /// @code
+    /// for (const auto& entry : madt->getEntries())
+    ///     if (const auto* apic = entry.as<MadtLocalApic>())
+    ///         use(apic->apic_id);
+    /// @endcode
+    class AcpiSubtables {
+    public:
+        class Iterator {
+        public:
+            Iterator(const uint8_t* position, const uint8_t* end) noexcept : _position(position), _end(end) {
+                _check();
+            }
+
+            const AcpiSubtable& operator*() const noexcept {
+                return *reinterpret_cast<const AcpiSubtable*>(_position);
+            }
+
+            Iterator& operator++() noexcept {
+                _position += (**this).length;
+                _check();
+                return *this;
+            }
+
+            bool operator!=(const Iterator& other) const noexcept {
+                return _position != other._position;
+            }
+
+        private:
+            void _check() noexcept {
+                const auto remaining = static_cast<size_t>(_end - _position);
+                if (remaining < sizeof(AcpiSubtable) || (**this).length < sizeof(AcpiSubtable) || (**this).length > remaining)
+                    _position = _end;
+            }
+
+            const uint8_t* _position;
+            const uint8_t* _end;
+        };
+
+        AcpiSubtables(const void* data, size_t size) noexcept
+            : _begin(static_cast<const uint8_t*>(data)), _end(_begin + size) {}
+
+        [[nodiscard]] Iterator begin() const noexcept {
+            return {_begin, _end};
+        }
+
+        [[nodiscard]] Iterator end() const noexcept {
+            return {_end, _end};
+        }
+
+    private:
+        const uint8_t* _begin;
+        const uint8_t* _end;
+    };
+
+    namespace Detail {
+        /// The entries of a table whose fixed part is the structure T.
+        template <typename T>
+        AcpiSubtables getAcpiSubtables(const T& table) noexcept {
+            const auto length = table.header.length;
+            return {&table + 1, length > sizeof(T) ? length - sizeof(T) : 0};
+        }
+    } // namespace Detail
+
+    /// Multiple APIC Description Table: the processors and interrupt controllers.
+    struct [[gnu::packed]] AcpiMadt {
+        static constexpr uint32_t expected_signature = makeAcpiSignature("APIC");
+
+        AcpiTableHeader header;
+        uint32_t local_interrupt_controller_address;
+        uint32_t flags;
+
+        [[nodiscard]] AcpiSubtables getEntries() const noexcept {
+            return Detail::getAcpiSubtables(*this);
+        }
+    };
+
+    /// A processor with an xAPIC (x86), with an ID below 255.
+    struct [[gnu::packed]] MadtLocalApic : AcpiSubtable {
+        static constexpr uint8_t subtable_type = 0;
+
+        uint8_t acpi_processor_uid;
+        uint8_t apic_id;
+        uint32_t flags;
+
+        /// Whether the processor is usable. Disabled processors may only be hot-plugged later.
+        [[nodiscard]] bool isEnabled() const noexcept {
+            return (flags & 1) != 0;
+        }
+    };
+
+    static_assert(sizeof(MadtLocalApic) == 8);
+
+    /// A processor with an x2APIC (x86).
+    struct [[gnu::packed]] MadtLocalX2Apic : AcpiSubtable {
+        static constexpr uint8_t subtable_type = 9;
+
+        uint16_t reserved;
+        uint32_t x2apic_id;
+        uint32_t flags;
+        uint32_t acpi_processor_uid;
+
+        [[nodiscard]] bool isEnabled() const noexcept {
+            return (flags & 1) != 0;
+        }
+    };
+
+    static_assert(sizeof(MadtLocalX2Apic) == 16);
+
+    /// A processor with a GIC CPU interface (AArch64), as of ACPI 5.1.
+    struct [[gnu::packed]] MadtGicc : AcpiSubtable {
+        static constexpr uint8_t subtable_type = 11;
+
+        uint16_t reserved;
+        uint32_t cpu_interface_number;
+        uint32_t acpi_processor_uid;
+        uint32_t flags;
+        uint32_t parking_protocol_version;
+        uint32_t performance_interrupt;
+        uint64_t parked_address;
+        uint64_t physical_base_address;
+        uint64_t gicv_address;
+        uint64_t gich_address;
+        uint32_t vgic_maintenance_interrupt;
+        uint64_t gicr_base_address;
+        /// The affinity fields of the processor's MPIDR_EL1.
+        uint64_t mpidr;
+
+        [[nodiscard]] bool isEnabled() const noexcept {
+            return (flags & 1) != 0;
+        }
+
+        /// Processors with a higher class are faster but less efficient, like the big cores of big.LITTLE.
+        /// Always 0 before ACPI 6.0.
+        [[nodiscard]] uint8_t getEfficiencyClass() const noexcept {
+            return length > sizeof(MadtGicc) ? reinterpret_cast<const uint8_t*>(this)[sizeof(MadtGicc)] : 0;
+        }
+    };
+
+    static_assert(sizeof(MadtGicc) == 76);
+
+    /// System Resource Affinity Table: which proximity domain (NUMA node) each processor and memory range is in.
+    struct [[gnu::packed]] AcpiSrat {
+        static constexpr uint32_t expected_signature = makeAcpiSignature("SRAT");
+
+        AcpiTableHeader header;
+        uint32_t table_revision;
+        uint64_t reserved;
+
+        [[nodiscard]] AcpiSubtables getEntries() const noexcept {
+            return Detail::getAcpiSubtables(*this);
+        }
+    };
+
+    /// The domain of a processor, identified by its xAPIC ID (x86).
+    struct [[gnu::packed]] SratProcessorAffinity : AcpiSubtable {
+        static constexpr uint8_t subtable_type = 0;
+
+        uint8_t proximity_domain_low;
+        uint8_t apic_id;
+        uint32_t flags;
+        uint8_t local_sapic_eid;
+        uint8_t proximity_domain_high[3];
+        uint32_t clock_domain;
+
+        [[nodiscard]] uint32_t getProximityDomain() const noexcept {
+            return proximity_domain_low | (static_cast<uint32_t>(proximity_domain_high[0]) << 8) |
+                (static_cast<uint32_t>(proximity_domain_high[1]) << 16) | (static_cast<uint32_t>(proximity_domain_high[2]) << 24);
+        }
+
+        /// Entries which are not enabled must be ignored.
+        [[nodiscard]] bool isEnabled() const noexcept {
+            return (flags & 1) != 0;
+        }
+    };
+
+    static_assert(sizeof(SratProcessorAffinity) == 16);
+
+    /// The domain of a range of physical memory.
+    struct [[gnu::packed]] SratMemoryAffinity : AcpiSubtable {
+        static constexpr uint8_t subtable_type = 1;
+
+        uint32_t proximity_domain;
+        uint16_t reserved1;
+        uint64_t base_address;
+        uint64_t size;
+        uint32_t reserved2;
+        uint32_t flags;
+        uint64_t reserved3;
+
+        [[nodiscard]] bool isEnabled() const noexcept {
+            return (flags & 1) != 0;
+        }
+
+        /// The range is not necessarily populated yet.
+        [[nodiscard]] bool isHotPluggable() const noexcept {
+            return (flags & 2) != 0;
+        }
+
+        [[nodiscard]] bool isNonVolatile() const noexcept {
+            return (flags & 4) != 0;
+        }
+    };
+
+    static_assert(sizeof(SratMemoryAffinity) == 40);
+
+    /// The domain of a processor, identified by its x2APIC ID (x86).
+    struct [[gnu::packed]] SratX2ApicAffinity : AcpiSubtable {
+        static constexpr uint8_t subtable_type = 2;
+
+        uint16_t reserved1;
+        uint32_t proximity_domain;
+        uint32_t x2apic_id;
+        uint32_t flags;
+        uint32_t clock_domain;
+        uint32_t reserved2;
+
+        [[nodiscard]] bool isEnabled() const noexcept {
+            return (flags & 1) != 0;
+        }
+    };
+
+    static_assert(sizeof(SratX2ApicAffinity) == 24);
+
+    /// The domain of a processor, identified by the UID of its MadtGicc (AArch64).
+    struct [[gnu::packed]] SratGiccAffinity : AcpiSubtable {
+        static constexpr uint8_t subtable_type = 3;
+
+        uint32_t proximity_domain;
+        uint32_t acpi_processor_uid;
+        uint32_t flags;
+        uint32_t clock_domain;
+
+        [[nodiscard]] bool isEnabled() const noexcept {
+            return (flags & 1) != 0;
+        }
+    };
+
+    static_assert(sizeof(SratGiccAffinity) == 18);
+
+    /// System Locality Information Table: the relative distances between proximity domains.
+    struct [[gnu::packed]] AcpiSlit {
+        static constexpr uint32_t expected_signature = makeAcpiSignature("SLIT");
+
+        /// The distance of a domain to itself. The other distances are relative to it: 20 is twice as far.
+        static constexpr uint8_t local_distance = 10;
+        static constexpr uint8_t unreachable = 0xFF;
+
+        AcpiTableHeader header;
+        uint64_t locality_count;
+
+        /// @return unreachable A domain is not in the table, or the matrix is longer than the table.
+        [[nodiscard]] uint8_t getDistance(uint32_t from, uint32_t to) const noexcept {
+            const auto count = locality_count;
+            const uint64_t matrix_size = header.length > sizeof(AcpiSlit) ? header.length - sizeof(AcpiSlit) : 0;
+
+            // Divides rather than squaring the count, which can overflow.
+            if (from >= count || to >= count || count > matrix_size / count)
+                return unreachable;
+
+            return reinterpret_cast<const uint8_t*>(this + 1)[(from * count) + to];
+        }
+    };
+
+    static_assert(sizeof(AcpiSlit) == 44);
+
+    /// Fixed ACPI Description Table. Only the fields locating the DSDT are declared.
+    struct [[gnu::packed]] AcpiFadt {
+        static constexpr uint32_t expected_signature = makeAcpiSignature("FACP");
+
+        /// Offsets of the DSDT addresses: the 32-bit one of ACPI 1.0, and the 64-bit one which replaces it.
+        static constexpr size_t dsdt_offset = 40;
+        static constexpr size_t x_dsdt_offset = 140;
+
+        AcpiTableHeader header;
+    };
+
+    /// A window of PCI Express configuration space (ECAM), in which every function of a range of buses has 4 KiB of
+    /// memory-mapped registers.
+    struct [[gnu::packed]] McfgAllocation {
+        /// The address of the registers of bus 0, even if start_bus is higher.
+        uint64_t base_address;
+        uint16_t segment;
+        uint8_t start_bus;
+        uint8_t end_bus;
+        uint32_t reserved;
+    };
+
+    static_assert(sizeof(McfgAllocation) == 16);
+
+    /// PCI Express memory mapped configuration space base address description table.
+    /// See the PCI Firmware Specification 3.3, section 4.1.2.
+    struct [[gnu::packed]] AcpiMcfg {
+        static constexpr uint32_t expected_signature = makeAcpiSignature("MCFG");
+
+        AcpiTableHeader header;
+        uint64_t reserved;
+
+        [[nodiscard]] size_t getAllocationCount() const noexcept {
+            return (header.length - sizeof(AcpiMcfg)) / sizeof(McfgAllocation);
+        }
+
+        [[nodiscard]] const McfgAllocation& getAllocation(size_t index) const noexcept {
+            return reinterpret_cast<const McfgAllocation*>(this + 1)[index];
+        }
+    };
+
+    static_assert(sizeof(AcpiMcfg) == 44);
+
+    /// Validates the tables the firmware lists in the XSDT (or the RSDT on ACPI 1.0) once, and keeps an index of
+    /// their signatures, so that finding a table is a scan of a small array. The tables are not copied.
+    /// @code
+    /// AcpiTables tables;
+    /// if (tables.initialize(system_table.findConfigurationTable(acpi2_guid)) == Status::Success)
+    ///     if (const auto* madt = tables.find<AcpiMadt>())
+    ///         ...
+    /// @endcode
+    class AcpiTables {
+    public:
+        /// Tables beyond this are ignored.
+        static constexpr size_t max_table_count = 64;
+
+        /// @param rsdp What the firmware installed as acpi2_guid, or acpi1_guid on old firmware.
+        /// @return InvalidParameter `rsdp` is nullptr.
+        /// @return CrcError The RSDP or the XSDT has a wrong signature or checksum.
+        /// @return OutOfResources The firmware lists more than max_table_count tables. The first ones are indexed.
+        Status initialize(const void* rsdp) noexcept {
+            _count = 0;
+
+            if (rsdp == nullptr)
+                return Status::InvalidParameter;
+
+            const auto& pointer = *static_cast<const AcpiRsdp*>(rsdp);
+            if (pointer.signature != AcpiRsdp::expected_signature || Detail::sumBytes(&pointer, 20) != 0)
+                return Status::CrcError;
+
+            // ACPI 2.0 replaced the RSDT by the XSDT, whose entries are 64-bit.
+            const bool extended = pointer.revision >= 2 && pointer.length >= sizeof(AcpiRsdp) && pointer.xsdt_address != 0 &&
+                Detail::sumBytes(&pointer, sizeof(AcpiRsdp)) == 0;
+
+            const auto* root = _toTable(extended ? pointer.xsdt_address : pointer.rsdt_address);
+            const auto expected_signature = extended ? makeAcpiSignature("XSDT") : makeAcpiSignature("RSDT");
+            if (root == nullptr || root->signature != expected_signature || !_isValid(*root))
+                return Status::CrcError;
+
+            const auto entry_size = extended ? sizeof(uint64_t) : sizeof(uint32_t);
+            const auto entry_count = (root->length - sizeof(AcpiTableHeader)) / entry_size;
+            const auto* entries = reinterpret_cast<const uint8_t*>(root + 1);
+            auto status = Status::Success;
+
+            for (size_t i = 0; i < entry_count; ++i) {
+                // The entries of the XSDT are 64-bit, but only 4-byte aligned.
+                uint64_t address = 0;
+                Detail::copyBytes(&address, entries + (i * entry_size), entry_size);
+
+                status = _add(_toTable(address));
+                if (status != Status::Success)
+                    return status;
+            }
+
+            // The DSDT is not listed, only pointed to by the FADT.
+            if (const auto* fadt = find(AcpiFadt::expected_signature))
+                status = _add(_toTable(_getDsdtAddress(*fadt)));
+
+            return status;
+        }
+
+        /// @param instance Which one of the tables with this signature, in the firmware's order. Some, like SSDT, are
+        /// usually present more than once.
+        /// @return nullptr There is no such table.
+        [[nodiscard]] const AcpiTableHeader* find(uint32_t signature, size_t instance = 0) const noexcept {
+            for (size_t i = 0; i < _count; ++i) {
+                if (_signatures[i] == signature && instance-- == 0)
+                    return _tables[i];
+            }
+
+            return nullptr;
+        }
+
+        /// Finds a table by the expected_signature of T, e.g. AcpiMadt.
+        /// @return nullptr There is no such table, or it is too short to hold the fixed fields of T.
+        template <typename T>
+        [[nodiscard]] const T* find(size_t instance = 0) const noexcept {
+            const auto* header = find(T::expected_signature, instance);
+            if (header == nullptr || header->length < sizeof(T))
+                return nullptr;
+
+            return reinterpret_cast<const T*>(header);
+        }
+
+        /// Number of valid tables, DSDT included.
+        [[nodiscard]] size_t getTableCount() const noexcept {
+            return _count;
+        }
+
+        [[nodiscard]] const AcpiTableHeader& getTable(size_t index) const noexcept {
+            return *_tables[index];
+        }
+
+    private:
+        static const AcpiTableHeader* _toTable(uint64_t address) noexcept {
+            return reinterpret_cast<const AcpiTableHeader*>(static_cast<uintptr_t>(address));
+        }
+
+        static bool _isValid(const AcpiTableHeader& table) noexcept {
+            return table.length >= sizeof(AcpiTableHeader) && Detail::sumBytes(&table, table.length) == 0;
+        }
+
+        static uint64_t _getDsdtAddress(const AcpiTableHeader& fadt) noexcept {
+            const auto* bytes = reinterpret_cast<const uint8_t*>(&fadt);
+            uint64_t address = 0;
+
+            if (fadt.length >= AcpiFadt::x_dsdt_offset + sizeof(uint64_t))
+                Detail::copyBytes(&address, bytes + AcpiFadt::x_dsdt_offset, sizeof(uint64_t));
+
+            if (address == 0 && fadt.length >= AcpiFadt::dsdt_offset + sizeof(uint32_t))
+                Detail::copyBytes(&address, bytes + AcpiFadt::dsdt_offset, sizeof(uint32_t));
+
+            return address;
+        }
+
+        /// Indexes a table, unless it is missing or corrupted.
+        Status _add(const AcpiTableHeader* table) noexcept {
+            if (table == nullptr || !_isValid(*table))
+                return Status::Success;
+
+            if (_count == max_table_count)
+                return Status::OutOfResources;
+
+            _signatures[_count] = table->signature;
+            _tables[_count] = table;
+            ++_count;
+            return Status::Success;
+        }
+
+        /// Kept apart from the pointers, so that a lookup scans a single cache line or two.
+        uint32_t _signatures[max_table_count];
+        const AcpiTableHeader* _tables[max_table_count];
+        size_t _count;
+    };
+} // namespace Uefi
@@ -0,0 +1,342 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "detail/hash.h"
+#include "format.h"
+#include "memory_type.h"
+#include "status.h"
+
+namespace Uefi {
+    /// Where an allocation was made. As a defaulted parameter, current() captures the caller's file and line.
+    struct AllocationSite {
+        const char* file;
+        uint32_t line;
+
+        static constexpr AllocationSite current(const char* file = __builtin_FILE(), uint32_t line = __builtin_LINE()) noexcept {
+            return {file, line};
+        }
+    };
+
+    /// The allocations of a memory type or a call site.
+    struct AllocationStats {
+        uint64_t live_bytes;
+        /// The highest live_bytes has been.
+        uint64_t peak_bytes;
+        uint64_t live_count;
+        uint64_t total_count;
+    };
+
+    /// Accounts for the memory allocated through BootServices, per memory type and per call site, to find what makes
+    /// boot memory grow and which pool allocations leak.
+    /// Defining UEFI_ALLOCATION_PROFILER before including the library makes allocatePool(), freePool(),
+    /// allocatePages() and freePages() capture their call site and report to the installed profiler. Without it,
+    /// they are unchanged and nothing of this is compiled in. Other allocators can call recordAllocation() and
+    /// recordFree() themselves.
+    /// Everything is kept in fixed tables, so tracking never allocates. Allocations which do not fit, and those made
+    /// by an event callback while another is being recorded, are counted as missed.
+    /// @code
+    /// static AllocationProfiler profiler;
+    /// static uint8_t profiler_memory[AllocationProfiler::getRequiredSize(4096)];
+    /// profiler.initialize(profiler_memory, sizeof(profiler_memory));
+    /// profiler.install();
+    /// ...
+    /// // Before the last getMemoryMap(), since printing may allocate.
+    /// profiler.report(*system_table.console_out);
+    /// @endcode
+    class AllocationProfiler {
+    public:
+        /// Call sites tracked separately. The others are accounted together.
+        static constexpr size_t max_site_count = 128;
+        /// Allocation sizes are counted in power-of-two buckets: bucket n holds the sizes of n bits.
+        static constexpr size_t histogram_size = 65;
+
+        struct Site {
+            AllocationSite site;
+            AllocationStats stats;
+        };
+
+        /// The memory initialize() needs to track `allocation_count` live allocations, a power of two. Keep it at
+        /// twice the live allocations expected, so that lookups stay short.
+        static constexpr size_t getRequiredSize(size_t allocation_count) noexcept {
+            return allocation_count * sizeof(Allocation);
+        }
+
+        /// Lays out the table of live allocations in `memory`, 8-byte aligned, and clears the statistics.
+        /// @return BufferTooSmall `memory` holds less than 2 allocations.
+        Status initialize(void* memory, size_t size) noexcept {
+            size_t count = 2;
+            if (size < count * sizeof(Allocation))
+                return Status::BufferTooSmall;
+
+            while (count * 2 * sizeof(Allocation) <= size)
+                count *= 2;
+
+            _allocations = static_cast<Allocation*>(memory);
+            _mask = count - 1;
+            _liveCount = 0;
+
+            for (size_t i = 0; i < count; ++i)
+                _allocations[i].address = 0;
+
+            for (auto& stats : _types)
+                stats = {};
+
+            for (auto& bucket : _histogram)
+                bucket = 0;
+
+            _siteCount = 0;
+            _otherSites = {};
+            _untrackedFrees = 0;
+            _missed = 0;
+            _busy = false;
+            return Status::Success;
+        }
+
+        /// Makes the BootServices wrappers report to this profiler, when UEFI_ALLOCATION_PROFILER is defined.
+        void install() noexcept;
+
+        void uninstall() noexcept;
+
+        /// Accounts for `size` bytes allocated at `address`.
+        void recordAllocation(uint64_t address, uint64_t size, MemoryType type, AllocationSite site) noexcept {
+            if (address == 0 || __atomic_exchange_n(&_busy, true, __ATOMIC_ACQUIRE)) {
+                ++_missed;
+                return;
+            }
+
+            // Keeps a quarter of the table free, so that probing ends quickly.
+            if (_liveCount * 4 >= (_mask + 1) * 3) {
+                ++_missed;
+            } else {
+                auto index = Detail::mixBits(address) & _mask;
+                while (_allocations[index].address != 0)
+                    index = (index + 1) & _mask;
+
+                const auto site_index = _findSite(site);
+                const auto type_index = _getTypeIndex(type);
+
+                _allocations[index] = {address, size, static_cast<uint16_t>(site_index), static_cast<uint16_t>(type_index), {}};
+                ++_liveCount;
+
+                _add(_types[type_index], size);
+                _add(site_index < max_site_count ? _sites[site_index].stats : _otherSites, size);
+
+                size_t bucket = 0;
+                for (auto rest = size; rest != 0; rest >>= 1)
+                    ++bucket;
+
+                ++_histogram[bucket];
+            }
+
+            __atomic_store_n(&_busy, false, __ATOMIC_RELEASE);
+        }
+
+        /// Accounts for freeing the allocation at `address`. Freeing part of it frees all of it.
+        void recordFree(uint64_t address) noexcept {
+            if (__atomic_exchange_n(&_busy, true, __ATOMIC_ACQUIRE)) {
+                ++_missed;
+                return;
+            }
+
+            auto index = Detail::mixBits(address) & _mask;
+            while (_allocations[index].address != address && _allocations[index].address != 0)
+                index = (index + 1) & _mask;
+
+            if (address == 0 || _allocations[index].address == 0) {
+                // Allocated by the firmware, like the buffer of locateHandleBuffer(), or before install().
+                ++_untrackedFrees;
+            } else {
+                const auto& allocation = _allocations[index];
+                _remove(_types[allocation.type_index], allocation.size);
+                _remove(allocation.site_index < max_site_count ? _sites[allocation.site_index].stats : _otherSites, allocation.size);
+                _erase(index);
+                --_liveCount;
+            }
+
+            __atomic_store_n(&_busy, false, __ATOMIC_RELEASE);
+        }
+
+        /// The allocations of a type. The OEM and OS loader types are accounted together, as MaxMemoryType.
+        [[nodiscard]] const AllocationStats& getTypeStats(MemoryType type) const noexcept {
+            return _types[_getTypeIndex(type)];
+        }
+
+        [[nodiscard]] size_t getSiteCount() const noexcept {
+            return _siteCount;
+        }
+
+        /// The call sites, in the order of their first allocation.
+        [[nodiscard]] const Site& getSite(size_t index) const noexcept {
+            return _sites[index];
+        }
+
+        /// The allocations of the sites past max_site_count.
+        [[nodiscard]] const AllocationStats& getOtherSiteStats() const noexcept {
+            return _otherSites;
+        }
+
+        /// The number of allocations of `bits`-bit sizes, from 2^(bits - 1) to 2^bits - 1 bytes.
+        [[nodiscard]] uint64_t getHistogramCount(size_t bits) const noexcept {
+            return _histogram[bits];
+        }
+
+        /// Frees of memory which was not recorded.
+        [[nodiscard]] uint64_t getUntrackedFreeCount() const noexcept {
+            return _untrackedFrees;
+        }
+
+        /// Allocations and frees which could not be recorded.
+        [[nodiscard]] uint64_t getMissedCount() const noexcept {
+            return _missed;
+        }
+
+        /// Prints the memory types in use, the call sites which still have live allocations, and the histogram.
+        /// Call it before the last getMemoryMap() of exitBootServices(), since printing may allocate.
+        template <typename Output>
+        Status report(Output& output) const noexcept {
+            static constexpr const char16_t* type_names[] = {
+                u"Reserved", u"LoaderCode", u"LoaderData", u"BootServicesCode", u"BootServicesData",
+                u"RuntimeServicesCode", u"RuntimeServicesData", u"Conventional", u"Unusable", u"ACPIReclaim",
+                u"ACPINVS", u"MMIO", u"MMIOPortSpace", u"PalCode", u"Persistent", u"Other"};
+
+            print(output, UEFI_FORMAT("Memory type          live bytes  peak bytes  live count  total count\r\n"));
+            for (size_t i = 0; i < type_count; ++i) {
+                const auto& stats = _types[i];
+                if (stats.total_count != 0)
+                    print(output, UEFI_FORMAT("{:19} {:11} {:11} {:11} {:12}\r\n"), type_names[i], stats.live_bytes,
+                          stats.peak_bytes, stats.live_count, stats.total_count);
+            }
+
+            print(output, UEFI_FORMAT("Live allocations by call site:\r\n"));
+            for (size_t i = 0; i < _siteCount; ++i) {
+                const auto& site = _sites[i];
+                if (site.stats.live_count != 0)
+                    print(output, UEFI_FORMAT("  {}:{}: {} bytes in {} of {} allocations, peak {} bytes\r\n"),
+                          site.site.file, site.site.line, site.stats.live_bytes, site.stats.live_count,
+                          site.stats.total_count, site.stats.peak_bytes);
+            }
+
+            if (_otherSites.live_count != 0)
+                print(output, UEFI_FORMAT("  Other sites: {} bytes in {} allocations\r\n"), _otherSites.live_bytes,
+                      _otherSites.live_count);
+
+            print(output, UEFI_FORMAT("Allocation sizes:\r\n"));
+            for (size_t bits = 0; bits < histogram_size; ++bits) {
+                if (_histogram[bits] != 0)
+                    print(output, UEFI_FORMAT("  < 2^{:2}: {}\r\n"), bits, _histogram[bits]);
+            }
+
+            return print(output, UEFI_FORMAT("{} untracked frees, {} missed\r\n"), _untrackedFrees, _missed);
+        }
+
+    private:
+        static constexpr size_t type_count = static_cast<size_t>(MemoryType::MaxMemoryType) + 1;
+
+        struct Allocation {
+            /// 0 for a free slot.
+            uint64_t address;
+            uint64_t size;
+            uint16_t site_index;
+            uint16_t type_index;
+            uint32_t _reserved;
+        };
+
+        static size_t _getTypeIndex(MemoryType type) noexcept {
+            const auto index = static_cast<size_t>(type);
+            return index < type_count ? index : type_count - 1;
+        }
+
+        static void _add(AllocationStats& stats, uint64_t size) noexcept {
+            stats.live_bytes += size;
+            ++stats.live_count;
+            ++stats.total_count;
+            if (stats.live_bytes > stats.peak_bytes)
+                stats.peak_bytes = stats.live_bytes;
+        }
+
+        static void _remove(AllocationStats& stats, uint64_t size) noexcept {
+            stats.live_bytes -= size;
+            --stats.live_count;
+        }
+
+        static bool _isSameFile(const char* a, const char* b) noexcept {
+            // The same header seen from several translation units may have several copies of its name.
+            if (a == b)
+                return true;
+
+            for (; *a != 0 && *a == *b; ++a, ++b) {
+            }
+
+            return *a == *b;
+        }
+
+        /// The index of a site, adding it if it is new, or max_site_count if the table is full.
+        size_t _findSite(const AllocationSite& site) noexcept {
+            for (size_t i = 0; i < _siteCount; ++i) {
+                if (_sites[i].site.line == site.line && _isSameFile(_sites[i].site.file, site.file))
+                    return i;
+            }
+
+            if (_siteCount == max_site_count)
+                return max_site_count;
+
+            _sites[_siteCount] = {site, {}};
+            return _siteCount++;
+        }
+
+        /// Frees a slot, moving back the entries after it which probed past it, so that no lookup ends early.
+        void _erase(size_t index) noexcept {
+            for (auto next = (index + 1) & _mask; _allocations[next].address != 0; next = (next + 1) & _mask) {
+                const auto home = Detail::mixBits(_allocations[next].address) & _mask;
+                // Whether `home` is cyclically outside (index, next]: then the entry may move to `index`.
+                if (((next - home) & _mask) >= ((next - index) & _mask)) {
+                    _allocations[index] = _allocations[next];
+                    index = next;
+                }
+            }
+
+            _allocations[index].address = 0;
+        }
+
+        Allocation* _allocations;
+        size_t _mask;
+        size_t _liveCount;
+
+        AllocationStats _types[type_count];
+        Site _sites[max_site_count];
+        size_t _siteCount;
+        AllocationStats _otherSites;
+        uint64_t _histogram[histogram_size];
+
+        uint64_t _untrackedFrees;
+        uint64_t _missed;
+        bool _busy;
+    };
+
+    namespace Detail {
+        /// The profiler the BootServices wrappers report to.
+        inline AllocationProfiler* allocation_profiler = nullptr;
+
+        inline void recordAllocation(uint64_t address, uint64_t size, MemoryType type, AllocationSite site) noexcept {
+            if (allocation_profiler != nullptr)
+                allocation_profiler->recordAllocation(address, size, type, site);
+        }
+
+        inline void recordFree(uint64_t address) noexcept {
+            if (allocation_profiler != nullptr)
+                allocation_profiler->recordFree(address);
+        }
+    } // namespace Detail
+
+    inline void AllocationProfiler::install() noexcept {
+        Detail::allocation_profiler = this;
+    }
+
+    inline void AllocationProfiler::uninstall() noexcept {
+        if (Detail::allocation_profiler == this)
+            Detail::allocation_profiler = nullptr;
+    }
+} // namespace Uefi
+
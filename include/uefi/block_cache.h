@@ -0,0 +1,577 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "block_io_protocol.h"
+#include "boot_services.h"
+#include "detail/memory.h"
+#include "non_copyable.h"
+
+namespace Uefi {
+    /// A write-through block cache on top of BlockIoProtocol.
+    /// - Blocks are kept in a least-recently-used cache, indexed by LBA.
+    /// - Adjacent missing blocks of a request are fetched with a single device read (up to max_transfer blocks).
+    ///   When the misses are sequential, the blocks after the request are fetched with them.
+    /// - When reads are sequential, the following read_ahead blocks are fetched as well.
+    ///   If BlockIo2Protocol is available, this happens asynchronously, while the caller processes the current data.
+    /// - Reads of at least max_transfer blocks which are not cached go straight to the caller's buffer,
+    ///   so that big file-like reads don't evict the small, frequently used metadata blocks.
+    ///
+    /// The cache doesn't allocate anything: all of its memory is given to initialize().
+    class BlockCache : private NonCopyable {
+    public:
+        struct Configuration {
+            /// Number of blocks kept in the cache. Must be at least max_transfer + read_ahead.
+            size_t capacity;
+            /// Largest number of blocks fetched from the device at once when filling the cache.
+            size_t max_transfer;
+            /// Number of blocks fetched ahead of sequential reads. 0 disables read-ahead.
+            size_t read_ahead;
+        };
+
+        struct Statistics {
+            /// Blocks found in the cache.
+            uint64_t hits;
+            /// Blocks which had to be fetched from the device.
+            uint64_t misses;
+            /// Number of read requests sent to the device, and the number of blocks they transferred.
+            uint64_t device_reads, device_blocks;
+            /// Blocks fetched by asynchronous read-ahead.
+            uint64_t prefetched_blocks;
+        };
+
+        /// @return The number of bytes of storage needed by initialize().
+        static size_t getStorageSize(uint32_t block_size, const Configuration& config) noexcept {
+            return Layout{block_size, config}.total;
+        }
+
+        /// Prepares the cache.
+        /// @param storage At least getStorageSize() bytes, aligned to the device's io_align.
+        /// Memory from allocatePages() is always suitably aligned.
+        /// @param block_io2 If not nullptr, read-ahead is done asynchronously through this protocol (on the same handle).
+        /// @param boot_services Needed for asynchronous read-ahead, to create and wait for events.
+        /// @return Success The cache is ready.
+        /// @return NoMedia There is no medium in the device.
+        /// @return InvalidParameter The configuration is invalid, or the storage is not aligned.
+        Status initialize(BlockIoProtocol& block_io, void* storage, const Configuration& config,
+            BlockIo2Protocol* block_io2 = nullptr, BootServices* boot_services = nullptr) {
+            const auto& media = *block_io.media;
+
+            if (!media.media_present)
+                return Status::NoMedia;
+
+            if (config.capacity < config.max_transfer + config.read_ahead || config.max_transfer == 0 || config.capacity >= none)
+                return Status::InvalidParameter;
+
+            if (media.io_align > 1 && reinterpret_cast<uintptr_t>(storage) % media.io_align != 0)
+                return Status::InvalidParameter;
+
+            _blockIo = &block_io;
+            _blockIo2 = nullptr;
+            _bootServices = boot_services;
+            _mediaId = media.media_id;
+            _blockSize = media.block_size;
+            _layoutBlockSize = media.block_size;
+            _ioAlign = media.io_align;
+            _lastBlock = media.last_block;
+            _config = config;
+            _statistics = {};
+            _nextSequential = none_lba;
+            _nextMiss = none_lba;
+            _prefetchPending = false;
+
+            const Layout layout{_blockSize, config};
+            auto* bytes = static_cast<uint8_t*>(storage);
+
+            _data = bytes;
+            _staging = bytes + layout.staging;
+            _prefetchBuffer = bytes + layout.prefetch;
+            _slots = reinterpret_cast<Slot*>(bytes + layout.slots);
+            _buckets = reinterpret_cast<uint32_t*>(bytes + layout.buckets);
+            _bucketMask = layout.bucket_count - 1;
+
+            invalidate();
+
+            if (block_io2 != nullptr && boot_services != nullptr && config.read_ahead != 0) {
+                const auto status = boot_services->createEvent(EventType::None, Tpl::Callback, nullptr, nullptr, _prefetchEvent);
+                if (status == Status::Success)
+                    _blockIo2 = block_io2;
+            }
+
+            return Status::Success;
+        }
+
+        /// Waits for pending asynchronous reads and releases the event used for them.
+        /// The storage can be freed afterwards.
+        void shutdown() {
+            if (_blockIo2 == nullptr)
+                return;
+
+            _waitPrefetch(false);
+            _bootServices->closeEvent(_prefetchEvent);
+            _blockIo2 = nullptr;
+        }
+
+        /// Drops every cached block.
+        void invalidate() {
+            for (uint32_t i = 0; i <= _bucketMask; ++i)
+                _buckets[i] = none;
+
+            // All the slots are free, linked in LRU order.
+            for (uint32_t i = 0; i < _config.capacity; ++i)
+                _slots[i] = {none_lba, i == 0 ? none : i - 1, i + 1 == _config.capacity ? none : i + 1, none};
+
+            _head = 0;
+            _tail = static_cast<uint32_t>(_config.capacity - 1);
+        }
+
+        [[nodiscard]] uint32_t getBlockSize() const noexcept {
+            return _blockSize;
+        }
+
+        [[nodiscard]] const Statistics& getStatistics() const noexcept {
+            return _statistics;
+        }
+
+        /// Reads whole blocks. Unlike BlockIoProtocol::readBlocks(), the buffer doesn't need to be aligned.
+        /// @return Success The data was read.
+        /// @return InvalidParameter The request goes past the end of the device.
+        /// @return MediaChanged The medium was changed. The cache has been emptied, and uses the new medium's geometry.
+        /// @return Unsupported The new medium has bigger blocks, or a stricter alignment, than the storage was laid out for.
+        /// @return DeviceError The device reported an error.
+        Status readBlocks(Lba lba, size_t count, void* buffer) {
+            if (count == 0)
+                return Status::Success;
+
+            if (lba > _lastBlock || count - 1 > _lastBlock - lba)
+                return Status::InvalidParameter;
+
+            _pollPrefetch();
+
+            const auto end = lba + count;
+            const auto sequential = lba == _nextSequential;
+            _nextSequential = end;
+
+            auto* out = static_cast<uint8_t*>(buffer);
+
+            // Blocks before this one were just fetched from the device, so they are not counted as hits.
+            Lba fetched_end = 0;
+
+            for (auto i = lba; i < end;) {
+                if (_isPrefetching(i))
+                    _waitPrefetch(true);
+
+                const auto slot = _find(i);
+
+                if (slot != none) {
+                    if (i >= fetched_end)
+                        ++_statistics.hits;
+
+                    _touch(slot);
+                    Detail::copyBytes(out, _blockData(slot), _blockSize);
+                    out += _blockSize;
+                    ++i;
+                    continue;
+                }
+
+                const auto remaining = end - i;
+
+                if (remaining >= _config.max_transfer && _isAligned(out)) {
+                    // Big reads bypass the cache.
+                    const auto run = _missingRun(i, end, remaining);
+                    const auto status = _deviceRead(i, run, out);
+                    if (status != Status::Success)
+                        return status;
+
+                    _statistics.misses += run;
+                    out += run * _blockSize;
+                    i += run;
+                    continue;
+                }
+
+                const auto run = _missingRun(i, end, _config.max_transfer);
+                _statistics.misses += run;
+
+                // Fetch the next blocks as well if the reads are sequential and there's no asynchronous read-ahead.
+                auto fetch = run;
+                if (sequential && _blockIo2 == nullptr && i + run == end) {
+                    fetch += _config.read_ahead;
+                    fetch = fetch > _config.max_transfer ? _config.max_transfer : fetch;
+                    fetch = fetch > _lastBlock - i + 1 ? _lastBlock - i + 1 : fetch;
+                }
+
+                const auto status = _fill(i, fetch);
+                if (status != Status::Success)
+                    return status;
+
+                // The blocks are all in the cache now, and are going to be copied by the next iterations.
+                fetched_end = i + run;
+            }
+
+            if (sequential)
+                _startPrefetch(end);
+
+            return Status::Success;
+        }
+
+        /// Reads bytes at any offset, like DiskIoProtocol::readDisk().
+        /// @see readBlocks() for the return values.
+        Status read(uint64_t offset, size_t size, void* buffer) {
+            auto* out = static_cast<uint8_t*>(buffer);
+
+            while (size != 0) {
+                const auto lba = offset / _blockSize;
+                const auto in_block = static_cast<size_t>(offset % _blockSize);
+
+                // Whole blocks in the middle of the request.
+                if (in_block == 0 && size >= _blockSize) {
+                    const auto blocks = size / _blockSize;
+                    const auto status = readBlocks(lba, blocks, out);
+                    if (status != Status::Success)
+                        return status;
+
+                    const auto bytes = blocks * _blockSize;
+                    out += bytes;
+                    offset += bytes;
+                    size -= bytes;
+                    continue;
+                }
+
+                // Partial first or last block.
+                const uint8_t* block = nullptr;
+                const auto status = _getBlock(lba, (offset + size + _blockSize - 1) / _blockSize, block);
+                if (status != Status::Success)
+                    return status;
+
+                const auto chunk = (_blockSize - in_block) < size ? (_blockSize - in_block) : size;
+                Detail::copyBytes(out, block + in_block, chunk);
+
+                out += chunk;
+                offset += chunk;
+                size -= chunk;
+            }
+
+            return Status::Success;
+        }
+
+        /// Writes whole blocks to the device, and updates the cached copies.
+        /// @param buffer Must be aligned to the device's io_align.
+        Status writeBlocks(Lba lba, size_t count, const void* buffer) {
+            if (count == 0)
+                return Status::Success;
+
+            // Don't let a pending read-ahead bring back old data afterwards.
+            _waitPrefetch(true);
+
+            const auto status = _blockIo->writeBlocks(_mediaId, lba, count * _blockSize, buffer);
+            if (status != Status::Success)
+                return _checkMedia(status);
+
+            const auto* in = static_cast<const uint8_t*>(buffer);
+
+            for (size_t i = 0; i < count; ++i, in += _blockSize) {
+                const auto slot = _find(lba + i);
+                if (slot != none)
+                    Detail::copyBytes(_blockData(slot), in, _blockSize);
+            }
+
+            return Status::Success;
+        }
+
+    private:
+        static constexpr uint32_t none = 0xFFFFFFFF;
+        static constexpr Lba none_lba = ~Lba{0};
+
+        struct Slot {
+            Lba lba;
+            /// Neighbours in the LRU list. The head is the most recently used block.
+            uint32_t previous, next;
+            /// Next slot in the same hash bucket.
+            uint32_t hash_next;
+        };
+
+        /// Where everything is placed inside the storage.
+        struct Layout {
+            Layout(uint32_t block_size, const Configuration& config) {
+                staging = config.capacity * block_size;
+                prefetch = staging + (config.max_transfer * block_size);
+                slots = _alignUp(prefetch + (config.read_ahead * block_size), alignof(Slot));
+                buckets = slots + (config.capacity * sizeof(Slot));
+
+                // Keep the buckets at most half full.
+                bucket_count = 1;
+                while (bucket_count < 2 * config.capacity)
+                    bucket_count *= 2;
+
+                total = buckets + (bucket_count * sizeof(uint32_t));
+            }
+
+            size_t staging, prefetch, slots, buckets, bucket_count, total;
+        };
+
+        static size_t _alignUp(size_t value, size_t alignment) noexcept {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        [[nodiscard]] bool _isAligned(const void* buffer) const noexcept {
+            return _ioAlign <= 1 || reinterpret_cast<uintptr_t>(buffer) % _ioAlign == 0;
+        }
+
+        [[nodiscard]] uint8_t* _blockData(uint32_t slot) const noexcept {
+            return _data + (static_cast<size_t>(slot) * _blockSize);
+        }
+
+        [[nodiscard]] uint32_t _bucket(Lba lba) const noexcept {
+            // Fibonacci hashing, so that consecutive LBAs end up in different buckets.
+            return static_cast<uint32_t>((lba * 0x9E3779B97F4A7C15ULL) >> 32) & _bucketMask;
+        }
+
+        [[nodiscard]] uint32_t _find(Lba lba) const noexcept {
+            for (auto slot = _buckets[_bucket(lba)]; slot != none; slot = _slots[slot].hash_next)
+                if (_slots[slot].lba == lba)
+                    return slot;
+
+            return none;
+        }
+
+        void _unlinkLru(uint32_t slot) noexcept {
+            auto& s = _slots[slot];
+
+            if (s.previous != none)
+                _slots[s.previous].next = s.next;
+            else
+                _head = s.next;
+
+            if (s.next != none)
+                _slots[s.next].previous = s.previous;
+            else
+                _tail = s.previous;
+        }
+
+        /// Marks a slot as the most recently used one.
+        void _touch(uint32_t slot) noexcept {
+            if (slot == _head)
+                return;
+
+            _unlinkLru(slot);
+
+            _slots[slot].previous = none;
+            _slots[slot].next = _head;
+            _slots[_head].previous = slot;
+            _head = slot;
+        }
+
+        void _unlinkHash(uint32_t slot) noexcept {
+            auto* link = &_buckets[_bucket(_slots[slot].lba)];
+
+            while (*link != slot)
+                link = &_slots[*link].hash_next;
+
+            *link = _slots[slot].hash_next;
+        }
+
+        /// Puts a copy of a block in the cache, evicting the least recently used block if needed.
+        void _insert(Lba lba, const uint8_t* data) noexcept {
+            auto slot = _find(lba);
+
+            if (slot == none) {
+                slot = _tail;
+
+                if (_slots[slot].lba != none_lba)
+                    _unlinkHash(slot);
+
+                auto& bucket = _buckets[_bucket(lba)];
+                _slots[slot].lba = lba;
+                _slots[slot].hash_next = bucket;
+                bucket = slot;
+            }
+
+            _touch(slot);
+            Detail::copyBytes(_blockData(slot), data, _blockSize);
+        }
+
+        /// @return How many blocks starting at `lba` (and before `end`, at most `limit`) are neither cached nor being prefetched.
+        [[nodiscard]] size_t _missingRun(Lba lba, Lba end, size_t limit) const noexcept {
+            size_t run = 1;
+
+            while (run < limit && lba + run < end && _find(lba + run) == none && !_isPrefetching(lba + run))
+                ++run;
+
+            return run;
+        }
+
+        /// Empties the cache when the medium was changed, and takes the new medium's geometry. A medium which doesn't
+        /// fit the storage keeps the old media ID, so that every request fails until it is changed again.
+        Status _checkMedia(Status status) {
+            if (status != Status::MediaChanged && status != Status::NoMedia)
+                return status;
+
+            // A pending read-ahead brings back blocks of the old medium.
+            _waitPrefetch(false);
+            invalidate();
+            _nextSequential = none_lba;
+            _nextMiss = none_lba;
+
+            const auto& media = *_blockIo->media;
+            if (!media.media_present)
+                return status;
+
+            if (media.block_size == 0 || media.block_size > _layoutBlockSize)
+                return Status::Unsupported;
+
+            if (media.io_align > 1 && reinterpret_cast<uintptr_t>(_data) % media.io_align != 0)
+                return Status::Unsupported;
+
+            _mediaId = media.media_id;
+            _blockSize = media.block_size;
+            _ioAlign = media.io_align;
+            _lastBlock = media.last_block;
+            return status;
+        }
+
+        Status _deviceRead(Lba lba, size_t count, void* buffer) {
+            ++_statistics.device_reads;
+            _statistics.device_blocks += count;
+
+            return _checkMedia(_blockIo->readBlocks(_mediaId, lba, count * _blockSize, buffer));
+        }
+
+        /// Reads blocks into the staging area with a single request, and adds them to the cache.
+        Status _fill(Lba lba, size_t count) {
+            const auto status = _deviceRead(lba, count, _staging);
+            if (status != Status::Success)
+                return status;
+
+            _nextMiss = lba + count;
+
+            for (size_t i = 0; i < count; ++i)
+                _insert(lba + i, _staging + (i * _blockSize));
+
+            return Status::Success;
+        }
+
+        /// Finds a block in the cache, reading it from the device if needed, with the missing blocks after it up to
+        /// `end`. When the misses are sequential, the following blocks are read as well, up to max_transfer.
+        Status _getBlock(Lba lba, Lba end, const uint8_t*& data) {
+            if (lba > _lastBlock)
+                return Status::InvalidParameter;
+
+            if (_isPrefetching(lba))
+                _waitPrefetch(true);
+
+            auto slot = _find(lba);
+
+            if (slot == none) {
+                ++_statistics.misses;
+
+                end = lba == _nextMiss || end > _lastBlock ? _lastBlock + 1 : end;
+                const auto status = _fill(lba, _missingRun(lba, end, _config.max_transfer));
+                if (status != Status::Success)
+                    return status;
+
+                slot = _find(lba);
+            } else {
+                ++_statistics.hits;
+            }
+
+            _touch(slot);
+            data = _blockData(slot);
+            return Status::Success;
+        }
+
+        [[nodiscard]] bool _isPrefetching(Lba lba) const noexcept {
+            return _prefetchPending && lba >= _prefetchLba && lba - _prefetchLba < _prefetchCount;
+        }
+
+        /// Starts reading the blocks following a sequential read in the background.
+        void _startPrefetch(Lba lba) {
+            if (_blockIo2 == nullptr || _prefetchPending || lba > _lastBlock)
+                return;
+
+            auto count = _config.read_ahead;
+            count = count > _lastBlock - lba + 1 ? _lastBlock - lba + 1 : count;
+
+            // Skip what is already cached.
+            while (count != 0 && _find(lba) != none) {
+                ++lba;
+                --count;
+            }
+
+            if (count == 0)
+                return;
+
+            _prefetchToken = {_prefetchEvent, Status::Success};
+
+            const auto status = _blockIo2->readBlocksEx(_mediaId, lba, &_prefetchToken, count * _blockSize, _prefetchBuffer);
+            if (status != Status::Success)
+                return;
+
+            ++_statistics.device_reads;
+            _statistics.device_blocks += count;
+
+            _prefetchLba = lba;
+            _prefetchCount = count;
+            _prefetchPending = true;
+        }
+
+        void _finishPrefetch(bool keep) {
+            _prefetchPending = false;
+
+            if (!keep || _prefetchToken.transaction_status != Status::Success)
+                return;
+
+            for (size_t i = 0; i < _prefetchCount; ++i)
+                _insert(_prefetchLba + i, _prefetchBuffer + (i * _blockSize));
+
+            _statistics.prefetched_blocks += _prefetchCount;
+        }
+
+        /// Adds the read-ahead blocks to the cache if they have already arrived.
+        void _pollPrefetch() {
+            if (_prefetchPending && _bootServices->checkEvent(_prefetchEvent) == Status::Success)
+                _finishPrefetch(true);
+        }
+
+        /// Waits until the pending read-ahead is done.
+        void _waitPrefetch(bool keep) {
+            if (!_prefetchPending)
+                return;
+
+            size_t index = 0;
+            _bootServices->waitForEvent(1, &_prefetchEvent, index);
+            _finishPrefetch(keep);
+        }
+
+        BlockIoProtocol* _blockIo;
+        BlockIo2Protocol* _blockIo2;
+        BootServices* _bootServices;
+
+        uint32_t _mediaId, _blockSize, _ioAlign;
+        Lba _lastBlock;
+        /// The block size the storage was laid out for.
+        uint32_t _layoutBlockSize;
+
+        Configuration _config;
+        Statistics _statistics;
+
+        uint8_t* _data;
+        uint8_t* _staging;
+        Slot* _slots;
+        uint32_t* _buckets;
+        uint32_t _bucketMask;
+        uint32_t _head, _tail;
+
+        /// Where the next read starts if the reads are sequential.
+        Lba _nextSequential;
+        /// The block after the last ones fetched into the cache: a miss there is sequential.
+        Lba _nextMiss;
+
+        uint8_t* _prefetchBuffer;
+        Event _prefetchEvent;
+        BlockIo2Protocol::Token _prefetchToken;
+        Lba _prefetchLba;
+        size_t _prefetchCount;
+        bool _prefetchPending;
+    };
+} // namespace Uefi
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "event.h"
+#include "guid.h"
+#include "non_copyable.h"
+#include "status.h"
+
+namespace Uefi {
+    /// Logical block address.
+    using Lba = uint64_t;
+
+    /// Describes the medium of a block device. Shared by BlockIoProtocol and BlockIo2Protocol.
+    struct BlockIoMedia {
+        /// The current media ID. Changes every time the medium is changed.
+        uint32_t media_id;
+
+        bool removable_media;
+        bool media_present;
+        /// True if this device is a partition of a bigger device.
+        bool logical_partition;
+        bool read_only;
+        bool write_caching;
+
+        /// The intrinsic block size of the device, in bytes.
+        uint32_t block_size;
+
+        /// Buffers passed to the device must be aligned to this many bytes. 0 or 1 means no alignment is required.
+        uint32_t io_align;
+
+        /// The last LBA on the device.
+        Lba last_block;
+
+        /// Only present since revision 2 of the protocol.
+        /// @{
+        Lba lowest_aligned_lba;
+        uint32_t logical_blocks_per_physical_block;
+        /// @}
+
+        /// Only present since revision 3 of the protocol.
+        /// The optimal transfer length, in logical blocks. 0 if unknown.
+        uint32_t optimal_transfer_length_granularity;
+    };
+
+    /// Abstracts mass storage devices, allowing code running in the EFI boot services environment to access them
+    /// without specific knowledge of the type of device or controller that manages the device.
+    class BlockIoProtocol : private NonCopyable {
+    public:
+        static constexpr Guid guid = {0x964e5b21, 0x6459, 0x11d2, {0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b}};
+
+        uint64_t revision;
+        BlockIoMedia* media;
+
+        Status reset(bool extended_verification) {
+            return _reset(this, extended_verification);
+        }
+
+        /// Reads the requested number of blocks from the device.
+        /// @param buffer_size Must be a multiple of the block size.
+        /// @param buffer Must be aligned to media->io_align.
+        /// @return Success The data was read correctly from the device.
+        /// @return DeviceError The device reported an error while performing the read.
+        /// @return NoMedia There is no media in the device.
+        /// @return MediaChanged media_id is not for the current media.
+        /// @return BadBufferSize The buffer size is not a multiple of the block size of the device.
+        /// @return InvalidParameter The read request contains LBAs that are not valid, or the buffer is not aligned.
+        Status readBlocks(uint32_t media_id, Lba lba, size_t buffer_size, void* buffer) {
+            return _readBlocks(this, media_id, lba, buffer_size, buffer);
+        }
+
+        /// Writes a specified number of blocks to the device.
+        /// @return WriteProtected The device cannot be written to.
+        /// @see readBlocks() for the other return values.
+        Status writeBlocks(uint32_t media_id, Lba lba, size_t buffer_size, const void* buffer) {
+            return _writeBlocks(this, media_id, lba, buffer_size, buffer);
+        }
+
+        /// Flushes all modified data to the physical block device.
+        Status flushBlocks() {
+            return _flushBlocks(this);
+        }
+
+    private:
+        Status (*_reset)(BlockIoProtocol*, bool);
+        Status (*_readBlocks)(BlockIoProtocol*, uint32_t, Lba, size_t, void*);
+        Status (*_writeBlocks)(BlockIoProtocol*, uint32_t, Lba, size_t, const void*);
+        Status (*_flushBlocks)(BlockIoProtocol*);
+    };
+
+    /// Like BlockIoProtocol, but requests can be executed asynchronously.
+    class BlockIo2Protocol : private NonCopyable {
+    public:
+        static constexpr Guid guid = {0xa77b2472, 0xe282, 0x4e9f, {0xa2, 0x45, 0xc2, 0xc0, 0xe2, 0x7b, 0xbc, 0xc1}};
+
+        /// Describes an asynchronous request.
+        struct Token {
+            /// Signaled when the request completes.
+            /// If it is nullptr, the request is executed synchronously.
+            Event event;
+            /// The result of the request, valid once the event has been signaled.
+            Status transaction_status;
+        };
+
+        BlockIoMedia* media;
+
+        /// Resets the device and aborts every pending request.
+        Status reset(bool extended_verification) {
+            return _reset(this, extended_verification);
+        }
+
+        /// Reads the requested number of blocks from the device.
+        /// If token->event is not nullptr the function returns immediately,
+        /// and the event is signaled once the data has been read.
+        /// The buffer must stay valid until then.
+        /// @return Success The request was queued, or the data was read if the request is synchronous.
+        /// @return OutOfResources The request could not be queued.
+        /// @see BlockIoProtocol::readBlocks() for the other return values.
+        Status readBlocksEx(uint32_t media_id, Lba lba, Token* token, size_t buffer_size, void* buffer) {
+            return _readBlocksEx(this, media_id, lba, token, buffer_size, buffer);
+        }
+
+        Status writeBlocksEx(uint32_t media_id, Lba lba, Token* token, size_t buffer_size, const void* buffer) {
+            return _writeBlocksEx(this, media_id, lba, token, buffer_size, buffer);
+        }
+
+        Status flushBlocksEx(Token* token) {
+            return _flushBlocksEx(this, token);
+        }
+
+    private:
+        Status (*_reset)(BlockIo2Protocol*, bool);
+        Status (*_readBlocksEx)(BlockIo2Protocol*, uint32_t, Lba, Token*, size_t, void*);
+        Status (*_writeBlocksEx)(BlockIo2Protocol*, uint32_t, Lba, Token*, size_t, const void*);
+        Status (*_flushBlocksEx)(BlockIo2Protocol*, Token*);
+    };
+} // namespace Uefi
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "crc32.h"
+#include "memory_attribute.h"
+#include "memory_type.h"
+#include "span.h"
+
+namespace Uefi {
+    /// A memory map entry of BootInfo. Unlike the descriptors of the firmware, its size is fixed.
+    struct BootInfoMemoryRange {
+        uint64_t base;
+        uint64_t page_count;
+        MemoryAttribute attributes;
+        MemoryType type;
+        uint32_t _reserved;
+    };
+
+    static_assert(sizeof(BootInfoMemoryRange) == 32);
+
+    struct BootInfoFramebuffer {
+        /// 0 without a linear framebuffer.
+        uint64_t base;
+        uint32_t width, height;
+        uint32_t pixels_per_scan_line;
+        uint32_t red_mask, green_mask, blue_mask, reserved_mask;
+        uint32_t _reserved;
+    };
+
+    static_assert(sizeof(BootInfoFramebuffer) == 40);
+
+    /// Where a variable-size part of the blob is, from the start of the blob.
+    struct BootInfoBlock {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    /// What the loader hands over to the kernel, in a single blob which can be moved or mapped anywhere: the parts
+    /// after this header are found by their offset from its start, and a CRC32 of everything else ends it.
+    /// This header is read without any dependency on boot services, so that the kernel can include it alone.
+    /// @code
+    /// const auto* boot_info = BootInfo::validate(blob);
+    /// if (boot_info == nullptr)
+    ///     panic();
+    /// for (const auto& range : boot_info->getMemoryMap())
+    ///     addMemory(range);
+    /// @endcode
+    struct BootInfo {
+        static constexpr uint64_t signature_value = 0x4F464E49544F4F42; // "BOOTINFO"
+        static constexpr uint32_t current_version = 1;
+
+        uint64_t signature;
+        /// Later versions only add fields at the end of the header, so a reader accepts any version since its own.
+        uint32_t version;
+        /// The size of the header in the version which wrote it.
+        uint32_t header_size;
+        /// The size of the whole blob, the trailing CRC32 included.
+        uint64_t size;
+
+        /// The physical address of the UEFI SystemTable, to reach the runtime services.
+        uint64_t system_table;
+        /// The physical address of the ACPI RSDP, 0 without ACPI.
+        uint64_t acpi_rsdp;
+        /// The physical address of the SMBIOS entry point, 0 without SMBIOS.
+        uint64_t smbios_entry_point;
+        /// 3 for a 64-bit entry point, 2 for a 32-bit one.
+        uint32_t smbios_major_version;
+        uint32_t _reserved;
+
+        /// The initial RAM disk, 0 and 0 without one.
+        uint64_t initrd_base;
+        uint64_t initrd_size;
+
+        BootInfoFramebuffer framebuffer;
+
+        /// BootInfoMemoryRange entries sorted by address, neighbours of the same type and attributes joined.
+        BootInfoBlock memory_map;
+        /// UTF-8, null-terminated. The size counts the terminator.
+        BootInfoBlock command_line;
+
+        /// Checks the signature, the version, that the blocks are inside the blob, and the CRC32.
+        /// @return nullptr The blob is not a valid BootInfo.
+        [[nodiscard]] static const BootInfo* validate(const void* blob) noexcept {
+            const auto* info = static_cast<const BootInfo*>(blob);
+            if (info == nullptr || info->signature != signature_value || info->version < 1 || info->header_size < sizeof(BootInfo))
+                return nullptr;
+
+            const auto data_size = info->size - sizeof(Crc32);
+            if (info->size < info->header_size + sizeof(Crc32) || !_isInside(info->memory_map, data_size) || !_isInside(info->command_line, data_size))
+                return nullptr;
+
+            if (info->memory_map.size % sizeof(BootInfoMemoryRange) != 0 || info->memory_map.offset % alignof(BootInfoMemoryRange) != 0)
+                return nullptr;
+
+            Crc32 crc;
+            __builtin_memcpy(&crc, static_cast<const uint8_t*>(blob) + data_size, sizeof(crc));
+            return calculateCrc32(blob, static_cast<size_t>(data_size)) == crc ? info : nullptr;
+        }
+
+        [[nodiscard]] Span<const BootInfoMemoryRange> getMemoryMap() const noexcept {
+            return {reinterpret_cast<const BootInfoMemoryRange*>(_getBlock(memory_map)), memory_map.size / sizeof(BootInfoMemoryRange)};
+        }
+
+        /// An empty string without a command line.
+        [[nodiscard]] const char* getCommandLine() const noexcept {
+            return command_line.size != 0 ? reinterpret_cast<const char*>(_getBlock(command_line)) : "";
+        }
+
+    private:
+        static bool _isInside(const BootInfoBlock& block, uint64_t size) noexcept {
+            return uint64_t{block.offset} + block.size <= size;
+        }
+
+        [[nodiscard]] const uint8_t* _getBlock(const BootInfoBlock& block) const noexcept {
+            return reinterpret_cast<const uint8_t*>(this) + block.offset;
+        }
+    };
+
+    static_assert(sizeof(BootInfo) == 128);
+} // namespace Uefi
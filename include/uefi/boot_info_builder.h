@@ -0,0 +1,285 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "boot_info.h"
+#include "boot_services.h"
+#include "configuration_table.h"
+#include "graphics_output_protocol.h"
+#include "handle.h"
+#include "memory_map.h"
+#include "result.h"
+#include "status.h"
+#include "system_table.h"
+
+namespace Uefi {
+    /// Gathers what the kernel needs into a BootInfo blob, and leaves boot services with it.
+    /// The blob and the buffer the firmware writes the final memory map to come from a single allocation made
+    /// beforehand, so nothing is allocated between the last getMemoryMap() and exitBootServices(), and the map is
+    /// translated in place instead of being copied around. The blob lives in LoaderData pages, which the kernel must
+    /// keep until it has read it.
+    /// @code
+    /// BootInfoBuilder builder;
+    /// builder.initialize(system_table);
+    /// builder.setFramebuffer(framebuffer);
+    /// builder.setCommandLine(options);
+    /// if (builder.allocate(boot_services) != Status::Success || builder.exitBootServices(boot_services, image) != Status::Success)
+    ///     return;
+    /// jumpToKernel(builder.getBootInfo());
+    /// @endcode
+    class BootInfoBuilder {
+    public:
+        /// Descriptors the memory map may gain between allocate() and exitBootServices(), the allocation included.
+        static constexpr size_t slack_descriptor_count = 8;
+
+        /// Reads the ACPI and SMBIOS entry points from the configuration tables, preferring the newer ones.
+        void initialize(const SystemTable& system_table) noexcept {
+            _header = {};
+            _header.signature = BootInfo::signature_value;
+            _header.version = BootInfo::current_version;
+            _header.header_size = sizeof(BootInfo);
+            _header.system_table = reinterpret_cast<uintptr_t>(&system_table);
+
+            auto* rsdp = system_table.findConfigurationTable(acpi2_guid);
+            if (rsdp == nullptr)
+                rsdp = system_table.findConfigurationTable(acpi1_guid);
+
+            _header.acpi_rsdp = reinterpret_cast<uintptr_t>(rsdp);
+
+            if (auto* entry_point = system_table.findConfigurationTable(smbios3_guid); entry_point != nullptr) {
+                _header.smbios_entry_point = reinterpret_cast<uintptr_t>(entry_point);
+                _header.smbios_major_version = 3;
+            } else if (entry_point = system_table.findConfigurationTable(smbios_guid); entry_point != nullptr) {
+                _header.smbios_entry_point = reinterpret_cast<uintptr_t>(entry_point);
+                _header.smbios_major_version = 2;
+            }
+
+            _commandLine = nullptr;
+            _commandLineSize = 0;
+            _memory = 0;
+            _bootInfo = nullptr;
+        }
+
+        void setFramebuffer(const Framebuffer& framebuffer) noexcept {
+            _header.framebuffer = {reinterpret_cast<uintptr_t>(framebuffer.base), framebuffer.width, framebuffer.height,
+                                   framebuffer.pixels_per_scan_line, framebuffer.masks.red, framebuffer.masks.green,
+                                   framebuffer.masks.blue, framebuffer.masks.reserved, 0};
+        }
+
+        /// The string is converted to UTF-8 by write(), so it must live until then. nullptr for none.
+        void setCommandLine(const char16_t* command_line) noexcept {
+            _commandLine = command_line;
+            _commandLineSize = command_line != nullptr ? _getUtf8Size(command_line) + 1 : 0;
+        }
+
+        void setInitrd(uint64_t base, uint64_t size) noexcept {
+            _header.initrd_base = base;
+            _header.initrd_size = size;
+        }
+
+        /// The size of a blob for a firmware map of `descriptor_count` descriptors, in the worst case where no
+        /// neighbours are joined.
+        [[nodiscard]] size_t getRequiredSize(size_t descriptor_count) const noexcept {
+            return _getMapOffset() + (descriptor_count * sizeof(BootInfoMemoryRange)) + _alignUp(_commandLineSize, sizeof(Crc32)) + sizeof(Crc32);
+        }
+
+        /// Writes the blob for `map`. It only touches memory, so it can run between the last getMemoryMap() and
+        /// exitBootServices(), or after it.
+        /// @return The size of the blob.
+        /// @return BufferTooSmall `capacity` is below getRequiredSize() for the map.
+        Result<size_t> write(void* blob, size_t capacity, const MemoryMap& map) const noexcept {
+            const auto descriptor_count = map.getNumberOfEntries();
+            if (capacity < getRequiredSize(descriptor_count))
+                return {Status::BufferTooSmall, 0};
+
+            auto* bytes = static_cast<uint8_t*>(blob);
+            auto* ranges = reinterpret_cast<BootInfoMemoryRange*>(bytes + _getMapOffset());
+            const auto range_count = _writeMemoryMap(ranges, map);
+
+            auto offset = _getMapOffset() + (range_count * sizeof(BootInfoMemoryRange));
+            auto* header = static_cast<BootInfo*>(blob);
+            *header = _header;
+            header->memory_map = {static_cast<uint32_t>(_getMapOffset()), static_cast<uint32_t>(range_count * sizeof(BootInfoMemoryRange))};
+            header->command_line = {static_cast<uint32_t>(offset), static_cast<uint32_t>(_commandLineSize)};
+
+            if (_commandLine != nullptr)
+                _writeUtf8(reinterpret_cast<char*>(bytes + offset), _commandLine);
+
+            offset += _commandLineSize;
+            const auto data_size = _alignUp(offset, sizeof(Crc32));
+            for (; offset < data_size; ++offset)
+                bytes[offset] = 0;
+
+            header->size = data_size + sizeof(Crc32);
+            const auto crc = calculateCrc32(blob, data_size);
+            __builtin_memcpy(bytes + data_size, &crc, sizeof(crc));
+            return {Status::Success, static_cast<size_t>(header->size)};
+        }
+
+        /// Allocates the pages holding the blob and the buffer of the final memory map, with room for
+        /// slack_descriptor_count more descriptors than the map has now. Call it after the set functions.
+        Status allocate(BootServices& boot_services) noexcept {
+            size_t map_size = 0;
+            size_t map_key;
+            size_t descriptor_size = 0;
+            uint32_t descriptor_version;
+
+            const auto status = boot_services.getMemoryMap(map_size, nullptr, map_key, descriptor_size, descriptor_version);
+            if (status != Status::BufferTooSmall || descriptor_size == 0)
+                return status == Status::BufferTooSmall || status == Status::Success ? Status::DeviceError : status;
+
+            _mapCapacity = map_size + (slack_descriptor_count * descriptor_size);
+            _blobCapacity = _alignUp(getRequiredSize(_mapCapacity / descriptor_size), alignof(BootServices::MemoryDescriptor));
+            const auto page_count = (_blobCapacity + _mapCapacity + page_size - 1) / page_size;
+
+            const auto memory = boot_services.allocatePages(MemoryType::LoaderData, page_count);
+            if (!memory)
+                return memory.getStatus();
+
+            _memory = *memory;
+            return Status::Success;
+        }
+
+        /// Gets the final memory map, writes the blob, and exits boot services. Calls the firmware again when the map
+        /// changed in between, as the specification allows.
+        /// @return Anything returned by BootServices::getMemoryMap() or BootServices::exitBootServices().
+        Status exitBootServices(BootServices& boot_services, Handle image_handle) noexcept {
+            auto* blob = reinterpret_cast<void*>(static_cast<uintptr_t>(_memory));
+            auto* descriptors = reinterpret_cast<BootServices::MemoryDescriptor*>(static_cast<uintptr_t>(_memory) + _blobCapacity);
+
+            auto status = Status::InvalidParameter;
+            for (int attempt = 0; attempt < max_exit_attempts && status == Status::InvalidParameter; ++attempt) {
+                size_t map_size = _mapCapacity;
+                size_t map_key;
+                size_t descriptor_size;
+                uint32_t descriptor_version;
+
+                status = boot_services.getMemoryMap(map_size, descriptors, map_key, descriptor_size, descriptor_version);
+                if (status != Status::Success)
+                    return status;
+
+                const auto size = write(blob, _blobCapacity, {map_size, descriptor_size, map_key, descriptors});
+                if (!size)
+                    return size.getStatus();
+
+                status = boot_services.exitBootServices(image_handle, map_key);
+            }
+
+            if (status == Status::Success)
+                _bootInfo = static_cast<BootInfo*>(blob);
+
+            return status;
+        }
+
+        /// nullptr until exitBootServices() succeeds.
+        [[nodiscard]] const BootInfo* getBootInfo() const noexcept {
+            return _bootInfo;
+        }
+
+    private:
+        static constexpr size_t page_size = 0x1000;
+        static constexpr int max_exit_attempts = 4;
+
+        static constexpr size_t _alignUp(size_t value, size_t alignment) noexcept {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+
+        static constexpr size_t _getMapOffset() noexcept {
+            return _alignUp(sizeof(BootInfo), alignof(BootInfoMemoryRange));
+        }
+
+        /// Sorts the descriptors by address while translating them, then joins neighbours.
+        /// Firmware maps are mostly sorted already, so the insertion sort hardly moves anything.
+        static size_t _writeMemoryMap(BootInfoMemoryRange* ranges, const MemoryMap& map) noexcept {
+            size_t count = 0;
+            for (const auto& descriptor : map) {
+                size_t i = count++;
+                for (; i > 0 && ranges[i - 1].base > descriptor.physical_start; --i)
+                    ranges[i] = ranges[i - 1];
+
+                ranges[i] = {descriptor.physical_start, descriptor.pages_count, descriptor.attribute, descriptor.type, 0};
+            }
+
+            if (count == 0)
+                return 0;
+
+            size_t joined = 0;
+            for (size_t i = 1; i < count; ++i) {
+                auto& last = ranges[joined];
+                const auto& range = ranges[i];
+                if (last.type == range.type && last.attributes == range.attributes && last.base + (last.page_count * page_size) == range.base)
+                    last.page_count += range.page_count;
+                else
+                    ranges[++joined] = range;
+            }
+
+            return joined + 1;
+        }
+
+        /// Without the terminator. Unpaired surrogates become U+FFFD, like _writeUtf8() writes them.
+        static size_t _getUtf8Size(const char16_t* string) noexcept {
+            size_t size = 0;
+            for (; *string != u'\0'; ++string) {
+                const auto character = *string;
+                if (character < 0x80)
+                    size += 1;
+                else if (character < 0x800)
+                    size += 2;
+                else if (_isHighSurrogate(character) && _isLowSurrogate(string[1])) {
+                    size += 4;
+                    ++string;
+                } else
+                    size += 3;
+            }
+
+            return size;
+        }
+
+        static void _writeUtf8(char* output, const char16_t* string) noexcept {
+            auto* bytes = reinterpret_cast<uint8_t*>(output);
+            for (; *string != u'\0'; ++string) {
+                uint32_t code_point = *string;
+                if (_isHighSurrogate(*string) && _isLowSurrogate(string[1])) {
+                    code_point = 0x10000 + ((code_point - 0xD800) << 10) + (string[1] - 0xDC00);
+                    ++string;
+                } else if (code_point >= 0xD800 && code_point < 0xE000)
+                    code_point = 0xFFFD;
+
+                if (code_point < 0x80)
+                    *bytes++ = static_cast<uint8_t>(code_point);
+                else if (code_point < 0x800) {
+                    *bytes++ = static_cast<uint8_t>(0xC0 | (code_point >> 6));
+                    *bytes++ = static_cast<uint8_t>(0x80 | (code_point & 0x3F));
+                } else if (code_point < 0x10000) {
+                    *bytes++ = static_cast<uint8_t>(0xE0 | (code_point >> 12));
+                    *bytes++ = static_cast<uint8_t>(0x80 | ((code_point >> 6) & 0x3F));
+                    *bytes++ = static_cast<uint8_t>(0x80 | (code_point & 0x3F));
+                } else {
+                    *bytes++ = static_cast<uint8_t>(0xF0 | (code_point >> 18));
+                    *bytes++ = static_cast<uint8_t>(0x80 | ((code_point >> 12) & 0x3F));
+                    *bytes++ = static_cast<uint8_t>(0x80 | ((code_point >> 6) & 0x3F));
+                    *bytes++ = static_cast<uint8_t>(0x80 | (code_point & 0x3F));
+                }
+            }
+
+            *bytes = '\0';
+        }
+
+        static constexpr bool _isHighSurrogate(char16_t character) noexcept {
+            return character >= 0xD800 && character < 0xDC00;
+        }
+
+        static constexpr bool _isLowSurrogate(char16_t character) noexcept {
+            return character >= 0xDC00 && character < 0xE000;
+        }
+
+        BootInfo _header;
+        const char16_t* _commandLine;
+        size_t _commandLineSize;
+        BootServices::PhysicalAddress _memory;
+        size_t _blobCapacity;
+        size_t _mapCapacity;
+        BootInfo* _bootInfo;
+    };
+} // namespace Uefi
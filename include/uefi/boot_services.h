@@ -1,11 +1,15 @@
 #pragma once
 
+#include "detail/allocation_hooks.h"
 #include "detail/bit_flags.h"
+#include "event.h"
 #include "guid.h"
 #include "handle.h"
 #include "memory_attribute.h"
 #include "memory_type.h"
+#include "result.h"
 #include "signed_table.h"
+#include "span.h"
 #include "status.h"
 #include "task_priority_level.h"
 #include <ctime>
@@ -50,12 +54,30 @@ namespace Uefi {
         /// @return InvalidParameter MemoryType is in the range MaxMemoryType ... 0x6FFFFFFF.
         /// @return InvalidParameter MemoryType is PersistentMemory.
         /// @return NotFound The requested pages could not be found
-        Status allocatePages(AllocateType type, MemoryType mem_type, size_t pages, PhysicalAddress& memory) {
-            return _allocatePages(type, mem_type, pages, memory);
+        Status allocatePages(AllocateType type, MemoryType mem_type, size_t pages, PhysicalAddress& memory UEFI_ALLOCATION_SITE_PARAMETER) {
+            const auto status = _allocatePages(type, mem_type, pages, memory);
+            if (status == Status::Success)
+                UEFI_RECORD_ALLOCATION(memory, pages * 0x1000ULL, mem_type);
+
+            return status;
+        }
+
+        /// Allocates memory pages from the system, and returns their address.
+        /// @param address The highest address for MaxAddress, or the address to allocate for Address.
+        Result<PhysicalAddress> allocatePages(MemoryType mem_type, size_t pages, AllocateType type = AllocateType::AnyPages, PhysicalAddress address = 0 UEFI_ALLOCATION_SITE_PARAMETER) {
+            const auto status = _allocatePages(type, mem_type, pages, address);
+            if (status == Status::Success)
+                UEFI_RECORD_ALLOCATION(address, pages * 0x1000ULL, mem_type);
+
+            return {status, address};
         }
 
         Status freePages(PhysicalAddress memory, size_t pages) {
-            return _freePages(memory, pages);
+            const auto status = _freePages(memory, pages);
+            if (status == Status::Success)
+                UEFI_RECORD_FREE(memory);
+
+            return status;
         }
 
         /// Describes a region of memory.
@@ -108,24 +130,102 @@ namespace Uefi {
         /// @return InvalidParameter The type is in the range MaxMemoryType .. 0x6FFFFFFF.
         /// @return InvalidParameter The type is PersistentMemory .
         /// @return InvalidParameter The buffer is nullptr.
-        Status allocatePool(MemoryType pool_type, size_t size, void** buffer) {
-            return _allocatePool(pool_type, size, buffer);
+        Status allocatePool(MemoryType pool_type, size_t size, void** buffer UEFI_ALLOCATION_SITE_PARAMETER) {
+            const auto status = _allocatePool(pool_type, size, buffer);
+            if (status == Status::Success)
+                UEFI_RECORD_ALLOCATION(reinterpret_cast<uintptr_t>(*buffer), size, pool_type);
+
+            return status;
+        }
+
+        /// Allocates pool memory, and returns it.
+        Result<void*> allocatePool(MemoryType pool_type, size_t size UEFI_ALLOCATION_SITE_PARAMETER) {
+            void* buffer = nullptr;
+            const auto status = _allocatePool(pool_type, size, &buffer);
+            if (status == Status::Success)
+                UEFI_RECORD_ALLOCATION(reinterpret_cast<uintptr_t>(buffer), size, pool_type);
+
+            return {status, buffer};
         }
 
         /// Returns pool memory to the system.
         Status freePool(void* buffer) {
-            return _freePool(buffer);
+            const auto status = _freePool(buffer);
+            if (status == Status::Success)
+                UEFI_RECORD_FREE(reinterpret_cast<uintptr_t>(buffer));
+
+            return status;
         }
 
         //
         // Event & Timer Services
         //
-        // EFI_CREATE_EVENT CreateEvent;
-        // EFI_SET_TIMER SetTimer;
-        // EFI_WAIT_FOR_EVENT WaitForEvent;
-        // EFI_SIGNAL_EVENT SignalEvent;
-        // EFI_CLOSE_EVENT CloseEvent;
-        // EFI_CHECK_EVENT CheckEvent;
+
+        /// Creates an event.
+        /// @param notify_tpl The priority level of the notification function, if any.
+        /// @param notify_function Called when the event is signaled or waited on, depending on the type. Can be nullptr.
+        /// @param notify_context Passed to the notification function.
+        /// @param[out] event The newly created event.
+        /// @return Success The event structure was created.
+        /// @return InvalidParameter One of the parameters has an invalid value.
+        /// @return OutOfResources The event could not be allocated.
+        Status createEvent(EventType type, Tpl notify_tpl, EventNotify notify_function, void* notify_context, Event& event) {
+            return _createEvent(type, notify_tpl, notify_function, notify_context, event);
+        }
+
+        /// Creates an event, and returns it.
+        Result<Event> createEvent(EventType type, Tpl notify_tpl, EventNotify notify_function = nullptr, void* notify_context = nullptr) {
+            Event event = nullptr;
+            const auto status = _createEvent(type, notify_tpl, notify_function, notify_context, event);
+            return {status, event};
+        }
+
+        enum class TimerDelay {
+            /// Cancels the event's timer.
+            Cancel,
+            /// The event is signaled every trigger_time.
+            Periodic,
+            /// The event is signaled once, after trigger_time.
+            Relative
+        };
+
+        /// Sets the type of timer and the trigger time for a timer event.
+        /// @param trigger_time The time, in 100 ns units. Zero means the next timer tick.
+        Status setTimer(Event event, TimerDelay type, uint64_t trigger_time) {
+            return _setTimer(event, type, trigger_time);
+        }
+
+        /// Stops execution until an event is signaled. Can only be called at Tpl::Application.
+        /// @param[out] index The index of the event which satisfied the wait.
+        /// @return Success The event indicated by index was signaled.
+        /// @return InvalidParameter An event is of type NotifySignal.
+        /// @return Unsupported The current TPL is not Application.
+        Status waitForEvent(size_t event_count, Event* events, size_t& index) {
+            return _waitForEvent(event_count, events, index);
+        }
+
+        /// Stops execution until an event is signaled, and returns the index of that event.
+        Result<size_t> waitForEvent(Span<Event> events) {
+            size_t index = 0;
+            const auto status = _waitForEvent(events.getSize(), events.getData(), index);
+            return {status, index};
+        }
+
+        Status signalEvent(Event event) {
+            return _signalEvent(event);
+        }
+
+        Status closeEvent(Event event) {
+            return _closeEvent(event);
+        }
+
+        /// Checks whether an event is in the signaled state, and clears it if it is.
+        /// @return Success The event is in the signaled state.
+        /// @return NotReady The event is not in the signaled state.
+        /// @return InvalidParameter The event is of type NotifySignal.
+        Status checkEvent(Event event) {
+            return _checkEvent(event);
+        }
 
         //
         // Protocol Handler Services
@@ -141,6 +241,14 @@ namespace Uefi {
             return _handleProtocol(handle, protocol, interface);
         }
 
+        /// Returns the interface of a protocol supported by a handle.
+        template <typename Protocol>
+        Result<Protocol*> handleProtocol(Handle handle) {
+            void* interface = nullptr;
+            const auto status = _handleProtocol(handle, Protocol::guid, &interface);
+            return {status, static_cast<Protocol*>(interface)};
+        }
+
         // EFI_REGISTER_PROTOCOL_NOTIFY RegisterProtocolNotify;
         enum class LocateSearchType {
             AllHandles,
@@ -171,9 +279,32 @@ namespace Uefi {
         //
         // Miscellaneous Services
         //
-        // EFI_GET_NEXT_MONOTONIC_COUNT GetNextMonotonicCount;
-        // EFI_STALL Stall;
-        // EFI_SET_WATCHDOG_TIMER SetWatchdogTimer;
+
+        /// Returns a count which increases on every call. Only its low 32 bits change until the next boot.
+        Status getNextMonotonicCount(uint64_t& count) {
+            return _getNextMonotonicCount(count);
+        }
+
+        Result<uint64_t> getNextMonotonicCount() {
+            uint64_t count = 0;
+            const auto status = _getNextMonotonicCount(count);
+            return {status, count};
+        }
+
+        /// Busy-waits for at least the given time.
+        Status stall(size_t microseconds) {
+            return _stall(microseconds);
+        }
+
+        /// Sets the watchdog timer, which resets the system when it expires. The firmware arms it for 5 minutes before
+        /// starting an application.
+        /// @param timeout In seconds. 0 disables the timer.
+        /// @param watchdog_code Logged when the timer expires. Codes up to 0xFFFF are reserved for the firmware.
+        /// @param data_size The size of data, in bytes.
+        /// @param data A null-terminated string, optionally followed by binary data, logged when the timer expires.
+        Status setWatchdogTimer(size_t timeout, uint64_t watchdog_code = 0x10000, size_t data_size = 0, const char16_t* data = nullptr) {
+            return _setWatchdogTimer(timeout, watchdog_code, data_size, data);
+        }
 
         // --> These only exist in UEFI 1.1+
 
@@ -202,6 +333,14 @@ namespace Uefi {
             return _openProtocol(handle, protocol_guid, interface, agent, controller, attributes);
         }
 
+        /// Opens a protocol on behalf of the calling agent, and returns its interface.
+        template <typename Protocol>
+        Result<Protocol*> openProtocol(Handle handle, Handle agent, Handle controller, OpenProtocolAttributes attributes) {
+            void* interface = nullptr;
+            const auto status = _openProtocol(handle, Protocol::guid, &interface, agent, controller, attributes);
+            return {status, static_cast<Protocol*>(interface)};
+        }
+
         Status closeProtocol(Handle handle, const Guid& protocol_guid, Handle agent, Handle controller) {
             return _closeProtocol(handle, protocol_guid, agent, controller);
         }
@@ -217,10 +356,26 @@ namespace Uefi {
             return _locateHandleBuffer(search_type, protocol, search_key, handle_count, buffer);
         }
 
+        /// Returns the handles matching a search, in a buffer allocated from the pool. Free it with freePool().
+        Result<Span<Handle>> locateHandleBuffer(LocateSearchType search_type, const Guid* protocol = nullptr, const void* search_key = nullptr) {
+            size_t handle_count = 0;
+            Handle* buffer = nullptr;
+            const auto status = _locateHandleBuffer(search_type, protocol, search_key, handle_count, buffer);
+            return {status, Span<Handle>(buffer, handle_count)};
+        }
+
         Status locateProtocol(const Guid* protocol, void* registration, void** output) {
             return _locateProtocol(protocol, registration, output);
         }
 
+        /// Returns the first installed interface of a protocol.
+        template <typename Protocol>
+        Result<Protocol*> locateProtocol(void* registration = nullptr) {
+            void* interface = nullptr;
+            const auto status = _locateProtocol(&Protocol::guid, registration, &interface);
+            return {status, static_cast<Protocol*>(interface)};
+        }
+
         // EFI_LOCATE_PROTOCOL LocateProtocol;
 
         // EFI_INSTALL_MULTIPLE_PROTOCOL_INTERFACES InstallMultipleProtocolInterfaces;
@@ -264,7 +419,14 @@ namespace Uefi {
         Status (*_allocatePool)(MemoryType, size_t, void**);
         Status (*_freePool)(void*);
 
-        [[maybe_unused]] void* _buf2[9];
+        Status (*_createEvent)(EventType, Tpl, EventNotify, void*, Event&);
+        Status (*_setTimer)(Event, TimerDelay, uint64_t);
+        Status (*_waitForEvent)(size_t, Event*, size_t&);
+        Status (*_signalEvent)(Event);
+        Status (*_closeEvent)(Event);
+        Status (*_checkEvent)(Event);
+
+        [[maybe_unused]] void* _buf2[3];
 
         Status (*_handleProtocol)(Handle, const Guid&, void**);
         [[maybe_unused]] void* _reserved;
@@ -281,7 +443,11 @@ namespace Uefi {
 
         Status (*_exitBootServices)(Handle, size_t);
 
-        [[maybe_unused]] void* _buf6[5];
+        Status (*_getNextMonotonicCount)(uint64_t&);
+        Status (*_stall)(size_t);
+        Status (*_setWatchdogTimer)(size_t, uint64_t, size_t, const char16_t*);
+
+        [[maybe_unused]] void* _buf6[2];
 
         Status (*_openProtocol)(Handle, const Guid&, void**, Handle, Handle, OpenProtocolAttributes);
         Status (*_closeProtocol)(Handle, const Guid&, Handle, Handle);
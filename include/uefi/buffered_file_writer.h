@@ -0,0 +1,230 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "detail/memory.h"
+#include "file_protocol.h"
+#include "non_copyable.h"
+#include "status.h"
+#include "ucs2.h"
+
+namespace Uefi {
+    /// Gathers small writes to a file in a buffer, and passes them on to the firmware a full buffer at a time, so
+    /// logs, traces or crash dumps written piece by piece cost one FAT write per buffer instead of one per piece.
+    /// The buffer is only written when it is full, by flush() and by close(), which is also called when the writer
+    /// goes out of scope: it is meant to live on the stack, not as a global.
+    /// @code
+    /// BufferedFileWriter writer;
+    /// writer.initialize(*file, buffer, 64 * 1024);
+    /// writer.preallocate(expected_size);
+    /// print(writer, UEFI_FORMAT("{} entries\r\n"), count);
+    /// writer.write(dump, dump_size);
+    /// @endcode
+    class BufferedFileWriter : private NonCopyable {
+    public:
+        BufferedFileWriter() noexcept = default;
+
+        ~BufferedFileWriter() {
+            static_cast<void>(close());
+        }
+
+        /// Takes over `file`, opened for writing: the writes start at its current position, and close() closes it.
+        /// @param buffer Best page-aligned, with a size that is a multiple of the cluster size, like 64 KiB, so that
+        /// each write covers whole clusters.
+        Status initialize(FileProtocol& file, void* buffer, size_t buffer_size) noexcept {
+            static_cast<void>(close());
+
+            const auto status = file.getPosition(_start);
+            if (status != Status::Success)
+                return status;
+
+            _file = &file;
+            _buffer = static_cast<uint8_t*>(buffer);
+            _capacity = buffer_size;
+            _used = 0;
+            _written = 0;
+            _originalSize = 0;
+            _preallocatedSize = 0;
+            return Status::Success;
+        }
+
+        /// Grows the file to `size` bytes from the start of the writes at once, so the file system allocates its
+        /// clusters in one go instead of each time the file grows. close() cuts off what was not written, down to the
+        /// size the file had before. A file which is already long enough is left as it is.
+        /// @return VolumeFull The volume has no room for it.
+        Status preallocate(uint64_t size) noexcept {
+            alignas(8) uint8_t buffer[info_buffer_size];
+            size_t buffer_size = sizeof(buffer);
+
+            auto status = _file->getInfo(FileInfo::guid, buffer_size, buffer);
+            if (status != Status::Success)
+                return status;
+
+            auto* info = reinterpret_cast<FileInfo*>(buffer);
+            const auto end = _start + size;
+            if (info->file_size >= end)
+                return Status::Success;
+
+            const auto original_size = info->file_size;
+            info->file_size = end;
+            status = _file->setInfo(FileInfo::guid, buffer_size, buffer);
+            if (status != Status::Success)
+                return status;
+
+            if (_preallocatedSize == 0)
+                _originalSize = original_size;
+
+            _preallocatedSize = end;
+            return Status::Success;
+        }
+
+        /// Copies `data` to the buffer, writing the buffer out when it fills. Writes at least as large as the buffer
+        /// go to the file directly.
+        /// @return Anything returned by FileProtocol::write(), when the buffer was written out. What the firmware did
+        /// not take stays in the buffer, and getWrittenSize() tells how much of `data` was taken.
+        /// @return DeviceError The firmware took none of the bytes, without an error.
+        Status write(const void* data, size_t size) noexcept {
+            const auto* bytes = static_cast<const uint8_t*>(data);
+
+            if (_used + size < _capacity) {
+                Detail::copyBytes(_buffer + _used, bytes, size);
+                _used += size;
+                _written += size;
+                return Status::Success;
+            }
+
+            // Tops the buffer up, so that whole buffers are written as long as the writes are small.
+            if (_used != 0) {
+                const auto part = _capacity - _used;
+                Detail::copyBytes(_buffer + _used, bytes, part);
+                _used = _capacity;
+                _written += part;
+                bytes += part;
+                size -= part;
+
+                const auto status = _writeBuffer();
+                if (status != Status::Success)
+                    return status;
+            }
+
+            if (size >= _capacity) {
+                auto written = size;
+                const auto status = _writeAll(bytes, written);
+                _written += written;
+                return status;
+            }
+
+            Detail::copyBytes(_buffer, bytes, size);
+            _used = size;
+            _written += size;
+            return Status::Success;
+        }
+
+        /// Writes a string, without its terminator, so that print() can format into the file.
+        Status outputString(const char16_t* string) noexcept {
+            return write(string, getStringLength(string) * sizeof(char16_t));
+        }
+
+        /// Writes the buffer out, and has the firmware write what it cached to the device.
+        Status flush() noexcept {
+            const auto status = _writeBuffer();
+            if (status != Status::Success)
+                return status;
+
+            return _file->flush();
+        }
+
+        /// Writes the buffer out, cuts off what preallocate() reserved beyond the last write, and closes the file.
+        /// The file is closed even if writing fails. Does nothing if the writer is not initialized.
+        /// @return The first error.
+        Status close() noexcept {
+            if (_file == nullptr)
+                return Status::Success;
+
+            auto status = _writeBuffer();
+
+            // Only what preallocate() added is cut off, never what the file held before.
+            const auto written_end = _start + _written;
+            const auto end = written_end > _originalSize ? written_end : _originalSize;
+            if (status == Status::Success && _preallocatedSize > end)
+                status = _truncate(end);
+
+            const auto close_status = _file->close();
+            _file = nullptr;
+            return status != Status::Success ? status : close_status;
+        }
+
+        /// The number of bytes written so far, including those still in the buffer.
+        [[nodiscard]] uint64_t getWrittenSize() const noexcept {
+            return _written;
+        }
+
+    private:
+        /// Fits the fixed part of FileInfo and a name as long as FAT allows.
+        static constexpr size_t info_buffer_size = offsetof(FileInfo, file_name) + (256 * sizeof(char16_t));
+
+        Status _writeBuffer() noexcept {
+            if (_used == 0)
+                return Status::Success;
+
+            auto written = _used;
+            const auto status = _writeAll(_buffer, written);
+
+            // Keeps what the firmware did not take, so that the next write starts with it.
+            if (written < _used)
+                Detail::moveBytes(_buffer, _buffer + written, _used - written);
+
+            _used -= written;
+            return status;
+        }
+
+        /// Writes until the firmware took everything: it may take less than asked and still succeed.
+        /// @param size Receives the number of bytes taken.
+        Status _writeAll(const uint8_t* bytes, size_t& size) noexcept {
+            size_t taken = 0;
+            auto status = Status::Success;
+
+            while (taken < size) {
+                auto part = size - taken;
+                status = _file->write(part, bytes + taken);
+                taken += part;
+
+                if (status != Status::Success)
+                    break;
+
+                if (part == 0) {
+                    status = Status::DeviceError;
+                    break;
+                }
+            }
+
+            size = taken;
+            return status;
+        }
+
+        Status _truncate(uint64_t size) noexcept {
+            alignas(8) uint8_t buffer[info_buffer_size];
+            size_t buffer_size = sizeof(buffer);
+
+            const auto status = _file->getInfo(FileInfo::guid, buffer_size, buffer);
+            if (status != Status::Success)
+                return status;
+
+            reinterpret_cast<FileInfo*>(buffer)->file_size = size;
+            return _file->setInfo(FileInfo::guid, buffer_size, buffer);
+        }
+
+        FileProtocol* _file = nullptr;
+        uint8_t* _buffer;
+        size_t _capacity;
+        size_t _used;
+        /// The position of the file when the writer was initialized.
+        uint64_t _start;
+        uint64_t _written;
+        /// The size of the file before preallocate() grew it.
+        uint64_t _originalSize;
+        /// The size preallocate() grew the file to, or 0.
+        uint64_t _preallocatedSize;
+    };
+} // namespace Uefi
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "boot_services.h"
+#include "memory_type.h"
+#include "runtime_services.h"
+#include "span.h"
+#include "status.h"
+
+namespace Uefi {
+    /// A piece of a capsule image, where it was loaded.
+    struct CapsuleFragment {
+        const void* data;
+        size_t size;
+    };
+
+    /// Builds the scatter-gather list of updateCapsule() around capsules which are already in memory, without copying
+    /// them: each fragment becomes a block descriptor, and fragments which follow each other in memory are merged.
+    /// All the descriptors go in a single allocation, ended by a null descriptor.
+    /// Boot services identity-map memory, so a buffer is physically contiguous and its address is its physical one.
+    /// @code
+    /// CapsuleBuilder builder;
+    /// builder.initialize();
+    /// builder.add(header, body_fragments);
+    /// if (builder.build(boot_services) == Status::Success && builder.validate(runtime_services, reset_type) == Status::Success)
+    ///     builder.submit(runtime_services);
+    /// @endcode
+    class CapsuleBuilder {
+    public:
+        using CapsuleHeader = RuntimeServices::CapsuleHeader;
+        using CapsuleBlockDescriptor = RuntimeServices::CapsuleBlockDescriptor;
+
+        /// Capsules passed in a single updateCapsule() call, at most.
+        static constexpr size_t max_capsule_count = 8;
+
+        void initialize() noexcept {
+            _capsuleCount = 0;
+            _descriptors = nullptr;
+            _descriptorCount = 0;
+            _pageCount = 0;
+        }
+
+        /// Adds a capsule whose image follows its header in memory, as when a capsule file is loaded whole.
+        /// @return InvalidParameter The header sizes are inconsistent.
+        /// @return OutOfResources There are already max_capsule_count capsules.
+        Status add(CapsuleHeader& capsule) noexcept {
+            if (capsule.header_size < sizeof(CapsuleHeader) || capsule.image_size < capsule.header_size)
+                return Status::InvalidParameter;
+
+            return _add(capsule, {}, capsule.image_size);
+        }
+
+        /// Adds a capsule whose header (of header_size bytes) is separate from its body, which is in pieces.
+        /// The fragments are not copied: they must stay valid until submit().
+        /// @return InvalidParameter The header sizes are inconsistent, or the fragments do not add up to the image.
+        /// @return OutOfResources There are already max_capsule_count capsules.
+        Status add(CapsuleHeader& header, Span<const CapsuleFragment> body) noexcept {
+            size_t body_size = 0;
+            for (const auto& fragment : body)
+                body_size += fragment.size;
+
+            if (header.header_size < sizeof(CapsuleHeader) || header.image_size != header.header_size + body_size)
+                return Status::InvalidParameter;
+
+            return _add(header, body, header.header_size);
+        }
+
+        /// Allocates the scatter-gather list and fills it. Build again after adding more capsules.
+        /// @return OutOfResources The pages could not be allocated.
+        Status build(BootServices& boot_services, MemoryType memory_type = MemoryType::LoaderData) noexcept {
+            release(boot_services);
+
+            // One descriptor per header and fragment at most, and the terminator.
+            size_t count = 1;
+            for (size_t i = 0; i < _capsuleCount; ++i)
+                count += 1 + _fragmentCounts[i];
+
+            const auto page_count = ((count * sizeof(CapsuleBlockDescriptor)) + page_size - 1) / page_size;
+            const auto pages = boot_services.allocatePages(memory_type, page_count);
+            if (!pages)
+                return pages.getStatus();
+
+            _descriptors = reinterpret_cast<CapsuleBlockDescriptor*>(static_cast<uintptr_t>(*pages));
+            _pageCount = page_count;
+            _descriptorCount = 0;
+
+            for (size_t i = 0; i < _capsuleCount; ++i) {
+                _append(_headers[i], _headerBlockSizes[i]);
+
+                for (size_t j = 0; j < _fragmentCounts[i]; ++j)
+                    _append(_fragments[i][j].data, _fragments[i][j].size);
+            }
+
+            _descriptors[_descriptorCount] = {0, 0};
+            return Status::Success;
+        }
+
+        /// Asks the firmware whether it accepts the capsules, and checks their total size against its limit.
+        /// @param[out] reset_type The reset needed to process the capsules.
+        /// @return Unsupported The firmware does not support these capsules, or they are too big.
+        Status validate(RuntimeServices& runtime_services, RuntimeServices::ResetType& reset_type) noexcept {
+            uint64_t max_size = 0;
+            const auto status = runtime_services.queryCapsuleCapabilities(_headers, _capsuleCount, max_size, reset_type);
+            if (status != Status::Success)
+                return status;
+
+            uint64_t total_size = 0;
+            for (size_t i = 0; i < _capsuleCount; ++i)
+                total_size += _headers[i]->image_size;
+
+            return total_size <= max_size ? Status::Success : Status::Unsupported;
+        }
+
+        /// Passes the capsules and the list to the firmware. Unless it fails, the list and the capsules must then be
+        /// left in memory for the firmware to find them after the reset.
+        /// @return NotReady build() has not been called.
+        Status submit(RuntimeServices& runtime_services) noexcept {
+            if (_descriptors == nullptr)
+                return Status::NotReady;
+
+            return runtime_services.updateCapsule(_headers, _capsuleCount, getScatterGatherList());
+        }
+
+        /// Frees the list.
+        void release(BootServices& boot_services) noexcept {
+            if (_descriptors != nullptr)
+                static_cast<void>(boot_services.freePages(getScatterGatherList(), _pageCount));
+
+            _descriptors = nullptr;
+            _descriptorCount = 0;
+            _pageCount = 0;
+        }
+
+        /// The physical address of the first descriptor, or 0 before build().
+        [[nodiscard]] RuntimeServices::PhysicalAddress getScatterGatherList() const noexcept {
+            return reinterpret_cast<uintptr_t>(_descriptors);
+        }
+
+        /// The descriptors, without the terminator.
+        [[nodiscard]] Span<const CapsuleBlockDescriptor> getDescriptors() const noexcept {
+            return {_descriptors, _descriptorCount};
+        }
+
+        [[nodiscard]] size_t getCapsuleCount() const noexcept {
+            return _capsuleCount;
+        }
+
+    private:
+        static constexpr size_t page_size = 0x1000;
+
+        Status _add(CapsuleHeader& header, Span<const CapsuleFragment> body, size_t header_block_size) noexcept {
+            if (_capsuleCount == max_capsule_count)
+                return Status::OutOfResources;
+
+            _headers[_capsuleCount] = &header;
+            _fragments[_capsuleCount] = body.getData();
+            _fragmentCounts[_capsuleCount] = body.getSize();
+            _headerBlockSizes[_capsuleCount] = header_block_size;
+            ++_capsuleCount;
+            return Status::Success;
+        }
+
+        /// Adds a block, or extends the last one if the block follows it in memory.
+        void _append(const void* data, size_t size) noexcept {
+            if (size == 0)
+                return;
+
+            const auto address = static_cast<RuntimeServices::PhysicalAddress>(reinterpret_cast<uintptr_t>(data));
+
+            if (_descriptorCount != 0) {
+                auto& last = _descriptors[_descriptorCount - 1];
+                if (last.address + last.length == address) {
+                    last.length += size;
+                    return;
+                }
+            }
+
+            _descriptors[_descriptorCount++] = {size, address};
+        }
+
+        CapsuleHeader* _headers[max_capsule_count];
+        const CapsuleFragment* _fragments[max_capsule_count];
+        size_t _fragmentCounts[max_capsule_count];
+        /// The size of the block starting at each header: header_size, or the whole image if it follows the header.
+        size_t _headerBlockSizes[max_capsule_count];
+        size_t _capsuleCount;
+
+        CapsuleBlockDescriptor* _descriptors;
+        size_t _descriptorCount;
+        size_t _pageCount;
+    };
+} // namespace Uefi
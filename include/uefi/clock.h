@@ -0,0 +1,184 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "boot_services.h"
+#include "detail/cpu_features.h"
+#include "detail/timestamp.h"
+#include "runtime_services.h"
+#include "status.h"
+#include "time.h"
+
+namespace Uefi {
+    namespace Detail {
+        // Conversions between dates and days since 1970-01-01, in the proleptic Gregorian calendar.
+        // See http://howardhinnant.github.io/date_algorithms.html
+
+        constexpr int64_t daysFromCivil(int64_t year, unsigned month, unsigned day) noexcept {
+            year -= month <= 2 ? 1 : 0;
+            const int64_t era = (year >= 0 ? year : year - 399) / 400;
+            const auto year_of_era = static_cast<unsigned>(year - (era * 400));
+            const unsigned day_of_year = ((153 * (month > 2 ? month - 3 : month + 9)) + 2) / 5 + day - 1;
+            const unsigned day_of_era = (year_of_era * 365) + (year_of_era / 4) - (year_of_era / 100) + day_of_year;
+            return (era * 146097) + static_cast<int64_t>(day_of_era) - 719468;
+        }
+
+        inline void civilFromDays(int64_t days, int64_t& year, unsigned& month, unsigned& day) noexcept {
+            days += 719468;
+            const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+            const auto day_of_era = static_cast<unsigned>(days - (era * 146097));
+            const unsigned year_of_era = (day_of_era - (day_of_era / 1460) + (day_of_era / 36524) - (day_of_era / 146096)) / 365;
+            const unsigned day_of_year = day_of_era - ((365 * year_of_era) + (year_of_era / 4) - (year_of_era / 100));
+            const unsigned shifted_month = ((5 * day_of_year) + 2) / 153;
+            day = day_of_year - (((153 * shifted_month) + 2) / 5) + 1;
+            month = shifted_month < 10 ? shifted_month + 3 : shifted_month - 9;
+            year = static_cast<int64_t>(year_of_era) + (era * 400) + (month <= 2 ? 1 : 0);
+        }
+    } // namespace Detail
+
+    /// Cheap, precise time: converts readings of the CPU's counter (Detail::readTimestamp()) to nanoseconds.
+    /// initialize() measures the counter's frequency once, and reads the real-time clock once, so that the wall-clock
+    /// time can later be derived from the counter too:
+    /// @code
+    /// clock.initialize(boot_services, &runtime_services);
+    /// const auto start = clock.now();
+    /// work();
+    /// output << "took " << clock.now() - start << " ns";
+    /// @endcode
+    /// Reading the clock only costs a counter read and a multiplication. It keeps working after exitBootServices().
+    class Clock {
+    public:
+        /// How long initialize() measures the counter for, by default.
+        static constexpr uint32_t default_calibration_time = 10000;
+
+        /// Finds the frequency of the counter: from the CPU if it reports it, otherwise by counting ticks during
+        /// stall(). Each of the 3 measurements takes `calibration_time` microseconds, and the shortest one is kept,
+        /// since the firmware can only stall for longer than asked.
+        /// @param runtime_services If not nullptr, its getTime() is read once as the base of getWallClock().
+        /// @return InvalidParameter `calibration_time` is 0.
+        /// @return Unsupported The CPU has no usable counter.
+        Status initialize(BootServices& boot_services, RuntimeServices* runtime_services = nullptr,
+                          uint32_t calibration_time = default_calibration_time) noexcept {
+            if (calibration_time == 0)
+                return Status::InvalidParameter;
+
+            _isInvariant = Detail::hasInvariantTimestamp();
+            _frequency = Detail::getTimestampFrequency();
+
+            if (_frequency == 0) {
+                uint64_t shortest = ~uint64_t{0};
+
+                for (size_t i = 0; i < 3; ++i) {
+                    const auto start = Detail::readTimestamp();
+                    const auto status = boot_services.stall(calibration_time);
+                    const auto ticks = Detail::readTimestamp() - start;
+
+                    if (status != Status::Success)
+                        return status;
+
+                    if (ticks < shortest)
+                        shortest = ticks;
+                }
+
+                if (shortest == 0)
+                    return Status::Unsupported;
+
+                _frequency = (shortest * 1000000) / calibration_time;
+            }
+
+            // Nanoseconds are ticks * 10^9 / frequency, computed as a multiplication by a 32.32 fixed-point factor.
+            _nanosecondsPerTick = (uint64_t{1000000000} << 32) / _frequency;
+            _hasWallClock = false;
+
+            if (runtime_services != nullptr) {
+                const auto time = runtime_services->getTime();
+                if (time) {
+                    _baseTime = *time;
+                    _baseSeconds = _toSeconds(*time);
+                    _hasWallClock = true;
+                }
+            }
+
+            // Taken last, so that the wall-clock base and the counter base are as close as possible.
+            _start = Detail::readTimestamp();
+            return Status::Success;
+        }
+
+        /// Nanoseconds since initialize().
+        [[nodiscard]] uint64_t now() const noexcept {
+            return toNanoseconds(Detail::readTimestamp() - _start);
+        }
+
+        /// Converts a number of counter ticks, like the difference of two Detail::readTimestamp(), to nanoseconds.
+        [[nodiscard]] uint64_t toNanoseconds(uint64_t ticks) const noexcept {
+#if defined(__SIZEOF_INT128__)
+            __extension__ typedef unsigned __int128 Product;
+            return static_cast<uint64_t>((static_cast<Product>(ticks) * _nanosecondsPerTick) >> 32);
+#else
+            return ((ticks / _frequency) * 1000000000) + (((ticks % _frequency) * 1000000000) / _frequency);
+#endif
+        }
+
+        /// The current date and time: the one read by initialize(), advanced by now(). It keeps the time zone and
+        /// daylight saving flags of the real-time clock.
+        /// @return false initialize() was not given the runtime services, or could not read the time.
+        bool getWallClock(Time& time) const noexcept {
+            if (!_hasWallClock)
+                return false;
+
+            const auto elapsed = now();
+            const auto seconds = _baseSeconds + (elapsed / 1000000000);
+            auto nanoseconds = _baseTime.nanosecond + (elapsed % 1000000000);
+            const auto carry = nanoseconds / 1000000000;
+            nanoseconds %= 1000000000;
+
+            const auto total_seconds = seconds + carry;
+            int64_t year;
+            unsigned month, day;
+            Detail::civilFromDays(static_cast<int64_t>(total_seconds / 86400), year, month, day);
+
+            const auto second_of_day = static_cast<uint32_t>(total_seconds % 86400);
+            time = _baseTime;
+            time.year = static_cast<uint16_t>(year);
+            time.month = static_cast<uint8_t>(month);
+            time.day = static_cast<uint8_t>(day);
+            time.hour = static_cast<uint8_t>(second_of_day / 3600);
+            time.minute = static_cast<uint8_t>((second_of_day / 60) % 60);
+            time.second = static_cast<uint8_t>(second_of_day % 60);
+            time.nanosecond = static_cast<uint32_t>(nanoseconds);
+            return true;
+        }
+
+        /// The counter value taken by initialize(), from which now() counts.
+        [[nodiscard]] uint64_t getStart() const noexcept {
+            return _start;
+        }
+
+        /// The frequency of the counter, in Hz.
+        [[nodiscard]] uint64_t getFrequency() const noexcept {
+            return _frequency;
+        }
+
+        /// Whether the counter keeps a constant rate when the CPU changes frequency or sleeps.
+        /// If not, now() is only accurate while the CPU runs at the frequency it had during initialize().
+        [[nodiscard]] bool isInvariant() const noexcept {
+            return _isInvariant;
+        }
+
+    private:
+        /// Seconds since 1970-01-01 00:00:00, in the time zone of `time`.
+        static uint64_t _toSeconds(const Time& time) noexcept {
+            const auto days = Detail::daysFromCivil(time.year, time.month, time.day);
+            return (static_cast<uint64_t>(days) * 86400) + (time.hour * 3600U) + (time.minute * 60U) + time.second;
+        }
+
+        uint64_t _start;
+        uint64_t _frequency;
+        uint64_t _nanosecondsPerTick;
+        bool _isInvariant;
+        bool _hasWallClock;
+        Time _baseTime;
+        uint64_t _baseSeconds;
+    };
+} // namespace Uefi
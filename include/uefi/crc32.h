@@ -10,17 +10,13 @@ namespace Uefi {
 
     struct Table;
 
-    /// Algorithm to calculate CCITT32 for a UEFI structure.
-    /// Original: http://stackoverflow.com/a/26051190
-    /// Adapted the original to C++ and turned table generator into a constexpr function.
-    /// @param data Pointer to the start of the structure.
-    /// @param size The size in bytes of the structure.
-    /// @return The calculated CRC32.
-    Crc32 calculateCrc32(const void* data, size_t size) noexcept {
-        constexpr static struct Crc32Table {
-            uint32_t data[256]{};
+    namespace Detail {
+        /// Lookup tables for the slicing-by-8 CRC32 algorithm, generated at compile time.
+        /// Table 0 is the usual byte-at-a-time table, table k gives the CRC of a byte followed by k zero bytes.
+        struct Crc32Tables {
+            uint32_t data[8][256]{};
 
-            constexpr Crc32Table() {
+            constexpr Crc32Tables() {
                 // 0xEDB88320 is 0x04C11DB7 but with changed endianess.
                 constexpr uint32_t polynomial = 0xEDB88320;
 
@@ -33,23 +29,50 @@ namespace Uefi {
                         else
                             remainder = (remainder >> 1);
 
-                    data[i] = remainder;
+                    data[0][i] = remainder;
                 }
-            }
 
-            uint32_t operator[](uint8_t i) const {
-                return data[i];
+                for (uint32_t k = 1; k < 8; ++k)
+                    for (uint32_t i = 0; i < 256; ++i)
+                        data[k][i] = (data[k - 1][i] >> 8) ^ data[0][data[k - 1][i] & 0xFF];
             }
+        };
 
-        } crc_table;
+        inline constexpr Crc32Tables crc32_tables{};
+    } // namespace Detail
 
-        Crc32 crc = 0xFF'FF'FF'FF;
+    /// Algorithm to calculate CCITT32 for a UEFI structure.
+    /// Original: http://stackoverflow.com/a/26051190
+    /// Adapted the original to C++ and turned table generator into a constexpr function.
+    /// The data is processed 8 bytes at a time (slicing-by-8), which is several times faster than one byte at a time
+    /// and, unlike BootServices::CalculateCrc32, keeps working after exitBootServices().
+    /// @param data Pointer to the start of the structure.
+    /// @param size The size in bytes of the structure.
+    /// @param previous The CRC of the data preceding this buffer, to compute a CRC over several buffers.
+    /// @return The calculated CRC32.
+    inline Crc32 calculateCrc32(const void* data, size_t size, Crc32 previous = 0) noexcept {
+        const auto& table = Detail::crc32_tables.data;
+
+        Crc32 crc = ~previous;
 
         // Pointer to go through the data.
         const auto* ptr = reinterpret_cast<const uint8_t*>(data);
 
-        for (size_t i = 0; i < size; ++i, ++ptr)
-            crc = crc_table[*ptr ^ (crc & 0xFF)] ^ (crc >> 8);
+        // UEFI is always little endian, so the words can be folded in as they are.
+        for (; size >= 8; size -= 8, ptr += 8) {
+            uint32_t low = 0;
+            uint32_t high = 0;
+            __builtin_memcpy(&low, ptr, 4);
+            __builtin_memcpy(&high, ptr + 4, 4);
+
+            low ^= crc;
+
+            crc = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^ table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24] ^
+                table[3][high & 0xFF] ^ table[2][(high >> 8) & 0xFF] ^ table[1][(high >> 16) & 0xFF] ^ table[0][high >> 24];
+        }
+
+        for (; size != 0; --size, ++ptr)
+            crc = table[0][*ptr ^ (crc & 0xFF)] ^ (crc >> 8);
 
         return ~crc;
     }
@@ -57,7 +80,7 @@ namespace Uefi {
     /// Calculates the CRC32 of an UEFI table.
     /// @param table The table to calculate.
     /// @return The CRC of the table.
-    Crc32 calculateCrc32(Table& table) noexcept {
+    inline Crc32 calculateCrc32(Table& table) noexcept {
         // CRC must be set to 0 before calculating.
         const auto crc = table.header.crc32;
 
@@ -74,7 +97,7 @@ namespace Uefi {
     /// Verifies an UEFI table's integrity.
     /// @param table The table to check.
     /// @return True if the table's specified CRC value matches the table's specified CRC.
-    bool doesCrc32Match(Table& table) noexcept {
+    inline bool doesCrc32Match(Table& table) noexcept {
         return table.header.crc32 == calculateCrc32(table);
     }
 } // namespace Uefi
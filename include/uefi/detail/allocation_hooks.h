@@ -0,0 +1,17 @@
+#pragma once
+
+// The hooks of the allocation functions of BootServices, which report to the installed AllocationProfiler when
+// UEFI_ALLOCATION_PROFILER is defined, and are nothing otherwise.
+
+#if defined(UEFI_ALLOCATION_PROFILER)
+#include "../allocation_profiler.h"
+
+/// Adds the call site parameter to the allocation functions.
+#define UEFI_ALLOCATION_SITE_PARAMETER , ::Uefi::AllocationSite site = ::Uefi::AllocationSite::current()
+#define UEFI_RECORD_ALLOCATION(address, size, type) ::Uefi::Detail::recordAllocation(address, size, type, site)
+#define UEFI_RECORD_FREE(address) ::Uefi::Detail::recordFree(address)
+#else
+#define UEFI_ALLOCATION_SITE_PARAMETER
+#define UEFI_RECORD_ALLOCATION(address, size, type) static_cast<void>(0)
+#define UEFI_RECORD_FREE(address) static_cast<void>(0)
+#endif
@@ -1,30 +1,32 @@
 #pragma once
 
 #include <cstdint>
+#include <type_traits>
 
 namespace Uefi {
 /// Generates bit operators for a given enum.
+/// The operators work on the enum's underlying type, so they are safe for 32-bit flag enums as well.
 /// @hideinitializer
 #define UEFI_BIT_FLAGS(E) \
     inline constexpr auto operator|(E lhs, E rhs) { \
-        return static_cast<E>(static_cast<std::uint64_t>(lhs) | static_cast<std::uint64_t>(rhs)); \
+        return static_cast<E>(static_cast<std::underlying_type_t<E>>(lhs) | static_cast<std::underlying_type_t<E>>(rhs)); \
     } \
 \
     inline auto operator|=(E& lhs, E rhs) { \
-        reinterpret_cast<std::uint64_t&>(lhs) |= static_cast<std::uint64_t>(rhs); \
+        reinterpret_cast<std::underlying_type_t<E>&>(lhs) |= static_cast<std::underlying_type_t<E>>(rhs); \
         return lhs; \
     } \
 \
     inline constexpr auto operator&(E lhs, E rhs) { \
-        return static_cast<E>(static_cast<std::uint64_t>(lhs) & static_cast<std::uint64_t>(rhs)); \
+        return static_cast<E>(static_cast<std::underlying_type_t<E>>(lhs) & static_cast<std::underlying_type_t<E>>(rhs)); \
     } \
 \
     inline auto operator&=(E& lhs, E rhs) { \
-        reinterpret_cast<std::uint64_t&>(lhs) &= static_cast<std::uint64_t>(rhs); \
+        reinterpret_cast<std::underlying_type_t<E>&>(lhs) &= static_cast<std::underlying_type_t<E>>(rhs); \
         return lhs; \
     } \
 \
     inline constexpr auto operator~(E lhs) { \
-        return static_cast<E>(~static_cast<std::uint64_t>(lhs)); \
+        return static_cast<E>(~static_cast<std::underlying_type_t<E>>(lhs)); \
     }
 } // namespace Uefi
@@ -0,0 +1,10 @@
+#pragma once
+
+/// Tells the compiler which way a condition usually goes, so it lays out the likely path as the straight line.
+/// Error checks after firmware calls are the main use.
+/// @{
+/// @hideinitializer
+#define UEFI_LIKELY(condition) __builtin_expect(static_cast<bool>(condition), 1)
+/// @hideinitializer
+#define UEFI_UNLIKELY(condition) __builtin_expect(static_cast<bool>(condition), 0)
+/// @}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Uefi::Detail {
+    /// The 8-bit sum of some bytes. ACPI and SMBIOS structures are valid if their bytes add up to 0.
+    inline uint8_t sumBytes(const void* data, size_t size) noexcept {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        uint8_t sum = 0;
+
+        for (size_t i = 0; i < size; ++i)
+            sum = static_cast<uint8_t>(sum + bytes[i]);
+
+        return sum;
+    }
+} // namespace Uefi::Detail
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Uefi::Detail {
+#if defined(__x86_64__) || defined(__i386__)
+    struct CpuidResult {
+        uint32_t eax, ebx, ecx, edx;
+    };
+
+    inline CpuidResult cpuid(uint32_t leaf, uint32_t subleaf = 0) noexcept {
+        CpuidResult result;
+        asm volatile("cpuid" : "=a"(result.eax), "=b"(result.ebx), "=c"(result.ecx), "=d"(result.edx) : "a"(leaf), "c"(subleaf));
+        return result;
+    }
+#endif
+
+    /// Whether the CPU can run the SHA-256 instructions: SHA-NI with SSSE3 and SSE4.1 on x86, the SHA2 crypto
+    /// extension on AArch64.
+    inline bool hasSha256Instructions() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+        if (cpuid(0).eax < 7)
+            return false;
+
+        const auto features = cpuid(1);
+        const auto extended_features = cpuid(7);
+        const bool has_ssse3 = (features.ecx & (1u << 9)) != 0;
+        const bool has_sse41 = (features.ecx & (1u << 19)) != 0;
+        const bool has_sha = (extended_features.ebx & (1u << 29)) != 0;
+        return has_ssse3 && has_sse41 && has_sha;
+#elif defined(__aarch64__)
+        // UEFI runs at EL1 or EL2, where the ID registers can be read directly.
+        uint64_t isar0;
+        asm volatile("mrs %0, id_aa64isar0_el1" : "=r"(isar0));
+        return ((isar0 >> 12) & 0xF) != 0;
+#else
+        return false;
+#endif
+    }
+
+    /// Whether readTimestamp() counts at a constant rate, whatever the power state and frequency of the CPU.
+    inline bool hasInvariantTimestamp() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+        if (cpuid(0x80000000).eax < 0x80000007)
+            return false;
+
+        return (cpuid(0x80000007).edx & (1u << 8)) != 0;
+#elif defined(__aarch64__) || defined(__riscv)
+        // The generic timer and the time CSR are defined to have a fixed frequency.
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /// Whether x86 page tables can map 1 GiB pages.
+    inline bool hasGigabytePages() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+        if (cpuid(0x80000000).eax < 0x80000001)
+            return false;
+
+        return (cpuid(0x80000001).edx & (1u << 26)) != 0;
+#else
+        return false;
+#endif
+    }
+} // namespace Uefi::Detail
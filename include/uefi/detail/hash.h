@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "../guid.h"
+
+namespace Uefi::Detail {
+    /// Spreads every bit of a 64-bit value over the whole result (the finalizer of SplitMix64), so that keys that only
+    /// differ in their low or high bits, like addresses and handles, still land far apart in a hash table.
+    constexpr uint64_t mixBits(uint64_t value) noexcept {
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EB;
+        return value ^ (value >> 31);
+    }
+
+    /// The hash of FlatMap keys. Specialize it for other key types.
+    template <typename T, typename = void>
+    struct Hash;
+
+    template <typename T>
+    struct Hash<T, std::enable_if_t<std::is_integral_v<T> || std::is_enum_v<T>>> {
+        constexpr uint64_t operator()(T value) const noexcept {
+            return mixBits(static_cast<uint64_t>(value));
+        }
+    };
+
+    template <typename T>
+    struct Hash<T*> {
+        uint64_t operator()(const T* value) const noexcept {
+            return mixBits(reinterpret_cast<uintptr_t>(value));
+        }
+    };
+
+    template <>
+    struct Hash<Guid> {
+        uint64_t operator()(const Guid& value) const noexcept {
+            return mixBits(value.b.data1 ^ mixBits(value.b.data2));
+        }
+    };
+} // namespace Uefi::Detail
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Uefi::Detail {
+    // These use the compiler builtins instead of <cstring>, which is not guaranteed to be available in a freestanding
+    // environment. The compiler either inlines them or emits calls to memcpy() / memmove() / memset(), which every
+    // UEFI toolchain already has to provide for its own code generation.
+    // Unlike BootServices::copyMem() and setMem(), they keep working after exitBootServices().
+
+    /// Copies `size` bytes between two non-overlapping buffers.
+    inline void copyBytes(void* destination, const void* source, size_t size) noexcept {
+        __builtin_memcpy(destination, source, size);
+    }
+
+    /// Copies `size` bytes between two buffers that might overlap.
+    inline void moveBytes(void* destination, const void* source, size_t size) noexcept {
+        __builtin_memmove(destination, source, size);
+    }
+
+    /// Fills `size` bytes of a buffer with `value`.
+    inline void setBytes(void* destination, uint8_t value, size_t size) noexcept {
+        __builtin_memset(destination, value, size);
+    }
+
+    /// Fills `count` 32-bit words of a buffer with `value`.
+    inline void setWords32(uint32_t* destination, uint32_t value, size_t count) noexcept {
+        for (size_t i = 0; i < count; ++i)
+            destination[i] = value;
+    }
+} // namespace Uefi::Detail
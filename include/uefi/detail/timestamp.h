@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Uefi::Detail {
+    /// Reads the CPU's free-running counter: the TSC on x86, CNTVCT on AArch64, the time CSR on RISC-V.
+    /// Only differences between two readings are meaningful, and their unit depends on the CPU.
+    /// Returns 0 on other architectures.
+    inline uint64_t readTimestamp() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+        return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+        uint64_t value;
+        asm volatile("isb; mrs %0, cntvct_el0" : "=r"(value));
+        return value;
+#elif defined(__riscv) && __riscv_xlen == 64
+        uint64_t value;
+        asm volatile("rdtime %0" : "=r"(value));
+        return value;
+#else
+        return 0;
+#endif
+    }
+
+    /// The frequency of readTimestamp(), in Hz, when the CPU reports it: CNTFRQ on AArch64.
+    /// Returns 0 when it has to be measured.
+    inline uint64_t getTimestampFrequency() noexcept {
+#if defined(__aarch64__)
+        uint64_t value;
+        asm volatile("mrs %0, cntfrq_el0" : "=r"(value));
+        return value;
+#else
+        return 0;
+#endif
+    }
+} // namespace Uefi::Detail
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace Uefi::Detail {
+    /// Upper-cases the ASCII letters, which is the case folding UEFI file systems are required to support.
+    constexpr char16_t toUpperAscii(char16_t character) noexcept {
+        return character >= u'a' && character <= u'z' ? static_cast<char16_t>(character - (u'a' - u'A')) : character;
+    }
+
+    /// Whether a 16-byte load at `address` stays in its page, and so cannot fault even if it reads past the end of a
+    /// string.
+    inline bool isWithinPage(const void* address) noexcept {
+        return (reinterpret_cast<uintptr_t>(address) & 0xFFF) <= 0x1000 - 16;
+    }
+
+    // The vector paths need nothing beyond the baseline of their architecture: SSE2 is part of x86-64, and the UEFI
+    // specification lets applications use it and NEON. Other targets use the scalar loops of ucs2.h.
+#if defined(__SSE2__) || defined(__ARM_NEON)
+#define UEFI_UCS2_VECTORS 1
+
+    /// 8 characters.
+    struct Ucs2Vector {
+#if defined(__SSE2__)
+        __m128i value;
+
+        /// A bit mask with `mask_bits` bits for each character, lowest first.
+        static constexpr unsigned mask_bits = 2;
+
+        static Ucs2Vector loadAligned(const char16_t* characters) noexcept {
+            return {_mm_load_si128(reinterpret_cast<const __m128i*>(characters))};
+        }
+
+        static Ucs2Vector load(const char16_t* characters) noexcept {
+            return {_mm_loadu_si128(reinterpret_cast<const __m128i*>(characters))};
+        }
+
+        static Ucs2Vector broadcast(char16_t character) noexcept {
+            return {_mm_set1_epi16(static_cast<short>(character))};
+        }
+
+        /// The mask of the characters equal in both vectors.
+        uint32_t equals(Ucs2Vector other) const noexcept {
+            return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi16(value, other.value)));
+        }
+
+        /// The mask of the null characters.
+        uint32_t nulls() const noexcept {
+            return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi16(value, _mm_setzero_si128())));
+        }
+
+        static constexpr uint32_t all = 0xFFFF;
+
+        /// toUpperAscii() on every character. The signed comparisons leave the characters from U+8000 untouched.
+        Ucs2Vector toUpperAscii() const noexcept {
+            const auto is_lower = _mm_and_si128(_mm_cmpgt_epi16(value, _mm_set1_epi16('a' - 1)), _mm_cmplt_epi16(value, _mm_set1_epi16('z' + 1)));
+            return {_mm_sub_epi16(value, _mm_and_si128(is_lower, _mm_set1_epi16('a' - 'A')))};
+        }
+#else
+        uint16x8_t value;
+
+        static constexpr unsigned mask_bits = 8;
+
+        static Ucs2Vector loadAligned(const char16_t* characters) noexcept {
+            return load(characters);
+        }
+
+        static Ucs2Vector load(const char16_t* characters) noexcept {
+            return {vld1q_u16(reinterpret_cast<const uint16_t*>(characters))};
+        }
+
+        static Ucs2Vector broadcast(char16_t character) noexcept {
+            return {vdupq_n_u16(character)};
+        }
+
+        // NEON has no movemask: narrowing each 16-bit lane of the comparison to 8 bits gives a 64-bit mask instead.
+        static uint64_t _toMask(uint16x8_t comparison) noexcept {
+            return vget_lane_u64(vreinterpret_u64_u8(vmovn_u16(comparison)), 0);
+        }
+
+        uint64_t equals(Ucs2Vector other) const noexcept {
+            return _toMask(vceqq_u16(value, other.value));
+        }
+
+        uint64_t nulls() const noexcept {
+            return _toMask(vceqq_u16(value, vdupq_n_u16(0)));
+        }
+
+        static constexpr uint64_t all = ~uint64_t{0};
+
+        Ucs2Vector toUpperAscii() const noexcept {
+            const auto is_lower = vcltq_u16(vsubq_u16(value, vdupq_n_u16('a')), vdupq_n_u16(26));
+            return {vsubq_u16(value, vandq_u16(is_lower, vdupq_n_u16('a' - 'A')))};
+        }
+#endif
+
+        /// The index of the first character set in a non-zero mask.
+        template <typename Mask>
+        static size_t getFirst(Mask mask) noexcept {
+            return static_cast<size_t>(__builtin_ctzll(mask)) / mask_bits;
+        }
+    };
+#endif
+} // namespace Uefi::Detail
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "memory.h"
+
+namespace Uefi::Detail {
+    /// Incremental 32-bit xxHash, used by the LZ4 frame format for its checksums.
+    /// See https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+    class Xxh32 {
+    public:
+        void initialize(uint32_t seed = 0) noexcept {
+            _accumulators[0] = seed + prime1 + prime2;
+            _accumulators[1] = seed + prime2;
+            _accumulators[2] = seed;
+            _accumulators[3] = seed - prime1;
+            _seed = seed;
+            _bufferSize = 0;
+            _totalSize = 0;
+        }
+
+        void update(const void* data, size_t size) noexcept {
+            const auto* bytes = static_cast<const uint8_t*>(data);
+            _totalSize += size;
+
+            // Completes the stripe started by the previous call.
+            if (_bufferSize != 0) {
+                const auto count = size < 16 - _bufferSize ? size : 16 - _bufferSize;
+                copyBytes(_buffer + _bufferSize, bytes, count);
+                _bufferSize += count;
+                bytes += count;
+                size -= count;
+
+                if (_bufferSize < 16)
+                    return;
+
+                _consumeStripe(_buffer);
+                _bufferSize = 0;
+            }
+
+            for (; size >= 16; bytes += 16, size -= 16)
+                _consumeStripe(bytes);
+
+            copyBytes(_buffer, bytes, size);
+            _bufferSize = size;
+        }
+
+        [[nodiscard]] uint32_t finish() const noexcept {
+            uint32_t hash;
+
+            if (_totalSize >= 16)
+                hash = _rotate(_accumulators[0], 1) + _rotate(_accumulators[1], 7) + _rotate(_accumulators[2], 12) + _rotate(_accumulators[3], 18);
+            else
+                hash = _seed + prime5;
+
+            hash += static_cast<uint32_t>(_totalSize);
+
+            size_t i = 0;
+            for (; i + 4 <= _bufferSize; i += 4)
+                hash = _rotate(hash + (_read32(_buffer + i) * prime3), 17) * prime4;
+
+            for (; i < _bufferSize; ++i)
+                hash = _rotate(hash + (_buffer[i] * prime5), 11) * prime1;
+
+            hash ^= hash >> 15;
+            hash *= prime2;
+            hash ^= hash >> 13;
+            hash *= prime3;
+            hash ^= hash >> 16;
+
+            return hash;
+        }
+
+        /// Hashes a whole buffer at once.
+        static uint32_t calculate(const void* data, size_t size, uint32_t seed = 0) noexcept {
+            Xxh32 hash;
+            hash.initialize(seed);
+            hash.update(data, size);
+            return hash.finish();
+        }
+
+    private:
+        static constexpr uint32_t prime1 = 0x9E3779B1;
+        static constexpr uint32_t prime2 = 0x85EBCA77;
+        static constexpr uint32_t prime3 = 0xC2B2AE3D;
+        static constexpr uint32_t prime4 = 0x27D4EB2F;
+        static constexpr uint32_t prime5 = 0x165667B1;
+
+        static constexpr uint32_t _rotate(uint32_t value, int bits) noexcept {
+            return (value << bits) | (value >> (32 - bits));
+        }
+
+        static uint32_t _read32(const uint8_t* bytes) noexcept {
+            uint32_t value;
+            copyBytes(&value, bytes, sizeof(value));
+            return value;
+        }
+
+        void _consumeStripe(const uint8_t* stripe) noexcept {
+            for (size_t i = 0; i < 4; ++i)
+                _accumulators[i] = _rotate(_accumulators[i] + (_read32(stripe + (i * 4)) * prime2), 13) * prime1;
+        }
+
+        uint32_t _accumulators[4];
+        uint32_t _seed;
+        uint8_t _buffer[16];
+        size_t _bufferSize;
+        uint64_t _totalSize;
+    };
+} // namespace Uefi::Detail
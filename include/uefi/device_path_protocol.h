@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "guid.h"
+
+namespace Uefi {
+    /// The header of a device path node. A device path is a sequence of nodes of varying size, ended by an end node.
+    /// The nodes are packed, so they are only ever handled through pointers to firmware memory.
+    struct DevicePathProtocol {
+        static constexpr Guid guid = {0x09576e91, 0x6d3f, 0x11d2, {0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b}};
+
+        static constexpr uint8_t end_type = 0x7F;
+        static constexpr uint8_t end_entire_sub_type = 0xFF;
+
+        uint8_t type;
+        uint8_t sub_type;
+        /// The size of the node, this header included, little-endian and unaligned.
+        uint8_t length[2];
+
+        [[nodiscard]] size_t getLength() const noexcept {
+            return length[0] | (size_t{length[1]} << 8);
+        }
+
+        [[nodiscard]] bool isEnd() const noexcept {
+            return type == end_type && sub_type == end_entire_sub_type;
+        }
+
+        [[nodiscard]] const DevicePathProtocol* getNext() const noexcept {
+            return reinterpret_cast<const DevicePathProtocol*>(reinterpret_cast<const uint8_t*>(this) + getLength());
+        }
+
+        /// The size of the whole path, the end node included.
+        [[nodiscard]] size_t getSize() const noexcept {
+            const auto* node = this;
+            for (; !node->isEnd(); node = node->getNext()) {
+            }
+
+            return reinterpret_cast<const uint8_t*>(node) - reinterpret_cast<const uint8_t*>(this) + node->getLength();
+        }
+    };
+
+    static_assert(sizeof(DevicePathProtocol) == 4);
+} // namespace Uefi
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "detail/branch_hints.h"
+#include "detail/memory.h"
+#include "file_protocol.h"
+#include "result.h"
+#include "status.h"
+#include "ucs2.h"
+
+namespace Uefi {
+    /// Reads the entries of a directory, skipping "." and "..".
+    /// The firmware returns one entry per read(), so the iterator owns a buffer which fits any entry a FAT volume can
+    /// hold, and reuses it: no read has to be retried with a larger guess, and nothing is allocated.
+    /// @code
+    /// DirectoryIterator iterator;
+    /// iterator.initialize(*directory);
+    /// for (auto entry = iterator.next(); entry && *entry != nullptr; entry = iterator.next())
+    ///     use(**entry);
+    /// @endcode
+    class DirectoryIterator {
+    public:
+        /// The fixed part of FileInfo, a name of 255 characters, the longest FAT allows, and its terminator.
+        static constexpr size_t buffer_size = offsetof(FileInfo, file_name) + (256 * sizeof(char16_t));
+
+        /// Starts again from the first entry of `directory`.
+        Status initialize(FileProtocol& directory) noexcept {
+            _directory = &directory;
+            return directory.setPosition(0);
+        }
+
+        /// Reads the next entry. It stays valid until the next call.
+        /// @return nullptr There are no more entries.
+        /// @return BufferTooSmall The entry's name is longer than FAT allows.
+        Result<const FileInfo*> next() noexcept {
+            auto* info = reinterpret_cast<const FileInfo*>(_buffer);
+
+            for (;;) {
+                const auto size = _directory->read(_buffer, buffer_size);
+                if (UEFI_UNLIKELY(!size))
+                    return size.getStatus();
+
+                if (*size == 0)
+                    return static_cast<const FileInfo*>(nullptr);
+
+                if (!_isDotEntry(info->file_name))
+                    return info;
+            }
+        }
+
+    private:
+        static bool _isDotEntry(const char16_t* name) noexcept {
+            return name[0] == u'.' && (name[1] == 0 || (name[1] == u'.' && name[2] == 0));
+        }
+
+        FileProtocol* _directory;
+        alignas(8) uint8_t _buffer[buffer_size];
+    };
+
+    /// Returned by the visitor of walkDirectory().
+    enum class WalkAction {
+        /// Goes on, descending into the entry if it is a directory.
+        Continue,
+        /// Goes on, but does not descend into the entry.
+        Skip,
+        /// Ends the walk.
+        Stop
+    };
+
+    namespace Detail {
+        template <typename Visitor>
+        class DirectoryWalker {
+        public:
+            /// Paths longer than this, in characters, make the walk fail with BufferTooSmall.
+            static constexpr size_t max_path_length = 1024;
+
+            DirectoryWalker(Visitor& visitor, size_t max_depth) : _visitor(visitor), _maxDepth(max_depth) {}
+
+            Status walk(FileProtocol& directory, size_t depth, size_t path_length) {
+                DirectoryIterator iterator;
+                auto status = iterator.initialize(directory);
+                if (status != Status::Success)
+                    return status;
+
+                for (;;) {
+                    const auto entry = iterator.next();
+                    if (!entry)
+                        return entry.getStatus();
+
+                    const auto* info = *entry;
+                    if (info == nullptr)
+                        return Status::Success;
+
+                    const auto name_length = getStringLength(info->file_name);
+                    if (path_length + 1 + name_length >= max_path_length)
+                        return Status::BufferTooSmall;
+
+                    _path[path_length] = u'\\';
+                    copyBytes(_path + path_length + 1, info->file_name, (name_length + 1) * sizeof(char16_t));
+
+                    const auto action = _visitor(static_cast<const char16_t*>(_path), depth, *info);
+
+                    if (action == WalkAction::Stop) {
+                        _stopped = true;
+                        return Status::Success;
+                    }
+
+                    if (action == WalkAction::Continue && info->isDirectory() && depth < _maxDepth) {
+                        const auto child = directory.open(_path + path_length + 1, OpenMode::Read);
+                        if (!child)
+                            return child.getStatus();
+
+                        status = walk(**child, depth + 1, path_length + 1 + name_length);
+                        (*child)->close();
+
+                        if (status != Status::Success || _stopped)
+                            return status;
+                    }
+                }
+            }
+
+        private:
+            Visitor& _visitor;
+            size_t _maxDepth;
+            bool _stopped = false;
+            char16_t _path[max_path_length];
+        };
+    } // namespace Detail
+
+    /// Visits every entry under `root`, depth-first, calling
+    /// `WalkAction visitor(const char16_t* path, size_t depth, const FileInfo& info)`.
+    /// The path starts with a backslash and is relative to `root`; depth is 0 for the entries of `root` itself.
+    /// Directories are visited before their contents, which lets the visitor skip them.
+    /// @param max_depth The deepest level visited.
+    /// @return Success The walk completed, or the visitor stopped it.
+    template <typename Visitor>
+    Status walkDirectory(FileProtocol& root, Visitor visitor, size_t max_depth = 8) {
+        Detail::DirectoryWalker<Visitor> walker(visitor, max_depth);
+        return walker.walk(root, 0, 0);
+    }
+} // namespace Uefi
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "guid.h"
+#include "non_copyable.h"
+#include "status.h"
+
+namespace Uefi {
+    /// Byte-granular access to a block device. Produced by the firmware on top of BlockIoProtocol.
+    class DiskIoProtocol : private NonCopyable {
+    public:
+        static constexpr Guid guid = {0xce345171, 0xba0b, 0x11d2, {0x8e, 0x4f, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b}};
+
+        uint64_t revision;
+
+        /// Reads a specified number of bytes from a device.
+        /// @param offset The starting byte offset on the device.
+        /// @return Success The data was read correctly from the device.
+        /// @return DeviceError The device reported an error while performing the read.
+        /// @return NoMedia There is no media in the device.
+        /// @return MediaChanged media_id is not for the current media.
+        /// @return InvalidParameter The read request contains device addresses that are not valid for the device.
+        Status readDisk(uint32_t media_id, uint64_t offset, size_t buffer_size, void* buffer) {
+            return _readDisk(this, media_id, offset, buffer_size, buffer);
+        }
+
+        /// Writes a specified number of bytes to a device.
+        /// @return WriteProtected The device cannot be written to.
+        /// @see readDisk() for the other return values.
+        Status writeDisk(uint32_t media_id, uint64_t offset, size_t buffer_size, const void* buffer) {
+            return _writeDisk(this, media_id, offset, buffer_size, buffer);
+        }
+
+    private:
+        Status (*_readDisk)(DiskIoProtocol*, uint32_t, uint64_t, size_t, void*);
+        Status (*_writeDisk)(DiskIoProtocol*, uint32_t, uint64_t, size_t, const void*);
+    };
+} // namespace Uefi
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+
+#include "detail/bit_flags.h"
+
+namespace Uefi {
+    // The parts of the ELF64 format needed to load executables.
+    // See https://refspecs.linuxfoundation.org/elf/gabi4+/contents.html
+
+    enum class ElfType : uint16_t {
+        None,
+        Relocatable,
+        /// Linked to run at a fixed address.
+        Executable,
+        /// Position independent: can run anywhere once relocated.
+        SharedObject,
+        Core
+    };
+
+    enum class ElfMachine : uint16_t {
+        X86_64 = 62,
+        AArch64 = 183,
+        RiscV = 243
+    };
+
+    struct Elf64Header {
+        /// "\x7F" "ELF"
+        static constexpr uint32_t expected_magic = 0x464c457f;
+        static constexpr uint8_t class_64 = 2;
+        static constexpr uint8_t little_endian = 1;
+
+        uint32_t magic;
+        uint8_t elf_class;
+        uint8_t data_encoding;
+        uint8_t identification_version;
+        uint8_t os_abi;
+        uint8_t abi_version;
+        uint8_t padding[7];
+
+        ElfType type;
+        ElfMachine machine;
+        uint32_t version;
+        /// The virtual address of the entry point.
+        uint64_t entry;
+        /// File offset of the program header table.
+        uint64_t program_header_offset;
+        uint64_t section_header_offset;
+        uint32_t flags;
+        uint16_t header_size;
+        uint16_t program_header_size;
+        uint16_t program_header_count;
+        uint16_t section_header_size;
+        uint16_t section_header_count;
+        uint16_t section_name_index;
+    };
+
+    static_assert(sizeof(Elf64Header) == 64);
+
+    struct Elf64ProgramHeader {
+        enum class Type : uint32_t {
+            Null,
+            /// A segment to load in memory.
+            Load,
+            /// The dynamic section, which locates the relocations.
+            Dynamic,
+            Interpreter,
+            Note,
+            SharedLibrary,
+            ProgramHeader,
+            ThreadLocalStorage
+        };
+
+        enum class Flags : uint32_t {
+            Execute = 1,
+            Write = 2,
+            Read = 4
+        };
+
+        Type type;
+        Flags flags;
+        /// Where the segment's bytes are in the file.
+        uint64_t offset;
+        uint64_t virtual_address;
+        uint64_t physical_address;
+        /// How many bytes to read from the file.
+        uint64_t file_size;
+        /// How many bytes the segment takes in memory. The bytes after file_size are zeroed.
+        uint64_t memory_size;
+        uint64_t alignment;
+    };
+
+    static_assert(sizeof(Elf64ProgramHeader) == 56);
+
+    UEFI_BIT_FLAGS(Elf64ProgramHeader::Flags);
+
+    /// An entry of the dynamic section.
+    struct Elf64Dynamic {
+        enum class Tag : int64_t {
+            Null = 0,
+            Rela = 7,
+            RelaSize = 8,
+            RelaEntrySize = 9,
+            Rel = 17,
+            RelrSize = 35,
+            Relr = 36,
+            RelrEntrySize = 37
+        };
+
+        Tag tag;
+        uint64_t value;
+    };
+
+    /// A relocation with an explicit addend.
+    struct Elf64Rela {
+        uint64_t offset;
+        uint64_t info;
+        int64_t addend;
+
+        [[nodiscard]] uint32_t getType() const noexcept {
+            return static_cast<uint32_t>(info);
+        }
+    };
+
+    /// The relocation types which only add the load bias, for the architectures supported by ElfMachine.
+    /// @{
+    constexpr uint32_t elf_relocation_none = 0;
+    constexpr uint32_t elf_relocation_x86_64_relative = 8;
+    constexpr uint32_t elf_relocation_aarch64_relative = 1027;
+    constexpr uint32_t elf_relocation_riscv_relative = 3;
+    /// @}
+} // namespace Uefi
@@ -0,0 +1,454 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "boot_services.h"
+#include "detail/memory.h"
+#include "detail/timestamp.h"
+#include "elf.h"
+#include "file_protocol.h"
+#include "memory_type.h"
+#include "status.h"
+
+namespace Uefi {
+    struct ElfLoadOptions {
+        /// The type of the pages holding the image.
+        MemoryType memory_type = MemoryType::LoaderData;
+
+        /// Where to load a position independent image. Must be page aligned. 0 lets the firmware choose.
+        /// Executables are always loaded at their physical addresses.
+        BootServices::PhysicalAddress base = 0;
+
+        /// The architecture the image must be built for.
+#if defined(__aarch64__)
+        ElfMachine machine = ElfMachine::AArch64;
+#elif defined(__riscv)
+        ElfMachine machine = ElfMachine::RiscV;
+#else
+        ElfMachine machine = ElfMachine::X86_64;
+#endif
+    };
+
+    /// What loadElf() did.
+    struct ElfLoadReport {
+        /// The pages holding the image. Free them with BootServices::freePages() if the image is not started.
+        BootServices::PhysicalAddress base;
+        size_t page_count;
+
+        /// Added to the link-time addresses of a position independent image. 0 for executables.
+        uint64_t load_bias;
+
+        /// The entry point, as a virtual address (relocated if the image is position independent).
+        uint64_t entry_point;
+        /// Where the entry point ended up in physical memory.
+        BootServices::PhysicalAddress physical_entry_point;
+
+        size_t segment_count;
+        size_t relocation_count;
+
+        /// How many bytes were read from the file into the segments, and how many were zeroed after them.
+        uint64_t bytes_read, bytes_zeroed;
+
+        /// Time spent reading segments, and in the whole load, in Detail::readTimestamp() units.
+        uint64_t read_ticks, total_ticks;
+
+        /// @param ticks_per_second The frequency of Detail::readTimestamp().
+        /// @return How fast the segments were read, in bytes per second.
+        [[nodiscard]] uint64_t getReadThroughput(uint64_t ticks_per_second) const noexcept {
+            if (read_ticks == 0)
+                return 0;
+
+            // Keeps the product in range for multi-GHz counters and multi-GiB images.
+            return bytes_read * (ticks_per_second / 1000) / read_ticks * 1000;
+        }
+    };
+
+    namespace Detail {
+        /// How much of the start of the file is read at once, hoping to get the program headers along with the ELF header.
+        constexpr size_t elf_header_read_size = 4096;
+        constexpr uint64_t elf_page_size = 4096;
+
+        /// Reads `size` bytes at `offset` of a file, failing if the file is shorter.
+        inline Status readFileAt(FileProtocol& file, uint64_t offset, void* buffer, uint64_t size) {
+            auto status = file.setPosition(offset);
+            if (status != Status::Success)
+                return status;
+
+            auto* bytes = static_cast<uint8_t*>(buffer);
+
+            while (size > 0) {
+                auto chunk = static_cast<size_t>(size);
+
+                status = file.read(chunk, bytes);
+                if (status != Status::Success)
+                    return status;
+
+                if (chunk == 0)
+                    return Status::LoadError;
+
+                bytes += chunk;
+                size -= chunk;
+            }
+
+            return Status::Success;
+        }
+
+        inline uint8_t* physicalToPointer(BootServices::PhysicalAddress address) noexcept {
+            return reinterpret_cast<uint8_t*>(static_cast<uintptr_t>(address));
+        }
+
+        /// Loads the segments of an image into pages that were already allocated, and applies its relocations.
+        class ElfImage {
+        public:
+            ElfImage(const Elf64Header& header, const Elf64ProgramHeader* program_headers, BootServices::PhysicalAddress base, uint64_t size, uint64_t load_bias)
+                : _header(header), _programHeaders(program_headers), _base(base), _size(size), _loadBias(load_bias) {}
+
+            [[nodiscard]] bool isRelocatable() const noexcept {
+                return _header.type == ElfType::SharedObject;
+            }
+
+            /// Where a segment goes in physical memory.
+            [[nodiscard]] BootServices::PhysicalAddress getLoadAddress(const Elf64ProgramHeader& segment) const noexcept {
+                return isRelocatable() ? segment.virtual_address + _loadBias : segment.physical_address;
+            }
+
+            Status loadSegments(FileProtocol& file, ElfLoadReport& report) {
+                for (size_t i = 0; i < _header.program_header_count; ++i) {
+                    const auto& segment = _programHeaders[i];
+
+                    if (segment.type != Elf64ProgramHeader::Type::Load || segment.memory_size == 0)
+                        continue;
+
+                    auto* destination = physicalToPointer(getLoadAddress(segment));
+
+                    const auto start = readTimestamp();
+                    const auto status = readFileAt(file, segment.offset, destination, segment.file_size);
+                    report.read_ticks += readTimestamp() - start;
+
+                    if (status != Status::Success)
+                        return status;
+
+                    const auto bss_size = segment.memory_size - segment.file_size;
+                    setBytes(destination + segment.file_size, 0, static_cast<size_t>(bss_size));
+
+                    report.bytes_read += segment.file_size;
+                    report.bytes_zeroed += bss_size;
+                    ++report.segment_count;
+                }
+
+                return Status::Success;
+            }
+
+            /// Finds the dynamic section in memory, and applies the relocations it lists.
+            Status relocate(ElfMachine machine, size_t& relocation_count) {
+                const Elf64Dynamic* dynamic = nullptr;
+                uint64_t dynamic_size = 0;
+
+                for (size_t i = 0; i < _header.program_header_count; ++i) {
+                    if (_programHeaders[i].type == Elf64ProgramHeader::Type::Dynamic) {
+                        dynamic = reinterpret_cast<const Elf64Dynamic*>(_linkToPointer(_programHeaders[i].virtual_address, _programHeaders[i].memory_size));
+                        dynamic_size = _programHeaders[i].memory_size;
+                    }
+                }
+
+                if (dynamic_size == 0)
+                    return Status::Success;
+
+                if (dynamic == nullptr)
+                    return Status::LoadError;
+
+                uint64_t rela = 0, rela_size = 0, rela_entry_size = sizeof(Elf64Rela);
+                uint64_t relr = 0, relr_size = 0;
+
+                for (size_t i = 0; i < dynamic_size / sizeof(Elf64Dynamic) && dynamic[i].tag != Elf64Dynamic::Tag::Null; ++i) {
+                    switch (dynamic[i].tag) {
+                    case Elf64Dynamic::Tag::Rela: rela = dynamic[i].value; break;
+                    case Elf64Dynamic::Tag::RelaSize: rela_size = dynamic[i].value; break;
+                    case Elf64Dynamic::Tag::RelaEntrySize: rela_entry_size = dynamic[i].value; break;
+                    case Elf64Dynamic::Tag::Relr: relr = dynamic[i].value; break;
+                    case Elf64Dynamic::Tag::RelrSize: relr_size = dynamic[i].value; break;
+                    // Implicit addends are not used by any supported 64-bit architecture.
+                    case Elf64Dynamic::Tag::Rel: return Status::Unsupported;
+                    default: break;
+                    }
+                }
+
+                if (rela_size != 0) {
+                    const auto status = _applyRela(machine, rela, rela_size, rela_entry_size, relocation_count);
+                    if (status != Status::Success)
+                        return status;
+                }
+
+                if (relr_size != 0)
+                    return _applyRelr(relr, relr_size, relocation_count);
+
+                return Status::Success;
+            }
+
+            /// Finds the entry point in the loaded segments.
+            Status findEntryPoint(ElfLoadReport& report) const noexcept {
+                for (size_t i = 0; i < _header.program_header_count; ++i) {
+                    const auto& segment = _programHeaders[i];
+
+                    if (segment.type != Elf64ProgramHeader::Type::Load)
+                        continue;
+
+                    if (_header.entry >= segment.virtual_address && _header.entry - segment.virtual_address < segment.memory_size) {
+                        report.entry_point = _header.entry + (isRelocatable() ? _loadBias : 0);
+                        report.physical_entry_point = getLoadAddress(segment) + (_header.entry - segment.virtual_address);
+                        return Status::Success;
+                    }
+                }
+
+                return Status::LoadError;
+            }
+
+        private:
+            /// @return A pointer to a link-time address range of a relocatable image, or nullptr if it is outside the image.
+            [[nodiscard]] uint8_t* _linkToPointer(uint64_t address, uint64_t size) const noexcept {
+                const auto offset = address + _loadBias - _base;
+
+                if (offset > _size || size > _size - offset)
+                    return nullptr;
+
+                return physicalToPointer(_base + offset);
+            }
+
+            /// Adds a value to the 64-bit word at a link-time address.
+            bool _add(uint64_t address, uint64_t value) const noexcept {
+                auto* target = _linkToPointer(address, sizeof(uint64_t));
+                if (target == nullptr)
+                    return false;
+
+                uint64_t word;
+                copyBytes(&word, target, sizeof(word));
+                word += value;
+                copyBytes(target, &word, sizeof(word));
+                return true;
+            }
+
+            Status _applyRela(ElfMachine machine, uint64_t address, uint64_t size, uint64_t entry_size, size_t& relocation_count) const noexcept {
+                const auto* table = _linkToPointer(address, size);
+                if (table == nullptr || entry_size < sizeof(Elf64Rela))
+                    return Status::LoadError;
+
+                const auto relative = machine == ElfMachine::AArch64 ? elf_relocation_aarch64_relative
+                                      : machine == ElfMachine::RiscV ? elf_relocation_riscv_relative
+                                                                     : elf_relocation_x86_64_relative;
+
+                for (uint64_t offset = 0; offset + sizeof(Elf64Rela) <= size; offset += entry_size) {
+                    Elf64Rela relocation;
+                    copyBytes(&relocation, table + offset, sizeof(relocation));
+
+                    if (relocation.getType() == elf_relocation_none)
+                        continue;
+
+                    // A position independent kernel has no symbols to resolve, only addresses to move.
+                    if (relocation.getType() != relative)
+                        return Status::Unsupported;
+
+                    // Overwrites the word: the addend is the whole value.
+                    auto* target = _linkToPointer(relocation.offset, sizeof(uint64_t));
+                    if (target == nullptr)
+                        return Status::LoadError;
+
+                    const uint64_t value = _loadBias + static_cast<uint64_t>(relocation.addend);
+                    copyBytes(target, &value, sizeof(value));
+                    ++relocation_count;
+                }
+
+                return Status::Success;
+            }
+
+            /// Applies the compact relative relocations: an address, then bitmaps of the following words to relocate.
+            Status _applyRelr(uint64_t address, uint64_t size, size_t& relocation_count) const noexcept {
+                const auto* table = _linkToPointer(address, size);
+                if (table == nullptr)
+                    return Status::LoadError;
+
+                uint64_t where = 0;
+
+                for (uint64_t offset = 0; offset + sizeof(uint64_t) <= size; offset += sizeof(uint64_t)) {
+                    uint64_t entry;
+                    copyBytes(&entry, table + offset, sizeof(entry));
+
+                    if ((entry & 1) == 0) {
+                        if (!_add(entry, _loadBias))
+                            return Status::LoadError;
+
+                        where = entry + sizeof(uint64_t);
+                        ++relocation_count;
+                        continue;
+                    }
+
+                    for (uint64_t bits = entry >> 1, i = 0; bits != 0; bits >>= 1, ++i) {
+                        if ((bits & 1) == 0)
+                            continue;
+
+                        if (!_add(where + (i * sizeof(uint64_t)), _loadBias))
+                            return Status::LoadError;
+
+                        ++relocation_count;
+                    }
+
+                    where += 63 * sizeof(uint64_t);
+                }
+
+                return Status::Success;
+            }
+
+            const Elf64Header& _header;
+            const Elf64ProgramHeader* _programHeaders;
+            BootServices::PhysicalAddress _base;
+            uint64_t _size;
+            uint64_t _loadBias;
+        };
+    } // namespace Detail
+
+    /// Loads an ELF64 executable (e.g. a kernel) from a file.
+    /// The file is not read in a temporary buffer: after a small read for the headers, every segment is read straight
+    /// into its final pages, and its uninitialized part is zeroed.
+    /// Executables are loaded at the physical addresses of their segments. Position independent images are loaded
+    /// anywhere (or at options.base), respecting the alignment of their segments, and their relative relocations are
+    /// applied so that they can run from their physical addresses.
+    /// @return Success The image is loaded. The report says where to jump to.
+    /// @return LoadError The file is not a valid ELF64 image, or is truncated.
+    /// @return Unsupported The image is for another architecture, or needs relocations other than relative ones.
+    /// @return InvalidParameter options.base is not page aligned.
+    /// @return Anything returned by FileProtocol::read() or BootServices::allocatePages().
+    inline Status loadElf(BootServices& boot_services, FileProtocol& file, ElfLoadReport& report, const ElfLoadOptions& options = {}) {
+        using namespace Detail;
+
+        report = {};
+        const auto start = readTimestamp();
+
+        alignas(8) uint8_t headers[elf_header_read_size];
+        size_t headers_size = sizeof(headers);
+
+        auto status = file.setPosition(0);
+        if (status == Status::Success)
+            status = file.read(headers_size, headers);
+        if (status != Status::Success)
+            return status;
+
+        if (headers_size < sizeof(Elf64Header))
+            return Status::LoadError;
+
+        Elf64Header header;
+        copyBytes(&header, headers, sizeof(header));
+
+        if (header.magic != Elf64Header::expected_magic || header.elf_class != Elf64Header::class_64 || header.data_encoding != Elf64Header::little_endian)
+            return Status::LoadError;
+
+        if (header.type != ElfType::Executable && header.type != ElfType::SharedObject)
+            return Status::LoadError;
+
+        if (header.machine != options.machine)
+            return Status::Unsupported;
+
+        if (header.program_header_size != sizeof(Elf64ProgramHeader))
+            return Status::LoadError;
+
+        const uint64_t table_size = uint64_t{header.program_header_count} * sizeof(Elf64ProgramHeader);
+        if (table_size > sizeof(headers) || header.program_header_offset % alignof(Elf64ProgramHeader) != 0)
+            return Status::LoadError;
+
+        // The program headers usually follow the ELF header, and were read along with it.
+        if (header.program_header_offset > headers_size || table_size > headers_size - header.program_header_offset) {
+            status = readFileAt(file, header.program_header_offset, headers, table_size);
+            if (status != Status::Success)
+                return status;
+
+            header.program_header_offset = 0;
+        }
+
+        const auto* program_headers = reinterpret_cast<const Elf64ProgramHeader*>(headers + header.program_header_offset);
+        const bool relocatable = header.type == ElfType::SharedObject;
+
+        // The range of addresses covered by the segments.
+        uint64_t low = ~uint64_t{0}, high = 0, alignment = elf_page_size;
+
+        for (size_t i = 0; i < header.program_header_count; ++i) {
+            const auto& segment = program_headers[i];
+
+            if (segment.type != Elf64ProgramHeader::Type::Load || segment.memory_size == 0)
+                continue;
+
+            const auto address = relocatable ? segment.virtual_address : segment.physical_address;
+
+            if (segment.file_size > segment.memory_size || address + segment.memory_size < address)
+                return Status::LoadError;
+
+            low = address < low ? address : low;
+            high = address + segment.memory_size > high ? address + segment.memory_size : high;
+
+            if (relocatable && segment.alignment > alignment)
+                alignment = segment.alignment;
+        }
+
+        if (high == 0 || (alignment & (alignment - 1)) != 0)
+            return Status::LoadError;
+
+        const auto link_base = low & ~(alignment - 1);
+        const auto page_count = static_cast<size_t>((((high + elf_page_size - 1) & ~(elf_page_size - 1)) - link_base) / elf_page_size);
+
+        BootServices::PhysicalAddress base = link_base;
+
+        if (!relocatable) {
+            status = boot_services.allocatePages(BootServices::AllocateType::Address, options.memory_type, page_count, base);
+        } else if (options.base != 0) {
+            if (options.base % alignment != 0)
+                return Status::InvalidParameter;
+
+            base = options.base;
+            status = boot_services.allocatePages(BootServices::AllocateType::Address, options.memory_type, page_count, base);
+        } else {
+            // The firmware only guarantees page alignment: allocate more, and give back what is not needed around
+            // the aligned range.
+            const auto extra_pages = static_cast<size_t>(alignment / elf_page_size) - 1;
+
+            status = boot_services.allocatePages(BootServices::AllocateType::AnyPages, options.memory_type, page_count + extra_pages, base);
+
+            if (status == Status::Success && extra_pages != 0) {
+                const auto aligned = (base + alignment - 1) & ~(alignment - 1);
+                const auto head_pages = static_cast<size_t>((aligned - base) / elf_page_size);
+
+                if (head_pages != 0)
+                    boot_services.freePages(base, head_pages);
+
+                if (extra_pages != head_pages)
+                    boot_services.freePages(aligned + (page_count * elf_page_size), extra_pages - head_pages);
+
+                base = aligned;
+            }
+        }
+
+        if (status != Status::Success)
+            return status;
+
+        report.base = base;
+        report.page_count = page_count;
+        report.load_bias = relocatable ? base - link_base : 0;
+
+        ElfImage image(header, program_headers, base, page_count * elf_page_size, report.load_bias);
+
+        status = image.loadSegments(file, report);
+
+        if (status == Status::Success && relocatable)
+            status = image.relocate(options.machine, report.relocation_count);
+
+        if (status == Status::Success)
+            status = image.findEntryPoint(report);
+
+        if (status != Status::Success) {
+            boot_services.freePages(base, page_count);
+            report.base = 0;
+            report.page_count = 0;
+            return status;
+        }
+
+        report.total_ticks = readTimestamp() - start;
+        return Status::Success;
+    }
+} // namespace Uefi
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "detail/bit_flags.h"
+
+namespace Uefi {
+    /// Represents an opaque event, created by BootServices::createEvent().
+    using Event = struct EventObject*;
+
+    /// The type of an event, passed to BootServices::createEvent().
+    enum class EventType : uint32_t {
+        /// A plain event, which can only be signaled and checked.
+        None = 0,
+        /// The event is a timer event and may be passed to setTimer().
+        Timer = 0x80000000,
+        /// The event is allocated from runtime memory.
+        Runtime = 0x40000000,
+        /// The notification function is queued whenever the event is being waited on or checked.
+        NotifyWait = 0x00000100,
+        /// The notification function is queued whenever the event is signaled.
+        NotifySignal = 0x00000200,
+        /// The event is signaled when exitBootServices() is called.
+        SignalExitBootServices = 0x00000201,
+        /// The event is signaled when setVirtualAddressMap() is called.
+        SignalVirtualAddressChange = 0x60000202
+    };
+
+    UEFI_BIT_FLAGS(EventType);
+
+    /// The type of function called when an event is signaled or waited on.
+    using EventNotify = void (*)(Event event, void* context);
+} // namespace Uefi
@@ -1,9 +1,12 @@
 #pragma once
 
 #include "detail/bit_flags.h"
+#include "event.h"
 #include "guid.h"
 #include "non_copyable.h"
+#include "result.h"
 #include "status.h"
+#include "time.h"
 #include <cstddef>
 
 namespace Uefi {
@@ -48,6 +51,30 @@ namespace Uefi {
 
     UEFI_BIT_FLAGS(FileAttributes);
 
+    /// What reading a directory returns for each of its entries, and what getInfo() returns for this guid.
+    /// The name follows the structure, so it is only used through pointers to buffers of at least `size` bytes.
+    struct FileInfo {
+        static constexpr Guid guid = {0x09576e92, 0x6d3f, 0x11d2, {0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b}};
+
+        /// The size of this structure, including the name and its terminator.
+        uint64_t size;
+        uint64_t file_size;
+        /// The space the file takes on the volume.
+        uint64_t physical_size;
+        Time create_time;
+        Time last_access_time;
+        Time modification_time;
+        FileAttributes attributes;
+        /// Null-terminated, without the path.
+        char16_t file_name[1];
+
+        [[nodiscard]] bool isDirectory() const noexcept {
+            return (attributes & FileAttributes::Directory) == FileAttributes::Directory;
+        }
+    };
+
+    static_assert(offsetof(FileInfo, file_name) == 80);
+
     /// Provides file based access to supported file systems.
     class FileProtocol : private NonCopyable {
     public:
@@ -64,58 +91,126 @@ namespace Uefi {
         /// @return OutOfResources Not enough resources were available to open the file.
         /// @return VolumeFull The volume is full.
         Status open(FileProtocol*& new_handle, const char16_t* file_name, OpenMode open_mode, FileAttributes attributes) {
-            return _open(new_handle, file_name, open_mode, attributes);
+            return _open(this, new_handle, file_name, open_mode, attributes);
+        }
+
+        /// Opens a file relative to this one, and returns its handle.
+        Result<FileProtocol*> open(const char16_t* file_name, OpenMode open_mode, FileAttributes attributes = FileAttributes::None) {
+            FileProtocol* new_handle = nullptr;
+            const auto status = _open(this, new_handle, file_name, open_mode, attributes);
+            return {status, new_handle};
         }
 
         Status close() {
-            return _close();
+            return _close(this);
         }
 
         // EFI_FILE_DELETE Delete;
 
+        /// Reads data from the current position, and advances it.
+        /// @param[in,out] buffer_size On input, the size of the buffer. On output, the number of bytes read, which is
+        /// less than requested only at the end of the file.
         Status read(size_t& buffer_size, void* buffer) {
-            return _read(buffer_size, buffer);
+            return _read(this, buffer_size, buffer);
+        }
+
+        /// Reads up to `size` bytes from the current position, and returns how many were read.
+        Result<size_t> read(void* buffer, size_t size) {
+            const auto status = _read(this, size, buffer);
+            return {status, size};
         }
 
         Status write(size_t& buffer_size, const void* buffer) {
-            return _write(buffer_size, buffer);
+            return _write(this, buffer_size, buffer);
+        }
+
+        /// Writes `size` bytes at the current position, and returns how many were written.
+        Result<size_t> write(const void* buffer, size_t size) {
+            const auto status = _write(this, size, buffer);
+            return {status, size};
         }
 
         Status getPosition(uint64_t& position) {
-            return _getPosition(position);
+            return _getPosition(this, position);
         }
 
+        Result<uint64_t> getPosition() {
+            uint64_t position = 0;
+            const auto status = _getPosition(this, position);
+            return {status, position};
+        }
+
+        /// Sets the position of the next read() or write(). 0xFFFFFFFFFFFFFFFF moves to the end of the file.
         Status setPosition(uint64_t position) {
-            return _setPosition(position);
+            return _setPosition(this, position);
         }
 
         Status getInfo(const Guid& info_type, size_t& buffer_size, void* buffer) {
-            return _getInfo(info_type, buffer_size, buffer);
+            return _getInfo(this, info_type, buffer_size, buffer);
+        }
+
+        /// Changes the information of this type, e.g. the size of the file through a FileInfo, which must come from
+        /// getInfo() with only the fields to change modified.
+        /// @return AccessDenied The file is read-only, or the change is not allowed, like renaming into a directory.
+        /// @return VolumeFull The volume has no room for the new size.
+        Status setInfo(const Guid& info_type, size_t buffer_size, const void* buffer) {
+            return _setInfo(this, info_type, buffer_size, buffer);
         }
 
-        // EFI_FILE_SET_INFO SetInfo;
-        // EFI_FILE_FLUSH Flush;
+        /// Writes the data the firmware has cached for this file to the device.
+        Status flush() {
+            return _flush(this);
+        }
 
-    private:
-        Status _open(FileProtocol*&, const char16_t*, OpenMode, FileAttributes);
-        Status _close();
+    protected:
+        Status (*_open)(FileProtocol*, FileProtocol*&, const char16_t*, OpenMode, FileAttributes);
+        Status (*_close)(FileProtocol*);
 
         [[maybe_unused]] void* _buf1[1];
 
-        Status _read(size_t&, void*);
-        Status _write(size_t&, const void*);
-        Status _getPosition(uint64_t&);
-        Status _setPosition(uint64_t);
-        Status _getInfo(const Guid&, size_t&, void*);
+        Status (*_read)(FileProtocol*, size_t&, void*);
+        Status (*_write)(FileProtocol*, size_t&, const void*);
+        Status (*_getPosition)(FileProtocol*, uint64_t&);
+        Status (*_setPosition)(FileProtocol*, uint64_t);
+        Status (*_getInfo)(FileProtocol*, const Guid&, size_t&, void*);
+        Status (*_setInfo)(FileProtocol*, const Guid&, size_t, const void*);
+        Status (*_flush)(FileProtocol*);
     };
 
+    /// Adds asynchronous I/O. A FileProtocol is a FileProtocol2 if its revision is at least FileProtocol2::revision_2.
     class FileProtocol2 : public FileProtocol {
     public:
+        static constexpr uint64_t revision_2 = 0x00020000;
+
+        struct IoToken {
+            /// Signaled when the request completes.
+            /// If it is nullptr, the request is executed synchronously.
+            Event event;
+            /// The result of the request, valid once the event has been signaled.
+            Status status;
+            /// On input, the size of the buffer. On completion, the number of bytes transferred.
+            size_t buffer_size;
+            void* buffer;
+        };
+
         // EFI_FILE_OPEN_EX OpenEx;
-        // EFI_FILE_READ_EX ReadEx;
+
+        /// Reads data from the current position, and advances it, like read().
+        /// @return Success The request was queued, or completed if token.event is nullptr.
+        /// @return Unsupported The file is a directory.
+        /// @return OutOfResources The request could not be queued.
+        Status readEx(IoToken& token) {
+            return _readEx(this, token);
+        }
+
         // EFI_FILE_WRITE_EX WriteEx;
         // EFI_FILE_FLUSH_EX FlushEx;
 
     private:
+        [[maybe_unused]] void* _buf3[1];
+
+        Status (*_readEx)(FileProtocol2*, IoToken&);
+
+        [[maybe_unused]] void* _buf4[2];
     };
 } // namespace Uefi
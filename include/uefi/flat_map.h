@@ -0,0 +1,258 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "detail/branch_hints.h"
+#include "detail/hash.h"
+#include "detail/memory.h"
+
+namespace Uefi {
+    /// A hash table with open addressing and linear probing: the entries are stored in one array, without a node per
+    /// entry, so a lookup usually touches a single cache line of entries.
+    /// A separate array holds one byte per slot: 0 if it is empty, or 7 bits of the hash. Probing compares these bytes
+    /// first, and only compares keys when they match.
+    /// Its memory comes from an allocator such as PageArena, with the methods:
+    /// - `void* allocate(size_t size, size_t alignment)`, which returns nullptr when out of memory.
+    /// - `void deallocate(void* memory, size_t size)`.
+    /// The table doubles when it is 3/4 full. Pointers to values are invalidated by insertions and erasures.
+    /// Keys and values must be trivial types, and keys must be comparable with ==.
+    template <typename Key, typename Value, typename Allocator, typename Hash = Detail::Hash<Key>>
+    class FlatMap {
+        static_assert(std::is_trivial_v<Key> && std::is_trivial_v<Value>, "The entries are moved around as bytes.");
+
+    public:
+        struct Entry {
+            Key key;
+            Value value;
+        };
+
+        class Iterator {
+        public:
+            Iterator(const FlatMap* map, size_t index) noexcept : _map(map), _index(index) {
+                _skipEmpty();
+            }
+
+            Entry& operator*() const noexcept {
+                return _map->_entries[_index];
+            }
+
+            Entry* operator->() const noexcept {
+                return &_map->_entries[_index];
+            }
+
+            Iterator& operator++() noexcept {
+                ++_index;
+                _skipEmpty();
+                return *this;
+            }
+
+            bool operator!=(const Iterator& other) const noexcept {
+                return _index != other._index;
+            }
+
+        private:
+            void _skipEmpty() noexcept {
+                while (_index < _map->_capacity && _map->_controls[_index] == 0)
+                    ++_index;
+            }
+
+            const FlatMap* _map;
+            size_t _index;
+        };
+
+        /// @param capacity The number of entries to make room for. The table grows past it if needed.
+        /// @return false The allocator is out of memory.
+        [[nodiscard]] bool initialize(Allocator& allocator, size_t capacity = 0) noexcept {
+            _allocator = &allocator;
+            _controls = nullptr;
+            _entries = nullptr;
+            _capacity = 0;
+            _size = 0;
+
+            size_t slots = minimum_capacity;
+            while (slots * 3 / 4 < capacity)
+                slots *= 2;
+
+            return _rehash(slots);
+        }
+
+        /// Gives the memory back to the allocator. The map must be initialized again to be used.
+        void release() noexcept {
+            if (_capacity != 0) {
+                _allocator->deallocate(_controls, _capacity);
+                _allocator->deallocate(_entries, _capacity * sizeof(Entry));
+            }
+
+            _controls = nullptr;
+            _entries = nullptr;
+            _capacity = 0;
+            _size = 0;
+        }
+
+        /// Removes every entry, keeping the memory.
+        void clear() noexcept {
+            Detail::setBytes(_controls, 0, _capacity);
+            _size = 0;
+        }
+
+        /// Adds an entry, or replaces the value of an existing one.
+        /// @return The stored value, or nullptr if the table had to grow and the allocator is out of memory.
+        Value* insert(const Key& key, const Value& value) noexcept {
+            if (UEFI_UNLIKELY((_size + 1) * 4 > _capacity * 3) && !_rehash(_capacity * 2))
+                return nullptr;
+
+            const auto hash = Hash{}(key);
+            const auto control = _getControl(hash);
+            auto index = _getHome(hash);
+
+            for (;; index = (index + 1) & (_capacity - 1)) {
+                if (_controls[index] == 0) {
+                    _controls[index] = control;
+                    _entries[index] = {key, value};
+                    ++_size;
+                    return &_entries[index].value;
+                }
+
+                if (_controls[index] == control && _entries[index].key == key) {
+                    _entries[index].value = value;
+                    return &_entries[index].value;
+                }
+            }
+        }
+
+        /// @return nullptr There is no entry with this key.
+        [[nodiscard]] Value* find(const Key& key) const noexcept {
+            const auto index = _findIndex(key);
+            return index == _capacity ? nullptr : &_entries[index].value;
+        }
+
+        [[nodiscard]] bool contains(const Key& key) const noexcept {
+            return _findIndex(key) != _capacity;
+        }
+
+        /// Removes an entry. The entries after it in its probe sequence are shifted back, so that lookups never have
+        /// to skip tombstones.
+        /// @return false There is no entry with this key.
+        bool erase(const Key& key) noexcept {
+            auto hole = _findIndex(key);
+            if (hole == _capacity)
+                return false;
+
+            const auto mask = _capacity - 1;
+            for (auto index = (hole + 1) & mask; _controls[index] != 0; index = (index + 1) & mask) {
+                // An entry can fill the hole if the hole is between its home slot and where it is now.
+                const auto home = _getHome(Hash{}(_entries[index].key));
+                if (((index - home) & mask) >= ((index - hole) & mask)) {
+                    _controls[hole] = _controls[index];
+                    _entries[hole] = _entries[index];
+                    hole = index;
+                }
+            }
+
+            _controls[hole] = 0;
+            --_size;
+            return true;
+        }
+
+        [[nodiscard]] size_t getSize() const noexcept {
+            return _size;
+        }
+
+        [[nodiscard]] bool isEmpty() const noexcept {
+            return _size == 0;
+        }
+
+        /// The number of slots, of which 3/4 can be used before the table grows.
+        [[nodiscard]] size_t getCapacity() const noexcept {
+            return _capacity;
+        }
+
+        /// Iterates over the entries, in no particular order.
+        [[nodiscard]] Iterator begin() const noexcept {
+            return {this, 0};
+        }
+
+        [[nodiscard]] Iterator end() const noexcept {
+            return {this, _capacity};
+        }
+
+    private:
+        static constexpr size_t minimum_capacity = 16;
+
+        static uint8_t _getControl(uint64_t hash) noexcept {
+            return static_cast<uint8_t>(0x80 | (hash >> 57));
+        }
+
+        size_t _getHome(uint64_t hash) const noexcept {
+            return static_cast<size_t>(hash) & (_capacity - 1);
+        }
+
+        /// @return _capacity There is no entry with this key.
+        size_t _findIndex(const Key& key) const noexcept {
+            const auto hash = Hash{}(key);
+            const auto control = _getControl(hash);
+
+            // The table is never full, so the search always ends on an empty slot.
+            for (auto index = _getHome(hash);; index = (index + 1) & (_capacity - 1)) {
+                if (_controls[index] == 0)
+                    return _capacity;
+
+                if (_controls[index] == control && _entries[index].key == key)
+                    return index;
+            }
+        }
+
+        bool _rehash(size_t capacity) noexcept {
+            auto* entries = static_cast<Entry*>(_allocator->allocate(capacity * sizeof(Entry), alignof(Entry)));
+            if (entries == nullptr)
+                return false;
+
+            auto* controls = static_cast<uint8_t*>(_allocator->allocate(capacity, 1));
+            if (controls == nullptr) {
+                _allocator->deallocate(entries, capacity * sizeof(Entry));
+                return false;
+            }
+
+            Detail::setBytes(controls, 0, capacity);
+
+            auto* old_controls = _controls;
+            auto* old_entries = _entries;
+            const auto old_capacity = _capacity;
+
+            _controls = controls;
+            _entries = entries;
+            _capacity = capacity;
+
+            for (size_t i = 0; i < old_capacity; ++i) {
+                if (old_controls[i] == 0)
+                    continue;
+
+                auto index = _getHome(Hash{}(old_entries[i].key));
+                while (_controls[index] != 0)
+                    index = (index + 1) & (_capacity - 1);
+
+                _controls[index] = old_controls[i];
+                _entries[index] = old_entries[i];
+            }
+
+            if (old_capacity != 0) {
+                _allocator->deallocate(old_controls, old_capacity);
+                _allocator->deallocate(old_entries, old_capacity * sizeof(Entry));
+            }
+
+            return true;
+        }
+
+        Allocator* _allocator;
+
+        /// One byte per slot: 0 if it is empty, or 0x80 and the top 7 bits of the hash of its key.
+        uint8_t* _controls;
+        Entry* _entries;
+
+        /// The number of slots, a power of two.
+        size_t _capacity;
+        size_t _size;
+    };
+} // namespace Uefi
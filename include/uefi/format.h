@@ -0,0 +1,451 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "simple_text_output_protocol.h"
+#include "status.h"
+
+namespace Uefi {
+    namespace Detail {
+        /// How a single replacement field ("{...}") should be formatted.
+        struct FormatField {
+            /// One of 0 (default for the argument's type), 'd', 'x', 'X', 'b' or 'o'.
+            char type;
+            /// '#': add the base prefix (0x, 0b or 0).
+            bool prefix;
+            /// Pad numbers with zeroes instead of spaces.
+            bool zero_pad;
+            /// Minimal number of characters to output.
+            uint8_t width;
+        };
+
+        /// Largest width accepted in a replacement field.
+        constexpr uint8_t max_format_width = 64;
+
+        /// A format string, parsed at compile time.
+        /// The text between replacement fields is stored already unescaped and converted to UCS-2.
+        template <size_t text_capacity, size_t field_capacity>
+        struct ParsedFormat {
+            char16_t text[text_capacity];
+
+            /// Literal i is text[literal_begin[i] .. literal_begin[i + 1]), and is printed before field i.
+            size_t literal_begin[field_capacity + 2];
+
+            FormatField fields[field_capacity + 1];
+            size_t field_count;
+        };
+
+        // Not constexpr on purpose: calling it while parsing a format string makes compilation fail,
+        // with the function name explaining what went wrong.
+        void invalidFormatString_unmatchedBrace();
+        void invalidFormatString_badSpecifier();
+        void invalidFormatString_widthTooLarge();
+
+        template <typename Format>
+        constexpr size_t formatFieldCapacity() {
+            // Each field takes at least two characters.
+            return Format::size() / 2;
+        }
+
+        template <typename Format>
+        constexpr auto parseFormat() {
+            constexpr auto size = Format::size();
+            const auto* string = Format::data();
+            using Char = std::remove_cv_t<std::remove_pointer_t<decltype(string)>>;
+
+            ParsedFormat<size + 1, formatFieldCapacity<Format>()> result{};
+
+            size_t text_size = 0;
+            size_t field = 0;
+
+            result.literal_begin[0] = 0;
+
+            for (size_t i = 0; i < size; ++i) {
+                // Like appendText(): bytes above 0x7F are Latin-1, not sign-extended.
+                const auto c = static_cast<char16_t>(static_cast<std::make_unsigned_t<Char>>(string[i]));
+
+                if (c == u'}') {
+                    if (i + 1 == size || string[i + 1] != '}')
+                        invalidFormatString_unmatchedBrace();
+
+                    result.text[text_size++] = u'}';
+                    ++i;
+                    continue;
+                }
+
+                if (c != u'{') {
+                    result.text[text_size++] = c;
+                    continue;
+                }
+
+                if (i + 1 < size && string[i + 1] == '{') {
+                    result.text[text_size++] = u'{';
+                    ++i;
+                    continue;
+                }
+
+                // A replacement field: "{" [":" ["#"] ["0"] [width] [type]] "}"
+                FormatField spec{};
+                ++i;
+
+                if (i < size && string[i] == ':') {
+                    ++i;
+
+                    if (i < size && string[i] == '#') {
+                        spec.prefix = true;
+                        ++i;
+                    }
+
+                    if (i < size && string[i] == '0') {
+                        spec.zero_pad = true;
+                        ++i;
+                    }
+
+                    unsigned width = 0;
+                    for (; i < size && string[i] >= '0' && string[i] <= '9'; ++i) {
+                        width = width * 10 + (string[i] - '0');
+
+                        if (width > max_format_width)
+                            invalidFormatString_widthTooLarge();
+                    }
+                    spec.width = static_cast<uint8_t>(width);
+
+                    if (i < size && string[i] != '}') {
+                        switch (string[i]) {
+                        case 'd':
+                        case 'x':
+                        case 'X':
+                        case 'b':
+                        case 'o':
+                            spec.type = static_cast<char>(string[i]);
+                            break;
+
+                        default:
+                            invalidFormatString_badSpecifier();
+                        }
+                        ++i;
+                    }
+                }
+
+                if (i >= size || string[i] != '}')
+                    invalidFormatString_unmatchedBrace();
+
+                result.fields[field++] = spec;
+                result.literal_begin[field] = text_size;
+            }
+
+            result.field_count = field;
+            result.literal_begin[field + 1] = text_size;
+
+            return result;
+        }
+
+        /// Holds the parsed form of a format string in read-only storage.
+        template <typename Format>
+        struct CompiledFormat {
+            static constexpr auto value = parseFormat<Format>();
+        };
+
+        template <typename T>
+        constexpr bool is_format_integer = std::is_integral_v<T> && !std::is_same_v<T, bool> &&
+            !std::is_same_v<T, char> && !std::is_same_v<T, char16_t>;
+
+        template <typename T>
+        constexpr bool is_format_number = is_format_integer<T> || std::is_enum_v<T> || std::is_pointer_v<T>;
+
+        template <typename T>
+        constexpr bool is_format_text = std::is_same_v<T, const char16_t*> || std::is_same_v<T, char16_t*> ||
+            std::is_same_v<T, const char*> || std::is_same_v<T, char*>;
+
+        /// Checks that a replacement field makes sense for the type of its argument.
+        template <typename T>
+        constexpr bool isFieldValidFor(const FormatField& field) {
+            using Arg = std::decay_t<T>;
+
+            // Base specifiers only make sense for numbers.
+            if (field.type != 0 || field.prefix || field.zero_pad)
+                return is_format_number<Arg> && !std::is_same_v<Arg, Status> && !is_format_text<Arg>;
+
+            return true;
+        }
+
+        /// Collects the formatted output in a buffer on the stack, and passes it to the firmware in as few calls as possible.
+        template <size_t capacity, typename Output = SimpleTextOutputProtocol>
+        class FormatWriter {
+            static_assert(capacity >= 2 * max_format_width + 2, "A formatted number must fit in the buffer.");
+
+        public:
+            explicit FormatWriter(Output& output)
+                : _output{output} {
+            }
+
+            FormatWriter(const FormatWriter&) = delete;
+            FormatWriter& operator=(const FormatWriter&) = delete;
+
+            void append(char16_t c) {
+                if (_used == capacity)
+                    flush();
+
+                _buffer[_used++] = c;
+            }
+
+            void append(const char16_t* text, size_t size) {
+                while (size != 0) {
+                    if (_used == capacity)
+                        flush();
+
+                    const auto chunk = (capacity - _used) < size ? (capacity - _used) : size;
+
+                    for (size_t i = 0; i < chunk; ++i)
+                        _buffer[_used + i] = text[i];
+
+                    _used += chunk;
+                    text += chunk;
+                    size -= chunk;
+                }
+            }
+
+            void appendPadding(size_t count) {
+                for (; count != 0; --count)
+                    append(u' ');
+            }
+
+            /// Formats a number straight into the buffer.
+            void appendNumber(uint64_t number, bool negative, const FormatField& field, char default_type) {
+                const auto type = field.type != 0 ? field.type : default_type;
+
+                uint64_t base = 10;
+                const char16_t* prefix = u"";
+                size_t prefix_size = 0;
+
+                switch (type) {
+                case 'x':
+                case 'X':
+                    base = 16;
+                    prefix = u"0x";
+                    prefix_size = 2;
+                    break;
+
+                case 'b':
+                    base = 2;
+                    prefix = u"0b";
+                    prefix_size = 2;
+                    break;
+
+                case 'o':
+                    base = 8;
+                    prefix = u"0";
+                    prefix_size = 1;
+                    break;
+
+                default:
+                    break;
+                }
+
+                if (!field.prefix)
+                    prefix_size = 0;
+
+                size_t digits = 1;
+                for (auto rest = number / base; rest != 0; rest /= base)
+                    ++digits;
+
+                const auto sign_size = negative ? 1 : 0;
+                const auto content = digits + prefix_size + sign_size;
+                const auto padding = field.width > content ? field.width - content : 0;
+
+                // Sign, prefix, padding and digits always fit, since the width is limited.
+                if (_used + content + padding > capacity)
+                    flush();
+
+                if (!field.zero_pad)
+                    for (size_t i = 0; i < padding; ++i)
+                        _buffer[_used++] = u' ';
+
+                if (negative)
+                    _buffer[_used++] = u'-';
+
+                for (size_t i = 0; i < prefix_size; ++i)
+                    _buffer[_used++] = prefix[i];
+
+                if (field.zero_pad)
+                    for (size_t i = 0; i < padding; ++i)
+                        _buffer[_used++] = u'0';
+
+                const auto letter = type == 'x' ? u'a' : u'A';
+
+                // Write the digits from right to left, so they don't have to be reversed.
+                for (auto i = _used + digits; i > _used; number /= base) {
+                    const auto digit = static_cast<char16_t>(number % base);
+                    _buffer[--i] = digit < 10 ? static_cast<char16_t>(u'0' + digit) : static_cast<char16_t>(letter + (digit - 10));
+                }
+
+                _used += digits;
+            }
+
+            template <typename Char>
+            void appendText(const Char* text, const FormatField& field) {
+                size_t size = 0;
+                while (text[size] != 0)
+                    ++size;
+
+                for (size_t i = 0; i < size; ++i)
+                    append(static_cast<char16_t>(static_cast<std::make_unsigned_t<Char>>(text[i])));
+
+                if (field.width > size)
+                    appendPadding(field.width - size);
+            }
+
+            // Taken by value, so that arrays decay to pointers.
+            template <typename T>
+            void appendArgument(const FormatField& field, T value) {
+                if constexpr (std::is_same_v<T, bool>) {
+                    appendText(value ? u"true" : u"false", field);
+                } else if constexpr (std::is_same_v<T, char16_t> || std::is_same_v<T, char>) {
+                    const char16_t text[2] = {static_cast<char16_t>(value), 0};
+                    appendText(text, field);
+                } else if constexpr (std::is_same_v<T, Status>) {
+                    // Same as TextOutputStream: the code without the error bit.
+                    appendNumber(static_cast<uint64_t>(value) & ~(1ULL << 63), false, field, 'd');
+                } else if constexpr (is_format_text<T>) {
+                    if (value == nullptr)
+                        appendText(u"(null)", field);
+                    else
+                        appendText(value, field);
+                } else if constexpr (std::is_pointer_v<T>) {
+                    FormatField pointer_field = field;
+                    pointer_field.prefix = true;
+                    appendNumber(reinterpret_cast<uintptr_t>(value), false, pointer_field, 'X');
+                } else if constexpr (std::is_enum_v<T>) {
+                    appendArgument(field, static_cast<std::underlying_type_t<T>>(value));
+                } else if constexpr (std::is_signed_v<T>) {
+                    const auto negative = value < 0;
+                    const auto magnitude = negative ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+                    appendNumber(magnitude, negative, field, 'd');
+                } else {
+                    static_assert(is_format_integer<T>, "This type cannot be formatted.");
+                    appendNumber(static_cast<uint64_t>(value), false, field, 'd');
+                }
+            }
+
+            /// Sends the buffer's contents to the output device.
+            void flush() {
+                if (_used == 0)
+                    return;
+
+                _buffer[_used] = 0;
+
+                const auto status = _output.outputString(_buffer);
+                if (isErrorCode(status) && _status == Status::Success)
+                    _status = status;
+
+                _used = 0;
+            }
+
+            /// The first error reported by the output device, if any.
+            [[nodiscard]] Status getStatus() const noexcept {
+                return _status;
+            }
+
+        private:
+            Output& _output;
+            Status _status = Status::Success;
+            size_t _used = 0;
+            char16_t _buffer[capacity + 1];
+        };
+
+        template <typename Format, typename Writer, typename... Args, size_t... indices>
+        void formatTo(Writer& writer, std::index_sequence<indices...> /*unused*/, const Args&... args) {
+            constexpr const auto& format = CompiledFormat<Format>::value;
+
+            const auto append_literal = [&writer](size_t i) {
+                const auto begin = format.literal_begin[i];
+                writer.append(format.text + begin, format.literal_begin[i + 1] - begin);
+            };
+
+            ((append_literal(indices), writer.appendArgument(format.fields[indices], args)), ...);
+
+            append_literal(sizeof...(Args));
+        }
+
+        template <typename Format, typename... Args, size_t... indices>
+        constexpr bool areFieldsValid(std::index_sequence<indices...> /*unused*/) {
+            constexpr const auto& format = CompiledFormat<Format>::value;
+            return (isFieldValidFor<Args>(format.fields[indices]) && ...);
+        }
+
+#if __cplusplus >= 202002L
+        /// Lets a string literal be used as a template argument.
+        template <typename Char, size_t size>
+        struct FixedString {
+            constexpr FixedString(const Char (&string)[size]) { // NOLINT
+                for (size_t i = 0; i < size; ++i)
+                    data[i] = string[i];
+            }
+
+            Char data[size];
+        };
+
+        template <FixedString string>
+        struct FixedFormat {
+            static constexpr auto data() {
+                return string.data;
+            }
+
+            static constexpr size_t size() {
+                return sizeof(string.data) / sizeof(string.data[0]) - 1;
+            }
+        };
+#endif
+    } // namespace Detail
+
+/// Turns a string literal (either "..." or u"...") into a format string checked at compile time.
+/// Replacement fields look like "{}" or "{:[#][0][width][d|x|X|b|o]}". Braces are escaped as "{{" and "}}".
+/// @code
+/// print(*system_table.console_out, UEFI_FORMAT("{} pages at {:#x}\r\n"), pages, address);
+/// @endcode
+/// @hideinitializer
+#define UEFI_FORMAT(string) \
+    [] { \
+        struct UefiFormatString { \
+            static constexpr auto data() { \
+                return string; \
+            } \
+            static constexpr size_t size() { \
+                return sizeof(string) / sizeof(string[0]) - 1; \
+            } \
+        }; \
+        return UefiFormatString{}; \
+    }()
+
+    /// Formats the arguments according to a compile-time format string and writes the result to the output.
+    /// The result is built on the stack, and passed to the firmware in a single outputString() call
+    /// unless it is longer than buffer_size characters.
+    /// The output can also be any other type with a `Status outputString(const char16_t*)` method.
+    /// @return The first error reported by the output device, or Success.
+    template <size_t buffer_size = 160, typename Output, typename Format, typename... Args>
+    Status print(Output& output, Format /*format*/, const Args&... args) {
+        using Indices = std::index_sequence_for<Args...>;
+
+        static_assert(Detail::CompiledFormat<Format>::value.field_count == sizeof...(Args),
+            "The number of arguments doesn't match the number of replacement fields.");
+        static_assert(Detail::areFieldsValid<Format, Args...>(Indices{}),
+            "A base specifier (d, x, X, b, o, #, 0) is used with an argument which is not a number.");
+
+        Detail::FormatWriter<buffer_size, Output> writer{output};
+        Detail::formatTo<Format>(writer, Indices{}, args...);
+        writer.flush();
+
+        return writer.getStatus();
+    }
+
+#if __cplusplus >= 202002L
+    /// C++20 form of print(): `print<"{} pages at {:#x}\r\n">(output, pages, address)`.
+    template <Detail::FixedString format, size_t buffer_size = 160, typename Output, typename... Args>
+    Status print(Output& output, const Args&... args) {
+        return print<buffer_size>(output, Detail::FixedFormat<format>{}, args...);
+    }
+#endif
+} // namespace Uefi
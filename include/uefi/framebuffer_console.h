@@ -0,0 +1,305 @@
+#pragma once
+
+#include "console_color.h"
+#include "detail/font_8x8.h"
+#include "detail/memory.h"
+#include "graphics_output_protocol.h"
+#include "simple_text_output_protocol.h"
+#include "text_output_stream.h"
+
+namespace Uefi {
+    /// A text console which draws straight into a linear framebuffer.
+    /// It is a SimpleTextOutputProtocol, so it can replace the firmware's console_out:
+    /// @code
+    /// console.initialize(framebuffer);
+    /// output.setOutput(console);
+    /// @endcode
+    /// Unlike the firmware console it does not depend on boot services, so it keeps working after exitBootServices().
+    class FramebufferConsole : public SimpleTextOutputProtocol {
+    public:
+        /// Size of a character cell, in pixels. The 8x8 font is drawn with every row doubled.
+        static constexpr uint32_t cell_width = 8;
+        static constexpr uint32_t cell_height = 16;
+
+        // Since static constructors require runtime support, it's better for users to just call initialize().
+        /// Attaches the console to a framebuffer, resets the colors and clears the screen.
+        /// @return Unsupported The framebuffer is smaller than a cell: the console then draws nothing.
+        Status initialize(const Framebuffer& framebuffer) {
+            _reset = &FramebufferConsole::_resetThunk;
+            _outputString = &FramebufferConsole::_outputStringThunk;
+            _testString = &FramebufferConsole::_testStringThunk;
+            _queryMode = &FramebufferConsole::_queryModeThunk;
+            _setMode = &FramebufferConsole::_setModeThunk;
+            _setAttribute = &FramebufferConsole::_setAttributeThunk;
+            _clearScreen = &FramebufferConsole::_clearScreenThunk;
+            _setCursorPosition = &FramebufferConsole::_setCursorPositionThunk;
+            _enableCursor = &FramebufferConsole::_enableCursorThunk;
+            _mode = &_modeData;
+            _modeData = {1, 0, 0, 0, 0, false};
+
+            _framebuffer = framebuffer;
+            _columns = framebuffer.width / cell_width;
+            _rows = framebuffer.height / cell_height;
+
+            if (_columns == 0 || _rows == 0) {
+                _columns = 0;
+                _rows = 0;
+            }
+
+            for (uint8_t i = 0; i < 16; ++i)
+                _palette[i] = _encodeColor(framebuffer.masks, palette_rgb[i]);
+
+            _cacheValid = false;
+            _useColor(default_color);
+            _clear();
+            return _columns != 0 ? Status::Success : Status::Unsupported;
+        }
+
+        /// Number of text columns.
+        [[nodiscard]] size_t getColumns() const noexcept {
+            return _columns;
+        }
+
+        /// Number of text rows.
+        [[nodiscard]] size_t getRows() const noexcept {
+            return _rows;
+        }
+
+    private:
+        /// The usual VGA palette, in 0xRRGGBB format. Indexed by ForegroundColor / BackgroundColor.
+        static constexpr uint32_t palette_rgb[16] = {
+            0x000000, 0x0000AA, 0x00AA00, 0x00AAAA, 0xAA0000, 0xAA00AA, 0xAA5500, 0xAAAAAA,
+            0x555555, 0x5555FF, 0x55FF55, 0x55FFFF, 0xFF5555, 0xFF55FF, 0xFFFF55, 0xFFFFFF};
+
+        static uint32_t _encodeComponent(uint32_t value, uint32_t mask) noexcept {
+            if (mask == 0)
+                return 0;
+
+            const auto shift = static_cast<uint32_t>(__builtin_ctz(mask));
+            const auto max = mask >> shift;
+
+            return ((value * max + 127) / 255) << shift;
+        }
+
+        static uint32_t _encodeColor(const Framebuffer::PixelMasks& masks, uint32_t rgb) noexcept {
+            return _encodeComponent((rgb >> 16) & 0xFF, masks.red) |
+                _encodeComponent((rgb >> 8) & 0xFF, masks.green) |
+                _encodeComponent(rgb & 0xFF, masks.blue);
+        }
+
+        /// Rebuilds the glyph row cache for a new color.
+        /// Every row of a glyph is one byte, so the 256 possible rows are rasterized once per color change.
+        /// Drawing a character then only copies pre-rendered pixels, without testing any bits.
+        void _useColor(TextColor color) noexcept {
+            _color = color;
+            _modeData.attribute = color.getValue();
+
+            const auto foreground = _palette[static_cast<uint8_t>(color.foreground) & 0xF];
+            const auto background = _palette[static_cast<uint8_t>(color.background) & 0x7];
+
+            if (_cacheValid && foreground == _foreground && background == _background)
+                return;
+
+            for (uint32_t bits = 0; bits < 256; ++bits)
+                for (uint32_t x = 0; x < cell_width; ++x)
+                    _rowCache[bits][x] = ((bits >> x) & 1) != 0 ? foreground : background;
+
+            _foreground = foreground;
+            _background = background;
+            _cacheValid = true;
+        }
+
+        [[nodiscard]] uint32_t* _cellAddress(size_t column, size_t row) const noexcept {
+            return _framebuffer.base + (row * cell_height * _framebuffer.pixels_per_scan_line) + (column * cell_width);
+        }
+
+        static bool _hasGlyph(char16_t c) noexcept {
+            return c >= Detail::font_8x8_first && c <= Detail::font_8x8_last;
+        }
+
+        void _drawGlyph(char16_t c, size_t column, size_t row) noexcept {
+            const auto& glyph = Detail::font_8x8[c - Detail::font_8x8_first];
+            const auto pitch = _framebuffer.pixels_per_scan_line;
+
+            auto* line = _cellAddress(column, row);
+
+            for (const auto bits : glyph) {
+                const auto* pixels = _rowCache[bits];
+
+                Detail::copyBytes(line, pixels, sizeof(_rowCache[0]));
+                Detail::copyBytes(line + pitch, pixels, sizeof(_rowCache[0]));
+
+                line += 2 * pitch;
+            }
+        }
+
+        /// Fills whole text rows [first, first + count) with the background color.
+        void _clearRows(size_t first, size_t count) noexcept {
+            const auto pitch = _framebuffer.pixels_per_scan_line;
+
+            // Scan lines are contiguous, so the padding at the end of each line can be overwritten as well.
+            Detail::setWords32(_cellAddress(0, first), _background, count * cell_height * pitch);
+        }
+
+        /// Moves every text row up by one, with a single memmove() over the framebuffer, and clears the last row.
+        void _scroll() noexcept {
+            if (_rows == 0)
+                return;
+
+            const auto row_pixels = static_cast<size_t>(cell_height) * _framebuffer.pixels_per_scan_line;
+
+            Detail::moveBytes(_cellAddress(0, 0), _cellAddress(0, 1), (_rows - 1) * row_pixels * sizeof(uint32_t));
+
+            _clearRows(_rows - 1, 1);
+        }
+
+        void _newLine() noexcept {
+            if (_row + 1 < _rows)
+                ++_row;
+            else
+                _scroll();
+        }
+
+        void _clear() noexcept {
+            _clearRows(0, _rows);
+            _column = 0;
+            _row = 0;
+            _updateCursor();
+        }
+
+        /// Reports the cursor position in the Mode.
+        void _updateCursor() noexcept {
+            _modeData.cursor_column = static_cast<int32_t>(_column);
+            _modeData.cursor_row = static_cast<int32_t>(_row);
+        }
+
+        Status _output(const char16_t* string) noexcept {
+            // Without a single cell, even the first glyph would be drawn outside the framebuffer.
+            if (_columns == 0)
+                return Status::DeviceError;
+
+            auto status = Status::Success;
+
+            for (; *string != 0; ++string) {
+                auto c = *string;
+
+                switch (c) {
+                case u'\r':
+                    _column = 0;
+                    continue;
+
+                case u'\n':
+                    _newLine();
+                    continue;
+
+                case u'\b':
+                    if (_column > 0)
+                        --_column;
+                    continue;
+
+                default:
+                    break;
+                }
+
+                if (!_hasGlyph(c)) {
+                    c = u'?';
+                    status = Status::WarnUnknownGlyph;
+                }
+
+                // Wrap around like the firmware consoles do.
+                if (_column == _columns) {
+                    _column = 0;
+                    _newLine();
+                }
+
+                _drawGlyph(c, _column++, _row);
+            }
+
+            _updateCursor();
+            return status;
+        }
+
+        static FramebufferConsole& _self(SimpleTextOutputProtocol* protocol) {
+            return *static_cast<FramebufferConsole*>(protocol);
+        }
+
+        static Status _resetThunk(SimpleTextOutputProtocol* protocol, bool) {
+            auto& self = _self(protocol);
+            self._useColor(default_color);
+            self._clear();
+            return Status::Success;
+        }
+
+        static Status _outputStringThunk(SimpleTextOutputProtocol* protocol, const char16_t* string) {
+            return _self(protocol)._output(string);
+        }
+
+        static Status _testStringThunk(SimpleTextOutputProtocol*, const char16_t* string) {
+            for (; *string != 0; ++string)
+                if (!_hasGlyph(*string) && *string != u'\r' && *string != u'\n' && *string != u'\b')
+                    return Status::Unsupported;
+
+            return Status::Success;
+        }
+
+        static Status _queryModeThunk(SimpleTextOutputProtocol* protocol, size_t mode_number, size_t& columns, size_t& rows) {
+            if (mode_number != 0)
+                return Status::Unsupported;
+
+            const auto& self = _self(protocol);
+            columns = self._columns;
+            rows = self._rows;
+            return Status::Success;
+        }
+
+        static Status _setModeThunk(SimpleTextOutputProtocol* protocol, size_t mode_number) {
+            if (mode_number != 0)
+                return Status::Unsupported;
+
+            _self(protocol)._clear();
+            return Status::Success;
+        }
+
+        static Status _setAttributeThunk(SimpleTextOutputProtocol* protocol, Attribute attribute) {
+            _self(protocol)._useColor(attribute);
+            return Status::Success;
+        }
+
+        static Status _clearScreenThunk(SimpleTextOutputProtocol* protocol) {
+            _self(protocol)._clear();
+            return Status::Success;
+        }
+
+        static Status _setCursorPositionThunk(SimpleTextOutputProtocol* protocol, size_t column, size_t row) {
+            auto& self = _self(protocol);
+            if (column >= self._columns || row >= self._rows)
+                return Status::Unsupported;
+
+            self._column = column;
+            self._row = row;
+            self._updateCursor();
+            return Status::Success;
+        }
+
+        static Status _enableCursorThunk(SimpleTextOutputProtocol*, bool visible) {
+            // No cursor is drawn.
+            return visible ? Status::Unsupported : Status::Success;
+        }
+
+        Framebuffer _framebuffer;
+
+        size_t _columns, _rows;
+        size_t _column, _row;
+
+        /// The 16 console colors, encoded in the framebuffer's pixel format.
+        uint32_t _palette[16];
+
+        TextColor _color;
+        Mode _modeData;
+        bool _cacheValid;
+        uint32_t _foreground, _background;
+
+        /// Pre-rasterized glyph rows for the current color, indexed by the font's row bits.
+        uint32_t _rowCache[256][cell_width];
+    };
+} // namespace Uefi
@@ -0,0 +1,325 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "block_io_protocol.h"
+#include "crc32.h"
+#include "guid.h"
+#include "status.h"
+
+namespace Uefi {
+    /// Header of a GUID Partition Table. The primary one is in LBA 1, the backup in the last LBA of the disk.
+    struct GptHeader {
+        /// "EFI PART".
+        static constexpr uint64_t expected_signature = 0x5452415020494645;
+
+        uint64_t signature;
+        uint32_t revision;
+        uint32_t header_size;
+        /// CRC32 of the first header_size bytes, computed with this field set to 0.
+        uint32_t header_crc32;
+        uint32_t reserved;
+
+        /// The LBA containing this header.
+        Lba my_lba;
+        /// The LBA of the other copy of the header.
+        Lba alternate_lba;
+
+        /// The range of blocks usable by partitions.
+        Lba first_usable_lba, last_usable_lba;
+
+        Guid disk_guid;
+
+        /// Where the partition entry array starts.
+        Lba partition_entry_lba;
+        uint32_t number_of_partition_entries;
+        /// Size of each entry in the array. A multiple of 128.
+        uint32_t size_of_partition_entry;
+        uint32_t partition_entry_array_crc32;
+    };
+
+    static_assert(sizeof(GptHeader) == 92 + 4, "The header is 92 bytes, followed by padding up to an 8 byte boundary.");
+
+    struct GptPartitionEntry {
+        /// All zero if the entry is not used.
+        Guid partition_type_guid;
+        Guid unique_partition_guid;
+
+        /// Inclusive range of blocks of the partition.
+        Lba starting_lba, ending_lba;
+
+        uint64_t attributes;
+
+        /// Null-terminated, unless it takes all 36 characters.
+        char16_t partition_name[36];
+
+        [[nodiscard]] bool isUsed() const noexcept {
+            return partition_type_guid.b.data1 != 0 || partition_type_guid.b.data2 != 0;
+        }
+    };
+
+    static_assert(sizeof(GptPartitionEntry) == 128);
+
+    /// Some well-known partition type GUIDs.
+    /// @{
+    constexpr Guid efi_system_partition_guid = {0xc12a7328, 0xf81f, 0x11d2, {0xba, 0x4b, 0x00, 0xa0, 0xc9, 0x3e, 0xc9, 0x3b}};
+    constexpr Guid microsoft_basic_data_partition_guid = {0xebd0a0a2, 0xb9e5, 0x4433, {0x87, 0xc0, 0x68, 0xb6, 0xb7, 0x26, 0x99, 0xc7}};
+    constexpr Guid linux_filesystem_partition_guid = {0x0fc63daf, 0x8483, 0x4772, {0x8e, 0x79, 0x3d, 0x69, 0xd8, 0x47, 0x7d, 0xe4}};
+    /// @}
+
+    /// A validated GUID Partition Table.
+    /// The partition entries are not copied: they are accessed in place, in the buffer they were read into,
+    /// which must therefore outlive the table.
+    /// Partitions can be looked up by unique GUID or by type GUID through a small hash index.
+    class GptTable {
+    public:
+        /// Returned by the lookup functions when there is no match.
+        static constexpr size_t none = ~size_t{0};
+
+        /// Size of the buffer needed by read() for the usual layout: a header block, followed by 128 entries of 128 bytes.
+        static size_t getBufferSize(uint32_t block_size) noexcept {
+            return (1 + _defaultEntryBlocks(block_size)) * block_size;
+        }
+
+        /// Reads and validates the GPT of a device.
+        /// In the usual layout, the header and the entry array are read with a single request.
+        /// If the primary GPT is corrupted, the backup at the end of the disk is used.
+        /// @param buffer Receives the entry array. Must be aligned to the device's io_align.
+        /// @param buffer_size Usually getBufferSize(). Must be bigger if the partition entry array is bigger than 16 KiB.
+        /// @return Success The table was read and validated.
+        /// @return VolumeCorrupted Neither the primary nor the backup GPT are valid.
+        /// @return BufferTooSmall The entry array doesn't fit in the buffer.
+        /// @return Anything returned by BlockIoProtocol::readBlocks().
+        Status read(BlockIoProtocol& block_io, void* buffer, size_t buffer_size) {
+            const auto& media = *block_io.media;
+            const auto block_size = media.block_size;
+            const auto entry_blocks = _defaultEntryBlocks(block_size);
+            const auto window_blocks = entry_blocks + 1;
+
+            if (buffer_size < window_blocks * block_size)
+                return Status::BufferTooSmall;
+
+            if (media.last_block < 2 * window_blocks)
+                return Status::VolumeCorrupted;
+
+            auto* bytes = static_cast<uint8_t*>(buffer);
+
+            // Primary: the header in LBA 1, usually followed by the entries.
+            auto status = block_io.readBlocks(media.media_id, 1, window_blocks * block_size, bytes);
+            if (status != Status::Success)
+                return status;
+
+            status = _load(block_io, 1, bytes, bytes + block_size, 2, entry_blocks, buffer_size - block_size);
+            if (status != Status::VolumeCorrupted) {
+                _backup = false;
+                return status;
+            }
+
+            // Backup: the header in the last LBA, usually preceded by the entries.
+            const auto first = media.last_block - entry_blocks;
+            status = block_io.readBlocks(media.media_id, first, window_blocks * block_size, bytes);
+            if (status != Status::Success)
+                return status;
+
+            status = _load(block_io, media.last_block, bytes + (entry_blocks * block_size), bytes, first, entry_blocks, buffer_size);
+            _backup = true;
+            return status;
+        }
+
+        /// Validates a GPT which is already in memory (e.g. inside a disk image).
+        /// @param header Must be followed in memory by the rest of its block, as header_size might be larger than the structure.
+        /// @param entries The partition entry array.
+        /// @return Success The header and entries are valid.
+        /// @return VolumeCorrupted A signature or CRC doesn't match.
+        Status parse(const GptHeader& header, uint32_t block_size, const void* entries, size_t entries_size) {
+            if (!_isHeaderValid(header, header.my_lba, block_size) || entries_size < _entryArraySize(header))
+                return Status::VolumeCorrupted;
+
+            return _useEntries(header, static_cast<const uint8_t*>(entries));
+        }
+
+        /// True if the backup GPT had to be used, because the primary one is corrupted.
+        [[nodiscard]] bool isBackup() const noexcept {
+            return _backup;
+        }
+
+        /// A copy of the header of the table in use.
+        [[nodiscard]] const GptHeader& getHeader() const noexcept {
+            return _header;
+        }
+
+        /// Number of entries in the array, including unused ones.
+        [[nodiscard]] size_t getEntryCount() const noexcept {
+            return _header.number_of_partition_entries;
+        }
+
+        [[nodiscard]] const GptPartitionEntry& getEntry(size_t index) const noexcept {
+            return *reinterpret_cast<const GptPartitionEntry*>(_entries + (index * _header.size_of_partition_entry));
+        }
+
+        /// @return The index of the partition with this unique GUID, or none.
+        [[nodiscard]] size_t findByUniqueId(const Guid& guid) const noexcept {
+            return _find(_byUniqueId, guid, 0, &GptPartitionEntry::unique_partition_guid);
+        }
+
+        /// @return The index of the first partition of this type at or after `first`, or none.
+        /// To go through all the partitions of a type, call it again with the last result plus one.
+        [[nodiscard]] size_t findByType(const Guid& guid, size_t first = 0) const noexcept {
+            return _find(_byType, guid, first, &GptPartitionEntry::partition_type_guid);
+        }
+
+    private:
+        /// Number of slots of each hash index. Kept at most half full, so up to half as many partitions are indexed.
+        static constexpr size_t index_size = 512;
+
+        /// The index slots hold an entry index plus one in 16 bits. Real tables have 128 entries.
+        static constexpr uint32_t max_entry_count = 0xFFFF;
+
+        static size_t _defaultEntryBlocks(uint32_t block_size) noexcept {
+            return (128 * sizeof(GptPartitionEntry) + block_size - 1) / block_size;
+        }
+
+        static size_t _entryArraySize(const GptHeader& header) noexcept {
+            return static_cast<size_t>(header.number_of_partition_entries) * header.size_of_partition_entry;
+        }
+
+        static bool _isHeaderValid(const GptHeader& header, Lba expected_lba, uint32_t block_size) noexcept {
+            if (header.signature != GptHeader::expected_signature || header.my_lba != expected_lba)
+                return false;
+
+            if (header.header_size < 92 || header.header_size > block_size)
+                return false;
+
+            if (header.size_of_partition_entry < sizeof(GptPartitionEntry) || header.size_of_partition_entry % 128 != 0)
+                return false;
+
+            if (header.number_of_partition_entries > max_entry_count)
+                return false;
+
+            // The CRC is computed with the CRC field itself set to zero. Do that without copying the header.
+            constexpr size_t crc_offset = offsetof(GptHeader, header_crc32);
+            constexpr uint32_t zero = 0;
+
+            const auto* bytes = reinterpret_cast<const uint8_t*>(&header);
+
+            auto crc = calculateCrc32(bytes, crc_offset);
+            crc = calculateCrc32(&zero, sizeof(zero), crc);
+            crc = calculateCrc32(bytes + crc_offset + sizeof(zero), header.header_size - crc_offset - sizeof(zero), crc);
+
+            return crc == header.header_crc32;
+        }
+
+        /// Validates a header, makes sure its entries are in memory, and validates them.
+        /// @param entries Where the entries usually are: the blocks starting at entries_lba.
+        /// @param entries_capacity The size of the buffer from `entries` on.
+        Status _load(BlockIoProtocol& block_io, Lba header_lba, const uint8_t* header_block, uint8_t* entries, Lba entries_lba, size_t entry_blocks, size_t entries_capacity) {
+            const auto block_size = block_io.media->block_size;
+            const auto& header = *reinterpret_cast<const GptHeader*>(header_block);
+
+            if (!_isHeaderValid(header, header_lba, block_size))
+                return Status::VolumeCorrupted;
+
+            const auto array_blocks = (_entryArraySize(header) + block_size - 1) / block_size;
+
+            // The entries are not where they usually are (or there are more of them): read them again.
+            if (header.partition_entry_lba != entries_lba || array_blocks > entry_blocks) {
+                // The header block might get overwritten.
+                const auto copy = header;
+
+                if (array_blocks * block_size > entries_capacity)
+                    return Status::BufferTooSmall;
+
+                const auto status = block_io.readBlocks(block_io.media->media_id, copy.partition_entry_lba, array_blocks * block_size, entries);
+                if (status != Status::Success)
+                    return status;
+
+                return _useEntries(copy, entries);
+            }
+
+            return _useEntries(header, entries);
+        }
+
+        Status _useEntries(const GptHeader& header, const uint8_t* entries) {
+            if (calculateCrc32(entries, _entryArraySize(header)) != header.partition_entry_array_crc32)
+                return Status::VolumeCorrupted;
+
+            _header = header;
+            _entries = entries;
+            _buildIndex();
+
+            return Status::Success;
+        }
+
+        static size_t _hash(const Guid& guid) noexcept {
+            return static_cast<size_t>(((guid.b.data1 ^ guid.b.data2) * 0x9E3779B97F4A7C15ULL) >> 55) % index_size;
+        }
+
+        /// Adds a partition to an open addressing (linear probing) index.
+        /// Slots hold the entry index plus one, so that 0 means empty.
+        static void _insert(uint16_t (&index)[index_size], const Guid& guid, size_t entry) noexcept {
+            auto slot = _hash(guid);
+
+            while (index[slot] != 0)
+                slot = (slot + 1) % index_size;
+
+            index[slot] = static_cast<uint16_t>(entry + 1);
+        }
+
+        void _buildIndex() noexcept {
+            for (size_t i = 0; i < index_size; ++i) {
+                _byUniqueId[i] = 0;
+                _byType[i] = 0;
+            }
+
+            size_t used = 0;
+            for (size_t i = 0; i < getEntryCount(); ++i)
+                used += getEntry(i).isUsed() ? 1 : 0;
+
+            // Very large tables are searched linearly instead.
+            _indexed = used <= index_size / 2;
+            if (!_indexed)
+                return;
+
+            for (size_t i = 0; i < getEntryCount(); ++i) {
+                const auto& entry = getEntry(i);
+
+                if (!entry.isUsed())
+                    continue;
+
+                _insert(_byUniqueId, entry.unique_partition_guid, i);
+                _insert(_byType, entry.partition_type_guid, i);
+            }
+        }
+
+        size_t _find(const uint16_t (&index)[index_size], const Guid& guid, size_t first, Guid GptPartitionEntry::*field) const noexcept {
+            if (!_indexed) {
+                for (auto i = first; i < getEntryCount(); ++i)
+                    if (getEntry(i).isUsed() && getEntry(i).*field == guid)
+                        return i;
+
+                return none;
+            }
+
+            // Entries of the same type are all in the same probe sequence, but not necessarily in order.
+            auto best = none;
+
+            for (auto slot = _hash(guid); index[slot] != 0; slot = (slot + 1) % index_size) {
+                const size_t entry = index[slot] - 1;
+
+                if (entry >= first && entry < best && getEntry(entry).*field == guid)
+                    best = entry;
+            }
+
+            return best;
+        }
+
+        GptHeader _header;
+        const uint8_t* _entries;
+        bool _backup;
+        bool _indexed;
+
+        uint16_t _byUniqueId[index_size];
+        uint16_t _byType[index_size];
+    };
+} // namespace Uefi
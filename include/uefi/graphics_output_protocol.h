@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "guid.h"
+#include "non_copyable.h"
+#include "status.h"
+
+namespace Uefi {
+    /// Describes a linear, 32 bits per pixel framebuffer.
+    struct Framebuffer {
+        /// Bit masks of each color component inside a pixel.
+        struct PixelMasks {
+            uint32_t red, green, blue, reserved;
+        };
+
+        uint32_t* base;
+
+        /// Visible size, in pixels.
+        uint32_t width, height;
+
+        /// Distance between two consecutive lines, in pixels. Can be bigger than width.
+        uint32_t pixels_per_scan_line;
+
+        PixelMasks masks;
+    };
+
+    /// Provides a basic abstraction to set video modes and copy pixels to and from the graphics controller's frame buffer.
+    class GraphicsOutputProtocol : private NonCopyable {
+    public:
+        static constexpr Guid guid = {0x9042a9de, 0x23dc, 0x4a38, {0x96, 0xfb, 0x7a, 0xde, 0xd0, 0x80, 0x51, 0x6a}};
+
+        enum class PixelFormat : uint32_t {
+            /// Byte 0 is red, byte 1 is green, byte 2 is blue and byte 3 is reserved.
+            RedGreenBlueReserved8BitPerColor,
+            /// Byte 0 is blue, byte 1 is green, byte 2 is red and byte 3 is reserved.
+            BlueGreenRedReserved8BitPerColor,
+            /// The pixel layout is described by ModeInformation::pixel_information.
+            BitMask,
+            /// There is no linear framebuffer, only Blt() can be used.
+            BltOnly,
+
+            FormatMax
+        };
+
+        struct PixelBitmask {
+            uint32_t red_mask, green_mask, blue_mask, reserved_mask;
+        };
+
+        struct ModeInformation {
+            uint32_t version;
+            uint32_t horizontal_resolution, vertical_resolution;
+            PixelFormat pixel_format;
+            /// Only valid if pixel_format is BitMask.
+            PixelBitmask pixel_information;
+            /// Pixels per line in the framebuffer. Can be bigger than horizontal_resolution.
+            uint32_t pixels_per_scan_line;
+        };
+
+        struct Mode {
+            /// Number of modes supported by queryMode() and setMode().
+            uint32_t max_mode;
+            /// The current mode.
+            uint32_t mode;
+            ModeInformation* info;
+            size_t size_of_info;
+            uint64_t frame_buffer_base;
+            size_t frame_buffer_size;
+        };
+
+        /// Returns information about available graphics modes.
+        /// @param mode_number The mode to return information on.
+        /// @param[out] size_of_info The size in bytes of info.
+        /// @param[out] info Pointer to a buffer allocated by the firmware, which must be freed with freePool().
+        /// @return Success Valid mode information was returned.
+        /// @return DeviceError A hardware error occurred trying to retrieve the video mode.
+        /// @return InvalidParameter mode_number is not valid.
+        Status queryMode(uint32_t mode_number, size_t& size_of_info, ModeInformation*& info) {
+            return _queryMode(this, mode_number, size_of_info, info);
+        }
+
+        /// Sets the video device into the specified mode and clears the visible portions of the output display to black.
+        /// @return Success The graphics mode specified by mode_number was selected.
+        /// @return DeviceError The device had an error and could not complete the request.
+        /// @return Unsupported mode_number is not supported by this device.
+        Status setMode(uint32_t mode_number) {
+            return _setMode(this, mode_number);
+        }
+
+        // EFI_GRAPHICS_OUTPUT_PROTOCOL_BLT Blt;
+
+        /// Describes the linear framebuffer of the current mode.
+        /// @return Success The framebuffer was returned.
+        /// @return Unsupported The current mode has no linear framebuffer.
+        Status getFramebuffer(Framebuffer& framebuffer) const {
+            const auto& info = *mode->info;
+
+            switch (info.pixel_format) {
+            case PixelFormat::RedGreenBlueReserved8BitPerColor:
+                framebuffer.masks = {0x0000FF, 0x00FF00, 0xFF0000, 0xFF000000};
+                break;
+
+            case PixelFormat::BlueGreenRedReserved8BitPerColor:
+                framebuffer.masks = {0xFF0000, 0x00FF00, 0x0000FF, 0xFF000000};
+                break;
+
+            case PixelFormat::BitMask: {
+                const auto& bits = info.pixel_information;
+                framebuffer.masks = {bits.red_mask, bits.green_mask, bits.blue_mask, bits.reserved_mask};
+                break;
+            }
+
+            default:
+                return Status::Unsupported;
+            }
+
+            framebuffer.base = reinterpret_cast<uint32_t*>(static_cast<uintptr_t>(mode->frame_buffer_base));
+            framebuffer.width = info.horizontal_resolution;
+            framebuffer.height = info.vertical_resolution;
+            framebuffer.pixels_per_scan_line = info.pixels_per_scan_line;
+
+            return Status::Success;
+        }
+
+    private:
+        Status (*_queryMode)(GraphicsOutputProtocol*, uint32_t, size_t&, ModeInformation*&);
+        Status (*_setMode)(GraphicsOutputProtocol*, uint32_t);
+
+        [[maybe_unused]] void* _blt;
+
+    public:
+        Mode* mode;
+    };
+} // namespace Uefi
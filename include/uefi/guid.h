@@ -6,6 +6,9 @@ namespace Uefi {
     /// Unique reference number used as an identifier for various protocols or for partition tables.
     /// See https://en.wikipedia.org/wiki/Globally_unique_identifier
     union Guid {
+        /// Leaves the GUID uninitialized, so that structures containing GUIDs (e.g. read from a disk) can be declared.
+        Guid() = default;
+
         /// Constructs a new GUID from some values (usually taken from the standard).
         constexpr Guid(uint32_t d1, uint16_t d2, uint16_t d3, const uint8_t (&d4)[8])
             : a{d1, d2, d3, {/* Constexpr constructor must initialize all members. */}} {
@@ -29,7 +32,11 @@ namespace Uefi {
 
     static_assert(sizeof(Guid) == 16, "GUIDs are supposed to be 128 bit big.");
 
-    bool operator==(const Guid& lhs, const Guid& rhs) {
-        return lhs.b.data1 == rhs.b.data2;
+    inline bool operator==(const Guid& lhs, const Guid& rhs) {
+        return lhs.b.data1 == rhs.b.data1 && lhs.b.data2 == rhs.b.data2;
+    }
+
+    inline bool operator!=(const Guid& lhs, const Guid& rhs) {
+        return !(lhs == rhs);
     }
 } // namespace Uefi
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "file_protocol.h"
+
+namespace Uefi {
+    /// A FileProtocol which hashes the bytes read through it, while they are still in the cache.
+    /// `Hash` is anything with an `update(const void*, size_t)` method, like Sha256 or Sha384.
+    /// @code
+    /// Sha256 hash;
+    /// hash.initialize();
+    /// HashingFile<Sha256> tap;
+    /// tap.initialize(*file, hash, scratch, sizeof(scratch));
+    /// loadElf(boot_services, tap, report);
+    /// tap.complete();
+    /// hash.finish(digest);
+    /// @endcode
+    /// The hash always covers the file from its beginning, in order, whatever the order of the reads: the bytes a read
+    /// skips over are first read and hashed through the scratch buffer. complete() hashes what was never read.
+    /// Writes are refused, since they would change bytes which are already hashed.
+    template <typename Hash>
+    class HashingFile : public FileProtocol {
+    public:
+        /// @param scratch Used to hash the parts of the file which are skipped or never read. Any non-zero size works,
+        /// larger ones need fewer reads.
+        void initialize(FileProtocol& file, Hash& hash, void* scratch, size_t scratch_size) noexcept {
+            // The asynchronous functions of FileProtocol2 are not forwarded.
+            revision = revision_1;
+            _open = &HashingFile::_openThunk;
+            _close = &HashingFile::_closeThunk;
+            _read = &HashingFile::_readThunk;
+            _write = &HashingFile::_writeThunk;
+            _getPosition = &HashingFile::_getPositionThunk;
+            _setPosition = &HashingFile::_setPositionThunk;
+            _getInfo = &HashingFile::_getInfoThunk;
+            _setInfo = &HashingFile::_setInfoThunk;
+            _flush = &HashingFile::_flushThunk;
+
+            for (auto& unused : _buf1)
+                unused = nullptr;
+
+            _file = &file;
+            _hash = &hash;
+            _scratch = static_cast<uint8_t*>(scratch);
+            _scratchSize = scratch_size;
+            _hashedSize = 0;
+        }
+
+        /// Hashes the rest of the file. The position of the underlying file is left at its end.
+        Status complete() noexcept {
+            auto status = _file->setPosition(_hashedSize);
+            if (status != Status::Success)
+                return status;
+
+            for (;;) {
+                size_t size = _scratchSize;
+                status = _file->read(size, _scratch);
+                if (status != Status::Success)
+                    return status;
+
+                if (size == 0)
+                    return Status::Success;
+
+                _hash->update(_scratch, size);
+                _hashedSize += size;
+            }
+        }
+
+        /// The number of bytes hashed so far, from the beginning of the file.
+        [[nodiscard]] uint64_t getHashedSize() const noexcept {
+            return _hashedSize;
+        }
+
+    private:
+        static constexpr uint64_t revision_1 = 0x00010000;
+
+        static HashingFile& _self(FileProtocol* protocol) noexcept {
+            return *static_cast<HashingFile*>(protocol);
+        }
+
+        // Files opened relative to this one are not hashed.
+        static Status _openThunk(FileProtocol* protocol, FileProtocol*& new_handle, const char16_t* file_name,
+                                 OpenMode open_mode, FileAttributes attributes) {
+            return _self(protocol)._file->open(new_handle, file_name, open_mode, attributes);
+        }
+
+        static Status _closeThunk(FileProtocol* protocol) {
+            return _self(protocol)._file->close();
+        }
+
+        static Status _readThunk(FileProtocol* protocol, size_t& buffer_size, void* buffer) {
+            return _self(protocol)._readAndHash(buffer_size, static_cast<uint8_t*>(buffer));
+        }
+
+        static Status _writeThunk(FileProtocol*, size_t& buffer_size, const void*) {
+            buffer_size = 0;
+            return Status::WriteProtected;
+        }
+
+        static Status _getPositionThunk(FileProtocol* protocol, uint64_t& position) {
+            return _self(protocol)._file->getPosition(position);
+        }
+
+        static Status _setPositionThunk(FileProtocol* protocol, uint64_t position) {
+            return _self(protocol)._file->setPosition(position);
+        }
+
+        static Status _getInfoThunk(FileProtocol* protocol, const Guid& info_type, size_t& buffer_size, void* buffer) {
+            return _self(protocol)._file->getInfo(info_type, buffer_size, buffer);
+        }
+
+        // Resizing or renaming would change the bytes the hash covers.
+        static Status _setInfoThunk(FileProtocol*, const Guid&, size_t, const void*) {
+            return Status::WriteProtected;
+        }
+
+        static Status _flushThunk(FileProtocol* protocol) {
+            return _self(protocol)._file->flush();
+        }
+
+        Status _readAndHash(size_t& buffer_size, uint8_t* buffer) {
+            uint64_t position;
+            auto status = _file->getPosition(position);
+            if (status != Status::Success)
+                return status;
+
+            if (position > _hashedSize) {
+                status = _hashGap(position);
+                if (status != Status::Success)
+                    return status;
+            }
+
+            status = _file->read(buffer_size, buffer);
+            if (status != Status::Success)
+                return status;
+
+            // Only the part after what is already hashed is new. Rereading earlier bytes hashes nothing.
+            const auto end = position + buffer_size;
+            if (position <= _hashedSize && end > _hashedSize) {
+                _hash->update(buffer + (_hashedSize - position), static_cast<size_t>(end - _hashedSize));
+                _hashedSize = end;
+            }
+
+            return Status::Success;
+        }
+
+        /// Hashes the bytes between the hashed prefix and `position`, and moves back to `position`.
+        Status _hashGap(uint64_t position) {
+            auto status = _file->setPosition(_hashedSize);
+            if (status != Status::Success)
+                return status;
+
+            while (_hashedSize < position) {
+                const auto remaining = position - _hashedSize;
+                size_t size = remaining < _scratchSize ? static_cast<size_t>(remaining) : _scratchSize;
+                status = _file->read(size, _scratch);
+                if (status != Status::Success)
+                    return status;
+
+                if (size == 0)
+                    break;
+
+                _hash->update(_scratch, size);
+                _hashedSize += size;
+            }
+
+            return _file->setPosition(position);
+        }
+
+        FileProtocol* _file;
+        Hash* _hash;
+        uint8_t* _scratch;
+        size_t _scratchSize;
+        uint64_t _hashedSize;
+    };
+} // namespace Uefi
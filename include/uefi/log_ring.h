@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "clock.h"
+#include "detail/timestamp.h"
+#include "format.h"
+#include "status.h"
+#include "text_output_stream.h"
+
+namespace Uefi {
+    enum class LogSeverity : uint8_t {
+        Error,
+        Warning,
+        Info,
+        Debug
+    };
+
+    struct LogRecord {
+        /// Characters of text a record holds. Longer messages are cut.
+        static constexpr size_t text_capacity = 117;
+
+        /// Detail::readTimestamp() when the record was reserved.
+        uint64_t timestamp;
+        LogSeverity severity;
+        uint8_t _reserved;
+        /// The number of characters in `text`.
+        uint16_t length;
+        /// Null-terminated.
+        char16_t text[text_capacity + 1];
+
+        /// Used by print() to format into the record, cutting what does not fit.
+        Status outputString(const char16_t* string) noexcept {
+            for (; *string != 0 && length < text_capacity; ++string)
+                text[length++] = *string;
+
+            text[length] = 0;
+            return Status::Success;
+        }
+    };
+
+    /// A ring of log records with many producers and one consumer, for diagnostics from the places where the console
+    /// cannot be used: event callbacks running at TPL_NOTIFY, and application processors.
+    /// Producers never block, allocate or call the firmware: they take a slot with a compare-and-swap, fill it, and
+    /// publish it. When the ring is full, the record is dropped and counted instead.
+    /// The consumer calls drain() at TPL_APPLICATION to print the records in the order they were reserved.
+    /// It follows the bounded queue of Dmitry Vyukov: each slot has a sequence number which tells whether it is free
+    /// for the producer of a given position, or published for the consumer.
+    /// See https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+    /// @code
+    /// static uint8_t log_memory[LogRing::getRequiredSize(256)];
+    /// log.initialize(log_memory, sizeof(log_memory));
+    /// // In an event callback or on an AP:
+    /// log.write(LogSeverity::Warning, UEFI_FORMAT("timer {} late by {} us"), index, late);
+    /// // In the main loop:
+    /// log.drain(output, &clock);
+    /// @endcode
+    class LogRing {
+    public:
+        /// The memory initialize() needs for `record_count` records, which must be a power of two.
+        static constexpr size_t getRequiredSize(size_t record_count) noexcept {
+            return record_count * sizeof(Slot);
+        }
+
+        /// Lays out the ring in `memory`, with as many records as fit, rounded down to a power of two.
+        /// @return BufferTooSmall `memory` holds less than 2 records.
+        Status initialize(void* memory, size_t size) noexcept {
+            size_t count = 2;
+            if (size < count * sizeof(Slot))
+                return Status::BufferTooSmall;
+
+            while (count * 2 * sizeof(Slot) <= size)
+                count *= 2;
+
+            _slots = static_cast<Slot*>(memory);
+            _mask = count - 1;
+            _head = 0;
+            _tail = 0;
+            _dropped = 0;
+
+            // A slot is free for the producer of position p when its sequence is p.
+            for (size_t i = 0; i < count; ++i)
+                _slots[i].sequence = i;
+
+            return Status::Success;
+        }
+
+        /// Takes the next slot and stamps it. Fill its text, then publish it with commit().
+        /// A reserved slot holds back the records after it until it is committed, so commit it promptly.
+        /// @return nullptr The ring is full. The record is counted as dropped.
+        [[nodiscard]] LogRecord* reserve(LogSeverity severity) noexcept {
+            auto position = __atomic_load_n(&_head, __ATOMIC_RELAXED);
+
+            for (;;) {
+                auto& slot = _slots[position & _mask];
+                const auto sequence = __atomic_load_n(&slot.sequence, __ATOMIC_ACQUIRE);
+                const auto difference = static_cast<int64_t>(sequence - position);
+
+                if (difference == 0) {
+                    // On failure, `position` is reloaded with the head another producer moved.
+                    if (__atomic_compare_exchange_n(&_head, &position, position + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                        slot.record.timestamp = Detail::readTimestamp();
+                        slot.record.severity = severity;
+                        slot.record.length = 0;
+                        slot.record.text[0] = 0;
+                        return &slot.record;
+                    }
+                } else if (difference < 0) {
+                    // The consumer has not freed this slot yet since the previous lap.
+                    __atomic_fetch_add(&_dropped, 1, __ATOMIC_RELAXED);
+                    return nullptr;
+                } else {
+                    position = __atomic_load_n(&_head, __ATOMIC_RELAXED);
+                }
+            }
+        }
+
+        /// Publishes a record returned by reserve().
+        void commit(LogRecord* record) noexcept {
+            auto* slot = reinterpret_cast<Slot*>(reinterpret_cast<uint8_t*>(record) - offsetof(Slot, record));
+            const auto position = __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED);
+            __atomic_store_n(&slot->sequence, position + 1, __ATOMIC_RELEASE);
+        }
+
+        /// Formats a record, like print(), and publishes it.
+        /// @return false The ring is full, and the record was dropped.
+        template <typename Format, typename... Args>
+        bool write(LogSeverity severity, Format format, const Args&... args) noexcept {
+            auto* record = reserve(severity);
+            if (record == nullptr)
+                return false;
+
+            print<format_buffer_size>(*record, format, args...);
+            commit(record);
+            return true;
+        }
+
+        /// Prints the published records as "[seconds.microseconds] E message", followed by the number of dropped
+        /// records if there are any. Only one processor may drain at a time, at TPL_APPLICATION since it calls the
+        /// firmware.
+        /// @param clock Converts the timestamps. Without one, the raw counter values are printed.
+        /// @return The number of records printed.
+        size_t drain(TextOutputStream& sink, const Clock* clock = nullptr) noexcept {
+            size_t count = 0;
+
+            for (;; ++_tail, ++count) {
+                auto& slot = _slots[_tail & _mask];
+                if (__atomic_load_n(&slot.sequence, __ATOMIC_ACQUIRE) != _tail + 1)
+                    break;
+
+                const auto& record = slot.record;
+                const char16_t severity = u"EWID"[static_cast<uint8_t>(record.severity) & 3];
+                const char16_t* text = record.text;
+
+                if (clock != nullptr) {
+                    // Records reserved before the clock was initialized show as 0.
+                    const auto ticks = record.timestamp > clock->getStart() ? record.timestamp - clock->getStart() : 0;
+                    const auto microseconds = clock->toNanoseconds(ticks) / 1000;
+                    sink.print(UEFI_FORMAT("[{:5}.{:06}] {} {}\r\n"), microseconds / 1000000, microseconds % 1000000, severity, text);
+                } else {
+                    sink.print(UEFI_FORMAT("[{:#x}] {} {}\r\n"), record.timestamp, severity, text);
+                }
+
+                // Frees the slot for the producer of the next lap.
+                __atomic_store_n(&slot.sequence, _tail + _mask + 1, __ATOMIC_RELEASE);
+            }
+
+            const auto dropped = __atomic_exchange_n(&_dropped, 0, __ATOMIC_RELAXED);
+            if (dropped != 0)
+                sink.print(UEFI_FORMAT("[log] {} records dropped\r\n"), dropped);
+
+            return count;
+        }
+
+        /// The number of records dropped since the last drain().
+        [[nodiscard]] uint64_t getDroppedCount() const noexcept {
+            return __atomic_load_n(&_dropped, __ATOMIC_RELAXED);
+        }
+
+        [[nodiscard]] size_t getCapacity() const noexcept {
+            return _mask + 1;
+        }
+
+    private:
+        /// The smallest buffer print() accepts. It is passed on to the record as it fills up.
+        static constexpr size_t format_buffer_size = (2 * Detail::max_format_width) + 2;
+
+        struct Slot {
+            uint64_t sequence;
+            LogRecord record;
+        };
+
+        static_assert(sizeof(Slot) == 256, "A slot spans whole cache lines.");
+
+        Slot* _slots;
+        uint64_t _mask;
+
+        // The producers and the consumer each write their own cache line.
+        alignas(64) uint64_t _head;
+        uint64_t _dropped;
+        alignas(64) uint64_t _tail;
+    };
+} // namespace Uefi
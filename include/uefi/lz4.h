@@ -0,0 +1,700 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "boot_services.h"
+#include "detail/memory.h"
+#include "detail/xxhash.h"
+#include "file_protocol.h"
+#include "non_copyable.h"
+#include "status.h"
+
+namespace Uefi {
+    /// A streaming decoder for the LZ4 frame format (what the lz4 command line tool produces).
+    /// See https://github.com/lz4/lz4/blob/dev/doc/lz4_Frame_format.md
+    ///
+    /// Compressed data can be given in chunks of any size, as they are read. The decompressed data is written straight
+    /// to a single output buffer (e.g. pages from allocatePages()), which also serves as the history for back
+    /// references: the decoder needs no window nor any other memory.
+    /// Concatenated and skippable frames are supported, dictionaries are not.
+    class Lz4Decoder : private NonCopyable {
+    public:
+        /// Finds the decompressed size of a frame, if its header declares it.
+        /// Useful to allocate the output before decompressing.
+        /// @param data The start of the compressed data. 14 bytes are enough.
+        /// @return Success The size was found.
+        /// @return NotFound The frame doesn't declare its size.
+        /// @return InvalidParameter The data is not an LZ4 frame, or is too short.
+        static Status getContentSize(const void* data, size_t size, uint64_t& content_size) noexcept {
+            const auto* bytes = static_cast<const uint8_t*>(data);
+
+            if (size < 6 || _read32(bytes) != frame_magic)
+                return Status::InvalidParameter;
+
+            if ((bytes[4] & flag_content_size) == 0)
+                return Status::NotFound;
+
+            if (size < 14)
+                return Status::InvalidParameter;
+
+            Detail::copyBytes(&content_size, bytes + 6, sizeof(content_size));
+            return Status::Success;
+        }
+
+        /// Prepares the decoder for a new stream.
+        /// @param output Receives the decompressed data.
+        /// @param verify_checksums Whether to check the optional block and content checksums of the frames.
+        void initialize(void* output, size_t output_size, bool verify_checksums = true) noexcept {
+            _output = static_cast<uint8_t*>(output);
+            _outputEnd = _output + output_size;
+            _out = _output;
+            _verifyChecksums = verify_checksums;
+            _state = State::Magic;
+            _fieldSize = 0;
+            _frameCount = 0;
+        }
+
+        /// Decompresses a chunk of compressed data. The whole chunk is always consumed: the decoder remembers where
+        /// it stopped, even in the middle of a sequence or a header.
+        /// @return Success The chunk was decompressed.
+        /// @return BufferTooSmall The output is full.
+        /// @return InvalidParameter The data is corrupted.
+        /// @return CrcError A checksum doesn't match.
+        /// @return Unsupported The frame needs a dictionary, or uses the legacy format.
+        Status decode(const void* input, size_t input_size) noexcept {
+            const auto* in = static_cast<const uint8_t*>(input);
+            const auto* const end = in + input_size;
+
+            while (in < end) {
+                if (_state == State::Block) {
+                    const auto available = static_cast<size_t>(end - in);
+                    const auto block_end = in + (available < _blockRemaining ? available : _blockRemaining);
+                    const auto* start = in;
+
+                    const auto status = _compressed ? _decodeSequences(in, block_end, static_cast<size_t>(block_end - in) == _blockRemaining) : _copyStored(in, block_end);
+
+                    _blockRemaining -= static_cast<uint32_t>(in - start);
+                    if (_verifyChecksums && _blockChecksums)
+                        _blockHash.update(start, in - start);
+
+                    if (status != Status::Success)
+                        return status;
+
+                    if (_blockRemaining == 0) {
+                        // A compressed block ends with a sequence made only of literals.
+                        if (_compressed && _sequenceState != SequenceState::Token)
+                            return Status::InvalidParameter;
+
+                        if (_verifyChecksums && _contentChecksum)
+                            _contentHash.update(_blockOutput, _out - _blockOutput);
+
+                        _state = _blockChecksums ? State::BlockChecksum : State::BlockSize;
+                    }
+
+                    continue;
+                }
+
+                const auto status = _decodeHeader(in, end);
+                if (status != Status::Success)
+                    return status;
+            }
+
+            return Status::Success;
+        }
+
+        /// True if at least one frame was decoded, and the decoder is not in the middle of another one.
+        [[nodiscard]] bool isFinished() const noexcept {
+            return _state == State::Magic && _fieldSize == 0 && _frameCount != 0;
+        }
+
+        /// Number of bytes decompressed so far.
+        [[nodiscard]] size_t getOutputSize() const noexcept {
+            return _out - _output;
+        }
+
+    private:
+        static constexpr uint32_t frame_magic = 0x184D2204;
+        static constexpr uint32_t legacy_magic = 0x184C2102;
+        static constexpr uint32_t skippable_magic = 0x184D2A50;
+
+        static constexpr uint8_t flag_version_mask = 0xC0;
+        static constexpr uint8_t flag_version = 0x40;
+        static constexpr uint8_t flag_block_checksum = 0x10;
+        static constexpr uint8_t flag_content_size = 0x08;
+        static constexpr uint8_t flag_content_checksum = 0x04;
+        static constexpr uint8_t flag_reserved = 0x02;
+        static constexpr uint8_t flag_dictionary = 0x01;
+
+        static constexpr uint32_t block_uncompressed = 0x80000000;
+        static constexpr size_t min_match = 4;
+
+        enum class State {
+            Magic,
+            Descriptor,
+            SkippableSize,
+            Skip,
+            BlockSize,
+            Block,
+            BlockChecksum,
+            ContentChecksum
+        };
+
+        enum class SequenceState {
+            Token,
+            LiteralLength,
+            Literals,
+            Offset,
+            MatchLength
+        };
+
+        static uint32_t _read32(const uint8_t* bytes) noexcept {
+            uint32_t value;
+            Detail::copyBytes(&value, bytes, sizeof(value));
+            return value;
+        }
+
+        static uint16_t _read16(const uint8_t* bytes) noexcept {
+            return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+        }
+
+        /// Accumulates a small field which might be split across chunks.
+        /// @return True once (at least) `size` bytes are available in _field.
+        bool _gather(const uint8_t*& in, const uint8_t* end, size_t size) noexcept {
+            while (_fieldSize < size && in < end)
+                _field[_fieldSize++] = *in++;
+
+            return _fieldSize >= size;
+        }
+
+        /// Handles everything outside of block data.
+        Status _decodeHeader(const uint8_t*& in, const uint8_t* end) noexcept {
+            switch (_state) {
+            case State::Magic: {
+                if (!_gather(in, end, 4))
+                    return Status::Success;
+
+                const auto magic = _read32(_field);
+                _fieldSize = 0;
+
+                if (magic == frame_magic)
+                    _state = State::Descriptor;
+                else if ((magic & 0xFFFFFFF0) == skippable_magic)
+                    _state = State::SkippableSize;
+                else if (magic == legacy_magic)
+                    return Status::Unsupported;
+                else
+                    return Status::InvalidParameter;
+
+                return Status::Success;
+            }
+
+            case State::Descriptor:
+                return _decodeDescriptor(in, end);
+
+            case State::SkippableSize:
+                if (!_gather(in, end, 4))
+                    return Status::Success;
+
+                _skipRemaining = _read32(_field);
+                _fieldSize = 0;
+                _state = State::Skip;
+                return Status::Success;
+
+            case State::Skip: {
+                const auto available = static_cast<size_t>(end - in);
+                const auto count = available < _skipRemaining ? available : _skipRemaining;
+
+                in += count;
+                _skipRemaining -= static_cast<uint32_t>(count);
+
+                if (_skipRemaining == 0)
+                    _state = State::Magic;
+
+                return Status::Success;
+            }
+
+            case State::BlockSize: {
+                if (!_gather(in, end, 4))
+                    return Status::Success;
+
+                const auto size = _read32(_field);
+                _fieldSize = 0;
+
+                // The end mark.
+                if (size == 0) {
+                    if (_contentChecksum) {
+                        _state = State::ContentChecksum;
+                        return Status::Success;
+                    }
+
+                    return _endFrame();
+                }
+
+                _compressed = (size & block_uncompressed) == 0;
+                _blockRemaining = size & ~block_uncompressed;
+
+                if (_blockRemaining > _blockMaxSize)
+                    return Status::InvalidParameter;
+
+                _blockOutput = _out;
+                _sequenceState = SequenceState::Token;
+                _state = State::Block;
+
+                if (_verifyChecksums && _blockChecksums)
+                    _blockHash.initialize();
+
+                return Status::Success;
+            }
+
+            case State::BlockChecksum:
+                if (!_gather(in, end, 4))
+                    return Status::Success;
+
+                _fieldSize = 0;
+                _state = State::BlockSize;
+
+                if (_verifyChecksums && _read32(_field) != _blockHash.finish())
+                    return Status::CrcError;
+
+                return Status::Success;
+
+            case State::ContentChecksum:
+                if (!_gather(in, end, 4))
+                    return Status::Success;
+
+                _fieldSize = 0;
+
+                if (_verifyChecksums && _read32(_field) != _contentHash.finish())
+                    return Status::CrcError;
+
+                return _endFrame();
+
+            case State::Block:
+                break;
+            }
+
+            return Status::Success;
+        }
+
+        Status _decodeDescriptor(const uint8_t*& in, const uint8_t* end) noexcept {
+            // The flag and block descriptor bytes tell how long the rest is.
+            if (!_gather(in, end, 2))
+                return Status::Success;
+
+            const auto flags = _field[0];
+
+            if ((flags & flag_version_mask) != flag_version || (flags & flag_reserved) != 0)
+                return Status::InvalidParameter;
+
+            if ((flags & flag_dictionary) != 0)
+                return Status::Unsupported;
+
+            const size_t size = 2 + ((flags & flag_content_size) != 0 ? 8 : 0) + 1;
+            if (!_gather(in, end, size))
+                return Status::Success;
+
+            _fieldSize = 0;
+
+            if (static_cast<uint8_t>(Detail::Xxh32::calculate(_field, size - 1) >> 8) != _field[size - 1])
+                return Status::CrcError;
+
+            const auto block_size_id = (_field[1] >> 4) & 7;
+            if (block_size_id < 4)
+                return Status::InvalidParameter;
+
+            _blockMaxSize = uint32_t{1} << (8 + (2 * block_size_id));
+            _blockChecksums = (flags & flag_block_checksum) != 0;
+            _contentChecksum = (flags & flag_content_checksum) != 0;
+            _frameStart = _out;
+            _contentSize = ~uint64_t{0};
+
+            if ((flags & flag_content_size) != 0) {
+                Detail::copyBytes(&_contentSize, _field + 2, sizeof(_contentSize));
+
+                if (_contentSize > static_cast<uint64_t>(_outputEnd - _out))
+                    return Status::BufferTooSmall;
+            }
+
+            if (_verifyChecksums && _contentChecksum)
+                _contentHash.initialize();
+
+            _state = State::BlockSize;
+            return Status::Success;
+        }
+
+        Status _endFrame() noexcept {
+            if (_contentSize != ~uint64_t{0} && _contentSize != static_cast<uint64_t>(_out - _frameStart))
+                return Status::InvalidParameter;
+
+            ++_frameCount;
+            _state = State::Magic;
+            return Status::Success;
+        }
+
+        Status _copyStored(const uint8_t*& in, const uint8_t* end) noexcept {
+            const auto size = static_cast<size_t>(end - in);
+            if (size > static_cast<size_t>(_outputEnd - _out))
+                return Status::BufferTooSmall;
+
+            Detail::copyBytes(_out, in, size);
+            _out += size;
+            in = end;
+            return Status::Success;
+        }
+
+        /// Copies a match, which might overlap its own output (e.g. a run of a single byte has an offset of 1).
+        static void _copyMatch(uint8_t* out, size_t offset, size_t length) noexcept {
+            const auto* match = out - offset;
+
+            if (offset >= length) {
+                Detail::copyBytes(out, match, length);
+                return;
+            }
+
+            // The bytes from match to out repeat. Each copy doubles the length of the repeated pattern, so that
+            // the source and destination never overlap.
+            for (auto step = offset; length > 0; step *= 2) {
+                const auto count = step < length ? step : length;
+                Detail::copyBytes(out, match, count);
+                out += count;
+                length -= count;
+            }
+        }
+
+        /// Copies a short match byte by byte, which is faster than a few small copies when it overlaps itself.
+        static void _copyShortMatch(uint8_t* out, size_t offset, size_t length) noexcept {
+            const auto* match = out - offset;
+
+            for (size_t i = 0; i < length; ++i)
+                out[i] = match[i];
+        }
+
+        /// Copies 16 bytes at a time, possibly past the end (up to 15 bytes), which must therefore be writable.
+        static void _copyWide(uint8_t* destination, const uint8_t* source, size_t size) noexcept {
+            for (size_t i = 0; i < size; i += 16)
+                Detail::copyBytes(destination + i, source + i, 16);
+        }
+
+        /// Reads the extra bytes of a literal or match length, each adding up to 255.
+        /// @return False if the input ends first.
+        static bool _readExtraLength(const uint8_t*& in, const uint8_t* end, size_t& length) noexcept {
+            uint8_t extra;
+
+            do {
+                if (in == end)
+                    return false;
+
+                extra = *in++;
+                length += extra;
+            } while (extra == 255);
+
+            return true;
+        }
+
+        /// Decodes whole sequences as long as they are entirely in the input and fit in the output.
+        /// This is the hot path: it only leaves the work to the state machine around chunk boundaries.
+        /// When there is enough room, literals and matches are copied 16 bytes at a time, past their end;
+        /// the extra bytes are overwritten by the following sequences.
+        /// @param block_ends Whether the block ends with this input: its last sequence has no match.
+        void _decodeFast(const uint8_t*& in, const uint8_t* end, bool block_ends) noexcept {
+            constexpr size_t slack = 16;
+
+            // Everything is kept in locals: the compiler would otherwise reload the members after every copy, as
+            // byte stores may alias them.
+            const auto* p = in;
+            auto* out = _out;
+            auto* const output_end = _outputEnd;
+            const auto* const frame_start = _frameStart;
+
+            while (p < end) {
+                const auto* const sequence = p;
+                const auto token = *p++;
+
+                size_t literal_length = token >> 4;
+                if (literal_length == 15 && !_readExtraLength(p, end, literal_length)) {
+                    p = sequence;
+                    break;
+                }
+
+                const auto input_left = static_cast<size_t>(end - p);
+                const auto output_left = static_cast<size_t>(output_end - out);
+
+                if (literal_length > input_left || literal_length > output_left) {
+                    p = sequence;
+                    break;
+                }
+
+                if (literal_length + slack <= input_left && literal_length + slack <= output_left)
+                    _copyWide(out, p, literal_length);
+                else
+                    Detail::copyBytes(out, p, literal_length);
+
+                p += literal_length;
+
+                // The last sequence of a block has no match.
+                if (p == end) {
+                    if (block_ends)
+                        out += literal_length;
+                    else
+                        p = sequence;
+                    break;
+                }
+
+                if (end - p < 2) {
+                    p = sequence;
+                    break;
+                }
+
+                const size_t offset = _read16(p);
+                p += 2;
+
+                size_t match_length = token & 15;
+                if (match_length == 15 && !_readExtraLength(p, end, match_length)) {
+                    p = sequence;
+                    break;
+                }
+
+                match_length += min_match;
+
+                auto* const match_out = out + literal_length;
+                const auto match_output_left = static_cast<size_t>(output_end - match_out);
+
+                // Invalid offsets are reported by the state machine.
+                if (offset == 0 || offset > static_cast<size_t>(match_out - frame_start) || match_length > match_output_left) {
+                    p = sequence;
+                    break;
+                }
+
+                // With an offset of at least 16, every 16 byte piece comes from output which is already written.
+                // The same goes for 8 byte pieces with an offset of at least 8.
+                if (offset >= slack && match_length + slack <= match_output_left) {
+                    _copyWide(match_out, match_out - offset, match_length);
+                } else if (offset >= 8 && match_length <= slack && slack <= match_output_left) {
+                    Detail::copyBytes(match_out, match_out - offset, 8);
+                    Detail::copyBytes(match_out + 8, match_out + 8 - offset, 8);
+                } else if (match_length <= slack) {
+                    _copyShortMatch(match_out, offset, match_length);
+                } else {
+                    _copyMatch(match_out, offset, match_length);
+                }
+
+                out = match_out + match_length;
+            }
+
+            in = p;
+            _out = out;
+        }
+
+        /// Decodes compressed block data.
+        /// @param block_ends Whether the block ends with this input.
+        Status _decodeSequences(const uint8_t*& in, const uint8_t* end, bool block_ends) noexcept {
+            while (in < end) {
+                switch (_sequenceState) {
+                case SequenceState::Token: {
+                    _decodeFast(in, end, block_ends);
+                    if (in == end)
+                        break;
+
+                    const auto token = *in++;
+                    _literalLength = token >> 4;
+                    _matchLength = token & 15;
+                    _sequenceState = _literalLength == 15 ? SequenceState::LiteralLength : SequenceState::Literals;
+                    break;
+                }
+
+                case SequenceState::LiteralLength: {
+                    const auto extra = *in++;
+                    _literalLength += extra;
+
+                    if (extra != 255)
+                        _sequenceState = SequenceState::Literals;
+                    break;
+                }
+
+                case SequenceState::Literals: {
+                    const auto available = static_cast<size_t>(end - in);
+                    const auto count = available < _literalLength ? available : _literalLength;
+
+                    if (count > static_cast<size_t>(_outputEnd - _out))
+                        return Status::BufferTooSmall;
+
+                    Detail::copyBytes(_out, in, count);
+                    _out += count;
+                    in += count;
+                    _literalLength -= count;
+
+                    if (_literalLength == 0)
+                        _sequenceState = in == end && block_ends ? SequenceState::Token : SequenceState::Offset;
+                    break;
+                }
+
+                case SequenceState::Offset:
+                    if (!_gather(in, end, 2))
+                        break;
+
+                    _fieldSize = 0;
+                    _offset = _read16(_field);
+
+                    if (_matchLength == 15) {
+                        _sequenceState = SequenceState::MatchLength;
+                        break;
+                    }
+
+                    if (const auto status = _endSequence(); status != Status::Success)
+                        return status;
+                    break;
+
+                case SequenceState::MatchLength: {
+                    const auto extra = *in++;
+                    _matchLength += extra;
+
+                    if (extra != 255) {
+                        if (const auto status = _endSequence(); status != Status::Success)
+                            return status;
+                    }
+                    break;
+                }
+                }
+            }
+
+            return Status::Success;
+        }
+
+        Status _endSequence() noexcept {
+            const auto length = _matchLength + min_match;
+
+            if (_offset == 0 || _offset > static_cast<size_t>(_out - _frameStart))
+                return Status::InvalidParameter;
+
+            if (length > static_cast<size_t>(_outputEnd - _out))
+                return Status::BufferTooSmall;
+
+            _copyMatch(_out, _offset, length);
+            _out += length;
+            _sequenceState = SequenceState::Token;
+            return Status::Success;
+        }
+
+        uint8_t* _output;
+        uint8_t* _outputEnd;
+        uint8_t* _out;
+        uint8_t* _frameStart;
+        uint8_t* _blockOutput;
+
+        State _state;
+        SequenceState _sequenceState;
+
+        uint8_t _field[16];
+        size_t _fieldSize;
+
+        bool _verifyChecksums;
+        /// Which checksums the current frame has.
+        bool _blockChecksums, _contentChecksum;
+        bool _compressed;
+
+        uint32_t _blockMaxSize;
+        uint32_t _blockRemaining;
+        uint32_t _skipRemaining;
+        uint64_t _contentSize;
+
+        size_t _literalLength;
+        size_t _matchLength;
+        size_t _offset;
+
+        size_t _frameCount;
+
+        Detail::Xxh32 _blockHash, _contentHash;
+    };
+
+    /// Reads a whole LZ4 compressed file and decompresses it with an initialized decoder.
+    /// When the file is a FileProtocol2 and boot services are given, the next chunk is read asynchronously while the
+    /// current one is decompressed, so that the total time is close to the longest of the two instead of their sum.
+    /// Otherwise (or if the file system doesn't support asynchronous reads), chunks are read and decompressed in turn.
+    /// @param buffer Holds the compressed chunks. It is split in two halves, which are read into alternately.
+    /// @return Success The whole file was decompressed.
+    /// @return InvalidParameter The file ends in the middle of a frame, or buffer_size is too small.
+    /// @return Anything returned by FileProtocol::read() or Lz4Decoder::decode().
+    inline Status decompressFile(FileProtocol& file, Lz4Decoder& decoder, void* buffer, size_t buffer_size, BootServices* boot_services = nullptr) {
+        auto status = file.setPosition(0);
+        if (status != Status::Success)
+            return status;
+
+        const auto half = buffer_size / 2;
+        if (half == 0)
+            return Status::InvalidParameter;
+
+        uint8_t* const halves[2] = {static_cast<uint8_t*>(buffer), static_cast<uint8_t*>(buffer) + half};
+
+        FileProtocol2::IoToken token = {};
+        auto* file2 = file.revision >= FileProtocol2::revision_2 && boot_services != nullptr ? static_cast<FileProtocol2*>(&file) : nullptr;
+
+        if (file2 != nullptr && boot_services->createEvent(EventType::None, Tpl::Callback, nullptr, nullptr, token.event) != Status::Success)
+            file2 = nullptr;
+
+        bool pending = false;
+
+        // Starts reading a chunk. Falls back to synchronous reads if asynchronous ones are not available.
+        const auto startRead = [&](uint8_t* destination) {
+            token.buffer = destination;
+            token.buffer_size = half;
+
+            if (file2 != nullptr) {
+                const auto result = file2->readEx(token);
+                if (result != Status::Unsupported) {
+                    pending = result == Status::Success;
+                    return result;
+                }
+
+                boot_services->closeEvent(token.event);
+                file2 = nullptr;
+            }
+
+            token.status = file.read(token.buffer_size, destination);
+            return Status::Success;
+        };
+
+        // Waits for the chunk being read.
+        const auto finishRead = [&]() {
+            if (pending) {
+                size_t index;
+                boot_services->waitForEvent(1, &token.event, index);
+                pending = false;
+            }
+
+            return token.status;
+        };
+
+        size_t current = 0;
+        status = startRead(halves[current]);
+
+        while (status == Status::Success) {
+            status = finishRead();
+            if (status != Status::Success)
+                break;
+
+            const auto size = token.buffer_size;
+            if (size == 0)
+                break;
+
+            // Reads the next chunk while this one is decompressed.
+            status = startRead(halves[current ^ 1]);
+            if (status != Status::Success)
+                break;
+
+            status = decoder.decode(halves[current], size);
+            current ^= 1;
+        }
+
+        // Never leaves a request pending on the buffer.
+        finishRead();
+
+        if (file2 != nullptr)
+            boot_services->closeEvent(token.event);
+
+        if (status == Status::Success && !decoder.isFinished())
+            return Status::InvalidParameter;
+
+        return status;
+    }
+} // namespace Uefi
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "boot_services.h"
+#include "strided_span.h"
 #include <cstddef>
 #include <cstdint>
 
@@ -33,6 +34,19 @@ namespace Uefi {
         const BootServices::MemoryDescriptor& operator[](size_t i) const noexcept {
             return *reinterpret_cast<const BootServices::MemoryDescriptor*>(reinterpret_cast<const uint8_t*>(descriptors) + (i * entry_size));
         }
+
+        /// The descriptors, stepping over the extra information at the end of each one.
+        [[nodiscard]] StridedSpan<const BootServices::MemoryDescriptor> getDescriptors() const noexcept {
+            return {descriptors, getNumberOfEntries(), entry_size};
+        }
+
+        StridedSpan<const BootServices::MemoryDescriptor>::Iterator begin() const noexcept {
+            return getDescriptors().begin();
+        }
+
+        StridedSpan<const BootServices::MemoryDescriptor>::Iterator end() const noexcept {
+            return getDescriptors().end();
+        }
     };
 
     /// This function will retrieve the memory map. It determines how much memory is needed,
@@ -0,0 +1,431 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "boot_services.h"
+#include "detail/branch_hints.h"
+#include "memory_map.h"
+#include "mp_services_protocol.h"
+#include "span.h"
+#include "status.h"
+
+namespace Uefi {
+    /// What MemoryScrubber writes to each 64-bit word.
+    enum class ScrubPattern {
+        Zero,
+        /// Alternating bits, 0xAAAA...: neighbouring data lines are driven to opposite values.
+        Checkerboard,
+        /// Word n of each 512-byte block has only bit n set, so that each data line is set alone.
+        WalkingOnes,
+        /// Each word holds its own address. A stuck or shorted address line makes words alias, and the alias holds
+        /// the address of the other word.
+        AddressInAddress
+    };
+
+    /// Words which did not read back as they were written, next to each other.
+    struct BadMemoryRange {
+        uint64_t address;
+        uint64_t size;
+        /// The bits which were wrong in any of the words.
+        uint64_t failed_bits;
+    };
+
+    namespace Detail {
+        /// Two words, with the vector extensions of GCC and Clang: SSE2 or NEON registers where there are some.
+        using ScrubVector = uint64_t __attribute__((vector_size(16)));
+
+        /// The 64 bytes of the line at `address`, which is 64-byte aligned.
+        template <ScrubPattern pattern>
+        inline void makeScrubLine(uint64_t address, ScrubVector (&line)[4]) noexcept {
+            if constexpr (pattern == ScrubPattern::Zero) {
+                line[0] = line[1] = line[2] = line[3] = ScrubVector{0, 0};
+            } else if constexpr (pattern == ScrubPattern::Checkerboard) {
+                line[0] = line[1] = line[2] = line[3] = ScrubVector{0xAAAAAAAAAAAAAAAA, 0xAAAAAAAAAAAAAAAA};
+            } else if constexpr (pattern == ScrubPattern::WalkingOnes) {
+                // A line holds words 8k to 8k + 7 of its block, so the shifts never wrap.
+                const auto first = uint64_t{1} << ((address >> 3) & 63);
+                line[0] = ScrubVector{first, first << 1};
+                line[1] = line[0] << 2;
+                line[2] = line[0] << 4;
+                line[3] = line[0] << 6;
+            } else {
+                line[0] = ScrubVector{address, address + 8};
+                line[1] = line[0] + 16;
+                line[2] = line[0] + 32;
+                line[3] = line[0] + 48;
+            }
+        }
+
+        /// Stores around the caches on x86, where memory being scrubbed would only evict what is worth keeping.
+        inline void storeScrubVector(uint64_t address, ScrubVector value) noexcept {
+#if defined(__SSE2__)
+            const auto vector = _mm_set_epi64x(static_cast<int64_t>(value[1]), static_cast<int64_t>(value[0]));
+            _mm_stream_si128(reinterpret_cast<__m128i*>(static_cast<uintptr_t>(address)), vector);
+#else
+            *reinterpret_cast<volatile ScrubVector*>(static_cast<uintptr_t>(address)) = value;
+#endif
+        }
+
+        /// Orders the streaming stores before what follows, like the end of a chunk.
+        inline void fenceScrubStores() noexcept {
+#if defined(__SSE2__)
+            _mm_sfence();
+#endif
+        }
+
+        template <ScrubPattern pattern>
+        inline void fillScrubLines(uint64_t address, uint64_t size) noexcept {
+            for (const auto end = address + size; address != end; address += 64) {
+                ScrubVector line[4];
+                makeScrubLine<pattern>(address, line);
+
+                for (size_t i = 0; i < 4; ++i)
+                    storeScrubVector(address + (i * 16), line[i]);
+            }
+        }
+
+        /// Reads lines back, and passes each wrong word to `report(address, failed_bits)`.
+        template <ScrubPattern pattern, typename Report>
+        inline void verifyScrubLines(uint64_t address, uint64_t size, Report& report) noexcept {
+            for (const auto end = address + size; address != end; address += 64) {
+                ScrubVector line[4];
+                makeScrubLine<pattern>(address, line);
+
+                // Volatile, so that nothing the compiler knows about the memory stands in for reading it.
+                const auto* memory = reinterpret_cast<const volatile ScrubVector*>(static_cast<uintptr_t>(address));
+
+                // Written out, so that the vectors stay in registers.
+                const ScrubVector failed[4] = {memory[0] ^ line[0], memory[1] ^ line[1], memory[2] ^ line[2], memory[3] ^ line[3]};
+
+                const auto any = failed[0] | failed[1] | failed[2] | failed[3];
+                if (UEFI_LIKELY((any[0] | any[1]) == 0))
+                    continue;
+
+                for (size_t i = 0; i < 8; ++i) {
+                    const auto bits = failed[i / 2][i % 2];
+                    if (bits != 0)
+                        report(address + (i * 8), bits);
+                }
+            }
+        }
+    } // namespace Detail
+
+    /// Fills the free memory with a pattern, and reads it back to find bad memory, with every processor.
+    /// The ConventionalMemory ranges of the memory map are claimed with allocatePages(), so that the firmware does
+    /// not hand them out while they are being written, and split into chunks that the bootstrap processor and the
+    /// APs take in turn: no processor is given a range of its own, so none waits for a slower one to finish.
+    /// Lines are written with non-temporal stores on x86, so that the caches keep what the firmware uses.
+    /// @code
+    /// MemoryScrubber scrubber;
+    /// scrubber.initialize(boot_services, getMemoryMap(boot_services));
+    /// auto mp = boot_services.locateProtocol<MpServicesProtocol>();
+    /// scrubber.fill(boot_services, ScrubPattern::AddressInAddress, mp ? *mp : nullptr);
+    /// if (scrubber.verify(boot_services, ScrubPattern::AddressInAddress, mp ? *mp : nullptr) == Status::DeviceError)
+    ///     report(scrubber.getBadRanges());
+    /// scrubber.fill(boot_services, ScrubPattern::Zero, mp ? *mp : nullptr);
+    /// scrubber.release(boot_services);
+    /// @endcode
+    class MemoryScrubber {
+    public:
+        /// The work a processor takes at a time.
+        static constexpr uint64_t chunk_size = 0x4000000;
+        static constexpr size_t max_range_count = 256;
+        static constexpr size_t max_bad_range_count = 64;
+
+        /// Claims the ConventionalMemory ranges of `map`, but for `reserve_size` bytes at the top of the largest one,
+        /// left to the firmware's own allocations. Ranges which cannot be claimed, since the map is stale, are skipped.
+        /// @return OutOfResources There are more than max_range_count ranges. Only the first ones are claimed.
+        Status initialize(BootServices& boot_services, const MemoryMap& map, uint64_t reserve_size = 0x1000000) noexcept {
+            _rangeCount = 0;
+            _chunkCount = 0;
+            _totalSize = 0;
+            _badRangeCount = 0;
+            _lostBadRangeCount = 0;
+
+            const BootServices::MemoryDescriptor* largest = nullptr;
+            for (const auto& descriptor : map) {
+                if (descriptor.type == MemoryType::ConventionalMemory && (largest == nullptr || descriptor.pages_count > largest->pages_count))
+                    largest = &descriptor;
+            }
+
+            auto status = Status::Success;
+
+            for (const auto& descriptor : map) {
+                if (descriptor.type != MemoryType::ConventionalMemory)
+                    continue;
+
+                auto size = descriptor.pages_count * page_size;
+                if (&descriptor == largest)
+                    size = size > reserve_size ? (size - reserve_size) & ~(page_size - 1) : 0;
+
+                if (size == 0)
+                    continue;
+
+                if (_rangeCount == max_range_count) {
+                    status = Status::OutOfResources;
+                    break;
+                }
+
+                auto base = descriptor.physical_start;
+                if (boot_services.allocatePages(BootServices::AllocateType::Address, MemoryType::LoaderData, size / page_size, base) != Status::Success)
+                    continue;
+
+                _ranges[_rangeCount++] = {base, size, _chunkCount};
+                _chunkCount += (size + chunk_size - 1) / chunk_size;
+                _totalSize += size;
+            }
+
+            return status;
+        }
+
+        /// Gives the claimed memory back to the firmware, as it was last written.
+        void release(BootServices& boot_services) noexcept {
+            for (size_t i = 0; i < _rangeCount; ++i)
+                static_cast<void>(boot_services.freePages(_ranges[i].base, _ranges[i].size / page_size));
+
+            _rangeCount = 0;
+            _chunkCount = 0;
+            _totalSize = 0;
+        }
+
+        /// Writes `pattern` to the claimed memory.
+        /// @param mp_services Runs on the APs as well, if given.
+        Status fill(BootServices& boot_services, ScrubPattern pattern, MpServicesProtocol* mp_services = nullptr) noexcept {
+            _pattern = pattern;
+            _verify = false;
+            _run(boot_services, mp_services);
+            return Status::Success;
+        }
+
+        /// Reads the claimed memory back, expecting what fill() wrote with `pattern`, and adds the words that differ to
+        /// the bad ranges.
+        /// @return DeviceError Some words differ.
+        Status verify(BootServices& boot_services, ScrubPattern pattern, MpServicesProtocol* mp_services = nullptr) noexcept {
+            const auto previous_count = _badRangeCount;
+
+            _pattern = pattern;
+            _verify = true;
+            _run(boot_services, mp_services);
+
+            // Counted before merging, since a word found again, by another pattern, merges into its known range.
+            const bool found = _badRangeCount != previous_count;
+
+            // Chunks report their ranges in any order, and a range crossing a chunk boundary comes in two parts.
+            if (_badRangeCount > max_bad_range_count) {
+                _lostBadRangeCount += _badRangeCount - max_bad_range_count;
+                _badRangeCount = max_bad_range_count;
+            }
+
+            _mergeBadRanges();
+            return found ? Status::DeviceError : Status::Success;
+        }
+
+        /// The bad ranges found by every verify() since initialize(), sorted by address.
+        [[nodiscard]] Span<const BadMemoryRange> getBadRanges() const noexcept {
+            return {_badRanges, _badRangeCount};
+        }
+
+        /// Bad ranges which did not fit in max_bad_range_count.
+        [[nodiscard]] uint64_t getLostBadRangeCount() const noexcept {
+            return _lostBadRangeCount;
+        }
+
+        /// The claimed memory, in bytes.
+        [[nodiscard]] uint64_t getTotalSize() const noexcept {
+            return _totalSize;
+        }
+
+    private:
+        static constexpr uint64_t page_size = 0x1000;
+
+        struct Range {
+            uint64_t base;
+            uint64_t size;
+            uint64_t first_chunk;
+        };
+
+        /// Gathers the wrong words of a chunk into ranges.
+        struct BadRangeCollector {
+            MemoryScrubber& scrubber;
+            BadMemoryRange range;
+
+            void operator()(uint64_t address, uint64_t failed_bits) noexcept {
+                if (range.size != 0 && range.address + range.size == address) {
+                    range.size += 8;
+                    range.failed_bits |= failed_bits;
+                    return;
+                }
+
+                flush();
+                range = {address, 8, failed_bits};
+            }
+
+            void flush() noexcept {
+                if (range.size != 0)
+                    scrubber._addBadRange(range);
+            }
+        };
+
+        static void _runOnAp(void* scrubber) {
+            static_cast<MemoryScrubber*>(scrubber)->_work();
+        }
+
+        void _run(BootServices& boot_services, MpServicesProtocol* mp_services) noexcept {
+            _nextChunk = 0;
+
+            Event done = nullptr;
+            if (mp_services != nullptr) {
+                const auto event = boot_services.createEvent(EventType::None, Tpl::Callback);
+                if (event) {
+                    const auto status = mp_services->startupAllAps(&_runOnAp, false, *event, 0, this);
+                    if (status == Status::Success)
+                        done = *event;
+                    else
+                        static_cast<void>(boot_services.closeEvent(*event));
+
+                    // Without a wait event, the APs take all the chunks while this processor waits.
+                    if (status == Status::Unsupported)
+                        static_cast<void>(mp_services->startupAllAps(&_runOnAp, false, nullptr, 0, this));
+                }
+            }
+
+            _work();
+
+            if (done != nullptr) {
+                size_t index;
+                static_cast<void>(boot_services.waitForEvent(1, &done, index));
+                static_cast<void>(boot_services.closeEvent(done));
+            }
+        }
+
+        /// Takes chunks until there are none left. Runs on every processor at once, without calling the firmware.
+        void _work() noexcept {
+            for (;;) {
+                const auto chunk = __atomic_fetch_add(&_nextChunk, 1, __ATOMIC_RELAXED);
+                if (chunk >= _chunkCount)
+                    break;
+
+                // The last range starting at or before the chunk.
+                size_t low = 0;
+                size_t high = _rangeCount;
+                while (high - low > 1) {
+                    const auto middle = (low + high) / 2;
+                    if (_ranges[middle].first_chunk <= chunk)
+                        low = middle;
+                    else
+                        high = middle;
+                }
+
+                const auto& range = _ranges[low];
+                const auto address = range.base + ((chunk - range.first_chunk) * chunk_size);
+                const auto end = range.base + range.size;
+                const auto size = end - address < chunk_size ? end - address : chunk_size;
+
+                if (_verify)
+                    _verifyChunk(address, size);
+                else
+                    _fillChunk(address, size);
+            }
+
+            Detail::fenceScrubStores();
+        }
+
+        void _fillChunk(uint64_t address, uint64_t size) noexcept {
+            switch (_pattern) {
+            case ScrubPattern::Zero:
+                Detail::fillScrubLines<ScrubPattern::Zero>(address, size);
+                break;
+
+            case ScrubPattern::Checkerboard:
+                Detail::fillScrubLines<ScrubPattern::Checkerboard>(address, size);
+                break;
+
+            case ScrubPattern::WalkingOnes:
+                Detail::fillScrubLines<ScrubPattern::WalkingOnes>(address, size);
+                break;
+
+            case ScrubPattern::AddressInAddress:
+                Detail::fillScrubLines<ScrubPattern::AddressInAddress>(address, size);
+                break;
+            }
+        }
+
+        void _verifyChunk(uint64_t address, uint64_t size) noexcept {
+            BadRangeCollector collector{*this, {0, 0, 0}};
+
+            switch (_pattern) {
+            case ScrubPattern::Zero:
+                Detail::verifyScrubLines<ScrubPattern::Zero>(address, size, collector);
+                break;
+
+            case ScrubPattern::Checkerboard:
+                Detail::verifyScrubLines<ScrubPattern::Checkerboard>(address, size, collector);
+                break;
+
+            case ScrubPattern::WalkingOnes:
+                Detail::verifyScrubLines<ScrubPattern::WalkingOnes>(address, size, collector);
+                break;
+
+            case ScrubPattern::AddressInAddress:
+                Detail::verifyScrubLines<ScrubPattern::AddressInAddress>(address, size, collector);
+                break;
+            }
+
+            collector.flush();
+        }
+
+        /// Called by every processor: the slot is taken atomically, and the ranges past the array only counted.
+        void _addBadRange(const BadMemoryRange& range) noexcept {
+            const auto index = __atomic_fetch_add(&_badRangeCount, 1, __ATOMIC_RELAXED);
+            if (index < max_bad_range_count)
+                _badRanges[index] = range;
+        }
+
+        /// Sorts the bad ranges by address, and joins those which touch.
+        void _mergeBadRanges() noexcept {
+            for (size_t i = 1; i < _badRangeCount; ++i) {
+                const auto range = _badRanges[i];
+                auto j = i;
+                for (; j > 0 && _badRanges[j - 1].address > range.address; --j)
+                    _badRanges[j] = _badRanges[j - 1];
+
+                _badRanges[j] = range;
+            }
+
+            size_t count = 0;
+            for (size_t i = 0; i < _badRangeCount; ++i) {
+                const auto& range = _badRanges[i];
+                if (count != 0 && _badRanges[count - 1].address + _badRanges[count - 1].size >= range.address) {
+                    auto& last = _badRanges[count - 1];
+                    const auto end = range.address + range.size;
+                    if (end > last.address + last.size)
+                        last.size = end - last.address;
+
+                    last.failed_bits |= range.failed_bits;
+                } else {
+                    _badRanges[count++] = range;
+                }
+            }
+
+            _badRangeCount = count;
+        }
+
+        Range _ranges[max_range_count];
+        size_t _rangeCount;
+        uint64_t _chunkCount;
+        uint64_t _totalSize;
+
+        ScrubPattern _pattern;
+        bool _verify;
+        uint64_t _nextChunk;
+
+        BadMemoryRange _badRanges[max_bad_range_count];
+        size_t _badRangeCount;
+        uint64_t _lostBadRangeCount;
+    };
+} // namespace Uefi
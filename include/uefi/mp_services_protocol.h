@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "event.h"
+#include "guid.h"
+#include "non_copyable.h"
+#include "status.h"
+
+namespace Uefi {
+    /// Runs code on the application processors (APs). Only the bootstrap processor (BSP) may call it.
+    /// The procedures run on the APs may not call boot services: they can only touch memory and the hardware.
+    class MpServicesProtocol : private NonCopyable {
+    public:
+        static constexpr Guid guid = {0x3fdda605, 0xa76e, 0x4f46, {0xad, 0x29, 0x12, 0xf4, 0x53, 0x1b, 0x3d, 0x08}};
+
+        using ApProcedure = void (*)(void* argument);
+
+        /// @param[out] processor_count All the processors, the BSP included.
+        /// @param[out] enabled_count Those which can run procedures.
+        Status getNumberOfProcessors(size_t& processor_count, size_t& enabled_count) {
+            return _getNumberOfProcessors(this, &processor_count, &enabled_count);
+        }
+
+        /// Runs `procedure` on every enabled AP.
+        /// @param single_thread Runs them one after the other instead of all at once.
+        /// @param wait_event Returns at once, and signals the event once every AP is done. Without one, returns once
+        /// every AP is done.
+        /// @param timeout_microseconds How long the APs may take, 0 for no limit.
+        /// @param[out] failed_processors If not nullptr, receives a pool buffer of the processor numbers which did not
+        /// finish, ended by END_OF_CPU_LIST, or nullptr.
+        /// @return NotStarted There are no enabled APs.
+        /// @return NotReady The APs are still busy with another procedure.
+        /// @return Unsupported A wait event was given, and the firmware only runs procedures in blocking mode.
+        /// @return Timeout Some APs did not finish in time.
+        Status startupAllAps(ApProcedure procedure, bool single_thread, Event wait_event, size_t timeout_microseconds,
+                             void* argument, size_t** failed_processors = nullptr) {
+            return _startupAllAps(this, procedure, single_thread, wait_event, timeout_microseconds, argument, failed_processors);
+        }
+
+        /// Runs `procedure` on a single AP.
+        /// @param[out] finished With a wait event, whether the AP finished before the timeout.
+        Status startupThisAp(ApProcedure procedure, size_t processor_number, Event wait_event, size_t timeout_microseconds,
+                             void* argument, bool* finished = nullptr) {
+            return _startupThisAp(this, procedure, processor_number, wait_event, timeout_microseconds, argument, finished);
+        }
+
+        /// The number of the calling processor, from 0 to processor_count - 1.
+        Status whoAmI(size_t& processor_number) {
+            return _whoAmI(this, &processor_number);
+        }
+
+    private:
+        Status (*_getNumberOfProcessors)(MpServicesProtocol*, size_t*, size_t*);
+
+        [[maybe_unused]] void* _buf1[1];
+
+        Status (*_startupAllAps)(MpServicesProtocol*, ApProcedure, bool, Event, size_t, void*, size_t**);
+        Status (*_startupThisAp)(MpServicesProtocol*, ApProcedure, size_t, Event, size_t, void*, bool*);
+
+        [[maybe_unused]] void* _buf2[2];
+
+        Status (*_whoAmI)(MpServicesProtocol*, size_t*);
+    };
+} // namespace Uefi
@@ -3,6 +3,11 @@
 namespace Uefi {
     /// Classes that inherit from this will not be copyable.
     class NonCopyable {
+    protected:
+        /// Trivial, so that derived classes can still be placed in zero-initialized static storage.
+        NonCopyable() = default;
+
+    private:
         NonCopyable(NonCopyable&) = delete;
         NonCopyable& operator=(NonCopyable&) = delete;
     };
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "boot_services.h"
+#include "detail/branch_hints.h"
+#include "memory_type.h"
+
+namespace Uefi {
+    /// A bump allocator over chunks of pages from allocatePages(): allocating is an addition and a comparison, and
+    /// everything is freed at once by release().
+    /// It is the allocator of Vector and FlatMap. Any class with the same allocate() and deallocate() can replace it.
+    /// @code
+    /// PageArena arena;
+    /// arena.initialize(boot_services);
+    /// FlatMap<uint64_t, Handle, PageArena> map;
+    /// map.initialize(arena);
+    /// ...
+    /// arena.release();
+    /// @endcode
+    class PageArena {
+    public:
+        static constexpr size_t page_size = 0x1000;
+
+        /// @param chunk_pages Pages requested from the firmware at a time. Bigger allocations get their own chunk.
+        void initialize(BootServices& boot_services, MemoryType memory_type = MemoryType::LoaderData, size_t chunk_pages = 16) noexcept {
+            _bootServices = &boot_services;
+            _memoryType = memory_type;
+            _chunkPages = chunk_pages;
+            _chunks = nullptr;
+            _position = 0;
+            _end = 0;
+        }
+
+        /// @param alignment A power of two, at most page_size.
+        /// @return nullptr The firmware is out of memory.
+        [[nodiscard]] void* allocate(size_t size, size_t alignment = alignof(max_align_t)) noexcept {
+            auto address = (_position + alignment - 1) & ~(alignment - 1);
+
+            if (UEFI_UNLIKELY(address + size > _end || _end == 0)) {
+                // The chunk is page aligned, so aligning the start after its header takes at most alignment - 1 bytes.
+                const auto padded_size = size + sizeof(Chunk) + alignment - 1;
+                const bool dedicated = padded_size > (_chunkPages * page_size) / 2;
+
+                auto* chunk = _allocateChunk(dedicated ? (padded_size + page_size - 1) / page_size : _chunkPages);
+                if (chunk == nullptr)
+                    return nullptr;
+
+                const auto start = reinterpret_cast<uintptr_t>(chunk + 1);
+                const auto chunk_end = reinterpret_cast<uintptr_t>(chunk) + (chunk->page_count * page_size);
+                address = (start + alignment - 1) & ~(alignment - 1);
+
+                if (UEFI_UNLIKELY(address + size > chunk_end))
+                    return nullptr;
+
+                // A big allocation takes a chunk of its own, so that the space left in the current one is not lost.
+                if (dedicated && _end != 0)
+                    return reinterpret_cast<void*>(address);
+
+                _end = chunk_end;
+            }
+
+            _position = address + size;
+            return reinterpret_cast<void*>(address);
+        }
+
+        /// Only gives the memory back if it was the latest allocation, like a temporary buffer freed right away.
+        /// A growing Vector allocates its new items before freeing the old ones, so those stay until release():
+        /// reserve() the final size when it is known. Everything else is freed by release().
+        void deallocate(void* memory, size_t size) noexcept {
+            if (reinterpret_cast<uintptr_t>(memory) + size == _position)
+                _position = reinterpret_cast<uintptr_t>(memory);
+        }
+
+        /// Gives every chunk back to the firmware.
+        void release() noexcept {
+            while (_chunks != nullptr) {
+                auto* chunk = _chunks;
+                _chunks = chunk->next;
+                static_cast<void>(_bootServices->freePages(reinterpret_cast<uintptr_t>(chunk), chunk->page_count));
+            }
+
+            _position = 0;
+            _end = 0;
+        }
+
+    private:
+        /// At the start of each chunk.
+        struct Chunk {
+            Chunk* next;
+            size_t page_count;
+        };
+
+        Chunk* _allocateChunk(size_t page_count) noexcept {
+            const auto memory = _bootServices->allocatePages(_memoryType, page_count);
+            if (!memory)
+                return nullptr;
+
+            auto* chunk = reinterpret_cast<Chunk*>(static_cast<uintptr_t>(*memory));
+            chunk->next = _chunks;
+            chunk->page_count = page_count;
+            _chunks = chunk;
+            return chunk;
+        }
+
+        BootServices* _bootServices;
+        MemoryType _memoryType;
+        size_t _chunkPages;
+
+        /// Every chunk, the latest first.
+        Chunk* _chunks;
+
+        /// The free space of the current chunk.
+        uintptr_t _position;
+        uintptr_t _end;
+    };
+} // namespace Uefi
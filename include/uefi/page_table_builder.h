@@ -0,0 +1,382 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "boot_services.h"
+#include "detail/bit_flags.h"
+#include "detail/memory.h"
+#include "memory_attribute.h"
+#include "memory_map.h"
+#include "memory_type.h"
+#include "status.h"
+
+namespace Uefi {
+    /// Permissions of the pages mapped by PageTableBuilder. Mapped pages are always present.
+    enum class PageFlags : uint64_t {
+        None = 0,
+        Writable = 0x2,
+        /// Accessible from ring 3.
+        User = 0x4,
+        /// Kept in the TLB across CR3 changes, if CR4.PGE is set.
+        Global = 0x100,
+        /// Requires EFER.NXE.
+        NoExecute = 0x8000000000000000
+    };
+
+    UEFI_BIT_FLAGS(PageFlags);
+
+    struct PageTableOptions {
+        /// Builds 5-level tables, for a CPU running with CR4.LA57 set. Otherwise, 4-level tables.
+        bool five_level = false;
+        /// Allows 1 GiB pages. Only set it if the CPU supports them: see Detail::hasGigabytePages().
+        bool gigabyte_pages = true;
+    };
+
+    /// Builds x86-64 page tables, using the largest pages that the alignment of each mapping allows.
+    /// The tables go into a single run of pages provided by the caller. Their size is bounded by getMaxPageCount():
+    /// @code
+    /// const auto pages = 1 + PageTableBuilder::getMaxPageCount(map, 0, options) +
+    ///                    PageTableBuilder::getMaxPageCount(map, higher_half, options);
+    /// boot_services.allocatePages(BootServices::AllocateType::AnyPages, MemoryType::LoaderData, pages, memory);
+    /// builder.initialize(memory, pages, options);
+    /// builder.mapMemoryMap(map, 0);
+    /// builder.mapMemoryMap(map, higher_half);
+    /// // Switch the PAT to PageTableBuilder::pat_value, then load builder.getRoot() into CR3.
+    /// @endcode
+    /// The pages after getUsedPageCount() can be freed once everything is mapped.
+    /// The tables are written through their physical addresses, so this must run while memory is identity mapped,
+    /// which is the case until exitBootServices() and the kernel's own tables take over.
+    class PageTableBuilder {
+    public:
+        /// The value for the IA32_PAT MSR that the cache bits of the entries assume: WB, WC, UC-, UC, WB, WP, UC-, WT.
+        /// With the power-on PAT (WB, WT, UC-, UC, WB, WT, UC-, UC), write combining and write-protected mappings
+        /// become write-through, and write-through ones uncacheable.
+        static constexpr uint64_t pat_value = 0x0407050600070106;
+
+        /// Size of the pages that can be mapped.
+        /// @{
+        static constexpr uint64_t small_page_size = 0x1000;
+        static constexpr uint64_t large_page_size = 0x200000;
+        static constexpr uint64_t huge_page_size = 0x40000000;
+        /// @}
+
+        /// Starts with an empty root table.
+        /// @param memory Identity mapped, 4 KiB aligned memory for the tables.
+        /// @param page_count The size of the memory, in pages: 1 for the root table, plus getMaxPageCount() for each
+        /// mapping.
+        /// @return OutOfResources There is no room for the root table.
+        Status initialize(BootServices::PhysicalAddress memory, size_t page_count, const PageTableOptions& options = {}) noexcept {
+            _memory = memory;
+            _pageCount = page_count;
+            _usedPageCount = 0;
+            _levels = options.five_level ? 5 : 4;
+            _largestLeafLevel = options.gigabyte_pages ? 3 : 2;
+            return _allocateTable(_root);
+        }
+
+        /// Maps `size` bytes of virtual memory starting at `virtual_address` to the physical memory at
+        /// `physical_address`. The addresses and size must be 4 KiB aligned, and the virtual addresses canonical.
+        /// Mapping over an existing mapping replaces it.
+        /// @param cache One of the cacheability attributes: WriteBack, WriteThrough, WriteCombining, Uncacheable or
+        /// WriteProtected.
+        /// @return InvalidParameter The range is not aligned, or not canonical.
+        /// @return OutOfResources There are not enough pages left for the tables.
+        Status map(uint64_t virtual_address, BootServices::PhysicalAddress physical_address, uint64_t size,
+                   MemoryAttribute cache, PageFlags flags = PageFlags::Writable) noexcept {
+            if (((virtual_address | physical_address | size) & (small_page_size - 1)) != 0)
+                return Status::InvalidParameter;
+
+            if (size == 0)
+                return Status::Success;
+
+            const auto last = virtual_address + (size - 1);
+            if (last < virtual_address || !_isCanonical(virtual_address) || !_isCanonical(last) ||
+                _sign(virtual_address) != _sign(last))
+                return Status::InvalidParameter;
+
+            const auto attributes = static_cast<uint64_t>(flags) | _getCacheBits(cache) | present;
+            return _mapRange(_root, _levels, virtual_address, physical_address, size, attributes);
+        }
+
+        /// Maps every region of the memory map at `virtual_offset` plus its physical address: 0 for an identity
+        /// mapping, or the base of a higher half. The cache policy of each region comes from selectCacheAttribute().
+        /// Adjacent regions with the same policy are mapped together, so they can share large pages.
+        Status mapMemoryMap(const MemoryMap& memory_map, uint64_t virtual_offset, PageFlags flags = PageFlags::Writable) noexcept {
+            Status status = Status::Success;
+
+            _forEachRange(memory_map, [&](BootServices::PhysicalAddress start, uint64_t size, MemoryAttribute cache) {
+                if (status == Status::Success)
+                    status = map(start + virtual_offset, start, size, cache, flags);
+            });
+
+            return status;
+        }
+
+        /// The largest number of table pages, besides the root table, that map() can need for a range.
+        /// Mappings which share tables need less than the sum of their bounds.
+        static size_t getMaxPageCount(uint64_t virtual_address, BootServices::PhysicalAddress physical_address, uint64_t size,
+                                      const PageTableOptions& options = {}) noexcept {
+            if (size == 0)
+                return 0;
+
+            const auto first = virtual_address;
+            const auto last = virtual_address + (size - 1);
+            const auto misalignment = virtual_address ^ physical_address;
+            const size_t levels = options.five_level ? 5 : 4;
+            size_t count = 0;
+
+            // A table at `level` covers 512 entries of the level above it. Tables are needed for the whole range at
+            // the levels which cannot hold leaves, but only at its unaligned ends for the others.
+            for (size_t level = 1; level < levels; ++level) {
+                const auto shift = _getShift(level + 1);
+                const auto spanned = static_cast<size_t>((last >> shift) - (first >> shift) + 1);
+                const bool leaves_above = level == 1 || (level == 2 && options.gigabyte_pages);
+
+                if (leaves_above && (misalignment & ((uint64_t{1} << shift) - 1)) == 0)
+                    count += spanned < 2 ? spanned : 2;
+                else
+                    count += spanned;
+            }
+
+            return count;
+        }
+
+        /// The largest number of table pages, besides the root table, that mapMemoryMap() can need.
+        static size_t getMaxPageCount(const MemoryMap& memory_map, uint64_t virtual_offset, const PageTableOptions& options = {}) noexcept {
+            size_t count = 0;
+
+            _forEachRange(memory_map, [&](BootServices::PhysicalAddress start, uint64_t size, MemoryAttribute) {
+                count += getMaxPageCount(start + virtual_offset, start, size, options);
+            });
+
+            return count;
+        }
+
+        /// Picks the cache policy for a region of the memory map: uncached for memory-mapped I/O, otherwise the
+        /// fastest policy the region supports.
+        static MemoryAttribute selectCacheAttribute(const BootServices::MemoryDescriptor& descriptor) noexcept {
+            const auto supports = [&](MemoryAttribute attribute) {
+                return (descriptor.attribute & attribute) == attribute;
+            };
+
+            const bool is_io = descriptor.type == MemoryType::MemoryMappedIO ||
+                               descriptor.type == MemoryType::MemoryMappedIOPortSpace;
+
+            if (!is_io) {
+                if (supports(MemoryAttribute::WriteBack))
+                    return MemoryAttribute::WriteBack;
+
+                if (supports(MemoryAttribute::WriteThrough))
+                    return MemoryAttribute::WriteThrough;
+
+                if (supports(MemoryAttribute::WriteCombining))
+                    return MemoryAttribute::WriteCombining;
+            }
+
+            return MemoryAttribute::Uncacheable;
+        }
+
+        /// Walks the tables like the CPU would.
+        /// @return false The address is not mapped.
+        [[nodiscard]] bool translate(uint64_t virtual_address, BootServices::PhysicalAddress& physical_address) const noexcept {
+            const auto* table = _getTable(_root);
+
+            for (auto level = _levels;; --level) {
+                const auto shift = _getShift(level);
+                const auto entry = table[(virtual_address >> shift) & 511];
+
+                if ((entry & present) == 0)
+                    return false;
+
+                if (level == 1 || (entry & huge) != 0) {
+                    const auto page_mask = (uint64_t{1} << shift) - 1;
+                    physical_address = (entry & _getAddressMask(level, entry)) | (virtual_address & page_mask);
+                    return true;
+                }
+
+                table = _getTable(entry & address_mask);
+            }
+        }
+
+        /// The value to load into CR3.
+        [[nodiscard]] BootServices::PhysicalAddress getRoot() const noexcept {
+            return _root;
+        }
+
+        /// How many pages of the memory given to initialize() hold tables. They are the first ones.
+        [[nodiscard]] size_t getUsedPageCount() const noexcept {
+            return _usedPageCount;
+        }
+
+    private:
+        static constexpr uint64_t present = 0x1;
+        static constexpr uint64_t write_through = 0x8;
+        static constexpr uint64_t cache_disable = 0x10;
+        /// The entry maps a 2 MiB or 1 GiB page instead of pointing to a table.
+        static constexpr uint64_t huge = 0x80;
+        /// The PAT bit of 4 KiB entries. In huge entries it is bit 12, since bit 7 is taken.
+        static constexpr uint64_t small_pat = 0x80;
+        static constexpr uint64_t huge_pat = 0x1000;
+        static constexpr uint64_t address_mask = 0x000FFFFFFFFFF000;
+        /// Entries pointing to tables are as permissive as possible: the leaves decide.
+        static constexpr uint64_t table_attributes = present | static_cast<uint64_t>(PageFlags::Writable | PageFlags::User);
+
+        /// Builds the cache bits of a 4 KiB entry, as an index into the PAT described by pat_value.
+        static uint64_t _getCacheBits(MemoryAttribute cache) noexcept {
+            switch (cache) {
+            case MemoryAttribute::WriteCombining:
+                return write_through;
+            case MemoryAttribute::Uncacheable:
+            case MemoryAttribute::UncacheableExported:
+                return cache_disable | write_through;
+            case MemoryAttribute::WriteProtected:
+                return small_pat | write_through;
+            case MemoryAttribute::WriteThrough:
+                return small_pat | cache_disable | write_through;
+            default:
+                return 0;
+            }
+        }
+
+        /// Moves the PAT bit of a 4 KiB entry to where huge entries have it.
+        static uint64_t _toHugeAttributes(uint64_t attributes) noexcept {
+            return (attributes & small_pat) != 0 ? (attributes & ~small_pat) | huge_pat | huge : attributes | huge;
+        }
+
+        static uint64_t _toSmallAttributes(uint64_t attributes) noexcept {
+            attributes &= ~huge;
+            return (attributes & huge_pat) != 0 ? (attributes & ~huge_pat) | small_pat : attributes;
+        }
+
+        static uint64_t _getAddressMask(size_t level, uint64_t entry) noexcept {
+            // The PAT bit of huge entries sits in the low bits of their address.
+            return level == 1 || (entry & huge) == 0 ? address_mask : address_mask & ~huge_pat;
+        }
+
+        /// The number of address bits below the entries of a table at `level`: 12 for page tables, 21 for page
+        /// directories...
+        static constexpr unsigned _getShift(size_t level) noexcept {
+            return static_cast<unsigned>(12 + (9 * (level - 1)));
+        }
+
+        [[nodiscard]] bool _isCanonical(uint64_t address) const noexcept {
+            const auto shift = 64 - (_getShift(_levels) + 9);
+            return static_cast<uint64_t>(static_cast<int64_t>(address << shift) >> shift) == address;
+        }
+
+        static bool _sign(uint64_t address) noexcept {
+            return (address >> 63) != 0;
+        }
+
+        static uint64_t* _getTable(BootServices::PhysicalAddress address) noexcept {
+            return reinterpret_cast<uint64_t*>(static_cast<uintptr_t>(address));
+        }
+
+        Status _allocateTable(BootServices::PhysicalAddress& table) noexcept {
+            if (_usedPageCount == _pageCount)
+                return Status::OutOfResources;
+
+            table = _memory + (_usedPageCount * small_page_size);
+            ++_usedPageCount;
+            Detail::setBytes(_getTable(table), 0, small_page_size);
+            return Status::Success;
+        }
+
+        /// Maps the part of a range covered by one table.
+        Status _mapRange(BootServices::PhysicalAddress table_address, size_t level, uint64_t virtual_address,
+                         BootServices::PhysicalAddress physical_address, uint64_t size, uint64_t attributes) noexcept {
+            auto* table = _getTable(table_address);
+            const auto shift = _getShift(level);
+            const auto entry_size = uint64_t{1} << shift;
+
+            while (size != 0) {
+                auto& entry = table[(virtual_address >> shift) & 511];
+                const auto offset = virtual_address & (entry_size - 1);
+                const auto chunk = size < entry_size - offset ? size : entry_size - offset;
+                const bool is_table = level > 1 && (entry & present) != 0 && (entry & huge) == 0;
+
+                if (level == 1) {
+                    entry = physical_address | attributes;
+                } else if (level <= _largestLeafLevel && chunk == entry_size && (physical_address & (entry_size - 1)) == 0 && !is_table) {
+                    entry = physical_address | _toHugeAttributes(attributes);
+                } else {
+                    BootServices::PhysicalAddress child;
+
+                    if (is_table) {
+                        child = entry & address_mask;
+                    } else {
+                        const auto status = _allocateTable(child);
+                        if (status != Status::Success)
+                            return status;
+
+                        if ((entry & present) != 0)
+                            _splitPage(child, level - 1, entry);
+
+                        entry = child | table_attributes;
+                    }
+
+                    const auto status = _mapRange(child, level - 1, virtual_address, physical_address, chunk, attributes);
+                    if (status != Status::Success)
+                        return status;
+                }
+
+                virtual_address += chunk;
+                physical_address += chunk;
+                size -= chunk;
+            }
+
+            return Status::Success;
+        }
+
+        /// Fills a new table with the mapping of the huge page it replaces, so that only part of it can be remapped.
+        static void _splitPage(BootServices::PhysicalAddress table_address, size_t level, uint64_t huge_entry) noexcept {
+            auto* table = _getTable(table_address);
+            const auto physical_address = huge_entry & address_mask & ~huge_pat;
+            const auto huge_attributes = huge_entry & ~physical_address;
+            const auto attributes = level == 1 ? _toSmallAttributes(huge_attributes) : huge_attributes;
+            const auto entry_size = uint64_t{1} << _getShift(level);
+
+            for (size_t i = 0; i < 512; ++i)
+                table[i] = (physical_address + (i * entry_size)) | attributes;
+        }
+
+        /// Calls `function(start, size, cache)` for each run of contiguous regions of the map with the same cache policy.
+        template <typename Function>
+        static void _forEachRange(const MemoryMap& map, Function function) {
+            BootServices::PhysicalAddress start = 0;
+            uint64_t size = 0;
+            auto cache = MemoryAttribute::WriteBack;
+
+            for (size_t i = 0; i < map.getNumberOfEntries(); ++i) {
+                const auto& descriptor = map[i];
+                if (descriptor.pages_count == 0)
+                    continue;
+
+                const auto descriptor_cache = selectCacheAttribute(descriptor);
+
+                if (size != 0 && descriptor.physical_start == start + size && descriptor_cache == cache) {
+                    size += descriptor.pages_count * small_page_size;
+                    continue;
+                }
+
+                if (size != 0)
+                    function(start, size, cache);
+
+                start = descriptor.physical_start;
+                size = descriptor.pages_count * small_page_size;
+                cache = descriptor_cache;
+            }
+
+            if (size != 0)
+                function(start, size, cache);
+        }
+
+        BootServices::PhysicalAddress _memory;
+        size_t _pageCount;
+        size_t _usedPageCount;
+        BootServices::PhysicalAddress _root;
+        size_t _levels;
+        size_t _largestLeafLevel;
+    };
+} // namespace Uefi
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+
+#include "detail/memory.h"
+#include "ucs2.h"
+
+namespace Uefi {
+    // Paths as the firmware file systems take them: components separated by backslashes, with "." and "..".
+    // Everything works in place on caller-provided buffers, so building a path never allocates.
+
+    constexpr bool isPathSeparator(char16_t character) noexcept {
+        return character == u'\\' || character == u'/';
+    }
+
+    /// Rewrites a path in place: forward slashes become backslashes, repeated and trailing separators are removed,
+    /// "." components are dropped and ".." components remove the one before them.
+    /// ".." never goes above the root of an absolute path, but stays at the start of a relative one.
+    /// @code
+    /// u"/EFI//Boot/./../BOOT/" becomes u"\\EFI\\BOOT"
+    /// @endcode
+    /// @return The new length. A relative path can become empty, meaning the current directory.
+    inline size_t normalizePath(char16_t* path) noexcept {
+        size_t read = 0;
+        size_t write = 0;
+
+        const bool is_absolute = isPathSeparator(path[0]);
+        if (is_absolute)
+            path[write++] = u'\\';
+
+        const size_t root = write;
+
+        for (;;) {
+            while (isPathSeparator(path[read]))
+                ++read;
+
+            if (path[read] == 0)
+                break;
+
+            auto end = read;
+            while (path[end] != 0 && !isPathSeparator(path[end]))
+                ++end;
+
+            const auto length = end - read;
+            const bool is_current = length == 1 && path[read] == u'.';
+            const bool is_parent = length == 2 && path[read] == u'.' && path[read + 1] == u'.';
+
+            if (is_parent) {
+                // The start of the last component written.
+                auto last = write;
+                while (last > root && path[last - 1] != u'\\')
+                    --last;
+
+                const bool last_is_parent = write - last == 2 && path[last] == u'.' && path[last + 1] == u'.';
+
+                if (write > root && !last_is_parent) {
+                    write = last > root ? last - 1 : root;
+                    read = end;
+                    continue;
+                }
+
+                if (is_absolute) {
+                    read = end;
+                    continue;
+                }
+            }
+
+            if (!is_current) {
+                // The output never gets ahead of the input, but the two can overlap.
+                if (write > root)
+                    path[write++] = u'\\';
+
+                Detail::moveBytes(path + write, path + read, length * sizeof(char16_t));
+                write += length;
+            }
+
+            read = end;
+        }
+
+        path[write] = 0;
+        return write;
+    }
+
+    /// Appends a component (or several) to a path, with a separator between them, then normalizes the result.
+    /// @param capacity The size of the buffer in characters, including the null terminator.
+    /// @return false The result does not fit, and the path is left unchanged.
+    inline bool joinPath(char16_t* path, size_t capacity, const char16_t* component) noexcept {
+        const auto length = getStringLength(path);
+        const auto component_length = getStringLength(component);
+        const bool needs_separator = length != 0 && !isPathSeparator(path[length - 1]);
+
+        if (length + needs_separator + component_length >= capacity)
+            return false;
+
+        if (needs_separator)
+            path[length] = u'\\';
+
+        Detail::copyBytes(path + length + needs_separator, component, (component_length + 1) * sizeof(char16_t));
+        normalizePath(path);
+        return true;
+    }
+
+    struct SplitPath {
+        /// The length of the directory part, without the separator before the file name, except for the root.
+        size_t directory_length;
+
+        /// The last component, which points into the path.
+        const char16_t* file_name;
+    };
+
+    /// Splits a normalized path before its last component:
+    /// u"\\EFI\\BOOT\\BOOTX64.EFI" gives u"\\EFI\\BOOT" and u"BOOTX64.EFI", u"\\EFI" gives u"\\" and u"EFI", and
+    /// u"EFI" gives an empty directory.
+    inline SplitPath splitPath(const char16_t* path) noexcept {
+        auto separator = getStringLength(path);
+        while (separator != 0 && !isPathSeparator(path[separator - 1]))
+            --separator;
+
+        if (separator == 0)
+            return {0, path};
+
+        return {separator == 1 ? 1 : separator - 1, path + separator};
+    }
+} // namespace Uefi
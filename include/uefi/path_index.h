@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "detail/memory.h"
+#include "directory.h"
+#include "file_protocol.h"
+#include "status.h"
+#include "ucs2.h"
+
+namespace Uefi {
+    /// A hash table from paths to the size and attributes of files, filled by walking a volume once.
+    /// Lookups are case-insensitive for ASCII letters, like FAT, and accept both slashes as separators.
+    /// @code
+    /// PathIndex index;
+    /// index.initialize(memory, memory_size);
+    /// index.build(*root);
+    /// if (const auto* entry = index.find(u"\\EFI\\BOOT\\BOOTX64.EFI"))
+    ///     use(entry->file_size);
+    /// @endcode
+    class PathIndex {
+    public:
+        struct Entry {
+            uint64_t file_size;
+            FileAttributes attributes;
+            /// Offset of the next entry of the same bucket, or none.
+            uint32_t next;
+            uint32_t hash;
+            /// The path follows the entry, null-terminated.
+            uint32_t path_length;
+
+            [[nodiscard]] const char16_t* getPath() const noexcept {
+                return reinterpret_cast<const char16_t*>(this + 1);
+            }
+
+            [[nodiscard]] bool isDirectory() const noexcept {
+                return (attributes & FileAttributes::Directory) == FileAttributes::Directory;
+            }
+        };
+
+        /// Ends the chain of entries of a bucket.
+        static constexpr uint32_t none = ~uint32_t{0};
+
+        /// Smallest memory that initialize() accepts: room for the buckets, though not for any entry.
+        static constexpr size_t min_size = 16 * sizeof(uint32_t);
+
+        /// Lays out the table in `memory`: a quarter goes to the buckets, the rest to the entries and their paths.
+        /// @param memory Aligned like Entry.
+        /// @return BufferTooSmall `size` is less than min_size. The index is left empty, and add() fails.
+        Status initialize(void* memory, size_t size) noexcept {
+            _used = 0;
+            _count = 0;
+
+            if (size < min_size) {
+                _emptyBucket = none;
+                _buckets = &_emptyBucket;
+                _bucketMask = 0;
+                _entries = nullptr;
+                _capacity = 0;
+                return Status::BufferTooSmall;
+            }
+
+            // A power of two number of buckets, so that the hash only has to be masked.
+            size_t bucket_count = min_size / sizeof(uint32_t);
+            while (bucket_count * 2 * sizeof(uint32_t) <= size / 4)
+                bucket_count *= 2;
+
+            _buckets = static_cast<uint32_t*>(memory);
+            _bucketMask = static_cast<uint32_t>(bucket_count - 1);
+            _entries = reinterpret_cast<uint8_t*>(_buckets + bucket_count);
+            _capacity = size - (bucket_count * sizeof(uint32_t));
+
+            for (size_t i = 0; i < bucket_count; ++i)
+                _buckets[i] = none;
+
+            return Status::Success;
+        }
+
+        /// Adds every entry under `root`, with paths relative to it.
+        /// @return OutOfResources The memory given to initialize() is full.
+        Status build(FileProtocol& root, size_t max_depth = 8) noexcept {
+            Status add_status = Status::Success;
+
+            const auto status = walkDirectory(
+                root,
+                [&](const char16_t* path, size_t, const FileInfo& info) {
+                    add_status = add(path, info.file_size, info.attributes);
+                    return add_status == Status::Success ? WalkAction::Continue : WalkAction::Stop;
+                },
+                max_depth);
+
+            return add_status != Status::Success ? add_status : status;
+        }
+
+        /// Adds a path. Adding the same path twice makes find() return the latest one.
+        /// @return OutOfResources The memory given to initialize() is full.
+        Status add(const char16_t* path, uint64_t file_size, FileAttributes attributes) noexcept {
+            const auto path_length = getStringLength(path);
+            const auto entry_size = _align(sizeof(Entry) + ((path_length + 1) * sizeof(char16_t)));
+
+            if (_capacity - _used < entry_size)
+                return Status::OutOfResources;
+
+            auto* entry = reinterpret_cast<Entry*>(_entries + _used);
+            entry->file_size = file_size;
+            entry->attributes = attributes;
+            entry->hash = _hash(path);
+            entry->path_length = static_cast<uint32_t>(path_length);
+            Detail::copyBytes(entry + 1, path, (path_length + 1) * sizeof(char16_t));
+
+            auto& bucket = _buckets[entry->hash & _bucketMask];
+            entry->next = bucket;
+            bucket = static_cast<uint32_t>(_used);
+
+            _used += entry_size;
+            ++_count;
+            return Status::Success;
+        }
+
+        /// @return nullptr The path is not in the index.
+        [[nodiscard]] const Entry* find(const char16_t* path) const noexcept {
+            const auto hash = _hash(path);
+
+            for (auto offset = _buckets[hash & _bucketMask]; offset != none;) {
+                const auto* entry = reinterpret_cast<const Entry*>(_entries + offset);
+                if (entry->hash == hash && _equals(entry->getPath(), path))
+                    return entry;
+
+                offset = entry->next;
+            }
+
+            return nullptr;
+        }
+
+        [[nodiscard]] size_t getEntryCount() const noexcept {
+            return _count;
+        }
+
+    private:
+        static size_t _align(size_t size) noexcept {
+            return (size + alignof(Entry) - 1) & ~(alignof(Entry) - 1);
+        }
+
+        static char16_t _fold(char16_t character) noexcept {
+            return character == u'/' ? u'\\' : Detail::toUpperAscii(character);
+        }
+
+        static const char16_t* _skipSeparators(const char16_t* path) noexcept {
+            while (*path == u'\\' || *path == u'/')
+                ++path;
+
+            return path;
+        }
+
+        /// FNV-1a over the folded path, without its leading separators.
+        static uint32_t _hash(const char16_t* path) noexcept {
+            uint32_t hash = 0x811c9dc5;
+
+            for (path = _skipSeparators(path); *path != 0; ++path)
+                hash = (hash ^ _fold(*path)) * 0x01000193;
+
+            return hash;
+        }
+
+        static bool _equals(const char16_t* a, const char16_t* b) noexcept {
+            a = _skipSeparators(a);
+            b = _skipSeparators(b);
+
+            for (; *a != 0 && *b != 0; ++a, ++b) {
+                if (_fold(*a) != _fold(*b))
+                    return false;
+            }
+
+            return *a == *b;
+        }
+
+        uint32_t* _buckets;
+        /// The only bucket when initialize() got too little memory.
+        uint32_t _emptyBucket;
+        uint32_t _bucketMask;
+        uint8_t* _entries;
+        size_t _capacity;
+        size_t _used;
+        size_t _count;
+    };
+} // namespace Uefi
@@ -0,0 +1,321 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "acpi.h"
+#include "boot_services.h"
+#include "detail/branch_hints.h"
+#include "detail/memory.h"
+#include "pci_io_protocol.h"
+#include "status.h"
+
+namespace Uefi {
+    /// A PCI function found by PciDeviceTable: the fields of its configuration header used to pick a driver.
+    struct PciDevice {
+        uint16_t segment;
+        uint8_t bus;
+        /// The device number in the upper 5 bits, the function in the lower 3.
+        uint8_t device_function;
+
+        uint16_t vendor_id;
+        uint16_t device_id;
+
+        // In the order of the third register of the header.
+        uint8_t revision_id;
+        uint8_t programming_interface;
+        uint8_t subclass;
+        uint8_t base_class;
+
+        /// 0 for a device, 1 for a PCI-to-PCI bridge, without the multi-function bit.
+        uint8_t header_type;
+        uint8_t reserved[3];
+
+        [[nodiscard]] uint8_t getDevice() const noexcept {
+            return device_function >> 3;
+        }
+
+        [[nodiscard]] uint8_t getFunction() const noexcept {
+            return device_function & 7;
+        }
+
+        /// The segment, bus, device and function, which orders the table.
+        [[nodiscard]] uint32_t getAddress() const noexcept {
+            return (uint32_t{segment} << 16) | (uint32_t{bus} << 8) | device_function;
+        }
+
+        /// The base class and the subclass, e.g. 0x0108 for an NVMe controller or 0x0200 for an Ethernet controller.
+        [[nodiscard]] uint16_t getClassCode() const noexcept {
+            return static_cast<uint16_t>((base_class << 8) | subclass);
+        }
+    };
+
+    static_assert(sizeof(PciDevice) == 16);
+
+    /// The first bus and the last bus behind a root bridge, from its ACPI resource descriptors.
+    /// @return false There is no bus range descriptor.
+    inline bool getPciBusRange(const void* resources, uint8_t& first, uint8_t& last) noexcept {
+        // QWORD address space descriptors (ACPI 6.5, section 6.4.3.5.1), up to the end tag. The firmware uses no other.
+        constexpr uint8_t qword_descriptor = 0x8A;
+        constexpr uint8_t bus_number_range = 2;
+
+        const auto* descriptor = static_cast<const uint8_t*>(resources);
+        if (descriptor == nullptr)
+            return false;
+
+        while (descriptor[0] == qword_descriptor) {
+            uint16_t length;
+            Detail::copyBytes(&length, descriptor + 1, sizeof(length));
+
+            if (descriptor[3] == bus_number_range) {
+                uint64_t minimum, maximum;
+                Detail::copyBytes(&minimum, descriptor + 14, sizeof(minimum));
+                Detail::copyBytes(&maximum, descriptor + 22, sizeof(maximum));
+
+                first = static_cast<uint8_t>(minimum);
+                last = static_cast<uint8_t>(maximum > 0xFF ? 0xFF : maximum);
+                return true;
+            }
+
+            // The length counts the bytes after the tag and the length itself.
+            descriptor += 3 + length;
+        }
+
+        return false;
+    }
+
+    /// The PCI functions of the system, found by reading their configuration headers, sorted by address and
+    /// indexed by class code.
+    /// With an MCFG table, the headers are read straight from the memory-mapped configuration space (ECAM), 3 reads
+    /// per function. Otherwise, each root bridge reads the first 16 bytes of a header in a single pciRead().
+    /// Either way, a device whose function 0 is absent costs a single read, and the other functions of a device are
+    /// only read if function 0 says it has several.
+    /// @code
+    /// PciDeviceTable pci;
+    /// pci.initialize(memory, size);
+    /// pci.scan(boot_services, acpi.find<AcpiMcfg>());
+    /// for (size_t i = 0; const auto* nvme = pci.findByClass(0x0108, i); ++i)
+    ///     use(*nvme);
+    /// @endcode
+    class PciDeviceTable {
+    public:
+        /// The memory needed for `device_count` devices: each takes 16 bytes, and 2 more for the class index.
+        static constexpr size_t getRequiredSize(size_t device_count) noexcept {
+            return device_count * (sizeof(PciDevice) + sizeof(uint16_t));
+        }
+
+        /// Lays out the table in `memory`, which must be 4-byte aligned. Scanning adds to it.
+        void initialize(void* memory, size_t size) noexcept {
+            const auto capacity = size / (sizeof(PciDevice) + sizeof(uint16_t));
+
+            _devices = static_cast<PciDevice*>(memory);
+            _byClass = reinterpret_cast<uint16_t*>(_devices + capacity);
+            _capacity = capacity > 0xFFFF ? 0xFFFF : capacity;
+            _count = 0;
+        }
+
+        /// Scans through the ECAM windows of `mcfg` if there is one, through every PciRootBridgeIoProtocol otherwise.
+        /// @return NotFound There is neither an MCFG table nor a root bridge.
+        /// @return BufferTooSmall There are more devices than the memory given to initialize() holds. The table has the
+        /// first ones.
+        Status scan(BootServices& boot_services, const AcpiMcfg* mcfg) noexcept {
+            if (mcfg != nullptr)
+                return scanEcam(*mcfg);
+
+            const auto handles = boot_services.locateHandleBuffer(BootServices::LocateSearchType::ByProtocol, &PciRootBridgeIoProtocol::guid);
+            if (!handles)
+                return handles.getStatus();
+
+            auto status = Status::Success;
+
+            for (const auto handle : *handles) {
+                const auto bridge = boot_services.handleProtocol<PciRootBridgeIoProtocol>(handle);
+                if (bridge)
+                    status = scanRootBridge(**bridge);
+
+                if (status != Status::Success)
+                    break;
+            }
+
+            boot_services.freePool(handles->getData());
+            return status;
+        }
+
+        /// Reads the configuration headers through the memory-mapped windows of an MCFG table. The addresses must be
+        /// identity-mapped, as they are during boot services.
+        /// @return BufferTooSmall The memory given to initialize() is full.
+        Status scanEcam(const AcpiMcfg& mcfg) noexcept {
+            auto status = Status::Success;
+
+            for (size_t i = 0; i < mcfg.getAllocationCount() && status == Status::Success; ++i) {
+                const auto& window = mcfg.getAllocation(i);
+
+                for (auto bus = window.start_bus; status == Status::Success; ++bus) {
+                    status = _scanBus(window.segment, bus, [&window, bus](uint8_t device_function, uint32_t* header) {
+                        const auto address = window.base_address + (uint64_t{bus} << 20) + (uint64_t{device_function} << 12);
+                        const auto* registers = reinterpret_cast<const volatile uint32_t*>(static_cast<uintptr_t>(address));
+
+                        header[0] = registers[0];
+                        if ((header[0] & 0xFFFF) != 0xFFFF) {
+                            header[2] = registers[2];
+                            header[3] = registers[3];
+                        }
+                    });
+
+                    if (bus == window.end_bus)
+                        break;
+                }
+            }
+
+            _sort();
+            return status;
+        }
+
+        /// Reads the configuration headers of the buses behind a root bridge, with one pciRead() per function.
+        /// @return BufferTooSmall The memory given to initialize() is full.
+        Status scanRootBridge(PciRootBridgeIoProtocol& bridge) noexcept {
+            uint8_t first = 0;
+            uint8_t last = 0xFF;
+
+            const void* resources = nullptr;
+            if (bridge.configuration(resources) == Status::Success)
+                getPciBusRange(resources, first, last);
+
+            auto status = Status::Success;
+
+            for (auto bus = first; status == Status::Success; ++bus) {
+                status = _scanBus(static_cast<uint16_t>(bridge.segment_number), bus, [&bridge, bus](uint8_t device_function, uint32_t* header) {
+                    const auto address = makePciAddress(bus, device_function >> 3, device_function & 7, 0);
+
+                    // A failed read looks like an absent function.
+                    if (bridge.pciRead(PciIoWidth::Uint32, address, 4, header) != Status::Success)
+                        header[0] = ~uint32_t{0};
+                });
+
+                if (bus == last)
+                    break;
+            }
+
+            _sort();
+            return status;
+        }
+
+        /// @return nullptr There is no such function.
+        [[nodiscard]] const PciDevice* find(uint16_t segment, uint8_t bus, uint8_t device, uint8_t function) const noexcept {
+            const auto address = (uint32_t{segment} << 16) | (uint32_t{bus} << 8) | static_cast<uint32_t>(device << 3) | function;
+
+            size_t low = 0;
+            size_t high = _count;
+            while (low < high) {
+                const auto middle = (low + high) / 2;
+                if (_devices[middle].getAddress() < address)
+                    low = middle + 1;
+                else
+                    high = middle;
+            }
+
+            return low < _count && _devices[low].getAddress() == address ? &_devices[low] : nullptr;
+        }
+
+        /// The devices of a class (see PciDevice::getClassCode()), in the order of their addresses.
+        /// @param instance Which one of them.
+        /// @return nullptr There are less than `instance + 1` devices of this class.
+        [[nodiscard]] const PciDevice* findByClass(uint16_t class_code, size_t instance = 0) const noexcept {
+            size_t low = 0;
+            size_t high = _count;
+            while (low < high) {
+                const auto middle = (low + high) / 2;
+                if (_devices[_byClass[middle]].getClassCode() < class_code)
+                    low = middle + 1;
+                else
+                    high = middle;
+            }
+
+            const auto index = low + instance;
+            if (index >= _count || _devices[_byClass[index]].getClassCode() != class_code)
+                return nullptr;
+
+            return &_devices[_byClass[index]];
+        }
+
+        [[nodiscard]] size_t getDeviceCount() const noexcept {
+            return _count;
+        }
+
+        /// The devices, in the order of their addresses.
+        [[nodiscard]] const PciDevice& getDevice(size_t index) const noexcept {
+            return _devices[index];
+        }
+
+    private:
+        /// Probes the 32 devices of a bus.
+        /// `read(device_function, header)` fills header[0] (vendor and device IDs), and if the function is present,
+        /// header[2] (class and revision) and header[3] (header type).
+        template <typename Read>
+        Status _scanBus(uint16_t segment, uint8_t bus, Read read) noexcept {
+            for (uint8_t device = 0; device < 32; ++device) {
+                for (uint8_t function = 0; function < 8; ++function) {
+                    uint32_t header[4];
+                    const auto device_function = static_cast<uint8_t>((device << 3) | function);
+                    read(device_function, header);
+
+                    // An absent function reads as all ones. Function 0 must be present for the others to be.
+                    if ((header[0] & 0xFFFF) == 0xFFFF) {
+                        if (function == 0)
+                            break;
+
+                        continue;
+                    }
+
+                    if (UEFI_UNLIKELY(_count == _capacity))
+                        return Status::BufferTooSmall;
+
+                    auto& entry = _devices[_count++];
+                    entry.segment = segment;
+                    entry.bus = bus;
+                    entry.device_function = device_function;
+                    entry.vendor_id = static_cast<uint16_t>(header[0]);
+                    entry.device_id = static_cast<uint16_t>(header[0] >> 16);
+                    Detail::copyBytes(&entry.revision_id, &header[2], sizeof(uint32_t));
+
+                    const auto header_type = static_cast<uint8_t>(header[3] >> 16);
+                    entry.header_type = header_type & 0x7F;
+                    entry.reserved[0] = entry.reserved[1] = entry.reserved[2] = 0;
+
+                    if (function == 0 && (header_type & 0x80) == 0)
+                        break;
+                }
+            }
+
+            return Status::Success;
+        }
+
+        /// Sorts the devices by address and rebuilds the class index. Insertion sorts, since each scan appends an
+        /// already sorted run.
+        void _sort() noexcept {
+            for (size_t i = 1; i < _count; ++i) {
+                const auto device = _devices[i];
+                auto j = i;
+                for (; j > 0 && _devices[j - 1].getAddress() > device.getAddress(); --j)
+                    _devices[j] = _devices[j - 1];
+
+                _devices[j] = device;
+            }
+
+            for (size_t i = 0; i < _count; ++i) {
+                const auto class_code = _devices[i].getClassCode();
+                auto j = i;
+                for (; j > 0 && _devices[_byClass[j - 1]].getClassCode() > class_code; --j)
+                    _byClass[j] = _byClass[j - 1];
+
+                _byClass[j] = static_cast<uint16_t>(i);
+            }
+        }
+
+        PciDevice* _devices;
+        /// Indices of _devices, sorted by class code, then by address.
+        uint16_t* _byClass;
+        size_t _capacity;
+        size_t _count;
+    };
+} // namespace Uefi
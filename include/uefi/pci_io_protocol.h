@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "guid.h"
+#include "handle.h"
+#include "non_copyable.h"
+#include "status.h"
+
+namespace Uefi {
+    /// The size of each access of PciRootBridgeIoProtocol and PciIoProtocol.
+    enum class PciIoWidth : uint32_t {
+        Uint8,
+        Uint16,
+        Uint32,
+        Uint64,
+        /// The same address is accessed `count` times, while the buffer advances.
+        FifoUint8,
+        FifoUint16,
+        FifoUint32,
+        FifoUint64,
+        /// The address advances, while the same buffer element is written `count` times.
+        FillUint8,
+        FillUint16,
+        FillUint32,
+        FillUint64
+    };
+
+    /// The address of a configuration register, for PciRootBridgeIoProtocol::pciRead() and pciWrite().
+    /// @param reg An offset up to 4095: offsets from 256 use the extended register field, only present on PCI Express.
+    constexpr uint64_t makePciAddress(uint8_t bus, uint8_t device, uint8_t function, uint16_t reg) noexcept {
+        const uint64_t legacy = reg < 256 ? reg : 0;
+        const uint64_t extended = reg < 256 ? 0 : reg;
+        return legacy | (uint64_t{function} << 8) | (uint64_t{device} << 16) | (uint64_t{bus} << 24) | (extended << 32);
+    }
+
+    /// Gives access to the memory, I/O and configuration spaces of the devices behind a PCI host bridge.
+    class PciRootBridgeIoProtocol : private NonCopyable {
+    public:
+        static constexpr Guid guid = {0x2f707ebb, 0x4a1a, 0x11d4, {0x9a, 0x38, 0x00, 0x90, 0x27, 0x3f, 0xc1, 0x4d}};
+
+        /// The host bridge this root bridge belongs to.
+        Handle parent_handle;
+
+        /// Reads `count` elements of `width` from memory space, e.g. the BAR of a device.
+        Status memRead(PciIoWidth width, uint64_t address, size_t count, void* buffer) {
+            return _memRead(this, width, address, count, buffer);
+        }
+
+        Status memWrite(PciIoWidth width, uint64_t address, size_t count, const void* buffer) {
+            return _memWrite(this, width, address, count, buffer);
+        }
+
+        Status ioRead(PciIoWidth width, uint64_t address, size_t count, void* buffer) {
+            return _ioRead(this, width, address, count, buffer);
+        }
+
+        Status ioWrite(PciIoWidth width, uint64_t address, size_t count, const void* buffer) {
+            return _ioWrite(this, width, address, count, buffer);
+        }
+
+        /// Reads configuration registers. A function which is absent reads as all ones.
+        /// @param address See makePciAddress().
+        Status pciRead(PciIoWidth width, uint64_t address, size_t count, void* buffer) {
+            return _pciRead(this, width, address, count, buffer);
+        }
+
+        Status pciWrite(PciIoWidth width, uint64_t address, size_t count, const void* buffer) {
+            return _pciWrite(this, width, address, count, buffer);
+        }
+
+        /// Flushes the posted writes to system memory.
+        Status flush() {
+            return _flush(this);
+        }
+
+        /// Returns the resources of the root bridge, as a list of ACPI address space descriptors which stays valid as
+        /// long as the protocol. See getPciBusRange() in pci.h for the buses.
+        /// @return Unsupported The resources have not been assigned yet.
+        Status configuration(const void*& resources) {
+            return _configuration(this, &resources);
+        }
+
+    private:
+        [[maybe_unused]] void* _buf1[2];
+
+        Status (*_memRead)(PciRootBridgeIoProtocol*, PciIoWidth, uint64_t, size_t, void*);
+        Status (*_memWrite)(PciRootBridgeIoProtocol*, PciIoWidth, uint64_t, size_t, const void*);
+        Status (*_ioRead)(PciRootBridgeIoProtocol*, PciIoWidth, uint64_t, size_t, void*);
+        Status (*_ioWrite)(PciRootBridgeIoProtocol*, PciIoWidth, uint64_t, size_t, const void*);
+        Status (*_pciRead)(PciRootBridgeIoProtocol*, PciIoWidth, uint64_t, size_t, void*);
+        Status (*_pciWrite)(PciRootBridgeIoProtocol*, PciIoWidth, uint64_t, size_t, const void*);
+
+        [[maybe_unused]] void* _buf2[5];
+
+        Status (*_flush)(PciRootBridgeIoProtocol*);
+
+        [[maybe_unused]] void* _buf3[2];
+
+        Status (*_configuration)(PciRootBridgeIoProtocol*, const void**);
+
+    public:
+        /// The PCI segment (or domain) of the buses behind this root bridge.
+        uint32_t segment_number;
+    };
+
+    /// Gives access to a single PCI function, installed on its handle by the PCI bus driver.
+    class PciIoProtocol : private NonCopyable {
+    public:
+        static constexpr Guid guid = {0x4cf5b200, 0x68b8, 0x4ca5, {0x9e, 0xec, 0xb2, 0x3e, 0x3f, 0x50, 0x02, 0x9a}};
+
+        /// Where the function is.
+        struct Location {
+            size_t segment;
+            size_t bus;
+            size_t device;
+            size_t function;
+        };
+
+        /// Reads from the memory space of a BAR.
+        /// @param bar_index Which one of the 6 base address registers `offset` is relative to.
+        Status memRead(PciIoWidth width, uint8_t bar_index, uint64_t offset, size_t count, void* buffer) {
+            return _memRead(this, width, bar_index, offset, count, buffer);
+        }
+
+        Status memWrite(PciIoWidth width, uint8_t bar_index, uint64_t offset, size_t count, const void* buffer) {
+            return _memWrite(this, width, bar_index, offset, count, buffer);
+        }
+
+        Status ioRead(PciIoWidth width, uint8_t bar_index, uint64_t offset, size_t count, void* buffer) {
+            return _ioRead(this, width, bar_index, offset, count, buffer);
+        }
+
+        Status ioWrite(PciIoWidth width, uint8_t bar_index, uint64_t offset, size_t count, const void* buffer) {
+            return _ioWrite(this, width, bar_index, offset, count, buffer);
+        }
+
+        /// Reads the configuration registers of the function, from `offset`.
+        Status pciRead(PciIoWidth width, uint32_t offset, size_t count, void* buffer) {
+            return _pciRead(this, width, offset, count, buffer);
+        }
+
+        Status pciWrite(PciIoWidth width, uint32_t offset, size_t count, const void* buffer) {
+            return _pciWrite(this, width, offset, count, buffer);
+        }
+
+        Status flush() {
+            return _flush(this);
+        }
+
+        Status getLocation(Location& location) {
+            return _getLocation(this, &location.segment, &location.bus, &location.device, &location.function);
+        }
+
+    private:
+        [[maybe_unused]] void* _buf1[2];
+
+        Status (*_memRead)(PciIoProtocol*, PciIoWidth, uint8_t, uint64_t, size_t, void*);
+        Status (*_memWrite)(PciIoProtocol*, PciIoWidth, uint8_t, uint64_t, size_t, const void*);
+        Status (*_ioRead)(PciIoProtocol*, PciIoWidth, uint8_t, uint64_t, size_t, void*);
+        Status (*_ioWrite)(PciIoProtocol*, PciIoWidth, uint8_t, uint64_t, size_t, const void*);
+        Status (*_pciRead)(PciIoProtocol*, PciIoWidth, uint32_t, size_t, void*);
+        Status (*_pciWrite)(PciIoProtocol*, PciIoWidth, uint32_t, size_t, const void*);
+
+        [[maybe_unused]] void* _buf2[5];
+
+        Status (*_flush)(PciIoProtocol*);
+        Status (*_getLocation)(PciIoProtocol*, size_t*, size_t*, size_t*, size_t*);
+
+        [[maybe_unused]] void* _buf3[3];
+
+    public:
+        /// The size of the option ROM of the device, and its copy in memory.
+        uint64_t rom_size;
+        void* rom_image;
+    };
+} // namespace Uefi
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "boot_services.h"
+#include "detail/memory.h"
+#include "device_path_protocol.h"
+#include "file_protocol.h"
+#include "guid.h"
+#include "memory_type.h"
+#include "non_copyable.h"
+#include "ram_disk_protocol.h"
+#include "status.h"
+
+namespace Uefi {
+    /// A disk image copied to memory and registered as a RAM disk, so that the many small reads of a file system,
+    /// each of which goes back to the device otherwise, run at memory speed. The image, e.g. a FAT image of a whole
+    /// directory tree, is read with a few large sequential reads, which slow devices like USB sticks handle far better
+    /// than scattered small ones.
+    /// @code
+    /// RamDisk disk;
+    /// if (disk.load(boot_services, *ram_disk_protocol, *image_file) != Status::Success)
+    ///     return;
+    /// // The firmware now has a SimpleFileSystemProtocol on the handle with disk.getDevicePath().
+    /// @endcode
+    class RamDisk : private NonCopyable {
+    public:
+        /// The size of each read: large enough that the fixed cost of a request is lost in the transfer, small enough
+        /// that the USB mass storage drivers of some firmware do not time out on it.
+        static constexpr size_t default_read_size = 4 * 1024 * 1024;
+
+        /// The block size of the firmware's RAM disks: the registered size is rounded up to it, zeros filling the gap.
+        static constexpr size_t block_size = 512;
+
+        /// Reads `image` from its start into newly allocated pages, and registers them as a disk. On failure, the
+        /// pages are freed, and the RamDisk holds nothing.
+        /// @param memory_type LoaderData for a disk only the loader reads, ReservedMemory for one the OS must find
+        /// intact, e.g. with persistent_virtual_disk_guid.
+        /// @return AlreadyStarted A disk is already loaded: unload() it first.
+        /// @return VolumeCorrupted The file ended before its size.
+        Status load(BootServices& boot_services, RamDiskProtocol& protocol, FileProtocol& image, const Guid& type = virtual_disk_guid,
+                    MemoryType memory_type = MemoryType::LoaderData, size_t read_size = default_read_size) noexcept {
+            if (_protocol != nullptr)
+                return Status::AlreadyStarted;
+
+            _devicePath = nullptr;
+            _base = 0;
+            _size = 0;
+            _readCount = 0;
+
+            uint64_t file_size;
+            auto status = _getFileSize(image, file_size);
+            if (status != Status::Success)
+                return status;
+
+            if (file_size == 0)
+                return Status::InvalidParameter;
+
+            const auto disk_size = (file_size + block_size - 1) & ~uint64_t{block_size - 1};
+            const auto page_count = static_cast<size_t>((disk_size + page_size - 1) / page_size);
+
+            const auto memory = boot_services.allocatePages(memory_type, page_count);
+            if (!memory)
+                return memory.getStatus();
+
+            auto* bytes = reinterpret_cast<uint8_t*>(static_cast<uintptr_t>(*memory));
+            status = _read(image, bytes, file_size, read_size);
+
+            if (status == Status::Success) {
+                Detail::setBytes(bytes + file_size, 0, static_cast<size_t>((page_count * page_size) - file_size));
+                status = protocol.registerRamDisk(*memory, disk_size, type, nullptr, _devicePath);
+            }
+
+            if (status != Status::Success) {
+                static_cast<void>(boot_services.freePages(*memory, page_count));
+                _devicePath = nullptr;
+                return status;
+            }
+
+            _protocol = &protocol;
+            _base = *memory;
+            _size = disk_size;
+            return Status::Success;
+        }
+
+        /// Unregisters the disk, and frees its pages. Does nothing if nothing is loaded.
+        Status unload(BootServices& boot_services) noexcept {
+            if (_protocol == nullptr)
+                return Status::Success;
+
+            const auto status = _protocol->unregisterRamDisk(_devicePath);
+            if (status != Status::Success)
+                return status;
+
+            _protocol = nullptr;
+            _devicePath = nullptr;
+            return boot_services.freePages(_base, static_cast<size_t>((_size + page_size - 1) / page_size));
+        }
+
+        [[nodiscard]] BootServices::PhysicalAddress getBase() const noexcept {
+            return _base;
+        }
+
+        /// The size of the disk, a multiple of block_size.
+        [[nodiscard]] uint64_t getSize() const noexcept {
+            return _size;
+        }
+
+        /// Identifies the disk, e.g. to find which of the handles with a SimpleFileSystemProtocol is on it.
+        [[nodiscard]] const DevicePathProtocol* getDevicePath() const noexcept {
+            return _devicePath;
+        }
+
+        /// The number of reads load() issued to the file.
+        [[nodiscard]] size_t getReadCount() const noexcept {
+            return _readCount;
+        }
+
+    private:
+        static constexpr size_t page_size = 0x1000;
+        /// Fits the fixed part of FileInfo and a name as long as FAT allows.
+        static constexpr size_t info_buffer_size = offsetof(FileInfo, file_name) + (256 * sizeof(char16_t));
+
+        static Status _getFileSize(FileProtocol& file, uint64_t& file_size) noexcept {
+            alignas(8) uint8_t buffer[info_buffer_size];
+            size_t buffer_size = sizeof(buffer);
+
+            const auto status = file.getInfo(FileInfo::guid, buffer_size, buffer);
+            if (status != Status::Success)
+                return status;
+
+            file_size = reinterpret_cast<const FileInfo*>(buffer)->file_size;
+            return Status::Success;
+        }
+
+        Status _read(FileProtocol& file, uint8_t* destination, uint64_t size, size_t read_size) noexcept {
+            auto status = file.setPosition(0);
+            if (status != Status::Success)
+                return status;
+
+            while (size > 0) {
+                auto chunk = size < read_size ? static_cast<size_t>(size) : read_size;
+
+                status = file.read(chunk, destination);
+                ++_readCount;
+                if (status != Status::Success)
+                    return status;
+
+                if (chunk == 0)
+                    return Status::VolumeCorrupted;
+
+                destination += chunk;
+                size -= chunk;
+            }
+
+            return Status::Success;
+        }
+
+        RamDiskProtocol* _protocol = nullptr;
+        const DevicePathProtocol* _devicePath;
+        BootServices::PhysicalAddress _base;
+        uint64_t _size;
+        size_t _readCount;
+    };
+} // namespace Uefi
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+
+#include "device_path_protocol.h"
+#include "guid.h"
+#include "non_copyable.h"
+#include "status.h"
+
+namespace Uefi {
+    /// RAM disk types, which tell the firmware and the OS how to present the disk.
+    constexpr Guid virtual_disk_guid = {0x77ab535a, 0x45fc, 0x624b, {0x55, 0x60, 0xf7, 0xb2, 0x81, 0xd1, 0xf9, 0x6e}};
+    constexpr Guid virtual_cd_guid = {0x3d5abd30, 0x4175, 0x87ce, {0x6d, 0x64, 0xd2, 0xad, 0xe5, 0x23, 0xc4, 0xbb}};
+    /// Like virtual_disk_guid, but the OS is told the disk survives its boot, through the ACPI NFIT.
+    constexpr Guid persistent_virtual_disk_guid = {0x5cea02c9, 0x4d07, 0x69d3, {0x26, 0x9f, 0x44, 0x96, 0xfb, 0xe0, 0x96, 0xf9}};
+    constexpr Guid persistent_virtual_cd_guid = {0x08018188, 0x42cd, 0xbb48, {0x10, 0x0f, 0x53, 0x87, 0xd5, 0x3d, 0xed, 0x3d}};
+
+    /// Turns memory holding a disk image into a block device. The firmware then connects its drivers to it, so a FAT
+    /// image gets a SimpleFileSystemProtocol like any other volume.
+    class RamDiskProtocol : private NonCopyable {
+    public:
+        static constexpr Guid guid = {0xab38a0df, 0x6873, 0x44a9, {0x87, 0xe6, 0xd4, 0xeb, 0x56, 0x14, 0x84, 0x62}};
+
+        /// Registers the memory at `base` as a disk. The memory must stay allocated until unregisterRamDisk().
+        /// @param type One of the RAM disk type GUIDs, e.g. virtual_disk_guid.
+        /// @param parent_device_path Prepended to the device path of the disk, or nullptr.
+        /// @param[out] device_path The device path of the new disk, which identifies it to unregisterRamDisk().
+        /// @return Unsupported The type is not supported.
+        /// @return AlreadyStarted A disk with the same device path is already registered.
+        Status registerRamDisk(uint64_t base, uint64_t size, const Guid& type, const DevicePathProtocol* parent_device_path,
+                               const DevicePathProtocol*& device_path) {
+            return _register(base, size, &type, parent_device_path, &device_path);
+        }
+
+        /// Removes the disk, which uninstalls the block device and the file system on it.
+        /// @return NotFound No disk has this device path.
+        Status unregisterRamDisk(const DevicePathProtocol* device_path) {
+            return _unregister(device_path);
+        }
+
+    private:
+        Status (*_register)(uint64_t, uint64_t, const Guid*, const DevicePathProtocol*, const DevicePathProtocol**);
+        Status (*_unregister)(const DevicePathProtocol*);
+    };
+} // namespace Uefi
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "detail/branch_hints.h"
+#include "status.h"
+
+namespace Uefi {
+    /// A value together with the Status of the call which produced it.
+    /// The firmware wrappers have overloads returning one instead of taking out-parameters:
+    /// @code
+    /// const auto memory = boot_services.allocatePages(MemoryType::LoaderData, page_count);
+    /// if (!memory)
+    ///     return memory.getStatus();
+    ///
+    /// use(*memory);
+    /// @endcode
+    /// The wrappers are inlined, so a Result never reaches memory: the compiler keeps its two members in registers, and
+    /// the code makes the same calls and memory accesses as the raw call with a local variable. Only the register
+    /// allocation may differ (see tests/result_codegen.cpp).
+    template <typename T>
+    class [[nodiscard]] Result {
+    public:
+        /// A failure, without a value.
+        constexpr Result(Status status) noexcept : _value(), _status(status) {}
+
+        /// A success.
+        constexpr Result(T value) noexcept : _value(value), _status(Status::Success) {}
+
+        /// The value is only meaningful if the status is not an error.
+        constexpr Result(Status status, T value) noexcept : _value(value), _status(status) {}
+
+        /// Whether the call succeeded, possibly with a warning, so that there is a value.
+        [[nodiscard]] constexpr bool isSuccess() const noexcept {
+            return UEFI_LIKELY(!isErrorCode(_status));
+        }
+
+        constexpr explicit operator bool() const noexcept {
+            return isSuccess();
+        }
+
+        [[nodiscard]] constexpr Status getStatus() const noexcept {
+            return _status;
+        }
+
+        /// Only valid if isSuccess().
+        /// @{
+        [[nodiscard]] constexpr T& getValue() noexcept {
+            return _value;
+        }
+
+        [[nodiscard]] constexpr const T& getValue() const noexcept {
+            return _value;
+        }
+
+        constexpr T& operator*() noexcept {
+            return _value;
+        }
+
+        constexpr const T& operator*() const noexcept {
+            return _value;
+        }
+
+        constexpr T* operator->() noexcept {
+            return &_value;
+        }
+
+        constexpr const T* operator->() const noexcept {
+            return &_value;
+        }
+        /// @}
+
+        /// The value, or `fallback` if the call failed.
+        [[nodiscard]] constexpr T getValueOr(T fallback) const noexcept {
+            return isSuccess() ? _value : fallback;
+        }
+
+    private:
+        T _value;
+        Status _status;
+    };
+} // namespace Uefi
@@ -3,6 +3,7 @@
 #include "boot_services.h"
 #include "guid.h"
 #include "handle.h"
+#include "result.h"
 #include "signed_table.h"
 #include "time.h"
 
@@ -10,7 +11,14 @@ namespace Uefi {
     class RuntimeServices : public SignedTable<0x56524553544e5552> {
     public:
         Status getTime(Time& time, TimeCapabilities& capabilities) {
-            return _getTime(time, capabilities);
+            return _getTime(time, &capabilities);
+        }
+
+        /// Returns the current time and date.
+        Result<Time> getTime() {
+            Time time;
+            const auto status = _getTime(time, nullptr);
+            return {status, time};
         }
 
         Status setTime(Time& time) {
@@ -32,15 +40,26 @@ namespace Uefi {
             EnhancedAuthenticatedAccess = 128
         };
 
-        Status getVariable(const char16_t* name, const Guid* guid, VariableAttributes& attributes, size_t& size, void*& data) {
-            return _getVariable(name, guid, attributes, size, data);
+        /// Reads a variable into `data`.
+        /// @param[in,out] size On input, the size of the buffer. On output, the size of the variable, also when it
+        /// returns BufferTooSmall.
+        Status getVariable(const char16_t* name, const Guid* guid, VariableAttributes& attributes, size_t& size, void* data) {
+            return _getVariable(name, guid, &attributes, size, data);
+        }
+
+        /// Reads a variable into a buffer of `size` bytes, and returns the size of the variable.
+        Result<size_t> getVariable(const char16_t* name, const Guid& guid, void* data, size_t size) {
+            const auto status = _getVariable(name, &guid, nullptr, size, data);
+            return {status, size};
         }
 
-        Status getNextVariable(size_t& name_size, const char16_t* name, const Guid* guid) {
+        /// Moves `name` and `guid` to the next variable. Start with an empty name.
+        /// @param[in,out] name_size The size of the name buffer, in bytes.
+        Status getNextVariable(size_t& name_size, char16_t* name, Guid& guid) {
             return _getNextVariable(name_size, name, guid);
         }
 
-        Status setVariable(const char16_t* name, const Guid* guid, VariableAttributes attributes, size_t size, void*& data) {
+        Status setVariable(const char16_t* name, const Guid* guid, VariableAttributes attributes, size_t size, const void* data) {
             return _setVariable(name, guid, attributes, size, data);
         }
 
@@ -51,25 +70,47 @@ namespace Uefi {
             PlatformSpecific
         };
 
-        void reset(ResetType type, Status status, size_t size, void*& data) {
+        void reset(ResetType type, Status status, size_t size = 0, const void* data = nullptr) {
             return _reset(type, status, size, data);
         }
 
         struct CapsuleHeader {
+            /// The capsule is processed after the next reset, from the scatter-gather list passed to updateCapsule().
+            static constexpr uint32_t persist_across_reset = 0x10000;
+            /// The capsule is installed in the configuration table after the reset. Requires persist_across_reset.
+            static constexpr uint32_t populate_system_table = 0x20000;
+            /// updateCapsule() resets the system itself. Requires persist_across_reset.
+            static constexpr uint32_t initiate_reset = 0x40000;
+
             Guid guid;
+            /// The size of this header and of any data following it before the image.
             uint32_t header_size;
             uint32_t flags;
+            /// The size of the whole capsule, header included.
             uint32_t image_size;
         };
 
         using PhysicalAddress = uint64_t;
 
+        /// An entry of the scatter-gather list of updateCapsule(): a physically contiguous block of capsule data.
+        /// A length of 0 ends the list if the address is 0, or continues it with the array at the address.
+        struct CapsuleBlockDescriptor {
+            uint64_t length;
+            PhysicalAddress address;
+        };
+
+        /// Passes capsules to the firmware. See CapsuleBuilder for building the scatter-gather list.
+        /// @param scatter_gather_list The physical address of the first CapsuleBlockDescriptor, which describes the
+        /// capsules in the order of `header_array`. Required if a capsule has persist_across_reset.
         Status updateCapsule(CapsuleHeader** header_array, size_t count, PhysicalAddress scatter_gather_list) {
             return _updateCapsule(header_array, count, scatter_gather_list);
         }
 
-        Status queryCapsuleCapabilities(CapsuleHeader** header_array, size_t count, size_t& max_size, ResetType reset_type) {
-            return _queryCapsuleCapabilities(header_array, count, max_size, reset_type);
+        /// Checks whether the firmware can process these capsules.
+        /// @param[out] max_size The largest capsule (or total of the capsules) the firmware accepts, in bytes.
+        /// @param[out] reset_type The reset updateCapsule() needs to process them.
+        Status queryCapsuleCapabilities(CapsuleHeader** header_array, size_t count, uint64_t& max_size, ResetType& reset_type) {
+            return _queryCapsuleCapabilities(header_array, count, &max_size, &reset_type);
         }
 
         Status queryVariableInfo(VariableAttributes attributes, uint64_t& max_storage_size, uint64_t& remaining_storage_size, uint64_t& max_size) {
@@ -77,24 +118,24 @@ namespace Uefi {
         }
 
     private:
-        Status _getTime(Time&, TimeCapabilities&);
-        Status _setTime(Time&);
+        Status (*_getTime)(Time&, TimeCapabilities*);
+        Status (*_setTime)(Time&);
 
         [[maybe_unused]] void* _buf1[2];
 
-        Status _setVirtualAddressMap(size_t, size_t, uint32_t, BootServices::MemoryDescriptor&);
+        Status (*_setVirtualAddressMap)(size_t, size_t, uint32_t, BootServices::MemoryDescriptor&);
 
         [[maybe_unused]] void* _buf2;
 
-        Status _getVariable(const char16_t*, const Guid*, VariableAttributes&, size_t&, void*&);
-        Status _getNextVariable(size_t&, const char16_t*, const Guid*);
-        Status _setVariable(const char16_t*, const Guid*, VariableAttributes, size_t, void*&);
+        Status (*_getVariable)(const char16_t*, const Guid*, VariableAttributes*, size_t&, void*);
+        Status (*_getNextVariable)(size_t&, char16_t*, Guid&);
+        Status (*_setVariable)(const char16_t*, const Guid*, VariableAttributes, size_t, const void*);
 
         [[maybe_unused]] void* _buf3;
 
-        void _reset(ResetType, Status, size_t, void*&);
-        Status _updateCapsule(CapsuleHeader**, size_t, PhysicalAddress);
-        Status _queryCapsuleCapabilities(CapsuleHeader**, size_t, size_t&, ResetType);
-        Status _queryVariableInfo(VariableAttributes, uint64_t&, uint64_t&, uint64_t&);
+        void (*_reset)(ResetType, Status, size_t, const void*);
+        Status (*_updateCapsule)(CapsuleHeader**, size_t, PhysicalAddress);
+        Status (*_queryCapsuleCapabilities)(CapsuleHeader**, size_t, uint64_t*, ResetType*);
+        Status (*_queryVariableInfo)(VariableAttributes, uint64_t&, uint64_t&, uint64_t&);
     };
 } // namespace Uefi
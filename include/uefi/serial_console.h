@@ -0,0 +1,413 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "console_color.h"
+#include "detail/memory.h"
+#include "serial_io_protocol.h"
+#include "simple_text_output_protocol.h"
+#include "text_output_stream.h"
+
+namespace Uefi {
+    /// Serial port backend which goes through the firmware's SerialIoProtocol.
+    /// Only usable until exitBootServices() is called.
+    struct SerialIoPort {
+        SerialIoProtocol* protocol;
+
+        /// Writes the whole buffer, retrying after partial writes.
+        /// @return DeviceError The firmware took nothing, but reported success.
+        Status write(const uint8_t* data, size_t size) {
+            while (size != 0) {
+                auto written = size;
+                const auto status = protocol->write(written, data);
+
+                data += written;
+                size -= written;
+
+                // A timeout after some progress only means the FIFO was full for a while.
+                if (status == Status::Timeout && written != 0)
+                    continue;
+
+                if (status != Status::Success)
+                    return status;
+
+                // Retrying would never end.
+                if (written == 0)
+                    return Status::DeviceError;
+            }
+
+            return Status::Success;
+        }
+    };
+
+    /// Serial port backend which programs a 16550-compatible UART directly.
+    /// It doesn't call the firmware at all, so it keeps working after exitBootServices().
+    class Uart16550 {
+    public:
+        /// Base I/O port of the first PC serial port.
+        static constexpr uint16_t com1 = 0x3F8;
+
+        /// Input clock of a PC serial port.
+        static constexpr uint32_t pc_clock = 1843200;
+
+        /// Size of the transmit FIFO of a 16550A.
+        static constexpr size_t fifo_size = 16;
+
+#if defined(__x86_64__) || defined(__i386__)
+        /// Uses an UART mapped in the I/O port space (e.g. com1), and configures it for 8N1 at the given baud rate.
+        void initializePortIo(uint16_t port, uint32_t baud_rate = 115200) {
+            _base = port;
+            _stride = 1;
+            _portIo = true;
+            _program(pc_clock, baud_rate);
+        }
+#endif
+
+        /// Uses an UART with memory-mapped registers (usually found on ARM, or in the ACPI SPCR table),
+        /// and configures it for 8N1 at the given baud rate.
+        /// @param register_stride Distance in bytes between two consecutive registers.
+        /// @param baud_rate 0, or a rate above clock / 16, gets clock / 16.
+        /// @param clock The UART's input clock, in Hz.
+        void initializeMmio(uintptr_t base, uint32_t register_stride = 1, uint32_t baud_rate = 115200, uint32_t clock = pc_clock) {
+            _base = base;
+            _stride = register_stride;
+            _portIo = false;
+            _program(clock, baud_rate);
+        }
+
+        /// Writes the whole buffer, filling the transmit FIFO each time it becomes empty.
+        Status write(const uint8_t* data, size_t size) {
+            while (size != 0) {
+                while ((_readRegister(line_status) & line_status_transmitter_empty) == 0)
+                    ;
+
+                const auto chunk = size < fifo_size ? size : fifo_size;
+
+                for (size_t i = 0; i < chunk; ++i)
+                    _writeRegister(transmit, data[i]);
+
+                data += chunk;
+                size -= chunk;
+            }
+
+            return Status::Success;
+        }
+
+    private:
+        // Register indices.
+        static constexpr uint8_t transmit = 0;
+        static constexpr uint8_t interrupt_enable = 1;
+        static constexpr uint8_t fifo_control = 2;
+        static constexpr uint8_t line_control = 3;
+        static constexpr uint8_t modem_control = 4;
+        static constexpr uint8_t line_status = 5;
+
+        /// Set in the line control register to access the divisor latch through registers 0 and 1.
+        static constexpr uint8_t line_control_divisor_latch = 0x80;
+        /// 8 data bits, no parity, 1 stop bit.
+        static constexpr uint8_t line_control_8n1 = 0x03;
+        /// THRE: the transmit FIFO is empty.
+        static constexpr uint8_t line_status_transmitter_empty = 0x20;
+
+        /// A baud rate of 0, or above clock / 16, gets the fastest rate: a divisor of 0 would mean 65536 to the UART.
+        void _program(uint32_t clock, uint32_t baud_rate) {
+            auto divisor = baud_rate != 0 ? clock / 16 / baud_rate : 1;
+            divisor = divisor == 0 ? 1 : (divisor > 0xFFFF ? 0xFFFF : divisor);
+
+            _writeRegister(interrupt_enable, 0);
+            _writeRegister(line_control, line_control_divisor_latch);
+            _writeRegister(0, divisor & 0xFF);
+            _writeRegister(1, (divisor >> 8) & 0xFF);
+            _writeRegister(line_control, line_control_8n1);
+            // Enable and clear both FIFOs.
+            _writeRegister(fifo_control, 0x07);
+            // DTR, RTS and OUT2.
+            _writeRegister(modem_control, 0x0B);
+        }
+
+        [[nodiscard]] uint8_t _readRegister(uint8_t index) const {
+#if defined(__x86_64__) || defined(__i386__)
+            if (_portIo) {
+                uint8_t value;
+                asm volatile("inb %1, %0"
+                             : "=a"(value)
+                             : "Nd"(static_cast<uint16_t>(_base + index)));
+                return value;
+            }
+#endif
+            return *reinterpret_cast<volatile uint8_t*>(_base + (index * _stride));
+        }
+
+        void _writeRegister(uint8_t index, uint8_t value) {
+#if defined(__x86_64__) || defined(__i386__)
+            if (_portIo) {
+                asm volatile("outb %0, %1"
+                             :
+                             : "a"(value), "Nd"(static_cast<uint16_t>(_base + index)));
+                return;
+            }
+#endif
+            *reinterpret_cast<volatile uint8_t*>(_base + (index * _stride)) = value;
+        }
+
+        uintptr_t _base;
+        uint32_t _stride;
+        bool _portIo;
+    };
+
+    /// A console which writes to a serial port, without going through console_out.
+    /// Text is collected in a buffer and sent to the port in large writes:
+    /// when the buffer is full, when flush() is called, and optionally at every new line.
+    /// UTF-8 / ASCII text can be written directly with write(), without converting it to UCS-2 first.
+    /// It is also a SimpleTextOutputProtocol, so it can be used as the output of a TextOutputStream.
+    /// Colors are sent as ANSI escape sequences.
+    /// @tparam Port The backend: SerialIoPort or Uart16550. It must provide `Status write(const uint8_t*, size_t)`.
+    /// @tparam buffer_size Size of the write buffer, in bytes.
+    template <typename Port, size_t buffer_size = 4096>
+    class SerialConsole : public SimpleTextOutputProtocol {
+        static_assert(buffer_size >= 16, "The buffer must at least hold a few characters and escape sequences.");
+
+    public:
+        /// Columns and rows reported by queryMode(). Serial terminals don't report their size.
+        static constexpr size_t columns = 80;
+        static constexpr size_t rows = 25;
+
+        // Since static constructors require runtime support, it's better for users to just call initialize().
+        /// @param flush_on_new_line If set, the buffer is also flushed after every line feed.
+        void initialize(const Port& port, bool flush_on_new_line = false) {
+            _reset = &SerialConsole::_resetThunk;
+            _outputString = &SerialConsole::_outputStringThunk;
+            _testString = &SerialConsole::_testStringThunk;
+            _queryMode = &SerialConsole::_queryModeThunk;
+            _setMode = &SerialConsole::_setModeThunk;
+            _setAttribute = &SerialConsole::_setAttributeThunk;
+            _clearScreen = &SerialConsole::_clearScreenThunk;
+            _setCursorPosition = &SerialConsole::_setCursorPositionThunk;
+            _enableCursor = &SerialConsole::_enableCursorThunk;
+            _mode = &_modeData;
+            _modeData = {1, 0, default_color.getValue(), 0, 0, true};
+
+            _port = port;
+            _used = 0;
+            _flushOnNewLine = flush_on_new_line;
+        }
+
+        /// Changes the backend, for example to switch to the same UART after exitBootServices().
+        /// Pending data is flushed to the old port first.
+        Status setPort(const Port& port) {
+            const auto status = flush();
+            _port = port;
+            return status;
+        }
+
+        /// Queues UTF-8 or ASCII text.
+        Status write(const char* text, size_t size) {
+            const auto* data = reinterpret_cast<const uint8_t*>(text);
+
+            // Big writes skip the buffer, instead of being cut into buffer-sized pieces.
+            if (size >= buffer_size) {
+                const auto status = flush();
+                if (status != Status::Success)
+                    return status;
+
+                return _port.write(data, size);
+            }
+
+            if (_used + size > buffer_size) {
+                const auto status = flush();
+                if (status != Status::Success)
+                    return status;
+            }
+
+            Detail::copyBytes(_buffer + _used, data, size);
+            _used += size;
+
+            if (_flushOnNewLine && size != 0 && data[size - 1] == '\n')
+                return flush();
+
+            return Status::Success;
+        }
+
+        /// Queues a null-terminated UTF-8 or ASCII string.
+        Status write(const char* text) {
+            return write(text, __builtin_strlen(text));
+        }
+
+        /// Sends everything that was queued to the port.
+        Status flush() {
+            if (_used == 0)
+                return Status::Success;
+
+            const auto status = _port.write(_buffer, _used);
+            _used = 0;
+            return status;
+        }
+
+    private:
+        /// Makes room for at least `size` bytes.
+        Status _reserve(size_t size) {
+            if (_used + size > buffer_size)
+                return flush();
+            return Status::Success;
+        }
+
+        /// Queues UCS-2 text, encoding it as UTF-8 straight into the buffer.
+        Status _writeUcs2(const char16_t* string) {
+            auto status = Status::Success;
+            auto saw_line_feed = false;
+
+            for (; *string != 0; ++string) {
+                // At most 4 bytes per code point.
+                status = _reserve(4);
+                if (status != Status::Success)
+                    return status;
+
+                auto c = static_cast<uint32_t>(*string);
+
+                if (c < 0x80) {
+                    _buffer[_used++] = static_cast<uint8_t>(c);
+                    saw_line_feed = c == '\n';
+                    continue;
+                }
+
+                saw_line_feed = false;
+
+                if (c < 0x800) {
+                    _buffer[_used++] = static_cast<uint8_t>(0xC0 | (c >> 6));
+                    _buffer[_used++] = static_cast<uint8_t>(0x80 | (c & 0x3F));
+                    continue;
+                }
+
+                if (c >= 0xD800 && c <= 0xDFFF) {
+                    const uint32_t low = string[1];
+
+                    // Lone surrogates cannot be encoded.
+                    if (c >= 0xDC00 || low < 0xDC00 || low > 0xDFFF) {
+                        _buffer[_used++] = '?';
+                        continue;
+                    }
+
+                    c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                    ++string;
+
+                    _buffer[_used++] = static_cast<uint8_t>(0xF0 | (c >> 18));
+                    _buffer[_used++] = static_cast<uint8_t>(0x80 | ((c >> 12) & 0x3F));
+                } else {
+                    _buffer[_used++] = static_cast<uint8_t>(0xE0 | (c >> 12));
+                }
+
+                _buffer[_used++] = static_cast<uint8_t>(0x80 | ((c >> 6) & 0x3F));
+                _buffer[_used++] = static_cast<uint8_t>(0x80 | (c & 0x3F));
+            }
+
+            if (_flushOnNewLine && saw_line_feed)
+                return flush();
+
+            return status;
+        }
+
+        /// Sends the ANSI "select graphic rendition" sequence for a console color.
+        Status _writeColor(TextColor color) {
+            // UEFI colors are in (blue, green, red) bit order, ANSI ones in (red, green, blue).
+            constexpr uint8_t ansi_colors[8] = {0, 4, 2, 6, 1, 5, 3, 7};
+
+            const auto foreground = static_cast<uint8_t>(color.foreground);
+            const auto background = static_cast<uint8_t>(color.background) & 0x7;
+
+            const uint8_t foreground_code = (foreground >= 8 ? 90 : 30) + ansi_colors[foreground & 0x7];
+            const uint8_t background_code = 40 + ansi_colors[background];
+
+            char sequence[] = {'\x1b', '[', 0, 0, ';', 0, 0, 'm'};
+            sequence[2] = static_cast<char>('0' + foreground_code / 10);
+            sequence[3] = static_cast<char>('0' + foreground_code % 10);
+            sequence[5] = static_cast<char>('0' + background_code / 10);
+            sequence[6] = static_cast<char>('0' + background_code % 10);
+
+            return write(sequence, sizeof(sequence));
+        }
+
+        static SerialConsole& _self(SimpleTextOutputProtocol* protocol) {
+            return *static_cast<SerialConsole*>(protocol);
+        }
+
+        static Status _resetThunk(SimpleTextOutputProtocol* protocol, bool) {
+            auto& self = _self(protocol);
+            self._modeData.attribute = default_color.getValue();
+            const auto status = self._writeColor(default_color);
+            if (status != Status::Success)
+                return status;
+            return self._clearScreenThunk(protocol);
+        }
+
+        static Status _outputStringThunk(SimpleTextOutputProtocol* protocol, const char16_t* string) {
+            return _self(protocol)._writeUcs2(string);
+        }
+
+        static Status _testStringThunk(SimpleTextOutputProtocol*, const char16_t*) {
+            // Anything can be encoded as UTF-8, it's up to the terminal to display it.
+            return Status::Success;
+        }
+
+        static Status _queryModeThunk(SimpleTextOutputProtocol*, size_t mode_number, size_t& mode_columns, size_t& mode_rows) {
+            if (mode_number != 0)
+                return Status::Unsupported;
+
+            mode_columns = columns;
+            mode_rows = rows;
+            return Status::Success;
+        }
+
+        static Status _setModeThunk(SimpleTextOutputProtocol* protocol, size_t mode_number) {
+            if (mode_number != 0)
+                return Status::Unsupported;
+
+            return _clearScreenThunk(protocol);
+        }
+
+        static Status _setAttributeThunk(SimpleTextOutputProtocol* protocol, Attribute attribute) {
+            auto& self = _self(protocol);
+            self._modeData.attribute = attribute.getValue();
+            return self._writeColor(attribute);
+        }
+
+        static Status _clearScreenThunk(SimpleTextOutputProtocol* protocol) {
+            // Erase the display and move the cursor to the top left corner.
+            constexpr char sequence[] = "\x1b[2J\x1b[H";
+            auto& self = _self(protocol);
+            self._modeData.cursor_column = 0;
+            self._modeData.cursor_row = 0;
+            return self.write(sequence, sizeof(sequence) - 1);
+        }
+
+        static Status _setCursorPositionThunk(SimpleTextOutputProtocol* protocol, size_t column, size_t row) {
+            if (column >= columns || row >= rows)
+                return Status::Unsupported;
+
+            auto& self = _self(protocol);
+            self._modeData.cursor_column = static_cast<int32_t>(column);
+            self._modeData.cursor_row = static_cast<int32_t>(row);
+
+            // ANSI positions start at 1: "ESC [ row ; column H".
+            char sequence[] = {'\x1b', '[', 0, 0, ';', 0, 0, 'H'};
+            sequence[2] = static_cast<char>('0' + (row + 1) / 10);
+            sequence[3] = static_cast<char>('0' + (row + 1) % 10);
+            sequence[5] = static_cast<char>('0' + (column + 1) / 10);
+            sequence[6] = static_cast<char>('0' + (column + 1) % 10);
+
+            return self.write(sequence, sizeof(sequence));
+        }
+
+        static Status _enableCursorThunk(SimpleTextOutputProtocol* protocol, bool visible) {
+            auto& self = _self(protocol);
+            self._modeData.cursor_visible = visible;
+            return self.write(visible ? "\x1b[?25h" : "\x1b[?25l", 6);
+        }
+
+        Port _port;
+        Mode _modeData;
+        size_t _used;
+        bool _flushOnNewLine;
+        uint8_t _buffer[buffer_size];
+    };
+} // namespace Uefi
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "detail/bit_flags.h"
+#include "guid.h"
+#include "non_copyable.h"
+#include "status.h"
+
+namespace Uefi {
+    /// Used to communicate with any type of character-based I/O device (usually a UART).
+    class SerialIoProtocol : private NonCopyable {
+    public:
+        static constexpr Guid guid = {0xbb25cf6f, 0xf1d4, 0x11d2, {0x9a, 0x0c, 0x00, 0x90, 0x27, 0x3f, 0xc1, 0xfd}};
+
+        enum class Parity : uint32_t {
+            Default,
+            None,
+            Even,
+            Odd,
+            Mark,
+            Space
+        };
+
+        enum class StopBits : uint32_t {
+            Default,
+            One,
+            OneAndHalf,
+            Two
+        };
+
+        enum class Control : uint32_t {
+            DataTerminalReady = 0x1,
+            RequestToSend = 0x2,
+            ClearToSend = 0x10,
+            DataSetReady = 0x20,
+            RingIndicate = 0x40,
+            CarrierDetect = 0x80,
+            InputBufferEmpty = 0x100,
+            OutputBufferEmpty = 0x200,
+            HardwareLoopbackEnable = 0x1000,
+            SoftwareLoopbackEnable = 0x2000,
+            HardwareFlowControlEnable = 0x4000
+        };
+
+        /// The current attributes of the device.
+        struct Mode {
+            /// Which Control bits getControl() is able to report.
+            Control control_mask;
+            /// In microseconds.
+            uint32_t timeout;
+            uint64_t baud_rate;
+            uint32_t receive_fifo_depth;
+            uint32_t data_bits;
+            Parity parity;
+            StopBits stop_bits;
+        };
+
+        uint32_t revision;
+
+        /// Resets the serial device.
+        /// @return Success The serial device was reset.
+        /// @return DeviceError The serial device could not be reset.
+        Status reset() {
+            return _reset(this);
+        }
+
+        /// Sets the baud rate, receive FIFO depth, transmit/receive time out, parity, data bits, and stop bits.
+        /// A value of 0 selects the device's default for every numeric parameter.
+        /// @return Success The new attributes were set on the serial device.
+        /// @return InvalidParameter One or more of the attributes has an unsupported value.
+        /// @return DeviceError The serial device is not functioning correctly.
+        Status setAttributes(uint64_t baud_rate, uint32_t receive_fifo_depth, uint32_t timeout, Parity parity, uint8_t data_bits, StopBits stop_bits) {
+            return _setAttributes(this, baud_rate, receive_fifo_depth, timeout, parity, data_bits, stop_bits);
+        }
+
+        Status setControl(Control control) {
+            return _setControl(this, control);
+        }
+
+        Status getControl(Control& control) {
+            return _getControl(this, control);
+        }
+
+        /// Writes data to the serial device.
+        /// @param[in,out] buffer_size On input, the number of bytes to write. On output, the number of bytes actually written.
+        /// @return Success The data was written.
+        /// @return DeviceError The device reported an error.
+        /// @return Timeout The data write was stopped due to a timeout.
+        Status write(size_t& buffer_size, const void* buffer) {
+            return _write(this, buffer_size, buffer);
+        }
+
+        /// Reads data from the serial device.
+        /// @param[in,out] buffer_size On input, the size of the buffer. On output, the number of bytes actually read.
+        /// @return Success The data was read.
+        /// @return DeviceError The device reported an error.
+        /// @return Timeout The operation was stopped due to a timeout or overrun.
+        Status read(size_t& buffer_size, void* buffer) {
+            return _read(this, buffer_size, buffer);
+        }
+
+    private:
+        Status (*_reset)(SerialIoProtocol*);
+        Status (*_setAttributes)(SerialIoProtocol*, uint64_t, uint32_t, uint32_t, Parity, uint8_t, StopBits);
+        Status (*_setControl)(SerialIoProtocol*, Control);
+        Status (*_getControl)(SerialIoProtocol*, Control&);
+        Status (*_write)(SerialIoProtocol*, size_t&, const void*);
+        Status (*_read)(SerialIoProtocol*, size_t&, void*);
+
+    public:
+        Mode* mode;
+    };
+
+    UEFI_BIT_FLAGS(SerialIoProtocol::Control);
+} // namespace Uefi
@@ -0,0 +1,444 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "detail/cpu_features.h"
+#include "detail/memory.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace Uefi {
+    namespace Detail {
+        // See FIPS 180-4: https://nvlpubs.nist.gov/nistpubs/FIPS/NIST.FIPS.180-4.pdf
+
+        alignas(16) inline constexpr uint32_t sha256_round_constants[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+        inline constexpr uint64_t sha512_round_constants[80] = {
+            0x428a2f98d728ae22, 0x7137449123ef65cd, 0xb5c0fbcfec4d3b2f, 0xe9b5dba58189dbbc, 0x3956c25bf348b538,
+            0x59f111f1b605d019, 0x923f82a4af194f9b, 0xab1c5ed5da6d8118, 0xd807aa98a3030242, 0x12835b0145706fbe,
+            0x243185be4ee4b28c, 0x550c7dc3d5ffb4e2, 0x72be5d74f27b896f, 0x80deb1fe3b1696b1, 0x9bdc06a725c71235,
+            0xc19bf174cf692694, 0xe49b69c19ef14ad2, 0xefbe4786384f25e3, 0x0fc19dc68b8cd5b5, 0x240ca1cc77ac9c65,
+            0x2de92c6f592b0275, 0x4a7484aa6ea6e483, 0x5cb0a9dcbd41fbd4, 0x76f988da831153b5, 0x983e5152ee66dfab,
+            0xa831c66d2db43210, 0xb00327c898fb213f, 0xbf597fc7beef0ee4, 0xc6e00bf33da88fc2, 0xd5a79147930aa725,
+            0x06ca6351e003826f, 0x142929670a0e6e70, 0x27b70a8546d22ffc, 0x2e1b21385c26c926, 0x4d2c6dfc5ac42aed,
+            0x53380d139d95b3df, 0x650a73548baf63de, 0x766a0abb3c77b2a8, 0x81c2c92e47edaee6, 0x92722c851482353b,
+            0xa2bfe8a14cf10364, 0xa81a664bbc423001, 0xc24b8b70d0f89791, 0xc76c51a30654be30, 0xd192e819d6ef5218,
+            0xd69906245565a910, 0xf40e35855771202a, 0x106aa07032bbd1b8, 0x19a4c116b8d2d0c8, 0x1e376c085141ab53,
+            0x2748774cdf8eeb99, 0x34b0bcb5e19b48a8, 0x391c0cb3c5c95a63, 0x4ed8aa4ae3418acb, 0x5b9cca4f7763e373,
+            0x682e6ff3d6b2b8a3, 0x748f82ee5defb2fc, 0x78a5636f43172f60, 0x84c87814a1f0ab72, 0x8cc702081a6439ec,
+            0x90befffa23631e28, 0xa4506cebde82bde9, 0xbef9a3f7b2c67915, 0xc67178f2e372532b, 0xca273eceea26619c,
+            0xd186b8c721c0c207, 0xeada7dd6cde0eb1e, 0xf57d4f7fee6ed178, 0x06f067aa72176fba, 0x0a637dc5a2c898a6,
+            0x113f9804bef90dae, 0x1b710b35131c471b, 0x28db77f523047d84, 0x32caab7b40c72493, 0x3c9ebe0a15c9bebc,
+            0x431d67c49c100d4c, 0x4cc5d4becb3e42b6, 0x597f299cfc657e2a, 0x5fcb6fab3ad6faec, 0x6c44198c4a475817};
+
+        // UEFI only runs on little-endian CPUs, so converting from and to big-endian is always a byte swap.
+
+        inline uint32_t loadBigEndian32(const uint8_t* bytes) noexcept {
+            uint32_t value;
+            copyBytes(&value, bytes, sizeof(value));
+            return __builtin_bswap32(value);
+        }
+
+        inline uint64_t loadBigEndian64(const uint8_t* bytes) noexcept {
+            uint64_t value;
+            copyBytes(&value, bytes, sizeof(value));
+            return __builtin_bswap64(value);
+        }
+
+        inline void storeBigEndian(uint8_t* bytes, uint32_t value) noexcept {
+            value = __builtin_bswap32(value);
+            copyBytes(bytes, &value, sizeof(value));
+        }
+
+        inline void storeBigEndian(uint8_t* bytes, uint64_t value) noexcept {
+            value = __builtin_bswap64(value);
+            copyBytes(bytes, &value, sizeof(value));
+        }
+
+        template <typename Word>
+        constexpr Word rotateRight(Word value, int bits) noexcept {
+            return (value >> bits) | (value << ((sizeof(Word) * 8) - bits));
+        }
+
+        inline void sha256BlocksPortable(uint32_t (&state)[8], const uint8_t* data, size_t block_count) noexcept {
+            for (; block_count != 0; --block_count, data += 64) {
+                uint32_t w[64];
+
+                for (size_t i = 0; i < 16; ++i)
+                    w[i] = loadBigEndian32(data + (i * 4));
+
+                for (size_t i = 16; i < 64; ++i) {
+                    const auto s0 = rotateRight(w[i - 15], 7) ^ rotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                    const auto s1 = rotateRight(w[i - 2], 17) ^ rotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+                }
+
+                auto a = state[0], b = state[1], c = state[2], d = state[3];
+                auto e = state[4], f = state[5], g = state[6], h = state[7];
+
+                for (size_t i = 0; i < 64; ++i) {
+                    const auto t1 = h + (rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25)) + ((e & f) ^ (~e & g)) +
+                                    sha256_round_constants[i] + w[i];
+                    const auto t2 = (rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                    h = g;
+                    g = f;
+                    f = e;
+                    e = d + t1;
+                    d = c;
+                    c = b;
+                    b = a;
+                    a = t1 + t2;
+                }
+
+                state[0] += a;
+                state[1] += b;
+                state[2] += c;
+                state[3] += d;
+                state[4] += e;
+                state[5] += f;
+                state[6] += g;
+                state[7] += h;
+            }
+        }
+
+        inline void sha512BlocksPortable(uint64_t (&state)[8], const uint8_t* data, size_t block_count) noexcept {
+            for (; block_count != 0; --block_count, data += 128) {
+                uint64_t w[80];
+
+                for (size_t i = 0; i < 16; ++i)
+                    w[i] = loadBigEndian64(data + (i * 8));
+
+                for (size_t i = 16; i < 80; ++i) {
+                    const auto s0 = rotateRight(w[i - 15], 1) ^ rotateRight(w[i - 15], 8) ^ (w[i - 15] >> 7);
+                    const auto s1 = rotateRight(w[i - 2], 19) ^ rotateRight(w[i - 2], 61) ^ (w[i - 2] >> 6);
+                    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+                }
+
+                auto a = state[0], b = state[1], c = state[2], d = state[3];
+                auto e = state[4], f = state[5], g = state[6], h = state[7];
+
+                for (size_t i = 0; i < 80; ++i) {
+                    const auto t1 = h + (rotateRight(e, 14) ^ rotateRight(e, 18) ^ rotateRight(e, 41)) + ((e & f) ^ (~e & g)) +
+                                    sha512_round_constants[i] + w[i];
+                    const auto t2 = (rotateRight(a, 28) ^ rotateRight(a, 34) ^ rotateRight(a, 39)) + ((a & b) ^ (a & c) ^ (b & c));
+                    h = g;
+                    g = f;
+                    f = e;
+                    e = d + t1;
+                    d = c;
+                    c = b;
+                    b = a;
+                    a = t1 + t2;
+                }
+
+                state[0] += a;
+                state[1] += b;
+                state[2] += c;
+                state[3] += d;
+                state[4] += e;
+                state[5] += f;
+                state[6] += g;
+                state[7] += h;
+            }
+        }
+
+#if defined(__x86_64__) || defined(__i386__)
+        // The SHA-NI instructions keep the state as two vectors, ABEF and CDGH, and do two rounds per sha256rnds2.
+        // See https://www.intel.com/content/www/us/en/developer/articles/technical/intel-sha-extensions.html
+        __attribute__((target("sha,sse4.1,ssse3"))) inline void
+        sha256BlocksShaNi(uint32_t (&state)[8], const uint8_t* data, size_t block_count) noexcept {
+            const auto byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0b, 0x0405060700010203);
+
+            const auto dcba = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0])), 0xB1);
+            const auto efgh = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4])), 0x1B);
+            auto abef = _mm_alignr_epi8(dcba, efgh, 8);
+            auto cdgh = _mm_blend_epi16(efgh, dcba, 0xF0);
+
+            for (; block_count != 0; --block_count, data += 64) {
+                const auto saved_abef = abef;
+                const auto saved_cdgh = cdgh;
+
+                // The message schedule only needs the last 16 words, in 4 vectors used as a ring.
+                __m128i w[4];
+                for (size_t i = 0; i < 4; ++i)
+                    w[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + (i * 16))), byte_swap);
+
+                // Each group of 4 rounds also finishes the words of the next group and starts those of the group
+                // after next, so the schedule never waits on the rounds.
+#pragma GCC unroll 16
+                for (size_t i = 0; i < 16; ++i) {
+                    const auto message = _mm_add_epi32(
+                        w[i & 3], _mm_load_si128(reinterpret_cast<const __m128i*>(&sha256_round_constants[i * 4])));
+                    cdgh = _mm_sha256rnds2_epu32(cdgh, abef, message);
+
+                    if (i >= 3 && i < 15) {
+                        const auto w7 = _mm_alignr_epi8(w[i & 3], w[(i + 3) & 3], 4);
+                        w[(i + 1) & 3] = _mm_sha256msg2_epu32(_mm_add_epi32(w[(i + 1) & 3], w7), w[i & 3]);
+                    }
+
+                    abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(message, 0x0E));
+
+                    if (i >= 1 && i < 13)
+                        w[(i + 3) & 3] = _mm_sha256msg1_epu32(w[(i + 3) & 3], w[i & 3]);
+                }
+
+                abef = _mm_add_epi32(abef, saved_abef);
+                cdgh = _mm_add_epi32(cdgh, saved_cdgh);
+            }
+
+            const auto feba = _mm_shuffle_epi32(abef, 0x1B);
+            const auto dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), _mm_blend_epi16(feba, dchg, 0xF0));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), _mm_alignr_epi8(dchg, feba, 8));
+        }
+#elif defined(__aarch64__)
+#if defined(__clang__)
+        __attribute__((target("sha2")))
+#else
+        __attribute__((target("+crypto")))
+#endif
+        inline void sha256BlocksArmv8(uint32_t (&state)[8], const uint8_t* data, size_t block_count) noexcept {
+            auto abcd = vld1q_u32(&state[0]);
+            auto efgh = vld1q_u32(&state[4]);
+
+            for (; block_count != 0; --block_count, data += 64) {
+                const auto saved_abcd = abcd;
+                const auto saved_efgh = efgh;
+
+                // The message schedule only needs the last 16 words, in 4 vectors used as a ring.
+                uint32x4_t w[4];
+                for (size_t i = 0; i < 4; ++i)
+                    w[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + (i * 16))));
+
+#pragma GCC unroll 16
+                for (size_t i = 0; i < 16; ++i) {
+                    if (i >= 4)
+                        w[i & 3] = vsha256su1q_u32(vsha256su0q_u32(w[i & 3], w[(i + 1) & 3]), w[(i + 2) & 3], w[(i + 3) & 3]);
+
+                    const auto message = vaddq_u32(w[i & 3], vld1q_u32(&sha256_round_constants[i * 4]));
+                    const auto previous_abcd = abcd;
+                    abcd = vsha256hq_u32(abcd, efgh, message);
+                    efgh = vsha256h2q_u32(efgh, previous_abcd, message);
+                }
+
+                abcd = vaddq_u32(abcd, saved_abcd);
+                efgh = vaddq_u32(efgh, saved_efgh);
+            }
+
+            vst1q_u32(&state[0], abcd);
+            vst1q_u32(&state[4], efgh);
+        }
+#endif
+
+        /// The Merkle–Damgård construction shared by the SHA-2 functions: buffers the input into blocks, and pads the
+        /// last one with the message length.
+        template <typename Word>
+        class Sha2Engine {
+        public:
+            static constexpr size_t block_size = 16 * sizeof(Word);
+
+            using BlockFunction = void (*)(Word (&state)[8], const uint8_t* data, size_t block_count);
+
+            void initialize(const Word (&initial_state)[8], BlockFunction process_blocks) noexcept {
+                copyBytes(_state, initial_state, sizeof(_state));
+                _processBlocks = process_blocks;
+                _bufferSize = 0;
+                _totalSize = 0;
+            }
+
+            void update(const void* data, size_t size) noexcept {
+                const auto* bytes = static_cast<const uint8_t*>(data);
+                _totalSize += size;
+
+                // Completes the block started by the previous call.
+                if (_bufferSize != 0) {
+                    const auto count = size < block_size - _bufferSize ? size : block_size - _bufferSize;
+                    copyBytes(_buffer + _bufferSize, bytes, count);
+                    _bufferSize += count;
+                    bytes += count;
+                    size -= count;
+
+                    if (_bufferSize < block_size)
+                        return;
+
+                    _processBlocks(_state, _buffer, 1);
+                    _bufferSize = 0;
+                }
+
+                // Whole blocks are hashed straight from the caller's buffer.
+                if (size >= block_size) {
+                    _processBlocks(_state, bytes, size / block_size);
+                    bytes += size - (size % block_size);
+                    size %= block_size;
+                }
+
+                copyBytes(_buffer, bytes, size);
+                _bufferSize = size;
+            }
+
+            /// Writes the first `digest_size` bytes of the hash. The engine must be initialized again afterwards.
+            void finish(uint8_t* digest, size_t digest_size) noexcept {
+                // The message length is stored in bits, in the last 8 bytes for SHA-256 and the last 16 for SHA-512.
+                constexpr size_t length_size = 2 * sizeof(Word);
+
+                _buffer[_bufferSize++] = 0x80;
+
+                if (_bufferSize > block_size - length_size) {
+                    setBytes(_buffer + _bufferSize, 0, block_size - _bufferSize);
+                    _processBlocks(_state, _buffer, 1);
+                    _bufferSize = 0;
+                }
+
+                setBytes(_buffer + _bufferSize, 0, block_size - _bufferSize - 8);
+                storeBigEndian(_buffer + block_size - 8, _totalSize * 8);
+                _processBlocks(_state, _buffer, 1);
+
+                for (size_t i = 0; i < digest_size / sizeof(Word); ++i)
+                    storeBigEndian(digest + (i * sizeof(Word)), _state[i]);
+            }
+
+        private:
+            Word _state[8];
+            BlockFunction _processBlocks;
+            uint8_t _buffer[block_size];
+            size_t _bufferSize;
+            uint64_t _totalSize;
+        };
+    } // namespace Detail
+
+    /// Streaming SHA-256. It uses the SHA instructions of the CPU when it has them: SHA-NI on x86, the SHA2 crypto
+    /// extension on AArch64.
+    /// @code
+    /// Sha256 hash;
+    /// hash.initialize();
+    /// hash.update(data, size);
+    /// Sha256::Digest digest;
+    /// hash.finish(digest);
+    /// @endcode
+    class Sha256 {
+    public:
+        static constexpr size_t digest_size = 32;
+
+        struct Digest {
+            uint8_t bytes[digest_size];
+
+            [[nodiscard]] bool operator==(const Digest& other) const noexcept {
+                return __builtin_memcmp(bytes, other.bytes, digest_size) == 0;
+            }
+
+            [[nodiscard]] bool operator!=(const Digest& other) const noexcept {
+                return !(*this == other);
+            }
+        };
+
+        /// @param use_cpu_extensions Can be false to compare against the portable implementation.
+        void initialize(bool use_cpu_extensions = true) noexcept {
+            constexpr uint32_t initial_state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                                   0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+            _engine.initialize(initial_state, use_cpu_extensions ? _getAcceleratedBlocks() : &Detail::sha256BlocksPortable);
+        }
+
+        void update(const void* data, size_t size) noexcept {
+            _engine.update(data, size);
+        }
+
+        /// The hash must be initialized again afterwards.
+        void finish(Digest& digest) noexcept {
+            _engine.finish(digest.bytes, digest_size);
+        }
+
+        /// Hashes a whole buffer at once.
+        static void calculate(const void* data, size_t size, Digest& digest) noexcept {
+            Sha256 hash;
+            hash.initialize();
+            hash.update(data, size);
+            hash.finish(digest);
+        }
+
+        /// Whether the CPU's SHA instructions are used when available.
+        [[nodiscard]] static bool isAccelerated() noexcept {
+            return _getAcceleratedBlocks() != &Detail::sha256BlocksPortable;
+        }
+
+    private:
+        using Engine = Detail::Sha2Engine<uint32_t>;
+
+        // The CPU is only queried once. Racing initializations store the same pointer, so no lock is needed.
+        static Engine::BlockFunction _getAcceleratedBlocks() noexcept {
+            static Engine::BlockFunction selected = nullptr;
+
+            if (selected == nullptr) {
+#if defined(__x86_64__) || defined(__i386__)
+                selected = Detail::hasSha256Instructions() ? &Detail::sha256BlocksShaNi : &Detail::sha256BlocksPortable;
+#elif defined(__aarch64__)
+                selected = Detail::hasSha256Instructions() ? &Detail::sha256BlocksArmv8 : &Detail::sha256BlocksPortable;
+#else
+                selected = &Detail::sha256BlocksPortable;
+#endif
+            }
+
+            return selected;
+        }
+
+        Engine _engine;
+    };
+
+    /// Streaming SHA-384, the SHA-512 function truncated to 48 bytes, as used by TPM 2.0 PCR banks.
+    /// It is always computed with 64-bit scalar code.
+    class Sha384 {
+    public:
+        static constexpr size_t digest_size = 48;
+
+        struct Digest {
+            uint8_t bytes[digest_size];
+
+            [[nodiscard]] bool operator==(const Digest& other) const noexcept {
+                return __builtin_memcmp(bytes, other.bytes, digest_size) == 0;
+            }
+
+            [[nodiscard]] bool operator!=(const Digest& other) const noexcept {
+                return !(*this == other);
+            }
+        };
+
+        void initialize() noexcept {
+            constexpr uint64_t initial_state[8] = {0xcbbb9d5dc1059ed8, 0x629a292a367cd507, 0x9159015a3070dd17,
+                                                   0x152fecd8f70e5939, 0x67332667ffc00b31, 0x8eb44a8768581511,
+                                                   0xdb0c2e0d64f98fa7, 0x47b5481dbefa4fa4};
+            _engine.initialize(initial_state, &Detail::sha512BlocksPortable);
+        }
+
+        void update(const void* data, size_t size) noexcept {
+            _engine.update(data, size);
+        }
+
+        /// The hash must be initialized again afterwards.
+        void finish(Digest& digest) noexcept {
+            _engine.finish(digest.bytes, digest_size);
+        }
+
+        /// Hashes a whole buffer at once.
+        static void calculate(const void* data, size_t size, Digest& digest) noexcept {
+            Sha384 hash;
+            hash.initialize();
+            hash.update(data, size);
+            hash.finish(digest);
+        }
+
+    private:
+        Detail::Sha2Engine<uint64_t> _engine;
+    };
+} // namespace Uefi
@@ -14,10 +14,17 @@ namespace Uefi {
         uint64_t revision;
 
         Status openVolume(FileProtocol*& root) {
-            return _openVolume(root);
+            return _openVolume(this, root);
+        }
+
+        /// Opens the root directory of the volume, and returns its handle.
+        Result<FileProtocol*> openVolume() {
+            FileProtocol* root = nullptr;
+            const auto status = _openVolume(this, root);
+            return {status, root};
         }
 
     private:
-        Status _openVolume(FileProtocol*);
+        Status (*_openVolume)(SimpleFileSystemProtocol*, FileProtocol*&);
     };
 } // namespace Uefi
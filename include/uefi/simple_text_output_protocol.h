@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 
 #include "guid.h"
 #include "non_copyable.h"
@@ -21,6 +22,23 @@ namespace Uefi {
 
             // This should only be 3 bits wide, but we need to ensure the compiler sets the extra bit to 0.
             BackgroundColor background : 4;
+
+            /// The attribute as the firmware encodes it, e.g. in Mode: the foreground in the low 4 bits.
+            [[nodiscard]] constexpr uint8_t getValue() const noexcept {
+                return static_cast<uint8_t>(static_cast<uint8_t>(foreground) | (static_cast<uint8_t>(background) << 4));
+            }
+        };
+
+        /// The current state of the console, kept up to date by the device.
+        struct Mode {
+            /// Number of modes supported by queryMode() and setMode().
+            int32_t max_mode;
+            int32_t mode;
+            /// The current Attribute, as its byte value.
+            int32_t attribute;
+            int32_t cursor_column;
+            int32_t cursor_row;
+            bool cursor_visible;
         };
 
         /// Resets the text output device hardware.
@@ -30,7 +48,7 @@ namespace Uefi {
         /// @return Success The text output device was reset.
         /// @return DeviceError The text output device is not functioning correctly and could not be reset.
         Status reset(bool extended_verification) {
-            return _reset(extended_verification);
+            return _reset(this, extended_verification);
         }
 
         /// Writes a string to the output device.
@@ -40,16 +58,16 @@ namespace Uefi {
         /// @return Unsupported The output device’s mode is not currently in a defined text mode.
         /// @return WarnUnknownGlyph This warning code indicates that some of the characters in the string could not be rendered and were skipped.
         Status outputString(const char16_t* string) {
-            return _outputString(string);
+            return _outputString(this, string);
         }
 
         // TODO: document these functions
         Status testString(const char16_t* string) {
-            return _testString(string);
+            return _testString(this, string);
         }
 
         Status queryMode(size_t mode_number, size_t& columns, size_t& rows) {
-            return _queryMode(mode_number, columns, rows);
+            return _queryMode(this, mode_number, columns, rows);
         }
 
         /// Sets the output device to a specified mode.
@@ -59,7 +77,7 @@ namespace Uefi {
         /// @return DeviceError The device had an error and could not complete the request.
         /// @return Unsupported The mode number was not valid.
         Status setMode(size_t mode_number) {
-            return _setMode(mode_number);
+            return _setMode(this, mode_number);
         }
 
         /// Sets the background and foreground colors for the output_string() and clear_screen() functions.
@@ -67,7 +85,7 @@ namespace Uefi {
         /// @return Success The requested attributes were set.
         /// @return DeviceError The device had an error and could not complete the request.
         Status setAttribute(Attribute attribute) {
-            return _setAttribute(attribute);
+            return _setAttribute(this, attribute);
         }
 
         /// Clears the output device display to the currently selected background color.
@@ -75,17 +93,44 @@ namespace Uefi {
         /// @return DeviceError The device had an error and could not complete the request.
         /// @return Unsupported The output device is not in a valid text mode.
         Status clearScreen() {
-            return _clearScreen();
+            return _clearScreen(this);
+        }
+
+        /// Moves the cursor, where the next outputString() starts. (0, 0) is the top left corner.
+        /// @return Success The operation completed successfully.
+        /// @return DeviceError The device had an error and could not complete the request.
+        /// @return Unsupported The output device is not in a valid text mode, or the position is outside of the screen.
+        Status setCursorPosition(size_t column, size_t row) {
+            return _setCursorPosition(this, column, row);
         }
 
-    private:
+        /// Shows or hides the cursor.
+        /// @return Success The operation completed successfully.
+        /// @return DeviceError The device had an error and could not complete the request.
+        /// @return Unsupported The output device does not support showing a cursor.
+        Status enableCursor(bool visible) {
+            return _enableCursor(this, visible);
+        }
+
+        /// The current mode, attribute and cursor position.
+        [[nodiscard]] const Mode& getMode() const {
+            return *_mode;
+        }
+
+    protected:
         // Function pointers.
-        Status _reset(bool);
-        Status _outputString(const char16_t*);
-        Status _testString(const char16_t*);
-        Status _queryMode(size_t, size_t&, size_t&);
-        Status _setMode(size_t);
-        Status _setAttribute(Attribute);
-        Status _clearScreen();
+        // These are protected so that software consoles (e.g. FramebufferConsole) can provide their own implementation
+        // and still be passed anywhere a SimpleTextOutputProtocol is expected.
+        Status (*_reset)(SimpleTextOutputProtocol*, bool);
+        Status (*_outputString)(SimpleTextOutputProtocol*, const char16_t*);
+        Status (*_testString)(SimpleTextOutputProtocol*, const char16_t*);
+        Status (*_queryMode)(SimpleTextOutputProtocol*, size_t, size_t&, size_t&);
+        Status (*_setMode)(SimpleTextOutputProtocol*, size_t);
+        Status (*_setAttribute)(SimpleTextOutputProtocol*, Attribute);
+        Status (*_clearScreen)(SimpleTextOutputProtocol*);
+        Status (*_setCursorPosition)(SimpleTextOutputProtocol*, size_t, size_t);
+        Status (*_enableCursor)(SimpleTextOutputProtocol*, bool);
+
+        Mode* _mode;
     };
 } // namespace Uefi
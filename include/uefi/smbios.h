@@ -0,0 +1,506 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "detail/checksum.h"
+#include "detail/memory.h"
+#include "status.h"
+
+namespace Uefi {
+    // The SMBIOS entry points and structure table.
+    // See https://www.dmtf.org/sites/default/files/standards/documents/DSP0134_3.7.0.pdf
+    // Like the ACPI tables, the structures are packed and read in place.
+
+    /// The 32-bit entry point, installed as smbios_guid.
+    struct [[gnu::packed]] SmbiosEntryPoint {
+        /// "_SM_".
+        static constexpr uint32_t expected_anchor = 0x5f4d535f;
+
+        uint32_t anchor;
+        /// Covers `length` bytes.
+        uint8_t checksum;
+        uint8_t length;
+        uint8_t major_version;
+        uint8_t minor_version;
+        uint16_t max_structure_size;
+        uint8_t entry_point_revision;
+        uint8_t formatted_area[5];
+        /// "_DMI_".
+        uint8_t intermediate_anchor[5];
+        /// Covers the 15 bytes from intermediate_anchor.
+        uint8_t intermediate_checksum;
+        uint16_t table_length;
+        uint32_t table_address;
+        uint16_t structure_count;
+        uint8_t bcd_revision;
+    };
+
+    static_assert(sizeof(SmbiosEntryPoint) == 31);
+
+    /// The 64-bit entry point of SMBIOS 3, installed as smbios3_guid.
+    struct [[gnu::packed]] Smbios3EntryPoint {
+        /// "_SM3_", without its last character.
+        static constexpr uint32_t expected_anchor = 0x334d535f;
+
+        uint32_t anchor;
+        uint8_t anchor_end;
+        uint8_t checksum;
+        uint8_t length;
+        uint8_t major_version;
+        uint8_t minor_version;
+        uint8_t docrev;
+        uint8_t entry_point_revision;
+        uint8_t reserved;
+        /// An upper bound: the table ends with the first structure of type end_of_table.
+        uint32_t table_max_size;
+        uint64_t table_address;
+    };
+
+    static_assert(sizeof(Smbios3EntryPoint) == 24);
+
+    /// The header of a structure. The formatted area is followed by the structure's strings, each null-terminated,
+    /// and by an extra null character.
+    struct [[gnu::packed]] SmbiosStructure {
+        static constexpr uint8_t end_of_table = 127;
+
+        uint8_t type;
+        /// Size of the formatted area, header included. Newer versions of the specification add fields at the end.
+        uint8_t length;
+        uint16_t handle;
+
+        /// The structure as one of the structures deriving from SmbiosStructure.
+        /// @return nullptr The structure has another type, or is older than T and misses some of its fields.
+        template <typename T>
+        [[nodiscard]] const T* as() const noexcept {
+            if (type != T::structure_type || length < sizeof(T))
+                return nullptr;
+
+            return static_cast<const T*>(this);
+        }
+
+        /// Reads a string in place. Strings are numbered from 1, 0 meaning that there is none.
+        /// Only valid on structures found through an SmbiosTable, which checked that their strings are terminated.
+        /// @return nullptr The string is 0 or missing.
+        [[nodiscard]] const char* getString(uint8_t number) const noexcept {
+            if (number == 0)
+                return nullptr;
+
+            const auto* string = reinterpret_cast<const char*>(this) + length;
+
+            // An empty string set is just the two null characters.
+            if (*string == 0)
+                return nullptr;
+
+            for (; number > 1; --number) {
+                while (*string != 0)
+                    ++string;
+
+                if (*++string == 0)
+                    return nullptr;
+            }
+
+            return string;
+        }
+    };
+
+    /// Processor Information (type 4), up to the fields of SMBIOS 2.6.
+    struct [[gnu::packed]] SmbiosProcessor : SmbiosStructure {
+        static constexpr uint8_t structure_type = 4;
+
+        uint8_t socket_designation;
+        uint8_t processor_type;
+        uint8_t processor_family;
+        uint8_t processor_manufacturer;
+        /// The CPUID signature and feature flags on x86, MIDR_EL1 on AArch64.
+        uint64_t processor_id;
+        uint8_t processor_version;
+        uint8_t voltage;
+        /// In MHz.
+        uint16_t external_clock;
+        uint16_t max_speed;
+        uint16_t current_speed;
+        uint8_t status;
+        uint8_t processor_upgrade;
+        uint16_t l1_cache_handle;
+        uint16_t l2_cache_handle;
+        uint16_t l3_cache_handle;
+        uint8_t serial_number;
+        uint8_t asset_tag;
+        uint8_t part_number;
+        /// 0xFF if there are more: the 16-bit counts of SMBIOS 3.0 follow.
+        uint8_t core_count;
+        uint8_t core_enabled;
+        uint8_t thread_count;
+        uint16_t processor_characteristics;
+        uint16_t processor_family2;
+
+        /// Whether the socket holds a processor.
+        [[nodiscard]] bool isPopulated() const noexcept {
+            return (status & 0x40) != 0;
+        }
+    };
+
+    static_assert(sizeof(SmbiosProcessor) == 0x2A);
+
+    /// Memory Device (type 17): a DIMM slot. Up to the fields of SMBIOS 2.8.
+    struct [[gnu::packed]] SmbiosMemoryDevice : SmbiosStructure {
+        static constexpr uint8_t structure_type = 17;
+
+        uint16_t physical_memory_array_handle;
+        uint16_t memory_error_information_handle;
+        uint16_t total_width;
+        uint16_t data_width;
+        /// 0 for an empty slot. See getSize().
+        uint16_t size;
+        uint8_t form_factor;
+        uint8_t device_set;
+        uint8_t device_locator;
+        uint8_t bank_locator;
+        uint8_t memory_type;
+        uint16_t type_detail;
+        /// In MT/s.
+        uint16_t speed;
+        uint8_t manufacturer;
+        uint8_t serial_number;
+        uint8_t asset_tag;
+        uint8_t part_number;
+        uint8_t attributes;
+        uint32_t extended_size;
+        uint16_t configured_memory_speed;
+        uint16_t minimum_voltage;
+        uint16_t maximum_voltage;
+        uint16_t configured_voltage;
+
+        /// The size of the module in bytes, 0 if the slot is empty or the size unknown.
+        [[nodiscard]] uint64_t getSize() const noexcept {
+            if (size == 0xFFFF)
+                return 0;
+
+            // Sizes of 32 GiB and more do not fit in the 15 bits of `size`.
+            if (size == 0x7FFF)
+                return static_cast<uint64_t>(extended_size & 0x7FFFFFFF) << 20;
+
+            // The top bit selects KiB instead of MiB.
+            return static_cast<uint64_t>(size & 0x7FFF) << ((size & 0x8000) != 0 ? 10 : 20);
+        }
+    };
+
+    static_assert(sizeof(SmbiosMemoryDevice) == 0x28);
+
+    /// The structures of one type, in table order.
+    class SmbiosStructures {
+    public:
+        class Iterator {
+        public:
+            Iterator(const uint8_t* table, const uint32_t* offset) noexcept : _table(table), _offset(offset) {}
+
+            const SmbiosStructure& operator*() const noexcept {
+                return *reinterpret_cast<const SmbiosStructure*>(_table + *_offset);
+            }
+
+            Iterator& operator++() noexcept {
+                ++_offset;
+                return *this;
+            }
+
+            bool operator!=(const Iterator& other) const noexcept {
+                return _offset != other._offset;
+            }
+
+        private:
+            const uint8_t* _table;
+            const uint32_t* _offset;
+        };
+
+        SmbiosStructures(const uint8_t* table, const uint32_t* begin, const uint32_t* end) noexcept
+            : _table(table), _begin(begin), _end(end) {}
+
+        [[nodiscard]] Iterator begin() const noexcept {
+            return {_table, _begin};
+        }
+
+        [[nodiscard]] Iterator end() const noexcept {
+            return {_table, _end};
+        }
+
+        [[nodiscard]] size_t getSize() const noexcept {
+            return static_cast<size_t>(_end - _begin);
+        }
+
+    private:
+        const uint8_t* _table;
+        const uint32_t* _begin;
+        const uint32_t* _end;
+    };
+
+    /// An index of the SMBIOS structure table, built with a single walk over it: finding the structures of a type or
+    /// the structure with a handle then takes constant time. The structures are not copied.
+    /// @code
+    /// const auto* entry_point = system_table.findConfigurationTable(smbios3_guid);
+    /// auto memory = boot_services.allocatePool(MemoryType::LoaderData, SmbiosTable::getIndexSize(entry_point));
+    /// smbios.initialize(entry_point, *memory, SmbiosTable::getIndexSize(entry_point));
+    /// for (const auto& structure : smbios.getStructures(SmbiosMemoryDevice::structure_type))
+    ///     if (const auto* dimm = structure.as<SmbiosMemoryDevice>())
+    ///         total += dimm->getSize();
+    /// @endcode
+    class SmbiosTable {
+    public:
+        /// Bytes of memory initialize() needs for the index of this entry point. This walks the table once to count
+        /// its structures; the firmware's own bound is often several times too large.
+        /// @return 0 The entry point is not valid.
+        static size_t getIndexSize(const void* entry_point) noexcept {
+            const uint8_t* table;
+            size_t table_size, max_count, count = 0;
+            uint8_t major, minor;
+
+            if (!_readEntryPoint(entry_point, table, table_size, max_count, major, minor))
+                return 0;
+
+            for (size_t offset = 0; count < max_count; ++count) {
+                const auto next = _getNextOffset(table, table_size, offset);
+                if (next == 0)
+                    break;
+
+                if (table[offset] == SmbiosStructure::end_of_table) {
+                    ++count;
+                    break;
+                }
+
+                offset = next;
+            }
+
+            return _getIndexSize(count);
+        }
+
+        /// Validates the entry point, either 32-bit or 64-bit, and indexes its table.
+        /// A truncated structure ends the table: the structures before it are indexed.
+        /// @param memory Usually getIndexSize() bytes, aligned to 4 bytes.
+        /// @return CrcError The entry point has a wrong anchor or checksum.
+        /// @return BufferTooSmall There are more structures than `size` bytes can index. The first ones are indexed.
+        Status initialize(const void* entry_point, void* memory, size_t size) noexcept {
+            size_t max_count;
+
+            _count = 0;
+            if (!_readEntryPoint(entry_point, _table, _tableSize, max_count, _majorVersion, _minorVersion))
+                return Status::CrcError;
+
+            // Split the memory between the three arrays, for as many structures as possible.
+            size_t capacity = 0, slot_count = 16;
+            for (auto slots = slot_count; (type_count + 1 + slots) * sizeof(uint32_t) <= size; slots *= 2) {
+                const auto fitting = ((size / sizeof(uint32_t)) - type_count - 1 - slots) / 2;
+                const auto usable = fitting < slots / 2 ? fitting : slots / 2;
+                if (usable > capacity) {
+                    capacity = usable;
+                    slot_count = slots;
+                }
+            }
+
+            if (capacity == 0)
+                return Status::BufferTooSmall;
+
+            _handleMask = static_cast<uint32_t>(slot_count - 1);
+            _typeStart = static_cast<uint32_t*>(memory);
+            _byType = _typeStart + type_count + 1;
+            auto* order = _byType + capacity;
+            _handleSlots = order + capacity;
+
+            for (size_t i = 0; i <= type_count; ++i)
+                _typeStart[i] = 0;
+
+            for (size_t i = 0; i <= _handleMask; ++i)
+                _handleSlots[i] = none;
+
+            // Record every structure in table order, count them by type and hash their handle.
+            auto status = Status::Success;
+            for (size_t offset = 0; _count < max_count;) {
+                const auto next = _getNextOffset(_table, _tableSize, offset);
+                if (next == 0)
+                    break;
+
+                if (_count == capacity) {
+                    status = Status::BufferTooSmall;
+                    break;
+                }
+
+                const auto& structure = _getStructure(static_cast<uint32_t>(offset));
+                order[_count++] = static_cast<uint32_t>(offset);
+                ++_typeStart[structure.type + 1];
+                _insertHandle(structure.handle, static_cast<uint32_t>(offset));
+
+                if (structure.type == SmbiosStructure::end_of_table)
+                    break;
+
+                offset = next;
+            }
+
+            // Then sort them by type, keeping the table order within a type.
+            for (size_t type = 0; type < type_count; ++type)
+                _typeStart[type + 1] += _typeStart[type];
+
+            uint32_t next_slot[type_count];
+            for (size_t type = 0; type < type_count; ++type)
+                next_slot[type] = _typeStart[type];
+
+            for (size_t i = 0; i < _count; ++i)
+                _byType[next_slot[_getStructure(order[i]).type]++] = order[i];
+
+            return status;
+        }
+
+        /// The version of the specification the firmware follows, e.g. 3 and 4 for SMBIOS 3.4.
+        /// @{
+        [[nodiscard]] uint8_t getMajorVersion() const noexcept {
+            return _majorVersion;
+        }
+
+        [[nodiscard]] uint8_t getMinorVersion() const noexcept {
+            return _minorVersion;
+        }
+        /// @}
+
+        [[nodiscard]] size_t getStructureCount() const noexcept {
+            return _count;
+        }
+
+        [[nodiscard]] SmbiosStructures getStructures(uint8_t type) const noexcept {
+            return {_table, _byType + _typeStart[type], _byType + _typeStart[type + 1]};
+        }
+
+        /// @param instance Which one of the structures of this type, in table order.
+        /// @return nullptr There is no such structure.
+        [[nodiscard]] const SmbiosStructure* find(uint8_t type, size_t instance = 0) const noexcept {
+            if (instance >= _typeStart[type + 1] - _typeStart[type])
+                return nullptr;
+
+            return &_getStructure(_byType[_typeStart[type] + instance]);
+        }
+
+        /// Finds a structure by the structure_type of T, e.g. SmbiosProcessor.
+        /// @return nullptr There is no such structure, or it is older than T.
+        template <typename T>
+        [[nodiscard]] const T* find(size_t instance = 0) const noexcept {
+            const SmbiosStructure* structure = find(T::structure_type, instance);
+            return structure != nullptr ? structure->as<T>() : nullptr;
+        }
+
+        /// Finds the structure another one refers to, like the caches of an SmbiosProcessor.
+        /// @return nullptr There is no structure with this handle.
+        [[nodiscard]] const SmbiosStructure* findByHandle(uint16_t handle) const noexcept {
+            for (auto slot = handle & _handleMask;; slot = (slot + 1) & _handleMask) {
+                const auto offset = _handleSlots[slot];
+                if (offset == none)
+                    return nullptr;
+
+                const auto& structure = _getStructure(offset);
+                if (structure.handle == handle)
+                    return &structure;
+            }
+        }
+
+    private:
+        static constexpr size_t type_count = 256;
+        static constexpr uint32_t none = ~uint32_t{0};
+
+        /// The smallest structure: a header without strings, followed by the two null characters.
+        static constexpr size_t min_structure_size = sizeof(SmbiosStructure) + 2;
+
+        static bool _readEntryPoint(const void* entry_point, const uint8_t*& table, size_t& table_size, size_t& max_count,
+                                    uint8_t& major, uint8_t& minor) noexcept {
+            if (entry_point == nullptr)
+                return false;
+
+            uint32_t anchor;
+            Detail::copyBytes(&anchor, entry_point, sizeof(anchor));
+
+            if (anchor == Smbios3EntryPoint::expected_anchor) {
+                const auto& point = *static_cast<const Smbios3EntryPoint*>(entry_point);
+                if (point.anchor_end != '_' || point.length < sizeof(Smbios3EntryPoint) ||
+                    Detail::sumBytes(&point, point.length) != 0)
+                    return false;
+
+                table = reinterpret_cast<const uint8_t*>(static_cast<uintptr_t>(point.table_address));
+                table_size = point.table_max_size;
+                max_count = table_size / min_structure_size;
+                major = point.major_version;
+                minor = point.minor_version;
+                return true;
+            }
+
+            if (anchor == SmbiosEntryPoint::expected_anchor) {
+                const auto& point = *static_cast<const SmbiosEntryPoint*>(entry_point);
+                if (point.length < sizeof(SmbiosEntryPoint) || Detail::sumBytes(&point, point.length) != 0 ||
+                    Detail::sumBytes(point.intermediate_anchor, 15) != 0)
+                    return false;
+
+                table = reinterpret_cast<const uint8_t*>(static_cast<uintptr_t>(point.table_address));
+                table_size = point.table_length;
+                max_count = point.structure_count;
+                major = point.major_version;
+                minor = point.minor_version;
+                return true;
+            }
+
+            return false;
+        }
+
+        /// The counts by type, the structures sorted by type and in table order, and the handle hash table: a power
+        /// of two number of slots, with at least half of them free.
+        static size_t _getIndexSize(size_t count) noexcept {
+            size_t slot_count = 16;
+            while (slot_count < 2 * count)
+                slot_count *= 2;
+
+            return (type_count + 1 + (2 * count) + slot_count) * sizeof(uint32_t);
+        }
+
+        [[nodiscard]] const SmbiosStructure& _getStructure(uint32_t offset) const noexcept {
+            return *reinterpret_cast<const SmbiosStructure*>(_table + offset);
+        }
+
+        /// Checks the structure at `offset`, its strings included.
+        /// @return The offset of the next structure, or 0 if this one is truncated.
+        static size_t _getNextOffset(const uint8_t* table, size_t table_size, size_t offset) noexcept {
+            if (table_size - offset < min_structure_size)
+                return 0;
+
+            const auto length = table[offset + 1];
+            if (length < sizeof(SmbiosStructure) || length > table_size - offset - 2)
+                return 0;
+
+            // The strings end with two null characters.
+            for (auto position = offset + length; position + 1 < table_size; ++position) {
+                if (table[position] == 0 && table[position + 1] == 0)
+                    return position + 2;
+            }
+
+            return 0;
+        }
+
+        void _insertHandle(uint16_t handle, uint32_t offset) noexcept {
+            auto slot = handle & _handleMask;
+
+            // A duplicate handle is a firmware bug: the first structure wins.
+            while (_handleSlots[slot] != none) {
+                if (_getStructure(_handleSlots[slot]).handle == handle)
+                    return;
+
+                slot = (slot + 1) & _handleMask;
+            }
+
+            _handleSlots[slot] = offset;
+        }
+
+        const uint8_t* _table;
+        size_t _tableSize;
+        uint8_t _majorVersion, _minorVersion;
+
+        size_t _count;
+        /// The structures of type t are _byType[_typeStart[t]] to _byType[_typeStart[t + 1]] excluded.
+        uint32_t* _typeStart;
+        uint32_t* _byType;
+        /// Open addressing with linear probing. Handles are usually numbered sequentially, so they rarely collide.
+        uint32_t* _handleSlots;
+        uint32_t _handleMask;
+    };
+} // namespace Uefi
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+
+namespace Uefi {
+    /// A view of a contiguous array, which it does not own.
+    template <typename T>
+    class Span {
+    public:
+        constexpr Span() noexcept = default;
+
+        constexpr Span(T* data, size_t size) noexcept : _data(data), _size(size) {}
+
+        [[nodiscard]] constexpr T* getData() const noexcept {
+            return _data;
+        }
+
+        [[nodiscard]] constexpr size_t getSize() const noexcept {
+            return _size;
+        }
+
+        [[nodiscard]] constexpr bool isEmpty() const noexcept {
+            return _size == 0;
+        }
+
+        constexpr T& operator[](size_t i) const noexcept {
+            return _data[i];
+        }
+
+        constexpr T* begin() const noexcept {
+            return _data;
+        }
+
+        constexpr T* end() const noexcept {
+            return _data + _size;
+        }
+
+    private:
+        T* _data = nullptr;
+        size_t _size = 0;
+    };
+} // namespace Uefi
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "detail/memory.h"
+#include "ucs2.h"
+
+namespace Uefi {
+    /// A UCS-2 string of up to `capacity` characters, stored inline and always null-terminated, so that it can be
+    /// passed straight to the firmware (outputString(), open(), getVariable()...).
+    /// Appending past the capacity truncates the string and reports it, instead of throwing.
+    /// Since static constructors require runtime support, it has none: call clear() before using it, unless it is a
+    /// global, which starts zeroed.
+    /// @code
+    /// StaticString<64> path;
+    /// path.clear();
+    /// path.append(u"\\EFI\\");
+    /// path.append(vendor);
+    /// root->open(path.getData(), OpenMode::Read);
+    /// @endcode
+    template <size_t capacity>
+    class StaticString {
+    public:
+        void clear() noexcept {
+            _length = 0;
+            _characters[0] = 0;
+        }
+
+        /// @return false The string was cut at the capacity.
+        bool append(char16_t character) noexcept {
+            if (_length == capacity)
+                return false;
+
+            _characters[_length++] = character;
+            _characters[_length] = 0;
+            return true;
+        }
+
+        /// @return false The string was cut at the capacity.
+        bool append(const char16_t* string) noexcept {
+            return append(string, getStringLength(string));
+        }
+
+        /// Appends `length` characters, which need not be null-terminated.
+        /// @return false The string was cut at the capacity.
+        bool append(const char16_t* string, size_t length) noexcept {
+            const auto room = capacity - _length;
+            const auto count = length < room ? length : room;
+
+            Detail::copyBytes(_characters + _length, string, count * sizeof(char16_t));
+            _length += count;
+            _characters[_length] = 0;
+            return count == length;
+        }
+
+        /// Appends ASCII text, widening each character.
+        /// @return false The string was cut at the capacity.
+        bool append(const char* string) noexcept {
+            for (; *string != 0; ++string) {
+                if (!append(static_cast<char16_t>(static_cast<uint8_t>(*string))))
+                    return false;
+            }
+
+            return true;
+        }
+
+        /// Cuts the string to `length` characters, if it is longer.
+        void truncate(size_t length) noexcept {
+            if (length < _length) {
+                _length = length;
+                _characters[_length] = 0;
+            }
+        }
+
+        /// The null-terminated string.
+        [[nodiscard]] const char16_t* getData() const noexcept {
+            return _characters;
+        }
+
+        [[nodiscard]] size_t getLength() const noexcept {
+            return _length;
+        }
+
+        [[nodiscard]] static constexpr size_t getCapacity() noexcept {
+            return capacity;
+        }
+
+        [[nodiscard]] bool isEmpty() const noexcept {
+            return _length == 0;
+        }
+
+        char16_t operator[](size_t i) const noexcept {
+            return _characters[i];
+        }
+
+        bool operator==(const char16_t* string) const noexcept {
+            for (size_t i = 0; i < _length; ++i) {
+                if (_characters[i] != string[i])
+                    return false;
+            }
+
+            return string[_length] == 0;
+        }
+
+        bool operator!=(const char16_t* string) const noexcept {
+            return !(*this == string);
+        }
+
+    private:
+        size_t _length;
+        char16_t _characters[capacity + 1];
+    };
+} // namespace Uefi
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+
+#include "span.h"
+
+namespace Uefi {
+    /// An array of up to `capacity` elements, stored inline: no allocation, and the elements are contiguous with the
+    /// size, so small lists stay in one or two cache lines.
+    /// Adding to a full vector fails instead of throwing. The elements must be trivial types, like every structure the
+    /// firmware deals with, so that nothing has to be constructed or destroyed.
+    /// Since static constructors require runtime support, it has none: call clear() before using it, unless it is a
+    /// global, which starts zeroed.
+    template <typename T, size_t capacity>
+    class StaticVector {
+        static_assert(std::is_trivial_v<T>, "The elements are never constructed or destroyed, only copied.");
+
+    public:
+        void clear() noexcept {
+            _size = 0;
+        }
+
+        /// @return false The vector is full.
+        bool pushBack(const T& value) noexcept {
+            if (_size == capacity)
+                return false;
+
+            _items[_size++] = value;
+            return true;
+        }
+
+        /// Removes the last element. The vector must not be empty.
+        void popBack() noexcept {
+            --_size;
+        }
+
+        /// Removes an element by moving the last one in its place, without shifting the others.
+        void swapRemove(size_t index) noexcept {
+            _items[index] = _items[--_size];
+        }
+
+        /// Changes the number of elements. New elements are left uninitialized.
+        /// @return false `size` is larger than the capacity.
+        bool resize(size_t size) noexcept {
+            if (size > capacity)
+                return false;
+
+            _size = size;
+            return true;
+        }
+
+        [[nodiscard]] constexpr size_t getSize() const noexcept {
+            return _size;
+        }
+
+        [[nodiscard]] static constexpr size_t getCapacity() noexcept {
+            return capacity;
+        }
+
+        [[nodiscard]] constexpr bool isEmpty() const noexcept {
+            return _size == 0;
+        }
+
+        [[nodiscard]] constexpr bool isFull() const noexcept {
+            return _size == capacity;
+        }
+
+        [[nodiscard]] T* getData() noexcept {
+            return _items;
+        }
+
+        [[nodiscard]] const T* getData() const noexcept {
+            return _items;
+        }
+
+        T& operator[](size_t i) noexcept {
+            return _items[i];
+        }
+
+        const T& operator[](size_t i) const noexcept {
+            return _items[i];
+        }
+
+        T& getBack() noexcept {
+            return _items[_size - 1];
+        }
+
+        T* begin() noexcept {
+            return _items;
+        }
+
+        T* end() noexcept {
+            return _items + _size;
+        }
+
+        const T* begin() const noexcept {
+            return _items;
+        }
+
+        const T* end() const noexcept {
+            return _items + _size;
+        }
+
+        operator Span<T>() noexcept {
+            return {_items, _size};
+        }
+
+        operator Span<const T>() const noexcept {
+            return {_items, _size};
+        }
+
+    private:
+        size_t _size;
+        T _items[capacity];
+    };
+} // namespace Uefi
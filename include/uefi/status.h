@@ -14,6 +14,10 @@ namespace Uefi {
     enum class Status : uint64_t {
         /// The operation completed successfully.
         Success = 0,
+
+        /// The string contained one or more characters that the device could not render and were skipped.
+        WarnUnknownGlyph = 1,
+
         /// The image failed to load.
         LoadError = makeErrorCode(1),
         /// A parameter was incorrect.
@@ -25,10 +29,36 @@ namespace Uefi {
         /// The buffer is not large enough to hold the requested data.
         /// The required buffer size is returned in the appropriate parameter when this error occurs.
         BufferTooSmall = makeErrorCode(5),
+        /// There is no data pending upon return.
+        NotReady = makeErrorCode(6),
+        /// The physical device reported an error while attempting the operation.
+        DeviceError = makeErrorCode(7),
+        /// The device cannot be written to.
+        WriteProtected = makeErrorCode(8),
+        /// A resource has run out.
+        OutOfResources = makeErrorCode(9),
+        /// An inconsistency was detected on the file system or partition table.
+        VolumeCorrupted = makeErrorCode(10),
+        /// There is no more space on the file system.
+        VolumeFull = makeErrorCode(11),
+        /// The device does not contain any medium to perform the operation.
+        NoMedia = makeErrorCode(12),
+        /// The medium in the device has changed since the last access.
+        MediaChanged = makeErrorCode(13),
         /// The item was not found.
         NotFound = makeErrorCode(14),
+        /// Access was denied.
+        AccessDenied = makeErrorCode(15),
+        /// The timeout time expired.
+        Timeout = makeErrorCode(18),
+        /// The protocol has not been started.
+        NotStarted = makeErrorCode(19),
+        /// The protocol has already been started.
+        AlreadyStarted = makeErrorCode(20),
         /// The function was not performed due to a security violation.
         SecurityViolation = makeErrorCode(26),
+        /// A CRC error was detected.
+        CrcError = makeErrorCode(27),
     };
 
     /// Error codes have the high-order bit set.
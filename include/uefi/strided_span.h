@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace Uefi {
+    /// A view of an array whose elements are `stride` bytes apart, which it does not own.
+    /// The firmware returns such arrays when its descriptors may grow in later versions of the specification, like
+    /// the memory map: the element type only declares the fields known today, and the stride skips the rest.
+    template <typename T>
+    class StridedSpan {
+        using Byte = std::conditional_t<std::is_const_v<T>, const uint8_t, uint8_t>;
+
+    public:
+        class Iterator {
+        public:
+            constexpr Iterator(Byte* position, size_t stride) noexcept : _position(position), _stride(stride) {}
+
+            T& operator*() const noexcept {
+                return *reinterpret_cast<T*>(_position);
+            }
+
+            T* operator->() const noexcept {
+                return reinterpret_cast<T*>(_position);
+            }
+
+            Iterator& operator++() noexcept {
+                _position += _stride;
+                return *this;
+            }
+
+            constexpr bool operator!=(const Iterator& other) const noexcept {
+                return _position != other._position;
+            }
+
+        private:
+            Byte* _position;
+            size_t _stride;
+        };
+
+        constexpr StridedSpan() noexcept = default;
+
+        constexpr StridedSpan(T* data, size_t size, size_t stride) noexcept
+            : _data(reinterpret_cast<Byte*>(data)), _size(size), _stride(stride) {}
+
+        [[nodiscard]] constexpr size_t getSize() const noexcept {
+            return _size;
+        }
+
+        [[nodiscard]] constexpr size_t getStride() const noexcept {
+            return _stride;
+        }
+
+        [[nodiscard]] constexpr bool isEmpty() const noexcept {
+            return _size == 0;
+        }
+
+        T& operator[](size_t i) const noexcept {
+            return *reinterpret_cast<T*>(_data + (i * _stride));
+        }
+
+        [[nodiscard]] Iterator begin() const noexcept {
+            return {_data, _stride};
+        }
+
+        [[nodiscard]] Iterator end() const noexcept {
+            return {_data + (_size * _stride), _stride};
+        }
+
+    private:
+        Byte* _data = nullptr;
+        size_t _size = 0;
+        size_t _stride = sizeof(T);
+    };
+} // namespace Uefi
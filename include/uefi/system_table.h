@@ -39,5 +39,16 @@ namespace Uefi {
 
         size_t table_entry_count;
         ConfigurationTable* configuration_table;
+
+        /// Finds a table installed by the firmware, e.g. with acpi2_guid or smbios3_guid.
+        /// @return nullptr There is no table with this GUID.
+        [[nodiscard]] void* findConfigurationTable(const Guid& guid) const noexcept {
+            for (size_t i = 0; i < table_entry_count; ++i) {
+                if (configuration_table[i].guid == guid)
+                    return configuration_table[i].table;
+            }
+
+            return nullptr;
+        }
     };
 } // namespace Uefi
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "console_color.h"
+#include "format.h"
 #include "simple_text_output_protocol.h"
 #include <utility>
 
@@ -42,6 +43,26 @@ namespace Uefi {
             base = b;
         }
 
+        /// Prints the arguments according to a format string checked at compile time.
+        /// Unlike operator<<(), this doesn't depend on (or change) the stream's number base.
+        /// @code
+        /// output.print(UEFI_FORMAT("{} descriptors, key {:#x}\r\n"), count, key);
+        /// @endcode
+        template <typename Format, typename... Args>
+        TextOutputStream& print(Format format, const Args&... args) {
+            Uefi::print(*output, format, args...);
+            return *this;
+        }
+
+#if __cplusplus >= 202002L
+        /// C++20 form of print(): `output.print<"{} descriptors, key {:#x}\r\n">(count, key)`.
+        template <Detail::FixedString format, typename... Args>
+        TextOutputStream& print(const Args&... args) {
+            Uefi::print<format>(*output, args...);
+            return *this;
+        }
+#endif
+
         TextOutputStream& operator<<(const char16_t* msg) {
             this->output->outputString(msg);
             return *this;
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "console_color.h"
+#include "simple_text_output_protocol.h"
+#include "status.h"
+#include "text_output_stream.h"
+
+namespace Uefi {
+    /// A double-buffered text screen: drawing goes to a grid of cells in memory, and present() only sends the cells
+    /// which changed since the previous present() to the console.
+    /// @code
+    /// screen.initialize(*system_table.console_out, memory, TextScreen::getRequiredSize(80, 25));
+    /// screen.write(2, selected, u"> Boot from disk", highlight_color);
+    /// screen.present();
+    /// @endcode
+    /// Consecutive changed cells with the same color are sent as one setCursorPosition() and one outputString(), and
+    /// short stretches of unchanged cells between them are sent again rather than starting a new run. On a serial
+    /// console, moving a menu's selection then costs a few hundred bytes instead of a full screen.
+    /// Anything else written to the console overwrites cells behind the screen's back: call invalidate() afterwards.
+    class TextScreen {
+    public:
+        /// Unchanged cells sent again to join two runs: about the size of the escape sequence which moves the cursor
+        /// on a serial terminal, without the firmware calls.
+        static constexpr size_t max_gap = 8;
+
+        /// Bytes of memory needed for a screen of this size.
+        static constexpr size_t getRequiredSize(size_t columns, size_t rows) noexcept {
+            return (2 * columns * rows * sizeof(uint32_t)) + ((columns + 1) * sizeof(char16_t));
+        }
+
+        /// Takes the size of the console's current mode, clears it and hides the cursor.
+        /// @param memory At least getRequiredSize() bytes, aligned to 4 bytes.
+        /// @return BufferTooSmall `size` is smaller than getRequiredSize() for the console's mode.
+        Status initialize(SimpleTextOutputProtocol& output, void* memory, size_t size) noexcept {
+            _output = &output;
+
+            auto status = output.queryMode(static_cast<size_t>(output.getMode().mode), _columns, _rows);
+            if (status != Status::Success)
+                return status;
+
+            if (size < getRequiredSize(_columns, _rows))
+                return Status::BufferTooSmall;
+
+            _back = static_cast<uint32_t*>(memory);
+            _front = _back + (_columns * _rows);
+            _line = reinterpret_cast<char16_t*>(_front + (_columns * _rows));
+
+            // Not every console can hide its cursor, which is only cosmetic.
+            static_cast<void>(output.enableCursor(false));
+
+            status = output.setAttribute(default_color);
+            if (status != Status::Success)
+                return status;
+
+            status = output.clearScreen();
+            if (status != Status::Success)
+                return status;
+
+            clear();
+            for (size_t i = 0; i < _columns * _rows; ++i)
+                _front[i] = _back[i];
+
+            return Status::Success;
+        }
+
+        [[nodiscard]] size_t getColumns() const noexcept {
+            return _columns;
+        }
+
+        [[nodiscard]] size_t getRows() const noexcept {
+            return _rows;
+        }
+
+        /// Fills the whole screen with spaces.
+        void clear(TextColor color = default_color) noexcept {
+            fill(0, 0, _columns, _rows, u' ', color);
+        }
+
+        /// Sets one cell. Control characters are drawn as spaces, and cells outside of the screen are ignored.
+        void put(size_t column, size_t row, char16_t character, TextColor color) noexcept {
+            if (column < _columns && row < _rows)
+                _back[(row * _columns) + column] = _makeCell(character, color);
+        }
+
+        /// Writes a null-terminated string on one row, cut at the right edge of the screen.
+        /// @return The column after the last character.
+        size_t write(size_t column, size_t row, const char16_t* text, TextColor color) noexcept {
+            if (row >= _rows)
+                return column;
+
+            auto* cells = _back + (row * _columns);
+            for (; *text != 0 && column < _columns; ++text, ++column)
+                cells[column] = _makeCell(*text, color);
+
+            return column;
+        }
+
+        /// Fills a rectangle, cut at the edges of the screen.
+        void fill(size_t column, size_t row, size_t width, size_t height, char16_t character, TextColor color) noexcept {
+            if (column >= _columns || row >= _rows)
+                return;
+
+            const auto end_column = width < _columns - column ? column + width : _columns;
+            const auto end_row = height < _rows - row ? row + height : _rows;
+            const auto cell = _makeCell(character, color);
+
+            for (; row < end_row; ++row) {
+                auto* cells = _back + (row * _columns);
+                for (auto i = column; i < end_column; ++i)
+                    cells[i] = cell;
+            }
+        }
+
+        /// Makes the next present() send every cell, e.g. after something else wrote to the console.
+        void invalidate() noexcept {
+            for (size_t i = 0; i < _columns * _rows; ++i)
+                _front[i] = unknown_cell;
+        }
+
+        /// Sends the cells which changed since the last present() to the console.
+        /// The bottom right cell is never sent: writing it makes most firmware consoles scroll.
+        /// @return The first error of the console. The cells which were not sent are sent by the next present().
+        Status present() noexcept {
+            // Someone else may have moved the cursor or changed the color since the last present().
+            _cursorColumn = unknown_position;
+            _attribute = unknown_cell;
+
+            for (size_t row = 0; row < _rows; ++row) {
+                const auto* back = _back + (row * _columns);
+                const auto* front = _front + (row * _columns);
+                const auto end = row + 1 == _rows ? _columns - 1 : _columns;
+
+                for (size_t column = 0; column < end;) {
+                    if (back[column] == front[column]) {
+                        ++column;
+                        continue;
+                    }
+
+                    // Extend the run over cells of the same color, up to the last changed one.
+                    const auto attribute = back[column] >> 16;
+                    auto run_end = column + 1;
+
+                    for (auto i = run_end; i < end && (back[i] >> 16) == attribute; ++i) {
+                        if (back[i] != front[i])
+                            run_end = i + 1;
+                        else if (i - run_end >= max_gap)
+                            break;
+                    }
+
+                    const auto status = _send(row, column, run_end);
+                    if (isErrorCode(status))
+                        return status;
+
+                    column = run_end;
+                }
+            }
+
+            return Status::Success;
+        }
+
+    private:
+        /// Never equal to a cell from _makeCell(), whose attribute is below 0x80.
+        static constexpr uint32_t unknown_cell = ~uint32_t{0};
+        static constexpr size_t unknown_position = ~size_t{0};
+
+        /// The character in the low 16 bits, the attribute above: comparing cells is a single comparison.
+        static uint32_t _makeCell(char16_t character, TextColor color) noexcept {
+            if (character < u' ')
+                character = u' ';
+
+            return static_cast<uint32_t>(character) | (static_cast<uint32_t>(color.getValue() & 0x7F) << 16);
+        }
+
+        /// Sends the cells [begin, end) of a row, which all have the same attribute.
+        Status _send(size_t row, size_t begin, size_t end) noexcept {
+            const auto* back = _back + (row * _columns);
+            const auto attribute = back[begin] >> 16;
+
+            if (attribute != _attribute) {
+                const TextColor color = {static_cast<ForegroundColor>(attribute & 0xF),
+                                         static_cast<BackgroundColor>(attribute >> 4)};
+
+                const auto status = _output->setAttribute(color);
+                if (status != Status::Success)
+                    return status;
+
+                _attribute = attribute;
+            }
+
+            if (begin != _cursorColumn || row != _cursorRow) {
+                const auto status = _output->setCursorPosition(begin, row);
+                if (status != Status::Success)
+                    return status;
+            }
+
+            for (auto i = begin; i < end; ++i)
+                _line[i - begin] = static_cast<char16_t>(back[i]);
+            _line[end - begin] = 0;
+
+            const auto status = _output->outputString(_line);
+            if (isErrorCode(status)) {
+                _cursorColumn = unknown_position;
+                return status;
+            }
+
+            auto* front = _front + (row * _columns);
+            for (auto i = begin; i < end; ++i)
+                front[i] = back[i];
+
+            // At the right edge, where the cursor goes depends on the console.
+            _cursorColumn = end < _columns ? end : unknown_position;
+            _cursorRow = row;
+            return status;
+        }
+
+        SimpleTextOutputProtocol* _output;
+        size_t _columns, _rows;
+
+        /// What the next present() shows, and what the console shows.
+        uint32_t* _back;
+        uint32_t* _front;
+
+        /// A run of characters, null-terminated for outputString().
+        char16_t* _line;
+
+        size_t _cursorColumn, _cursorRow;
+        uint32_t _attribute;
+    };
+} // namespace Uefi
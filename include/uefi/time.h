@@ -13,12 +13,14 @@ namespace Uefi {
         uint32_t nanosecond{};
         int16_t timezone = 0x7ff;
 
-        uint8_t _pad{};
+        /// Bit 0: the time is affected by daylight saving time. Bit 1: daylight saving time is in effect.
+        uint8_t daylight{};
 
-        uint8_t adjust_daylight{};
-        uint8_t in_daylight{};
+        uint8_t _pad{};
     };
 
+    static_assert(sizeof(Time) == 16);
+
     struct TimeCapabilities {
         uint32_t resolution;
         uint32_t accuracy;
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "acpi.h"
+#include "span.h"
+#include "status.h"
+
+namespace Uefi {
+    /// An enabled processor, from the MADT.
+    struct ProcessorInfo {
+        /// The APIC or x2APIC ID on x86, the affinity fields of MPIDR_EL1 on AArch64.
+        uint64_t hardware_id;
+        uint32_t acpi_processor_uid;
+        /// The proximity domain, 0 without an SRAT.
+        uint32_t domain;
+    };
+
+    /// A summary of the processors and NUMA domains, to decide how many workers to start and where to put their
+    /// memory. It is built from the MADT, the SRAT and the SLIT, which are read in place.
+    /// @code
+    /// ProcessorInfo processors[256];
+    /// SystemTopology topology;
+    /// topology.initialize(tables, {processors, 256});
+    /// for (const auto& domain : topology.getDomains())
+    ///     startWorkers(domain.id, domain.processor_count);
+    /// @endcode
+    class SystemTopology {
+    public:
+        struct Domain {
+            uint32_t id;
+            uint32_t processor_count;
+            /// Enabled memory, hot-pluggable ranges excluded.
+            uint64_t memory_size;
+        };
+
+        struct MemoryRange {
+            uint64_t base;
+            uint64_t size;
+            uint32_t domain;
+        };
+
+        static constexpr size_t max_domain_count = 64;
+        static constexpr size_t max_memory_range_count = 128;
+
+        /// Returned by findMemoryDomain() for addresses outside of any range.
+        static constexpr uint32_t no_domain = ~uint32_t{0};
+
+        /// @param processors Receives the enabled processors, in MADT order.
+        /// @return NotFound There is no MADT.
+        /// @return BufferTooSmall There are more processors than `processors` holds. The summary only covers the
+        /// processors which fit.
+        /// @return OutOfResources There are more domains or memory ranges than the summary holds. The first ones are kept.
+        Status initialize(const AcpiTables& tables, Span<ProcessorInfo> processors) noexcept {
+            _processors = processors.getData();
+            _processorCount = 0;
+            _storedCount = 0;
+            _domainCount = 0;
+            _rangeCount = 0;
+            _slit = tables.find<AcpiSlit>();
+            _hasAffinity = false;
+
+            const auto* madt = tables.find<AcpiMadt>();
+            if (madt == nullptr)
+                return Status::NotFound;
+
+            for (const auto& entry : madt->getEntries()) {
+                if (const auto* apic = entry.as<MadtLocalApic>()) {
+                    if (apic->isEnabled())
+                        _addProcessor(apic->apic_id, apic->acpi_processor_uid, processors.getSize());
+                } else if (const auto* x2apic = entry.as<MadtLocalX2Apic>()) {
+                    if (x2apic->isEnabled())
+                        _addProcessor(x2apic->x2apic_id, x2apic->acpi_processor_uid, processors.getSize());
+                } else if (const auto* gicc = entry.as<MadtGicc>()) {
+                    if (gicc->isEnabled())
+                        _addProcessor(gicc->mpidr, gicc->acpi_processor_uid, processors.getSize());
+                }
+            }
+
+            auto status = Status::Success;
+            if (const auto* srat = tables.find<AcpiSrat>()) {
+                _hasAffinity = true;
+                status = _readAffinity(*srat);
+            }
+
+            for (size_t i = 0; i < _storedCount; ++i) {
+                auto* domain = _getDomain(_processors[i].domain);
+                if (domain == nullptr)
+                    status = Status::OutOfResources;
+                else
+                    ++domain->processor_count;
+            }
+
+            if (_storedCount < _processorCount)
+                return Status::BufferTooSmall;
+
+            return status;
+        }
+
+        /// Number of enabled processors, including those which did not fit in the array.
+        [[nodiscard]] size_t getProcessorCount() const noexcept {
+            return _processorCount;
+        }
+
+        [[nodiscard]] Span<const ProcessorInfo> getProcessors() const noexcept {
+            return {_processors, _storedCount};
+        }
+
+        /// The domains with processors or memory, in the order they were found. A single domain 0 without an SRAT.
+        [[nodiscard]] Span<const Domain> getDomains() const noexcept {
+            return {_domains, _domainCount};
+        }
+
+        [[nodiscard]] Span<const MemoryRange> getMemoryRanges() const noexcept {
+            return {_ranges, _rangeCount};
+        }
+
+        /// Whether the firmware describes NUMA domains with an SRAT.
+        [[nodiscard]] bool hasAffinity() const noexcept {
+            return _hasAffinity;
+        }
+
+        /// The domain of the memory at `address`.
+        /// @return no_domain The address is not in an enabled range of the SRAT.
+        [[nodiscard]] uint32_t findMemoryDomain(uint64_t address) const noexcept {
+            for (size_t i = 0; i < _rangeCount; ++i) {
+                if (address - _ranges[i].base < _ranges[i].size)
+                    return _ranges[i].domain;
+            }
+
+            return _hasAffinity ? no_domain : 0;
+        }
+
+        /// The relative cost of accessing memory of domain `to` from domain `from`: AcpiSlit::local_distance for the
+        /// same domain. Without a SLIT, every other domain is twice as far.
+        [[nodiscard]] uint8_t getDistance(uint32_t from, uint32_t to) const noexcept {
+            if (_slit != nullptr)
+                return _slit->getDistance(from, to);
+
+            return from == to ? AcpiSlit::local_distance : 2 * AcpiSlit::local_distance;
+        }
+
+    private:
+        void _addProcessor(uint64_t hardware_id, uint32_t uid, size_t capacity) noexcept {
+            // Some firmware lists processors both as xAPIC and as x2APIC. Only the stored ones can be recognized.
+            for (size_t i = 0; i < _storedCount; ++i) {
+                if (_processors[i].hardware_id == hardware_id)
+                    return;
+            }
+
+            if (_storedCount < capacity)
+                _processors[_storedCount++] = {hardware_id, uid, 0};
+
+            ++_processorCount;
+        }
+
+        void _setProcessorDomain(uint64_t hardware_id, uint32_t domain) noexcept {
+            for (size_t i = 0; i < _storedCount; ++i) {
+                if (_processors[i].hardware_id == hardware_id) {
+                    _processors[i].domain = domain;
+                    return;
+                }
+            }
+        }
+
+        void _setProcessorDomainByUid(uint32_t uid, uint32_t domain) noexcept {
+            for (size_t i = 0; i < _storedCount; ++i) {
+                if (_processors[i].acpi_processor_uid == uid) {
+                    _processors[i].domain = domain;
+                    return;
+                }
+            }
+        }
+
+        Status _readAffinity(const AcpiSrat& srat) noexcept {
+            auto status = Status::Success;
+
+            for (const auto& entry : srat.getEntries()) {
+                if (const auto* apic = entry.as<SratProcessorAffinity>()) {
+                    if (apic->isEnabled())
+                        _setProcessorDomain(apic->apic_id, apic->getProximityDomain());
+                } else if (const auto* x2apic = entry.as<SratX2ApicAffinity>()) {
+                    if (x2apic->isEnabled())
+                        _setProcessorDomain(x2apic->x2apic_id, x2apic->proximity_domain);
+                } else if (const auto* gicc = entry.as<SratGiccAffinity>()) {
+                    if (gicc->isEnabled())
+                        _setProcessorDomainByUid(gicc->acpi_processor_uid, gicc->proximity_domain);
+                } else if (const auto* memory = entry.as<SratMemoryAffinity>()) {
+                    if (!memory->isEnabled() || memory->size == 0)
+                        continue;
+
+                    if (_rangeCount == max_memory_range_count) {
+                        status = Status::OutOfResources;
+                        continue;
+                    }
+
+                    _ranges[_rangeCount++] = {memory->base_address, memory->size, memory->proximity_domain};
+
+                    auto* domain = _getDomain(memory->proximity_domain);
+                    if (domain == nullptr)
+                        status = Status::OutOfResources;
+                    else if (!memory->isHotPluggable())
+                        domain->memory_size += memory->size;
+                }
+            }
+
+            return status;
+        }
+
+        /// Finds or adds a domain.
+        /// @return nullptr The summary is full.
+        Domain* _getDomain(uint32_t id) noexcept {
+            for (size_t i = 0; i < _domainCount; ++i) {
+                if (_domains[i].id == id)
+                    return &_domains[i];
+            }
+
+            if (_domainCount == max_domain_count)
+                return nullptr;
+
+            _domains[_domainCount] = {id, 0, 0};
+            return &_domains[_domainCount++];
+        }
+
+        ProcessorInfo* _processors;
+        size_t _processorCount;
+        size_t _storedCount;
+
+        Domain _domains[max_domain_count];
+        size_t _domainCount;
+
+        MemoryRange _ranges[max_memory_range_count];
+        size_t _rangeCount;
+
+        const AcpiSlit* _slit;
+        bool _hasAffinity;
+    };
+} // namespace Uefi
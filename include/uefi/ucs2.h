@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "detail/ucs2.h"
+
+namespace Uefi {
+    // Null-terminated UCS-2 strings, as used by the firmware for file names, variable names and console output.
+    // With SSE2 or NEON, they go through 8 characters at a time. Aligned loads never cross a page, and unaligned loads
+    // are only used away from the end of a page, so reading past the terminator cannot fault.
+
+    using Detail::toUpperAscii;
+
+    /// The number of characters before the null terminator.
+    inline size_t getStringLength(const char16_t* string) noexcept {
+        const auto* position = string;
+
+#if defined(UEFI_UCS2_VECTORS)
+        // The characters of a string at an odd address would straddle the aligned blocks. It never happens in practice.
+        if ((reinterpret_cast<uintptr_t>(position) & 1) == 0) {
+            for (; (reinterpret_cast<uintptr_t>(position) & 15) != 0; ++position) {
+                if (*position == 0)
+                    return static_cast<size_t>(position - string);
+            }
+
+            for (;; position += 8) {
+                const auto nulls = Detail::Ucs2Vector::loadAligned(position).nulls();
+                if (nulls != 0)
+                    return static_cast<size_t>(position - string) + Detail::Ucs2Vector::getFirst(nulls);
+            }
+        }
+#endif
+
+        while (*position != 0)
+            ++position;
+
+        return static_cast<size_t>(position - string);
+    }
+
+    /// @return The first occurrence of `character`, or nullptr if it is not in the string.
+    inline const char16_t* findCharacter(const char16_t* string, char16_t character) noexcept {
+        if (character == 0)
+            return string + getStringLength(string);
+
+#if defined(UEFI_UCS2_VECTORS)
+        if ((reinterpret_cast<uintptr_t>(string) & 1) == 0) {
+            for (; (reinterpret_cast<uintptr_t>(string) & 15) != 0; ++string) {
+                if (*string == character)
+                    return string;
+
+                if (*string == 0)
+                    return nullptr;
+            }
+
+            const auto wanted = Detail::Ucs2Vector::broadcast(character);
+
+            for (;; string += 8) {
+                const auto block = Detail::Ucs2Vector::loadAligned(string);
+                const auto matches = block.equals(wanted);
+                const auto nulls = block.nulls();
+
+                if ((matches | nulls) != 0) {
+                    // The match only counts if it comes before the terminator.
+                    const auto index = Detail::Ucs2Vector::getFirst(matches | nulls);
+                    return string[index] == character ? string + index : nullptr;
+                }
+            }
+        }
+#endif
+
+        for (; *string != character; ++string) {
+            if (*string == 0)
+                return nullptr;
+        }
+
+        return string;
+    }
+
+    namespace Detail {
+        /// Compares two strings, with the ASCII letters upper-cased if `ignore_case`.
+        template <bool ignore_case>
+        int compareStrings(const char16_t* a, const char16_t* b) noexcept {
+            const auto fold = [](char16_t character) {
+                return ignore_case ? toUpperAscii(character) : character;
+            };
+
+            for (;;) {
+#if defined(UEFI_UCS2_VECTORS)
+                // Unaligned loads of both strings, as long as neither can run into the next page.
+                while (isWithinPage(a) && isWithinPage(b)) {
+                    auto block_a = Ucs2Vector::load(a);
+                    auto block_b = Ucs2Vector::load(b);
+
+                    if (ignore_case) {
+                        block_a = block_a.toUpperAscii();
+                        block_b = block_b.toUpperAscii();
+                    }
+
+                    // Stops at the first difference, or at the terminator of both strings.
+                    const auto stops = (block_a.equals(block_b) ^ Ucs2Vector::all) | block_a.nulls();
+                    if (stops != 0) {
+                        const auto index = Ucs2Vector::getFirst(stops);
+                        return static_cast<int>(fold(a[index])) - static_cast<int>(fold(b[index]));
+                    }
+
+                    a += 8;
+                    b += 8;
+                }
+#endif
+
+                // One character at a time until both strings are away from the end of a page again.
+                for (size_t i = 0; i < 8; ++i, ++a, ++b) {
+                    const auto character_a = fold(*a);
+                    const auto character_b = fold(*b);
+
+                    if (character_a != character_b || character_a == 0)
+                        return static_cast<int>(character_a) - static_cast<int>(character_b);
+                }
+            }
+        }
+    } // namespace Detail
+
+    /// Compares the characters as 16-bit numbers.
+    /// @return 0 if the strings are equal, a negative number if `a` comes first, a positive one otherwise.
+    inline int compareStrings(const char16_t* a, const char16_t* b) noexcept {
+        return Detail::compareStrings<false>(a, b);
+    }
+
+    /// Compares the strings with ASCII letters upper-cased, like FAT file names.
+    /// @return 0 if the strings are equal, a negative number if `a` comes first, a positive one otherwise.
+    inline int compareStringsIgnoreCase(const char16_t* a, const char16_t* b) noexcept {
+        return Detail::compareStrings<true>(a, b);
+    }
+} // namespace Uefi
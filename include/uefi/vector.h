@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+
+#include "detail/branch_hints.h"
+#include "detail/memory.h"
+#include "span.h"
+
+namespace Uefi {
+    /// A growable array, whose memory comes from an allocator such as PageArena (see FlatMap for the methods it needs).
+    /// Growing doubles the capacity, and fails instead of throwing when the allocator is out of memory.
+    /// The elements must be trivial types, so that they can be moved as bytes and never destroyed.
+    template <typename T, typename Allocator>
+    class Vector {
+        static_assert(std::is_trivial_v<T>, "The elements are moved around as bytes.");
+
+    public:
+        void initialize(Allocator& allocator) noexcept {
+            _allocator = &allocator;
+            _items = nullptr;
+            _size = 0;
+            _capacity = 0;
+        }
+
+        /// Gives the memory back to the allocator.
+        void release() noexcept {
+            if (_capacity != 0)
+                _allocator->deallocate(_items, _capacity * sizeof(T));
+
+            _items = nullptr;
+            _size = 0;
+            _capacity = 0;
+        }
+
+        /// Removes every element, keeping the memory.
+        void clear() noexcept {
+            _size = 0;
+        }
+
+        /// Makes room for at least `capacity` elements.
+        /// @return false The allocator is out of memory.
+        [[nodiscard]] bool reserve(size_t capacity) noexcept {
+            if (capacity <= _capacity)
+                return true;
+
+            auto* items = static_cast<T*>(_allocator->allocate(capacity * sizeof(T), alignof(T)));
+            if (items == nullptr)
+                return false;
+
+            if (_capacity != 0) {
+                Detail::copyBytes(items, _items, _size * sizeof(T));
+                _allocator->deallocate(_items, _capacity * sizeof(T));
+            }
+
+            _items = items;
+            _capacity = capacity;
+            return true;
+        }
+
+        /// @return false The allocator is out of memory.
+        bool pushBack(const T& value) noexcept {
+            if (UEFI_UNLIKELY(_size == _capacity) && !reserve(_capacity < 8 ? 8 : _capacity * 2))
+                return false;
+
+            _items[_size++] = value;
+            return true;
+        }
+
+        /// Removes the last element. The vector must not be empty.
+        void popBack() noexcept {
+            --_size;
+        }
+
+        /// Removes an element by moving the last one in its place, without shifting the others.
+        void swapRemove(size_t index) noexcept {
+            _items[index] = _items[--_size];
+        }
+
+        /// Changes the number of elements. New elements are left uninitialized.
+        /// @return false The allocator is out of memory.
+        [[nodiscard]] bool resize(size_t size) noexcept {
+            if (!reserve(size))
+                return false;
+
+            _size = size;
+            return true;
+        }
+
+        [[nodiscard]] size_t getSize() const noexcept {
+            return _size;
+        }
+
+        [[nodiscard]] size_t getCapacity() const noexcept {
+            return _capacity;
+        }
+
+        [[nodiscard]] bool isEmpty() const noexcept {
+            return _size == 0;
+        }
+
+        [[nodiscard]] T* getData() noexcept {
+            return _items;
+        }
+
+        [[nodiscard]] const T* getData() const noexcept {
+            return _items;
+        }
+
+        T& operator[](size_t i) noexcept {
+            return _items[i];
+        }
+
+        const T& operator[](size_t i) const noexcept {
+            return _items[i];
+        }
+
+        T& getBack() noexcept {
+            return _items[_size - 1];
+        }
+
+        T* begin() noexcept {
+            return _items;
+        }
+
+        T* end() noexcept {
+            return _items + _size;
+        }
+
+        const T* begin() const noexcept {
+            return _items;
+        }
+
+        const T* end() const noexcept {
+            return _items + _size;
+        }
+
+        operator Span<T>() noexcept {
+            return {_items, _size};
+        }
+
+        operator Span<const T>() const noexcept {
+            return {_items, _size};
+        }
+
+    private:
+        Allocator* _allocator;
+        T* _items;
+        size_t _size;
+        size_t _capacity;
+    };
+} // namespace Uefi
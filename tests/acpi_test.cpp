@@ -0,0 +1,323 @@
+#include <cstring>
+#include <list>
+#include <vector>
+
+#include "test.h"
+#include "uefi.h"
+
+using namespace Uefi;
+
+namespace {
+    using Table = std::vector<uint8_t>;
+
+    /// Keeps the tables at stable addresses, like the firmware's memory.
+    std::list<Table> tables_memory;
+
+    Table makeTable(const char (&signature)[5], size_t fixed_size) {
+        Table table(fixed_size, 0);
+        std::memcpy(table.data(), signature, 4);
+        return table;
+    }
+
+    template <typename T>
+    void append(Table& table, const T& value) {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+        table.insert(table.end(), bytes, bytes + sizeof(T));
+    }
+
+    /// Sets the length and the checksum, and places the table in memory.
+    uint64_t place(Table table) {
+        const auto length = static_cast<uint32_t>(table.size());
+        std::memcpy(&table[4], &length, sizeof(length));
+        table[9] = 0;
+        uint8_t sum = 0;
+        for (const auto byte : table)
+            sum = static_cast<uint8_t>(sum + byte);
+
+        table[9] = static_cast<uint8_t>(-sum);
+        tables_memory.push_back(std::move(table));
+        return reinterpret_cast<uintptr_t>(tables_memory.back().data());
+    }
+
+    uint8_t sum(const void* data, size_t size) {
+        uint8_t total = 0;
+        for (size_t i = 0; i < size; ++i)
+            total = static_cast<uint8_t>(total + static_cast<const uint8_t*>(data)[i]);
+
+        return total;
+    }
+
+    AcpiRsdp makeRsdp(uint64_t xsdt) {
+        AcpiRsdp rsdp{};
+        rsdp.signature = AcpiRsdp::expected_signature;
+        rsdp.revision = 2;
+        rsdp.length = sizeof(AcpiRsdp);
+        rsdp.xsdt_address = xsdt;
+        rsdp.checksum = static_cast<uint8_t>(-sum(&rsdp, 20));
+        rsdp.extended_checksum = static_cast<uint8_t>(-sum(&rsdp, sizeof(AcpiRsdp)));
+        return rsdp;
+    }
+
+    uint64_t placeXsdt(const std::vector<uint64_t>& entries) {
+        auto xsdt = makeTable("XSDT", sizeof(AcpiTableHeader));
+        for (const auto entry : entries)
+            append(xsdt, entry);
+
+        return place(xsdt);
+    }
+
+    /// 8 xAPIC processors, the last one disabled, 4 x2APIC ones which repeat the first ones, 2 more x2APIC ones,
+    /// and an I/O APIC.
+    Table makeMadt() {
+        auto madt = makeTable("APIC", sizeof(AcpiMadt));
+        for (uint8_t i = 0; i < 8; ++i) {
+            MadtLocalApic apic{};
+            apic.type = MadtLocalApic::subtable_type;
+            apic.length = sizeof(MadtLocalApic);
+            apic.acpi_processor_uid = i;
+            apic.apic_id = static_cast<uint8_t>(i * 2);
+            apic.flags = i == 7 ? 0 : 1;
+            append(madt, apic);
+        }
+
+        for (uint32_t i = 0; i < 6; ++i) {
+            MadtLocalX2Apic apic{};
+            apic.type = MadtLocalX2Apic::subtable_type;
+            apic.length = sizeof(MadtLocalX2Apic);
+            apic.x2apic_id = i < 4 ? i * 2 : 300 + (i - 4);
+            apic.flags = 1;
+            apic.acpi_processor_uid = i < 4 ? i : 100 + (i - 4);
+            append(madt, apic);
+        }
+
+        const uint8_t io_apic[12] = {1, 12};
+        madt.insert(madt.end(), io_apic, io_apic + sizeof(io_apic));
+        return madt;
+    }
+
+    Table makeSrat() {
+        auto srat = makeTable("SRAT", sizeof(AcpiSrat));
+        for (uint8_t i = 0; i < 8; ++i) {
+            SratProcessorAffinity affinity{};
+            affinity.type = SratProcessorAffinity::subtable_type;
+            affinity.length = sizeof(SratProcessorAffinity);
+            affinity.apic_id = static_cast<uint8_t>(i * 2);
+            affinity.proximity_domain_low = i / 4;
+            affinity.flags = 1;
+            append(srat, affinity);
+        }
+
+        for (uint32_t i = 0; i < 2; ++i) {
+            SratX2ApicAffinity affinity{};
+            affinity.type = SratX2ApicAffinity::subtable_type;
+            affinity.length = sizeof(SratX2ApicAffinity);
+            affinity.x2apic_id = 300 + i;
+            affinity.proximity_domain = 1;
+            affinity.flags = 1;
+            append(srat, affinity);
+        }
+
+        const auto add_memory = [&](uint64_t base, uint64_t size, uint32_t domain, uint32_t flags) {
+            SratMemoryAffinity affinity{};
+            affinity.type = SratMemoryAffinity::subtable_type;
+            affinity.length = sizeof(SratMemoryAffinity);
+            affinity.base_address = base;
+            affinity.size = size;
+            affinity.proximity_domain = domain;
+            affinity.flags = flags;
+            append(srat, affinity);
+        };
+
+        add_memory(0, 0xA0000, 0, 1);
+        add_memory(0x100000, 0x7FF00000, 0, 1);
+        add_memory(0x100000000, 0x80000000, 1, 1);
+        // Hot-pluggable, then disabled.
+        add_memory(0x200000000, 0x40000000, 1, 3);
+        add_memory(0x300000000, 0x1000, 2, 0);
+        return srat;
+    }
+
+    /// A SLIT header followed by `matrix`, claiming `locality_count` domains.
+    Table makeSlit(uint64_t locality_count, const std::vector<uint8_t>& matrix) {
+        auto slit = makeTable("SLIT", sizeof(AcpiSlit));
+        std::memcpy(&slit[offsetof(AcpiSlit, locality_count)], &locality_count, sizeof(locality_count));
+        slit.insert(slit.end(), matrix.begin(), matrix.end());
+        return slit;
+    }
+
+    const AcpiSlit& placeSlit(uint64_t locality_count, const std::vector<uint8_t>& matrix) {
+        return *reinterpret_cast<const AcpiSlit*>(static_cast<uintptr_t>(place(makeSlit(locality_count, matrix))));
+    }
+
+    /// Places a copy of a table as it is, without touching its length or checksum.
+    template <size_t size>
+    uint64_t placeCopy(const uint8_t (&bytes)[size]) {
+        tables_memory.emplace_back(bytes, bytes + size);
+        return reinterpret_cast<uintptr_t>(tables_memory.back().data());
+    }
+
+    /// Captured from a Firecracker VM, from /sys/firmware/acpi/tables: one processor and an I/O APIC, and a PCI
+    /// segment with a single bus.
+    /// @{
+    const uint8_t firecracker_madt[] = {
+        0x41, 0x50, 0x49, 0x43, 0x40, 0x00, 0x00, 0x00, 0x06, 0x69, 0x46, 0x49, 0x52, 0x45, 0x43, 0x4B,
+        0x46, 0x43, 0x56, 0x4D, 0x4D, 0x41, 0x44, 0x54, 0x00, 0x00, 0x00, 0x00, 0x46, 0x43, 0x41, 0x54,
+        0x19, 0x01, 0x24, 0x20, 0x00, 0x00, 0xE0, 0xFE, 0x00, 0x00, 0x00, 0x00, 0x01, 0x0C, 0x00, 0x00,
+        0x00, 0x00, 0xC0, 0xFE, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00
+    };
+    const uint8_t firecracker_mcfg[] = {
+        0x4D, 0x43, 0x46, 0x47, 0x3C, 0x00, 0x00, 0x00, 0x01, 0x7F, 0x46, 0x49, 0x52, 0x45, 0x43, 0x4B,
+        0x46, 0x43, 0x4D, 0x56, 0x4D, 0x43, 0x46, 0x47, 0x00, 0x00, 0x00, 0x00, 0x46, 0x43, 0x41, 0x54,
+        0x19, 0x01, 0x24, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0xEE,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+    };
+    /// @}
+
+    /// QEMU's q35 machine with two NUMA nodes, `-M q35 -m 2G -smp 4` with nodes 0 and 1 of 1 GiB and two processors
+    /// each, at distance 21. There was no QEMU to capture them from: these are laid out field by field as its ACPI
+    /// generator (build_madt(), build_srat() and build_slit()) writes them, with its OEM IDs. The SRAT cuts the 640 KiB
+    /// hole out of node 0, and pads its memory entries with a disabled empty one.
+    /// @{
+    const uint8_t q35_madt[] = {
+        0x41, 0x50, 0x49, 0x43, 0x90, 0x00, 0x00, 0x00, 0x01, 0x4B, 0x42, 0x4F, 0x43, 0x48, 0x53, 0x20,
+        0x42, 0x58, 0x50, 0x43, 0x20, 0x20, 0x20, 0x20, 0x01, 0x00, 0x00, 0x00, 0x42, 0x58, 0x50, 0x43,
+        0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0xE0, 0xFE, 0x01, 0x00, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00,
+        0x01, 0x00, 0x00, 0x00, 0x00, 0x08, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x08, 0x02, 0x02,
+        0x01, 0x00, 0x00, 0x00, 0x00, 0x08, 0x03, 0x03, 0x01, 0x00, 0x00, 0x00, 0x01, 0x0C, 0x00, 0x00,
+        0x00, 0x00, 0xC0, 0xFE, 0x00, 0x00, 0x00, 0x00, 0x02, 0x0A, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x02, 0x0A, 0x00, 0x05, 0x05, 0x00, 0x00, 0x00, 0x0D, 0x00, 0x02, 0x0A, 0x00, 0x09,
+        0x09, 0x00, 0x00, 0x00, 0x0D, 0x00, 0x02, 0x0A, 0x00, 0x0A, 0x0A, 0x00, 0x00, 0x00, 0x0D, 0x00,
+        0x02, 0x0A, 0x00, 0x0B, 0x0B, 0x00, 0x00, 0x00, 0x0D, 0x00, 0x04, 0x06, 0xFF, 0x00, 0x00, 0x01
+    };
+    const uint8_t q35_srat[] = {
+        0x53, 0x52, 0x41, 0x54, 0x10, 0x01, 0x00, 0x00, 0x01, 0x8B, 0x42, 0x4F, 0x43, 0x48, 0x53, 0x20,
+        0x42, 0x58, 0x50, 0x43, 0x20, 0x20, 0x20, 0x20, 0x01, 0x00, 0x00, 0x00, 0x42, 0x58, 0x50, 0x43,
+        0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x10, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x10, 0x00, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x10, 0x01, 0x02, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x10, 0x01, 0x03, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x01, 0x28, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x28, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF0, 0x3F, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x01, 0x28, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x28, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+    };
+    const uint8_t q35_slit[] = {
+        0x53, 0x4C, 0x49, 0x54, 0x30, 0x00, 0x00, 0x00, 0x01, 0xE8, 0x42, 0x4F, 0x43, 0x48, 0x53, 0x20,
+        0x42, 0x58, 0x50, 0x43, 0x20, 0x20, 0x20, 0x20, 0x01, 0x00, 0x00, 0x00, 0x42, 0x58, 0x50, 0x43,
+        0x01, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0A, 0x15, 0x15, 0x0A
+    };
+    /// @}
+} // namespace
+
+int main() {
+    const auto dsdt = place(makeTable("DSDT", sizeof(AcpiTableHeader) + 16));
+    auto fadt = makeTable("FACP", 244);
+    std::memcpy(&fadt[AcpiFadt::x_dsdt_offset], &dsdt, sizeof(dsdt));
+
+    auto corrupted = makeTable("BAD!", sizeof(AcpiTableHeader));
+    const auto corrupted_address = place(corrupted);
+    reinterpret_cast<uint8_t*>(static_cast<uintptr_t>(corrupted_address))[20] ^= 1;
+
+    const auto madt = place(makeMadt());
+    const std::vector<uint64_t> entries = {place(fadt), madt, place(makeTable("APIC", sizeof(AcpiMadt))), place(makeSrat()),
+                                           place(makeSlit(2, {10, 21, 21, 10})), corrupted_address, 0};
+    auto rsdp = makeRsdp(placeXsdt(entries));
+
+    // The corrupted and missing tables are left out, and the DSDT comes from the FADT.
+    AcpiTables tables;
+    CHECK(tables.initialize(&rsdp) == Status::Success);
+    CHECK(tables.getTableCount() == 6);
+    CHECK(reinterpret_cast<uintptr_t>(tables.find(makeAcpiSignature("DSDT"))) == dsdt);
+    CHECK(reinterpret_cast<uintptr_t>(tables.find<AcpiMadt>()) == madt);
+    CHECK(tables.find(makeAcpiSignature("APIC"), 1) != nullptr && tables.find(makeAcpiSignature("APIC"), 2) == nullptr);
+    CHECK(tables.find(makeAcpiSignature("SSDT")) == nullptr && tables.find(makeAcpiSignature("BAD!")) == nullptr);
+
+    auto bad_rsdp = rsdp;
+    ++bad_rsdp.checksum;
+    CHECK(tables.initialize(&bad_rsdp) == Status::CrcError);
+    CHECK(tables.initialize(nullptr) == Status::InvalidParameter);
+
+    // The topology: duplicates and disabled processors are left out.
+    CHECK(tables.initialize(&rsdp) == Status::Success);
+    ProcessorInfo processors[16];
+    SystemTopology topology;
+    CHECK(topology.initialize(tables, {processors, 16}) == Status::Success);
+    CHECK(topology.getProcessorCount() == 9 && topology.hasAffinity());
+    const uint32_t expected_domains[] = {0, 0, 0, 0, 1, 1, 1, 1, 1};
+    for (size_t i = 0; i < 9; ++i)
+        CHECK(processors[i].domain == expected_domains[i]);
+
+    CHECK(processors[7].hardware_id == 300 && processors[8].acpi_processor_uid == 101);
+    CHECK(topology.getDomains().getSize() == 2);
+    CHECK(topology.getDomains()[0].processor_count == 4 && topology.getDomains()[1].processor_count == 5);
+    CHECK(topology.getDomains()[0].memory_size == 0xA0000 + 0x7FF00000 && topology.getDomains()[1].memory_size == 0x80000000);
+    CHECK(topology.findMemoryDomain(0x150000000) == 1 && topology.findMemoryDomain(0x90000000) == SystemTopology::no_domain);
+    CHECK(topology.getDistance(0, 1) == 21 && topology.getDistance(1, 1) == 10 && topology.getDistance(0, 5) == AcpiSlit::unreachable);
+
+    CHECK(topology.initialize(tables, {processors, 4}) == Status::BufferTooSmall);
+    CHECK(topology.getProcessors().getSize() == 4 && topology.getProcessorCount() == 9);
+
+    // Subtables running past the end of the table are not visited.
+    size_t count = 0;
+    for (const auto& entry : AcpiSubtables(reinterpret_cast<const uint8_t*>(static_cast<uintptr_t>(madt)) + sizeof(AcpiMadt), (8 * 8) + 5)) {
+        (void)entry;
+        ++count;
+    }
+
+    CHECK(count == 8);
+
+    // SLITs whose matrix does not fit in the table, including counts whose square overflows.
+    const auto& short_slit = placeSlit(3, {10, 21, 21, 10});
+    CHECK(short_slit.getDistance(0, 1) == AcpiSlit::unreachable);
+    const auto& huge_slit = placeSlit(uint64_t{1} << 32, {10, 21, 21, 10});
+    CHECK(huge_slit.getDistance(0x10000, 0) == AcpiSlit::unreachable && huge_slit.getDistance(0, 1) == AcpiSlit::unreachable);
+    const auto& wrapping_slit = placeSlit((uint64_t{1} << 63) + 1, {10});
+    CHECK(wrapping_slit.getDistance(1, 1) == AcpiSlit::unreachable);
+
+    auto truncated = makeSlit(1, {});
+    place(truncated);
+    auto& truncated_slit = *reinterpret_cast<AcpiSlit*>(tables_memory.back().data());
+    truncated_slit.header.length = sizeof(AcpiTableHeader);
+    CHECK(truncated_slit.getDistance(0, 0) == AcpiSlit::unreachable);
+
+    const auto& valid_slit = placeSlit(3, {10, 20, 30, 20, 10, 20, 30, 20, 10});
+    CHECK(valid_slit.getDistance(0, 2) == 30 && valid_slit.getDistance(2, 1) == 20 && valid_slit.getDistance(3, 0) == AcpiSlit::unreachable);
+
+    // The captured Firecracker tables. Their RSDP and XSDT hold the VM's addresses, so they are rebuilt around the
+    // copies. Its FADT is left out for the same reason: it points to the DSDT in the VM's memory.
+    auto firecracker_rsdp = makeRsdp(placeXsdt({placeCopy(firecracker_madt), placeCopy(firecracker_mcfg)}));
+    CHECK(tables.initialize(&firecracker_rsdp) == Status::Success && tables.getTableCount() == 2);
+    CHECK(topology.initialize(tables, {processors, 16}) == Status::Success);
+    CHECK(topology.getProcessorCount() == 1 && processors[0].hardware_id == 0 && processors[0].acpi_processor_uid == 0);
+    CHECK(!topology.hasAffinity() && topology.getDomains().getSize() == 1 && topology.getDomains()[0].processor_count == 1);
+    CHECK(topology.findMemoryDomain(0x12345000) == 0 && topology.getDistance(0, 1) == 2 * AcpiSlit::local_distance);
+    const auto* mcfg = tables.find<AcpiMcfg>();
+    CHECK(mcfg != nullptr && mcfg->getAllocationCount() == 1 && mcfg->getAllocation(0).base_address == 0xEEC00000);
+    CHECK(mcfg->getAllocation(0).segment == 0 && mcfg->getAllocation(0).start_bus == 0 && mcfg->getAllocation(0).end_bus == 0);
+
+    // The q35 tables: two domains of two processors and 1 GiB each, less the hole in the first one.
+    auto q35_rsdp = makeRsdp(placeXsdt({placeCopy(q35_madt), placeCopy(q35_srat), placeCopy(q35_slit)}));
+    CHECK(tables.initialize(&q35_rsdp) == Status::Success && tables.getTableCount() == 3);
+    CHECK(topology.initialize(tables, {processors, 16}) == Status::Success);
+    CHECK(topology.getProcessorCount() == 4 && topology.hasAffinity());
+    for (uint32_t i = 0; i < 4; ++i)
+        CHECK(processors[i].hardware_id == i && processors[i].acpi_processor_uid == i && processors[i].domain == i / 2);
+
+    const auto domains = topology.getDomains();
+    CHECK(domains.getSize() == 2 && domains[0].id == 0 && domains[0].processor_count == 2 && domains[1].processor_count == 2);
+    CHECK(domains[0].memory_size == 0x40000000 - 0x60000 && domains[1].memory_size == 0x40000000);
+    CHECK(topology.getMemoryRanges().getSize() == 3);
+    CHECK(topology.findMemoryDomain(0x9F000) == 0 && topology.findMemoryDomain(0xA0000) == SystemTopology::no_domain);
+    CHECK(topology.findMemoryDomain(0x100000) == 0 && topology.findMemoryDomain(0x7FFFFFFF) == 1);
+    CHECK(topology.findMemoryDomain(0x80000000) == SystemTopology::no_domain);
+    CHECK(topology.getDistance(0, 1) == 21 && topology.getDistance(1, 0) == 21 && topology.getDistance(1, 1) == 10);
+
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "mock_firmware.h"
+#include "test.h"
+
+using namespace Uefi;
+
+namespace {
+    /// Keeps what is printed, as ASCII.
+    struct Capture {
+        std::string text;
+
+        Status outputString(const char16_t* string) {
+            for (; *string != 0; ++string)
+                text += static_cast<char>(*string);
+
+            return Status::Success;
+        }
+    };
+
+    AllocationProfiler profiler;
+    uint8_t memory[AllocationProfiler::getRequiredSize(4096)];
+} // namespace
+
+int main() {
+    Test::MockTable<BootServices> boot_services_table;
+    Test::MockPages::install(boot_services_table);
+    auto& boot_services = boot_services_table.get();
+
+    CHECK(profiler.initialize(memory, AllocationProfiler::getRequiredSize(2) - 1) == Status::BufferTooSmall);
+    CHECK(profiler.initialize(memory, sizeof(memory)) == Status::Success);
+    profiler.install();
+
+    // Random allocations and frees of two types, against a model: with up to 2000 live allocations in 4096 slots,
+    // lookups probe past collisions, and frees move entries back.
+    std::mt19937 random(5);
+    struct Live {
+        void* buffer;
+        size_t size;
+        MemoryType type;
+    };
+    std::vector<Live> live;
+    std::map<MemoryType, uint64_t> live_bytes;
+    uint64_t loader_peak = 0;
+    for (int i = 0; i < 200000; ++i) {
+        if (live.empty() || (live.size() < 2000 && random() % 3 != 0)) {
+            const size_t size = 1 + (random() % 5000);
+            const auto type = random() % 4 == 0 ? MemoryType::BootServicesData : MemoryType::LoaderData;
+            const auto buffer = boot_services.allocatePool(type, size);
+            CHECK(buffer.isSuccess());
+            live.push_back({*buffer, size, type});
+            live_bytes[type] += size;
+            loader_peak = std::max(loader_peak, live_bytes[MemoryType::LoaderData]);
+        } else {
+            const auto index = random() % live.size();
+            CHECK(boot_services.freePool(live[index].buffer) == Status::Success);
+            live_bytes[live[index].type] -= live[index].size;
+            live[index] = live.back();
+            live.pop_back();
+        }
+    }
+
+    const auto& loader_data = profiler.getTypeStats(MemoryType::LoaderData);
+    CHECK(loader_data.live_bytes == live_bytes[MemoryType::LoaderData] && loader_data.peak_bytes == loader_peak);
+    CHECK(profiler.getTypeStats(MemoryType::BootServicesData).live_bytes == live_bytes[MemoryType::BootServicesData]);
+    CHECK(profiler.getSiteCount() == 1 && profiler.getSite(0).stats.live_count == live.size() && profiler.getMissedCount() == 0);
+    for (const auto& allocation : live)
+        CHECK(boot_services.freePool(allocation.buffer) == Status::Success);
+
+    CHECK(loader_data.live_bytes == 0 && loader_data.live_count == 0 && profiler.getUntrackedFreeCount() == 0);
+
+    // Leaks at their call sites, pages, another allocator, a free of memory which was never recorded and an OEM type.
+    CHECK(profiler.initialize(memory, sizeof(memory)) == Status::Success);
+    void* leak;
+    const auto leak_line = __LINE__ + 1;
+    CHECK(boot_services.allocatePool(MemoryType::LoaderData, 100, &leak) == Status::Success);
+    const auto leaked_pages = boot_services.allocatePages(MemoryType::LoaderData, 3);
+    const auto freed_pages = boot_services.allocatePages(MemoryType::RuntimeServicesData, 2);
+    CHECK(leaked_pages && freed_pages && boot_services.freePages(*freed_pages, 2) == Status::Success);
+
+    PageArena arena;
+    arena.initialize(boot_services, MemoryType::LoaderData, 16);
+    CHECK(arena.allocate(64) != nullptr);
+    CHECK(boot_services.freePool(std::malloc(10)) == Status::Success);
+    const auto oem = boot_services.allocatePool(static_cast<MemoryType>(0x80000001), 7);
+    CHECK(oem.isSuccess());
+
+    CHECK(profiler.getUntrackedFreeCount() == 1 && profiler.getTypeStats(static_cast<MemoryType>(0x80000001)).live_bytes == 7);
+    CHECK(profiler.getTypeStats(MemoryType::MaxMemoryType).live_count == 1);
+    const auto& runtime_data = profiler.getTypeStats(MemoryType::RuntimeServicesData);
+    CHECK(runtime_data.peak_bytes == 0x2000 && runtime_data.live_bytes == 0 && runtime_data.total_count == 1);
+    CHECK(profiler.getTypeStats(MemoryType::LoaderData).live_bytes == 100 + 0x3000 + 0x10000);
+
+    // 100 bytes have 7 bits, 7 bytes 3, 2 and 3 pages 14, and the chunk of the arena 17.
+    CHECK(profiler.getHistogramCount(7) == 1 && profiler.getHistogramCount(3) == 1 && profiler.getHistogramCount(14) == 2);
+    CHECK(profiler.getHistogramCount(17) == 1 && profiler.getHistogramCount(13) == 0);
+
+    Capture report;
+    CHECK(profiler.report(report) == Status::Success);
+    std::printf("%s", report.text.c_str());
+    CHECK(report.text.find("allocation_profiler_test.cpp:" + std::to_string(leak_line) + ": 100 bytes in 1 of 1 allocations") != std::string::npos);
+    CHECK(report.text.find("page_arena.h:") != std::string::npos && report.text.find("1 untracked frees, 0 missed") != std::string::npos);
+    CHECK(report.text.find("RuntimeServicesData") != std::string::npos && report.text.find("BootServicesData") == std::string::npos);
+
+    arena.release();
+    CHECK(boot_services.freePool(leak) == Status::Success && boot_services.freePages(*leaked_pages, 3) == Status::Success);
+    CHECK(boot_services.freePool(*oem) == Status::Success);
+    for (size_t i = 0; i < profiler.getSiteCount(); ++i)
+        CHECK(profiler.getSite(i).stats.live_count == 0);
+
+    // Sites past the table are accounted together.
+    CHECK(profiler.initialize(memory, sizeof(memory)) == Status::Success);
+    for (uint32_t line = 0; line < AllocationProfiler::max_site_count + 10; ++line)
+        profiler.recordAllocation(0x1000 + (line * 16), 16, MemoryType::LoaderData, {"generated.cpp", line});
+
+    CHECK(profiler.getSiteCount() == AllocationProfiler::max_site_count && profiler.getOtherSiteStats().live_count == 10);
+    CHECK(profiler.getOtherSiteStats().live_bytes == 160);
+
+    // A full table counts the allocations it cannot hold as missed, and so does a null address.
+    CHECK(profiler.initialize(memory, AllocationProfiler::getRequiredSize(8)) == Status::Success);
+    for (uint64_t i = 1; i <= 8; ++i)
+        profiler.recordAllocation(i * 0x1000, 1, MemoryType::LoaderData, AllocationSite::current());
+
+    profiler.recordAllocation(0, 1, MemoryType::LoaderData, AllocationSite::current());
+    CHECK(profiler.getTypeStats(MemoryType::LoaderData).live_count == 6 && profiler.getMissedCount() == 3);
+
+    // Uninstalled, the wrappers record nothing.
+    profiler.uninstall();
+    CHECK(boot_services.freePool(*boot_services.allocatePool(MemoryType::LoaderData, 5)) == Status::Success);
+    CHECK(profiler.getTypeStats(MemoryType::LoaderData).total_count == 6 && profiler.getUntrackedFreeCount() == 0);
+    CHECK(Test::MockPages::getOutstandingCount() == 0);
+    return 0;
+}
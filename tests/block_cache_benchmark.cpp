@@ -0,0 +1,129 @@
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "mock_block_io.h"
+#include "test.h"
+
+using namespace Uefi;
+
+namespace {
+    constexpr size_t block_size = 512;
+    constexpr size_t disk_blocks = 64 * 1024 * 1024 / block_size;
+
+    /// Reads bytes straight from the device, one request covering the blocks of each read.
+    Status readDirect(Test::MockDisk& disk, uint64_t offset, size_t size, void* buffer) {
+        static std::vector<uint64_t> blocks;
+        const auto first = offset / block_size;
+        const auto last = (offset + size + block_size - 1) / block_size;
+        blocks.resize(((last - first) * block_size) / sizeof(uint64_t));
+
+        const auto status = disk.getProtocol().readBlocks(disk.media.media_id, first, (last - first) * block_size, blocks.data());
+        std::memcpy(buffer, reinterpret_cast<const uint8_t*>(blocks.data()) + (offset % block_size), size);
+        return status;
+    }
+
+    struct Request {
+        uint64_t offset;
+        size_t size;
+    };
+
+    /// What a file system does while opening many small files: FAT and directory reads near the start of the
+    /// volume, and small file reads inside a few megabytes.
+    std::vector<Request> makeMetadataWorkload() {
+        std::mt19937 random(1);
+        std::vector<Request> requests(30000);
+        for (size_t i = 0; i < requests.size(); ++i) {
+            if (i % 3 == 0)
+                requests[i] = {(random() % 64) * block_size, block_size};
+            else
+                requests[i] = {random() % (4 * 1024 * 1024), random() % 3000};
+        }
+
+        return requests;
+    }
+
+    /// A large file read in 4 KiB pieces.
+    std::vector<Request> makeSequentialWorkload() {
+        std::vector<Request> requests;
+        for (uint64_t offset = 16 * 1024 * 1024; offset < 24 * 1024 * 1024; offset += 4096)
+            requests.push_back({offset, 4096});
+
+        return requests;
+    }
+
+    struct Result {
+        size_t reads;
+        double milliseconds;
+    };
+
+    template <typename Read>
+    Result run(Test::MockDisk& disk, const std::vector<Request>& requests, Read read) {
+        std::vector<uint8_t> buffer(64 * 1024);
+        disk.resetCounters();
+
+        for (const auto& request : requests) {
+            CHECK(read(request.offset, request.size, buffer.data()) == Status::Success);
+            CHECK(std::memcmp(buffer.data(), disk.data.data() + request.offset, request.size) == 0);
+        }
+
+        return {disk.read_count, disk.busy_microseconds / 1000};
+    }
+
+    void report(const char* name, const Result& direct, const Result& cached) {
+        std::printf("%-14s direct: %6zu reads, %8.1f ms | cached: %5zu reads, %7.1f ms | %5.1fx faster\n", name, direct.reads,
+                    direct.milliseconds, cached.reads, cached.milliseconds, direct.milliseconds / cached.milliseconds);
+    }
+} // namespace
+
+int main() {
+    Test::MockDisk disk(disk_blocks, block_size);
+    disk.fillPattern();
+
+    // 4 MiB of cache, which holds the working set of the metadata workload.
+    const BlockCache::Configuration config{8192, 64, 32};
+    std::vector<uint64_t> storage(BlockCache::getStorageSize(block_size, config) / sizeof(uint64_t) + 1);
+    static BlockCache cache;
+
+    const auto direct_read = [&](uint64_t offset, size_t size, void* buffer) { return readDirect(disk, offset, size, buffer); };
+    const auto cached_read = [&](uint64_t offset, size_t size, void* buffer) { return cache.read(offset, size, buffer); };
+
+    const auto metadata = makeMetadataWorkload();
+    CHECK(cache.initialize(disk.getProtocol(), storage.data(), config) == Status::Success);
+    const auto metadata_direct = run(disk, metadata, direct_read);
+    const auto metadata_cached = run(disk, metadata, cached_read);
+    report("metadata", metadata_direct, metadata_cached);
+    CHECK(metadata_cached.reads * 2 < metadata_direct.reads);
+
+    // A cache smaller than the working set: random misses only fetch the blocks they were asked for, so the cache
+    // never costs more device I/O than reading directly.
+    const BlockCache::Configuration small_config{1024, 64, 32};
+    CHECK(cache.initialize(disk.getProtocol(), storage.data(), small_config) == Status::Success);
+    const auto metadata_small = run(disk, metadata, cached_read);
+    report("metadata/small", metadata_direct, metadata_small);
+    CHECK(metadata_small.reads <= metadata_direct.reads && metadata_small.milliseconds <= metadata_direct.milliseconds);
+
+    const auto sequential = makeSequentialWorkload();
+    CHECK(cache.initialize(disk.getProtocol(), storage.data(), config) == Status::Success);
+    const auto sequential_direct = run(disk, sequential, direct_read);
+    const auto sequential_cached = run(disk, sequential, cached_read);
+    report("sequential", sequential_direct, sequential_cached);
+    CHECK(sequential_cached.reads * 4 < sequential_direct.reads);
+
+    const auto& statistics = cache.getStatistics();
+    std::printf("sequential cache: %llu hits, %llu misses, %llu device blocks\n", static_cast<unsigned long long>(statistics.hits),
+                static_cast<unsigned long long>(statistics.misses), static_cast<unsigned long long>(statistics.device_blocks));
+
+    // Writes go through, and the cached copies follow.
+    std::vector<uint64_t> block(block_size / sizeof(uint64_t), 0x0123456789ABCDEF);
+    uint8_t read_back[block_size];
+    CHECK(cache.read(0, block_size, read_back) == Status::Success);
+    CHECK(cache.writeBlocks(0, 1, block.data()) == Status::Success);
+    CHECK(cache.read(0, block_size, read_back) == Status::Success);
+    CHECK(std::memcmp(read_back, block.data(), block_size) == 0 && std::memcmp(disk.data.data(), block.data(), block_size) == 0);
+
+    // A new medium empties the cache.
+    ++disk.media.media_id;
+    CHECK(cache.read(4096, 16, read_back) == Status::MediaChanged);
+    return 0;
+}
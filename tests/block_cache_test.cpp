@@ -0,0 +1,97 @@
+#include <cstring>
+#include <vector>
+
+#include "mock_block_io.h"
+#include "test.h"
+
+using namespace Uefi;
+
+namespace {
+    constexpr size_t block_size = 512;
+    constexpr size_t disk_blocks = 4096;
+
+    /// Whether `size` bytes read at `offset` are what the disk holds.
+    bool matches(Test::MockDisk& disk, uint64_t offset, const void* buffer, size_t size) {
+        return std::memcmp(buffer, disk.data.data() + offset, size) == 0;
+    }
+
+    std::vector<uint64_t> storage;
+} // namespace
+
+int main() {
+    Test::MockDisk disk(disk_blocks, block_size);
+    disk.fillPattern();
+    Test::MockTable<BootServices> boot_services_table;
+    Test::MockDisk::installEvents(boot_services_table);
+    auto& boot_services = boot_services_table.get();
+
+    const BlockCache::Configuration config{64, 8, 16};
+    storage.resize(BlockCache::getStorageSize(block_size, config) / sizeof(uint64_t) + 1);
+    static BlockCache cache;
+    CHECK(cache.initialize(disk.getProtocol(), storage.data(), config) == Status::Success);
+    uint8_t buffer[16 * block_size];
+
+    // Random partial reads fetch the blocks they cover, and nothing else.
+    CHECK(cache.read((1000 * block_size) + 100, 50, buffer) == Status::Success && matches(disk, (1000 * block_size) + 100, buffer, 50));
+    CHECK(disk.read_count == 1 && disk.blocks_transferred == 1);
+    CHECK(cache.read((2000 * block_size) + 500, 1000, buffer) == Status::Success && matches(disk, (2000 * block_size) + 500, buffer, 1000));
+    CHECK(disk.read_count == 2 && disk.blocks_transferred == 4);
+
+    // A miss right after the blocks the last one fetched is sequential: the blocks after it are fetched as well.
+    disk.resetCounters();
+    for (uint64_t offset = 3000 * block_size; offset < 3010 * block_size; offset += 100)
+        CHECK(cache.read(offset, 100, buffer) == Status::Success && matches(disk, offset, buffer, 100));
+
+    CHECK(disk.read_count == 3 && disk.blocks_transferred == 1 + 8 + 8);
+
+    // A medium with smaller blocks: the cache follows its geometry.
+    ++disk.media.media_id;
+    disk.media.block_size = block_size / 2;
+    disk.media.last_block = (disk_blocks * 2) - 1;
+    CHECK(cache.readBlocks(0, 1, buffer) == Status::MediaChanged && cache.getBlockSize() == block_size / 2);
+    CHECK(cache.readBlocks((disk_blocks * 2) - 3, 3, buffer) == Status::Success && matches(disk, disk.data.size() - (3 * 256), buffer, 3 * 256));
+    CHECK(cache.read(disk.data.size() - 300, 300, buffer) == Status::Success && matches(disk, disk.data.size() - 300, buffer, 300));
+
+    // A medium with bigger blocks doesn't fit the storage, until it is changed again.
+    ++disk.media.media_id;
+    disk.media.block_size = block_size * 8;
+    disk.media.last_block = (disk_blocks / 8) - 1;
+    CHECK(cache.readBlocks(0, 1, buffer) == Status::Unsupported && cache.read(0, 10, buffer) == Status::Unsupported);
+    CHECK(cache.getBlockSize() == block_size / 2);
+    ++disk.media.media_id;
+    disk.media.block_size = block_size;
+    disk.media.last_block = disk_blocks - 1;
+    CHECK(cache.readBlocks(0, 1, buffer) == Status::MediaChanged && cache.getBlockSize() == block_size);
+    CHECK(cache.readBlocks(disk_blocks - 1, 1, buffer) == Status::Success && matches(disk, disk.data.size() - block_size, buffer, block_size));
+
+    // Asynchronous read-ahead: sequential reads queue a read of the following blocks.
+    CHECK(cache.initialize(disk.getProtocol(), storage.data(), config, &disk.getProtocol2(), &boot_services) == Status::Success);
+    disk.resetCounters();
+    CHECK(cache.readBlocks(100, 4, buffer) == Status::Success && disk.getPendingCount() == 0);
+    CHECK(cache.readBlocks(104, 4, buffer) == Status::Success && matches(disk, 104 * block_size, buffer, 4 * block_size));
+    CHECK(disk.read_count == 2 && disk.async_read_count == 1 && disk.getPendingCount() == 1);
+
+    // A completed read-ahead is added to the cache by the next read.
+    disk.completeReads();
+    CHECK(cache.readBlocks(108, 4, buffer) == Status::Success && matches(disk, 108 * block_size, buffer, 4 * block_size));
+    CHECK(disk.read_count == 2 && cache.getStatistics().prefetched_blocks == 16);
+
+    // The blocks after the cached ones are read ahead. A read of them waits for the read-ahead instead of reading
+    // them again.
+    CHECK(disk.async_read_count == 2 && disk.getPendingCount() == 1);
+    CHECK(cache.readBlocks(112, 14, buffer) == Status::Success && matches(disk, 112 * block_size, buffer, 14 * block_size));
+    CHECK(disk.read_count == 2 && cache.getStatistics().prefetched_blocks == 20);
+
+    // A medium changed while a read-ahead is in flight: the blocks it brings back belong to the old medium.
+    CHECK(disk.getPendingCount() == 1);
+    ++disk.media.media_id;
+    for (auto& byte : disk.data)
+        byte ^= 0x5A;
+
+    CHECK(cache.readBlocks(500, 1, buffer) == Status::MediaChanged && disk.getPendingCount() == 0);
+    CHECK(cache.getStatistics().prefetched_blocks == 20);
+    CHECK(cache.readBlocks(128, 8, buffer) == Status::Success && matches(disk, 128 * block_size, buffer, 8 * block_size));
+
+    cache.shutdown();
+    return 0;
+}
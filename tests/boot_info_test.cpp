@@ -0,0 +1,193 @@
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "mock_firmware.h"
+#include "test.h"
+
+using namespace Uefi;
+using MemoryDescriptor = BootServices::MemoryDescriptor;
+
+namespace {
+    /// Larger than MemoryDescriptor, as the specification allows: readers must step by the size the firmware gives.
+    constexpr size_t descriptor_size = 48;
+
+    std::vector<MemoryDescriptor> firmware_map;
+    size_t map_calls = 0;
+    size_t exit_calls = 0;
+    /// exitBootServices() calls which fail, each after the map gained a descriptor.
+    size_t exit_failures = 0;
+
+    Status getFirmwareMemoryMap(size_t& size, MemoryDescriptor* map, size_t& key, size_t& entry_size, uint32_t& version) {
+        ++map_calls;
+        key = map_calls;
+        entry_size = descriptor_size;
+        version = 1;
+
+        const auto needed = firmware_map.size() * descriptor_size;
+        if (size < needed || map == nullptr) {
+            size = needed;
+            return Status::BufferTooSmall;
+        }
+
+        size = needed;
+        auto* bytes = reinterpret_cast<uint8_t*>(map);
+        for (size_t i = 0; i < firmware_map.size(); ++i) {
+            std::memset(bytes + (i * descriptor_size), 0xAB, descriptor_size);
+            std::memcpy(bytes + (i * descriptor_size), &firmware_map[i], sizeof(MemoryDescriptor));
+        }
+
+        return Status::Success;
+    }
+
+    /// Mock pages, which show in the map.
+    Status allocatePages(BootServices::AllocateType type, MemoryType memory_type, size_t pages, BootServices::PhysicalAddress& memory) {
+        const auto status = Test::MockPages::allocatePages(type, memory_type, pages, memory);
+        if (status == Status::Success)
+            firmware_map.push_back({memory_type, 0, memory, 0, pages, MemoryAttribute{}});
+
+        return status;
+    }
+
+    Status exitBootServices(Handle, size_t key) {
+        ++exit_calls;
+        if (exit_failures != 0) {
+            --exit_failures;
+            firmware_map.push_back({MemoryType::BootServicesData, 0, 0x5000000 + (0x1000 * exit_calls), 0, 1, MemoryAttribute{}});
+            return Status::InvalidParameter;
+        }
+
+        return key == map_calls ? Status::Success : Status::InvalidParameter;
+    }
+
+    Status failGetMemoryMap(size_t&, MemoryDescriptor*, size_t&, size_t&, uint32_t&) {
+        return Status::DeviceError;
+    }
+
+    /// A copy of a blob, 8-byte aligned.
+    std::vector<uint64_t> copyBlob(const BootInfo& info) {
+        std::vector<uint64_t> copy((info.size + 7) / 8);
+        std::memcpy(copy.data(), &info, info.size);
+        return copy;
+    }
+} // namespace
+
+int main() {
+    Test::MockTable<BootServices> boot_services_table;
+    Test::MockPages::install(boot_services_table);
+    boot_services_table.set(Test::BootServicesOffset::allocate_pages, &allocatePages);
+    boot_services_table.set(Test::BootServicesOffset::get_memory_map, &getFirmwareMemoryMap);
+    boot_services_table.set(Test::BootServicesOffset::exit_boot_services, &exitBootServices);
+    auto& boot_services = boot_services_table.get();
+
+    static uint8_t rsdp1[8], rsdp2[8], smbios2[8], smbios3[8];
+    ConfigurationTable tables[] = {{acpi1_guid, rsdp1}, {smbios_guid, smbios2}, {acpi2_guid, rsdp2}};
+    Test::MockTable<SystemTable> system_table_storage;
+    auto& system_table = system_table_storage.get();
+    system_table.table_entry_count = 3;
+    system_table.configuration_table = tables;
+
+    // Out of order, with neighbours of the same type, and neighbours which differ in type or in attributes.
+    constexpr auto write_back = MemoryAttribute::WriteBack;
+    firmware_map = {
+        {MemoryType::ConventionalMemory, 0, 0x200000, 0, 16, write_back}, {MemoryType::ConventionalMemory, 0, 0x0, 0, 16, write_back},
+        {MemoryType::ConventionalMemory, 0, 0x10000, 0, 16, write_back},  {MemoryType::LoaderCode, 0, 0x100000, 0, 4, write_back},
+        {MemoryType::ConventionalMemory, 0, 0x210000, 0, 16, write_back}, {MemoryType::ConventionalMemory, 0, 0x104000, 0, 236, write_back},
+        {MemoryType::ConventionalMemory, 0, 0x220000, 0, 16, MemoryAttribute{}},
+    };
+
+    BootInfoBuilder builder;
+    builder.initialize(system_table);
+    uint32_t pixels[4];
+    builder.setFramebuffer({pixels, 800, 600, 832, {0xFF0000, 0xFF00, 0xFF, 0}});
+
+    // Every UTF-8 length, and an unpaired surrogate.
+    std::u16string command_line = u"root=/dev/sda1 name=café € \U0001F600 ";
+    command_line += static_cast<char16_t>(0xD800);
+    command_line += u"!";
+    builder.setCommandLine(command_line.c_str());
+    builder.setInitrd(0x4000000, 12345);
+
+    // The map changes twice before exitBootServices() succeeds.
+    exit_failures = 2;
+    CHECK(builder.getBootInfo() == nullptr);
+    CHECK(builder.allocate(boot_services) == Status::Success);
+    CHECK(builder.exitBootServices(boot_services, nullptr) == Status::Success && exit_calls == 3);
+
+    const auto* info = BootInfo::validate(builder.getBootInfo());
+    CHECK(info != nullptr && info == builder.getBootInfo() && info->version == BootInfo::current_version);
+    CHECK(info->system_table == reinterpret_cast<uintptr_t>(&system_table));
+    CHECK(info->acpi_rsdp == reinterpret_cast<uintptr_t>(rsdp2));
+    CHECK(info->smbios_entry_point == reinterpret_cast<uintptr_t>(smbios2) && info->smbios_major_version == 2);
+    CHECK(info->framebuffer.base == reinterpret_cast<uintptr_t>(pixels) && info->framebuffer.width == 800 && info->framebuffer.height == 600);
+    CHECK(info->framebuffer.pixels_per_scan_line == 832 && info->framebuffer.red_mask == 0xFF0000 && info->framebuffer.blue_mask == 0xFF);
+    CHECK(info->initrd_base == 0x4000000 && info->initrd_size == 12345);
+    CHECK(std::strcmp(info->getCommandLine(), "root=/dev/sda1 name=caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80 \xef\xbf\xbd!") == 0);
+    CHECK(info->command_line.size == std::strlen(info->getCommandLine()) + 1 && info->size % 4 == 0);
+
+    // Sorted and joined: the blob's own pages, and the two descriptors the failed exits added, are in it.
+    const struct {
+        uint64_t base;
+        uint64_t page_count;
+        MemoryType type;
+    } expected[] = {
+        {0x0, 32, MemoryType::ConventionalMemory},      {0x100000, 4, MemoryType::LoaderCode},
+        {0x104000, 236, MemoryType::ConventionalMemory}, {0x200000, 32, MemoryType::ConventionalMemory},
+        {0x220000, 16, MemoryType::ConventionalMemory},  {0x5001000, 2, MemoryType::BootServicesData},
+    };
+    const auto map = info->getMemoryMap();
+    CHECK(map.getSize() == 7);
+    for (size_t i = 0; i < 6; ++i)
+        CHECK(map[i].base == expected[i].base && map[i].page_count == expected[i].page_count && map[i].type == expected[i].type);
+
+    CHECK(map[6].type == MemoryType::LoaderData && map[6].base == reinterpret_cast<uintptr_t>(info) && map[0].attributes == write_back);
+    CHECK(Test::MockPages::isAllocated(map[6].base, map[6].page_count * 0x1000));
+
+    // The blob can be moved, and any changed byte is found.
+    auto moved = copyBlob(*info);
+    const auto* moved_info = BootInfo::validate(moved.data());
+    CHECK(moved_info != nullptr && std::strcmp(moved_info->getCommandLine(), info->getCommandLine()) == 0);
+    CHECK(moved_info->getMemoryMap().getSize() == 7 && moved_info->getMemoryMap()[3].base == 0x200000);
+    for (size_t offset = 0; offset < info->size; offset += 13) {
+        auto corrupted = copyBlob(*info);
+        reinterpret_cast<uint8_t*>(corrupted.data())[offset] ^= 1;
+        CHECK(BootInfo::validate(corrupted.data()) == nullptr);
+    }
+
+    // Blocks outside the blob are refused before the CRC32 is read.
+    auto outside = copyBlob(*info);
+    reinterpret_cast<BootInfo*>(outside.data())->command_line.size = 0x10000;
+    CHECK(BootInfo::validate(outside.data()) == nullptr && BootInfo::validate(nullptr) == nullptr);
+
+    // Writing a blob directly: too small, and without a command line.
+    const MemoryMap firmware{firmware_map.size() * sizeof(MemoryDescriptor), sizeof(MemoryDescriptor), 0, firmware_map.data()};
+    uint8_t small[64];
+    CHECK(builder.write(small, sizeof(small), firmware).getStatus() == Status::BufferTooSmall);
+    builder.setCommandLine(nullptr);
+    std::vector<uint64_t> buffer((builder.getRequiredSize(firmware_map.size()) + 7) / 8);
+    const auto size = builder.write(buffer.data(), buffer.size() * 8, firmware);
+    CHECK(size && *size <= buffer.size() * 8);
+    const auto* written = BootInfo::validate(buffer.data());
+    CHECK(written != nullptr && written->size == *size && written->getCommandLine()[0] == 0 && written->command_line.size == 0);
+    CHECK(written->getMemoryMap().getSize() == 7);
+
+    // The newer entry points are preferred, and the older ones used without them.
+    ConfigurationTable newer_tables[] = {{smbios_guid, smbios2}, {smbios3_guid, smbios3}, {acpi1_guid, rsdp1}};
+    system_table.configuration_table = newer_tables;
+    builder.initialize(system_table);
+    CHECK(builder.write(buffer.data(), buffer.size() * 8, firmware).isSuccess());
+    written = BootInfo::validate(buffer.data());
+    CHECK(written->smbios_entry_point == reinterpret_cast<uintptr_t>(smbios3) && written->smbios_major_version == 3);
+    CHECK(written->acpi_rsdp == reinterpret_cast<uintptr_t>(rsdp1));
+
+    // A map which keeps changing, and a map which cannot be read.
+    CHECK(builder.allocate(boot_services) == Status::Success);
+    exit_failures = 100;
+    exit_calls = 0;
+    CHECK(builder.exitBootServices(boot_services, nullptr) == Status::InvalidParameter && exit_calls == 4);
+    CHECK(builder.getBootInfo() == nullptr);
+
+    boot_services_table.set(Test::BootServicesOffset::get_memory_map, &failGetMemoryMap);
+    CHECK(builder.allocate(boot_services) == Status::DeviceError);
+    return 0;
+}
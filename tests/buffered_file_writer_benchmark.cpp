@@ -0,0 +1,71 @@
+#include <string>
+#include <vector>
+
+#include "mock_file.h"
+#include "test.h"
+
+using namespace Uefi;
+
+namespace {
+    constexpr int repeat_count = 5;
+
+    uint8_t buffer[64 * 1024];
+
+    /// Milliseconds of the best of a few runs, each into an empty file.
+    template <typename Write>
+    double getMilliseconds(Test::MockFile& file, size_t size, Write write) {
+        double best = 1e9;
+        for (int i = 0; i < repeat_count; ++i) {
+            file.data.clear();
+            file.data.reserve(size);
+            file.position = 0;
+            file.write_count = 0;
+
+            const auto start = Test::getTime();
+            write();
+            const auto time = (Test::getTime() - start) * 1000;
+            best = time < best ? time : best;
+        }
+
+        return best;
+    }
+} // namespace
+
+int main() {
+    // A log: 200000 lines of 40 to 110 bytes, formatted beforehand.
+    std::vector<std::string> lines;
+    size_t size = 0;
+    for (int i = 0; i < 200000; ++i) {
+        lines.push_back("[" + std::to_string(i) + "] event " + std::string(30 + (i % 70), 'q') + "\n");
+        size += lines.back().size();
+    }
+
+    // One write() per line, straight to the file.
+    Test::MockFile file;
+    const auto unbuffered_time = getMilliseconds(file, size, [&] {
+        for (const auto& line : lines) {
+            auto line_size = line.size();
+            CHECK(file.write(line_size, line.data()) == Status::Success && line_size == line.size());
+        }
+    });
+    const auto expected = file.data;
+    const auto unbuffered_writes = file.write_count;
+    CHECK(unbuffered_writes == lines.size());
+
+    // Through a 64 KiB buffer: one write() per buffer.
+    const auto buffered_time = getMilliseconds(file, size, [&] {
+        BufferedFileWriter writer;
+        CHECK(writer.initialize(file, buffer, sizeof(buffer)) == Status::Success);
+        for (const auto& line : lines)
+            CHECK(writer.write(line.data(), line.size()) == Status::Success);
+
+        CHECK(writer.close() == Status::Success);
+    });
+    CHECK(file.data == expected && file.write_count == (size + sizeof(buffer) - 1) / sizeof(buffer));
+
+    // The mock's write() is a memcpy(): the firmware's, through the FAT driver and the disk, costs much more per call.
+    std::printf("%zu bytes in %zu lines\n", size, lines.size());
+    std::printf("unbuffered %7.2f ms, %6zu writes\n", unbuffered_time, unbuffered_writes);
+    std::printf("buffered   %7.2f ms, %6zu writes\n", buffered_time, file.write_count);
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "mock_file.h"
+#include "test.h"
+
+using namespace Uefi;
+
+namespace {
+    uint8_t buffer[64 * 1024];
+
+    std::vector<uint8_t> toBytes(const std::string& string) {
+        return {string.begin(), string.end()};
+    }
+} // namespace
+
+int main() {
+    // Mixed sizes, print(), and writes bigger than the buffer, appended to an existing file which is preallocated
+    // and then cut back to what was written.
+    {
+        Test::MockFile file(std::vector<uint8_t>(100, 'x'));
+        file.position = 100;
+        auto expected = file.data;
+        const std::vector<uint8_t> big = [] {
+            std::vector<uint8_t> bytes(200000);
+            for (size_t i = 0; i < bytes.size(); ++i)
+                bytes[i] = static_cast<uint8_t>(i * 7);
+
+            return bytes;
+        }();
+
+        {
+            BufferedFileWriter writer;
+            CHECK(writer.initialize(file, buffer, sizeof(buffer)) == Status::Success);
+            CHECK(writer.preallocate(10 << 20) == Status::Success && file.data.size() == 100 + (10 << 20));
+
+            for (int i = 0; i < 5000; ++i) {
+                const auto line = toBytes("line " + std::to_string(i) + " " + std::string(i % 70, 'z') + "\n");
+                CHECK(writer.write(line.data(), line.size()) == Status::Success);
+                expected.insert(expected.end(), line.begin(), line.end());
+
+                if (i % 1000 == 999) {
+                    CHECK(writer.write(big.data(), big.size()) == Status::Success);
+                    expected.insert(expected.end(), big.begin(), big.end());
+                }
+            }
+
+            CHECK(print(writer, UEFI_FORMAT("{} done\r\n"), 42) == Status::Success);
+            const char16_t* done = u"42 done\r\n";
+            expected.insert(expected.end(), reinterpret_cast<const uint8_t*>(done), reinterpret_cast<const uint8_t*>(done) + 18);
+            CHECK(writer.getWrittenSize() == expected.size() - 100);
+        }
+
+        CHECK(file.closed && file.data == expected && file.set_info_count == 2);
+    }
+
+    // Preallocating less than the file holds changes nothing, and close() keeps the data after the writes.
+    {
+        std::vector<uint8_t> contents(10000);
+        for (size_t i = 0; i < contents.size(); ++i)
+            contents[i] = static_cast<uint8_t>(i);
+
+        Test::MockFile file(contents);
+        {
+            BufferedFileWriter writer;
+            CHECK(writer.initialize(file, buffer, sizeof(buffer)) == Status::Success);
+            CHECK(writer.preallocate(2000) == Status::Success);
+            CHECK(writer.write("hello", 5) == Status::Success);
+        }
+
+        std::memcpy(contents.data(), "hello", 5);
+        CHECK(file.closed && file.data == contents && file.set_info_count == 0);
+    }
+
+    // Growing a file partly written over: close() cuts back to its original size, not to the writes.
+    {
+        Test::MockFile file(std::vector<uint8_t>(10000, 'o'));
+        {
+            BufferedFileWriter writer;
+            CHECK(writer.initialize(file, buffer, sizeof(buffer)) == Status::Success);
+            CHECK(writer.preallocate(50000) == Status::Success && file.data.size() == 50000);
+            CHECK(writer.preallocate(20000) == Status::Success && file.data.size() == 50000);
+            CHECK(writer.write("hello", 5) == Status::Success);
+        }
+
+        CHECK(file.data.size() == 10000 && std::memcmp(file.data.data(), "hellooo", 7) == 0);
+    }
+
+    // The firmware takes 700 bytes at a time and succeeds: nothing in the buffer is overwritten or skipped.
+    {
+        Test::MockFile file;
+        file.max_write_size = 700;
+        std::vector<uint8_t> expected;
+        {
+            BufferedFileWriter writer;
+            CHECK(writer.initialize(file, buffer, 1000) == Status::Success);
+            for (size_t i = 0; i < 300; ++i) {
+                const std::vector<uint8_t> piece((i * 37) % 2500 + 1, static_cast<uint8_t>(i));
+                CHECK(writer.write(piece.data(), piece.size()) == Status::Success);
+                expected.insert(expected.end(), piece.begin(), piece.end());
+            }
+
+            CHECK(writer.flush() == Status::Success);
+            CHECK(file.data == expected);
+        }
+
+        CHECK(file.data == expected);
+    }
+
+    // An error keeps what the firmware did not take in the buffer, for the next write.
+    {
+        Test::MockFile file;
+        BufferedFileWriter writer;
+        CHECK(writer.initialize(file, buffer, 1000) == Status::Success);
+        const std::vector<uint8_t> start(999, 1);
+        CHECK(writer.write(start.data(), start.size()) == Status::Success);
+
+        file.max_write_size = 500;
+        file.write_status = Status::VolumeFull;
+        CHECK(writer.write("abc", 3) == Status::VolumeFull);
+        CHECK(writer.getWrittenSize() == 1000 && file.data.size() == 500);
+
+        file.max_write_size = SIZE_MAX;
+        file.write_status = Status::Success;
+        CHECK(writer.flush() == Status::Success && file.flush_count == 1 && file.data.size() == 1000);
+
+        // A write which takes nothing, yet succeeds, is an error rather than a hang.
+        file.max_write_size = 0;
+        const std::vector<uint8_t> big(5000, 2);
+        CHECK(writer.write(big.data(), big.size()) == Status::DeviceError);
+        CHECK(writer.getWrittenSize() == 1000);
+        file.max_write_size = SIZE_MAX;
+        CHECK(writer.close() == Status::Success && file.closed);
+    }
+
+    // Many small writes cost one write per buffer.
+    {
+        Test::MockFile file;
+        {
+            BufferedFileWriter writer;
+            CHECK(writer.initialize(file, buffer, sizeof(buffer)) == Status::Success);
+            for (int i = 0; i < 200000; ++i) {
+                const auto line = toBytes("[" + std::to_string(i) + "] event " + std::string(30 + (i % 70), 'q') + "\n");
+                CHECK(writer.write(line.data(), line.size()) == Status::Success);
+            }
+        }
+
+        CHECK(file.write_count == (file.data.size() + sizeof(buffer) - 1) / sizeof(buffer));
+    }
+
+    return 0;
+}
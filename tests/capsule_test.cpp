@@ -0,0 +1,164 @@
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "mock_firmware.h"
+#include "test.h"
+
+using namespace Uefi;
+using CapsuleHeader = RuntimeServices::CapsuleHeader;
+using CapsuleBlockDescriptor = RuntimeServices::CapsuleBlockDescriptor;
+
+namespace {
+    uint64_t max_capsule_size = uint64_t{1} << 30;
+    RuntimeServices::PhysicalAddress submitted_list = 0;
+    size_t submitted_count = 0;
+
+    Status queryCapsuleCapabilities(CapsuleHeader**, size_t, uint64_t* max_size, RuntimeServices::ResetType* reset_type) {
+        *max_size = max_capsule_size;
+        *reset_type = RuntimeServices::ResetType::Warm;
+        return Status::Success;
+    }
+
+    Status updateCapsule(CapsuleHeader**, size_t capsule_count, RuntimeServices::PhysicalAddress scatter_gather_list) {
+        submitted_list = scatter_gather_list;
+        submitted_count = capsule_count;
+        return Status::Success;
+    }
+
+    /// Gathers the bytes of a scatter-gather list as the firmware does, following the continuation descriptors.
+    /// @return false The list does not end.
+    bool gather(RuntimeServices::PhysicalAddress list, std::vector<uint8_t>& bytes, size_t& block_count) {
+        const auto* descriptor = reinterpret_cast<const CapsuleBlockDescriptor*>(static_cast<uintptr_t>(list));
+        block_count = 0;
+        for (size_t i = 0; i < 100000; ++i) {
+            if (descriptor->length == 0) {
+                if (descriptor->address == 0)
+                    return true;
+
+                descriptor = reinterpret_cast<const CapsuleBlockDescriptor*>(static_cast<uintptr_t>(descriptor->address));
+                continue;
+            }
+
+            const auto* data = reinterpret_cast<const uint8_t*>(static_cast<uintptr_t>(descriptor->address));
+            bytes.insert(bytes.end(), data, data + descriptor->length);
+            ++block_count;
+            ++descriptor;
+        }
+
+        return false;
+    }
+} // namespace
+
+int main() {
+    Test::MockTable<BootServices> boot_services_table;
+    Test::MockPages::install(boot_services_table);
+    auto& boot_services = boot_services_table.get();
+    Test::MockTable<RuntimeServices> runtime_services_table;
+    runtime_services_table.set(Test::RuntimeServicesOffset::query_capsule_capabilities, &queryCapsuleCapabilities);
+    runtime_services_table.set(Test::RuntimeServicesOffset::update_capsule, &updateCapsule);
+    auto& runtime_services = runtime_services_table.get();
+    std::mt19937 random(3);
+
+    // A capsule file loaded whole: its header, then 3 MiB of image.
+    std::vector<uint8_t> file(sizeof(CapsuleHeader) + (3 << 20));
+    for (auto& byte : file)
+        byte = static_cast<uint8_t>(random());
+
+    auto& whole = *reinterpret_cast<CapsuleHeader*>(file.data());
+    whole.header_size = sizeof(CapsuleHeader);
+    whole.flags = CapsuleHeader::persist_across_reset;
+    whole.image_size = static_cast<uint32_t>(file.size());
+
+    // A header with extra data of its own, separate from a body in 5 fragments: two of them adjacent, one empty.
+    struct {
+        CapsuleHeader header;
+        uint8_t extra[8];
+    } separate{};
+    separate.header.header_size = sizeof(separate);
+    separate.header.flags = CapsuleHeader::persist_across_reset;
+    std::memset(separate.extra, 0xEE, sizeof(separate.extra));
+
+    std::vector<uint8_t> loaded(4 << 20);
+    for (auto& byte : loaded)
+        byte = static_cast<uint8_t>(random());
+
+    const CapsuleFragment fragments[] = {
+        {loaded.data(), 1000}, {loaded.data() + 1000, 5000}, {loaded.data() + 100000, 0}, {loaded.data() + 200000, 70000}, {loaded.data() + 3000000, 123},
+    };
+    size_t body_size = 0;
+    for (const auto& fragment : fragments)
+        body_size += fragment.size;
+
+    separate.header.image_size = static_cast<uint32_t>(sizeof(separate) + body_size);
+
+    CapsuleBuilder builder;
+    builder.initialize();
+    CHECK(builder.add(whole) == Status::Success && builder.add(separate.header, {fragments, 5}) == Status::Success);
+    auto inconsistent = separate.header;
+    ++inconsistent.image_size;
+    CHECK(builder.add(inconsistent, {fragments, 5}) == Status::InvalidParameter);
+    inconsistent = whole;
+    inconsistent.header_size = 4;
+    CHECK(builder.add(inconsistent) == Status::InvalidParameter && builder.getCapsuleCount() == 2);
+
+    CHECK(builder.submit(runtime_services) == Status::NotReady && builder.getScatterGatherList() == 0);
+    CHECK(builder.build(boot_services) == Status::Success);
+    RuntimeServices::ResetType reset_type;
+    CHECK(builder.validate(runtime_services, reset_type) == Status::Success && reset_type == RuntimeServices::ResetType::Warm);
+    CHECK(builder.submit(runtime_services) == Status::Success && submitted_list == builder.getScatterGatherList() && submitted_count == 2);
+
+    // The firmware finds the capsules one after the other, and the descriptors point into the buffers: nothing was
+    // copied, the adjacent fragments were merged and the empty one skipped.
+    std::vector<uint8_t> expected(file);
+    expected.insert(expected.end(), reinterpret_cast<const uint8_t*>(&separate), reinterpret_cast<const uint8_t*>(&separate + 1));
+    for (const auto& fragment : fragments)
+        expected.insert(expected.end(), static_cast<const uint8_t*>(fragment.data), static_cast<const uint8_t*>(fragment.data) + fragment.size);
+
+    std::vector<uint8_t> gathered;
+    size_t block_count = 0;
+    CHECK(gather(submitted_list, gathered, block_count) && gathered == expected);
+    const auto descriptors = builder.getDescriptors();
+    CHECK(block_count == 5 && descriptors.getSize() == 5);
+    CHECK(descriptors[0].address == reinterpret_cast<uintptr_t>(file.data()) && descriptors[0].length == file.size());
+    CHECK(descriptors[1].address == reinterpret_cast<uintptr_t>(&separate) && descriptors[1].length == sizeof(separate));
+    CHECK(descriptors[2].address == reinterpret_cast<uintptr_t>(loaded.data()) && descriptors[2].length == 6000);
+    CHECK(Test::MockPages::isAllocated(builder.getScatterGatherList(), 6 * sizeof(CapsuleBlockDescriptor)));
+
+    // Too big for the firmware.
+    max_capsule_size = 1 << 20;
+    CHECK(builder.validate(runtime_services, reset_type) == Status::Unsupported);
+
+    // Many fragments: the list spans several pages, in a single allocation.
+    std::vector<CapsuleFragment> many;
+    for (size_t i = 0; i < 1000; ++i)
+        many.push_back({loaded.data() + (i * 4000), 100});
+
+    CapsuleHeader header{};
+    header.header_size = sizeof(header);
+    header.image_size = sizeof(header) + 100000;
+    CapsuleBuilder fragmented;
+    fragmented.initialize();
+    CHECK(fragmented.add(header, {many.data(), many.size()}) == Status::Success);
+    CHECK(fragmented.build(boot_services) == Status::Success);
+    gathered.clear();
+    CHECK(gather(fragmented.getScatterGatherList(), gathered, block_count) && block_count == 1001 && gathered.size() == header.image_size);
+    CHECK(Test::MockPages::isAllocated(fragmented.getScatterGatherList(), 1002 * sizeof(CapsuleBlockDescriptor)));
+
+    // Building again replaces the list, and a failed allocation leaves none.
+    CHECK(builder.build(boot_services) == Status::Success && Test::MockPages::getOutstandingCount() == 2);
+    Test::MockPages::failAllocations() = true;
+    CHECK(builder.build(boot_services) == Status::OutOfResources && builder.getScatterGatherList() == 0);
+    CHECK(builder.submit(runtime_services) == Status::NotReady);
+    Test::MockPages::failAllocations() = false;
+
+    builder.release(boot_services);
+    fragmented.release(boot_services);
+    CHECK(Test::MockPages::getOutstandingCount() == 0);
+
+    for (size_t i = 2; i < CapsuleBuilder::max_capsule_count; ++i)
+        CHECK(builder.add(whole) == Status::Success);
+
+    CHECK(builder.add(whole) == Status::OutOfResources && builder.getCapsuleCount() == CapsuleBuilder::max_capsule_count);
+    return 0;
+}
@@ -0,0 +1,45 @@
+# Disassembles the result_codegen object, and compares its functions in pairs: a call through its Result overload must
+# read and write memory no more often than through its Status overload with an out-parameter, so that the Result
+# itself never reaches memory. Both use a stack slot for what the firmware writes back.
+# The instruction counts are printed too. They may differ by register allocation: keeping an address in a callee-saved
+# register, or loading the value before testing the status.
+# Usage: cmake -DOBJDUMP=<objdump> -DOBJECT=<result_codegen.o> -P check_result_codegen.cmake
+
+execute_process(COMMAND ${OBJDUMP} -d --no-show-raw-insn ${OBJECT} OUTPUT_VARIABLE disassembly RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${OBJDUMP} failed on ${OBJECT}")
+endif()
+
+string(REPLACE "\n" ";" lines "${disassembly}")
+set(function "")
+foreach(line IN LISTS lines)
+    if(line MATCHES "^[0-9a-f]+ <([a-z_]+)>:$")
+        set(function ${CMAKE_MATCH_1})
+        set(instructions_${function} 0)
+        set(accesses_${function} 0)
+    elseif(function AND line MATCHES "^ +[0-9a-f]+:\t" AND NOT line MATCHES "\t(nop|xchg +%ax,%ax)")
+        math(EXPR instructions_${function} "${instructions_${function}} + 1")
+
+        # Memory operands, except the function pointers of the calls and the addresses taken by lea.
+        if(line MATCHES "\\(%" AND NOT line MATCHES "\t(call|lea)")
+            math(EXPR accesses_${function} "${accesses_${function}} + 1")
+        endif()
+    endif()
+endforeach()
+
+set(failed FALSE)
+foreach(name allocate_pages create_event open_volume read_all get_position)
+    if(NOT DEFINED instructions_result_${name} OR NOT DEFINED instructions_raw_${name})
+        message(FATAL_ERROR "${name} is missing from ${OBJECT}")
+    endif()
+
+    message(STATUS "${name}: Result ${instructions_result_${name}} instructions, ${accesses_result_${name}} memory accesses | "
+                   "out-parameter ${instructions_raw_${name}} instructions, ${accesses_raw_${name}} memory accesses")
+    if(accesses_result_${name} GREATER accesses_raw_${name})
+        set(failed TRUE)
+    endif()
+endforeach()
+
+if(failed)
+    message(FATAL_ERROR "A Result reaches memory")
+endif()
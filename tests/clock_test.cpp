@@ -0,0 +1,92 @@
+#include <chrono>
+#include <thread>
+
+#include "mock_firmware.h"
+#include "test.h"
+
+using namespace Uefi;
+
+namespace {
+    size_t stall_count = 0;
+
+    Status stall(size_t microseconds) {
+        ++stall_count;
+        std::this_thread::sleep_for(std::chrono::microseconds(microseconds));
+        return Status::Success;
+    }
+
+    /// Two seconds before a new year, in UTC+1 with daylight saving time.
+    Status getTime(Time& time, TimeCapabilities*) {
+        time = {};
+        time.year = 2024;
+        time.month = 12;
+        time.day = 31;
+        time.hour = 23;
+        time.minute = 59;
+        time.second = 58;
+        time.nanosecond = 900000000;
+        time.timezone = 60;
+        time.daylight = 1;
+        return Status::Success;
+    }
+
+    double getRelativeError(double value, double expected) {
+        return (value > expected ? value - expected : expected - value) / expected;
+    }
+} // namespace
+
+int main() {
+    static_assert(Detail::daysFromCivil(1970, 1, 1) == 0);
+    static_assert(Detail::daysFromCivil(2000, 3, 1) == 11017);
+    for (int64_t days = -800000; days < 800000; ++days) {
+        int64_t year;
+        unsigned month, day;
+        Detail::civilFromDays(days, year, month, day);
+        CHECK(Detail::daysFromCivil(year, month, day) == days);
+    }
+
+    Test::MockTable<BootServices> boot_services;
+    boot_services.set(Test::BootServicesOffset::stall, &stall);
+    Test::MockTable<RuntimeServices> runtime_services;
+    runtime_services.set(Test::RuntimeServicesOffset::get_time, &getTime);
+
+    Clock clock;
+    CHECK(clock.initialize(boot_services.get(), nullptr, 0) == Status::InvalidParameter);
+    CHECK(stall_count == 0);
+
+    CHECK(clock.initialize(boot_services.get(), &runtime_services.get()) == Status::Success);
+    CHECK(clock.getFrequency() > 0);
+
+    // The conversion holds over long spans, without overflowing.
+    const auto frequency = clock.getFrequency();
+    CHECK(getRelativeError(static_cast<double>(clock.toNanoseconds(frequency)), 1e9) < 1e-6);
+    CHECK(getRelativeError(static_cast<double>(clock.toNanoseconds(frequency * 36000)), 3.6e13) < 1e-6);
+
+    // Against the host's clock. Calibrating with a sleep only overestimates the time taken, so allow a margin.
+    const auto host_start = std::chrono::steady_clock::now();
+    const auto start = clock.now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1200));
+    const auto elapsed = static_cast<double>(clock.now() - start);
+    const auto host_elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - host_start).count();
+    std::printf("%.0f ns measured, %.0f ns on the host, frequency %llu Hz\n", elapsed, host_elapsed, static_cast<unsigned long long>(frequency));
+    CHECK(getRelativeError(elapsed, host_elapsed) < 0.1);
+
+    // 1.2 seconds later, the year changed, and the time zone stayed.
+    Time time;
+    CHECK(clock.getWallClock(time));
+    CHECK(time.year == 2025 && time.month == 1 && time.day == 1 && time.hour == 0 && time.minute == 0 && time.second <= 1);
+    CHECK(time.timezone == 60 && time.daylight == 1);
+
+    uint64_t previous = 0;
+    for (int i = 0; i < 1000000; ++i) {
+        const auto value = clock.now();
+        CHECK(value >= previous);
+        previous = value;
+    }
+
+    // Without the runtime services, there is no wall clock.
+    CHECK(clock.initialize(boot_services.get()) == Status::Success);
+    CHECK(!clock.getWallClock(time));
+
+    return 0;
+}
@@ -0,0 +1,162 @@
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "mock_firmware.h"
+#include "test.h"
+
+using namespace Uefi;
+
+namespace {
+    constexpr int repeat_count = 5;
+
+    /// Nanoseconds per operation, the best of a few runs.
+    template <typename Function>
+    double getNanoseconds(size_t operation_count, Function function) {
+        double best = 1e9;
+        for (int i = 0; i < repeat_count; ++i) {
+            const auto start = Test::getTime();
+            function();
+            const auto time = (Test::getTime() - start) / static_cast<double>(operation_count) * 1e9;
+            best = time < best ? time : best;
+        }
+
+        return best;
+    }
+
+    struct Entry {
+        uint64_t key;
+        uint64_t value;
+    };
+
+    /// Keeps the results, so that they are not optimized away.
+    volatile uint64_t sink;
+} // namespace
+
+int main() {
+    Test::MockTable<BootServices> boot_services_table;
+    Test::MockPages::install(boot_services_table);
+    auto& boot_services = boot_services_table.get();
+    PageArena arena;
+    std::mt19937_64 random(7);
+
+    // Lookups of keys which are all present, in a random order: where the hash table overtakes a scan of an array.
+    std::printf("lookups          FlatMap   linear scan\n");
+    for (const size_t size : {4, 16, 64, 256, 4096}) {
+        arena.initialize(boot_services);
+        FlatMap<uint64_t, uint64_t, PageArena> map;
+        CHECK(map.initialize(arena, size));
+        std::vector<Entry> entries;
+        for (size_t i = 0; i < size; ++i) {
+            entries.push_back({random(), i});
+            CHECK(map.insert(entries.back().key, i) != nullptr);
+        }
+
+        std::vector<uint64_t> keys;
+        for (size_t i = 0; i < 100000; ++i)
+            keys.push_back(entries[random() % size].key);
+
+        uint64_t map_sum = 0, scan_sum = 0;
+        const auto map_time = getNanoseconds(keys.size(), [&] {
+            for (const auto key : keys)
+                map_sum += *map.find(key);
+        });
+        const auto scan_time = getNanoseconds(keys.size(), [&] {
+            for (const auto key : keys) {
+                for (const auto& entry : entries) {
+                    if (entry.key == key) {
+                        scan_sum += entry.value;
+                        break;
+                    }
+                }
+            }
+        });
+        CHECK(map_sum == scan_sum);
+        std::printf("%4zu keys  %9.1f ns  %9.1f ns\n", size, map_time, scan_time);
+        sink = map_sum;
+        arena.release();
+    }
+
+    // Filling and summing 64 items: the vectors against a plain array.
+    constexpr size_t item_count = 64;
+    constexpr size_t fill_count = 100000;
+    arena.initialize(boot_services);
+    Vector<uint32_t, PageArena> vector;
+    vector.initialize(arena);
+    CHECK(vector.reserve(item_count));
+    StaticVector<uint32_t, item_count> static_vector;
+    uint32_t array[item_count];
+    uint64_t sums[3] = {};
+
+    const auto vector_time = getNanoseconds(fill_count * item_count, [&] {
+        for (size_t i = 0; i < fill_count; ++i) {
+            vector.clear();
+            for (uint32_t j = 0; j < item_count; ++j)
+                vector.pushBack(j ^ static_cast<uint32_t>(i));
+
+            for (const auto item : vector)
+                sums[0] += item;
+        }
+    });
+    const auto static_vector_time = getNanoseconds(fill_count * item_count, [&] {
+        for (size_t i = 0; i < fill_count; ++i) {
+            static_vector.clear();
+            for (uint32_t j = 0; j < item_count; ++j)
+                static_vector.pushBack(j ^ static_cast<uint32_t>(i));
+
+            for (const auto item : static_vector)
+                sums[1] += item;
+        }
+    });
+    const auto array_time = getNanoseconds(fill_count * item_count, [&] {
+        for (size_t i = 0; i < fill_count; ++i) {
+            size_t size = 0;
+            for (uint32_t j = 0; j < item_count; ++j)
+                array[size++] = j ^ static_cast<uint32_t>(i);
+
+            for (size_t j = 0; j < size; ++j)
+                sums[2] += array[j];
+        }
+    });
+    CHECK(sums[0] == sums[1] && sums[1] == sums[2]);
+    std::printf("push and sum     Vector %.2f ns | StaticVector %.2f ns | array %.2f ns, per item\n", vector_time, static_vector_time,
+                array_time);
+    sink = sums[0];
+    arena.release();
+
+    // Many small allocations, freed at once, against malloc() and free() of each one. The chunks come from the mock's
+    // mmap(), much slower than allocatePages(): one chunk is taken for all of them, outside the timing.
+    constexpr size_t allocation_count = 200000;
+    std::vector<void*> allocations(allocation_count);
+    std::vector<size_t> sizes(allocation_count);
+    for (auto& size : sizes)
+        size = 8 + (random() % 120);
+
+    double arena_time = 1e9;
+    for (int run = 0; run < repeat_count; ++run) {
+        arena.initialize(boot_services, MemoryType::LoaderData, allocation_count * 128 / PageArena::page_size);
+        arena.deallocate(arena.allocate(1), 1);
+        const auto start = Test::getTime();
+        for (size_t i = 0; i < allocation_count; ++i) {
+            allocations[i] = arena.allocate(sizes[i]);
+            *static_cast<uint8_t*>(allocations[i]) = 1;
+        }
+
+        const auto time = (Test::getTime() - start) / allocation_count * 1e9;
+        arena_time = time < arena_time ? time : arena_time;
+        arena.release();
+    }
+
+    const auto malloc_time = getNanoseconds(allocation_count, [&] {
+        for (size_t i = 0; i < allocation_count; ++i) {
+            allocations[i] = std::malloc(sizes[i]);
+            *static_cast<uint8_t*>(allocations[i]) = 1;
+        }
+
+        for (auto* allocation : allocations)
+            std::free(allocation);
+    });
+    CHECK(Test::MockPages::getOutstandingCount() == 0);
+    std::printf("allocate         PageArena %.1f ns | malloc and free %.1f ns, per allocation\n", arena_time, malloc_time);
+    return 0;
+}
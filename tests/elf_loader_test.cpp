@@ -0,0 +1,247 @@
+#include <cstring>
+#include <vector>
+
+#include <sys/mman.h>
+
+#include "mock_file.h"
+#include "mock_firmware.h"
+#include "test.h"
+
+using namespace Uefi;
+
+namespace {
+    constexpr uint64_t page = 0x1000;
+    constexpr uint64_t huge_page = 0x200000;
+
+    /// Free address space, for executables and fixed bases to be loaded at.
+    uint64_t findFreeAddressSpace(uint64_t size, uint64_t alignment) {
+        auto* memory = mmap(nullptr, size + alignment, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        CHECK(memory != MAP_FAILED);
+        munmap(memory, size + alignment);
+        return (reinterpret_cast<uintptr_t>(memory) + alignment - 1) & ~(alignment - 1);
+    }
+
+    uint64_t& word(uint64_t address) {
+        return *reinterpret_cast<uint64_t*>(static_cast<uintptr_t>(address));
+    }
+
+    /// An ELF64 image built in memory: the headers, then the bytes of the segments where the test puts them.
+    class Image {
+    public:
+        std::vector<uint8_t> bytes = std::vector<uint8_t>(page, 0);
+        Elf64Header header{};
+        std::vector<Elf64ProgramHeader> segments;
+
+        explicit Image(ElfType type) {
+            header.magic = Elf64Header::expected_magic;
+            header.elf_class = Elf64Header::class_64;
+            header.data_encoding = Elf64Header::little_endian;
+            header.identification_version = 1;
+            header.type = type;
+            header.machine = ElfMachine::X86_64;
+            header.version = 1;
+            header.program_header_offset = sizeof(Elf64Header);
+            header.header_size = sizeof(Elf64Header);
+            header.program_header_size = sizeof(Elf64ProgramHeader);
+        }
+
+        void addSegment(Elf64ProgramHeader::Type type, uint64_t offset, uint64_t virtual_address, uint64_t physical_address,
+                        uint64_t file_size, uint64_t memory_size, uint64_t alignment = page) {
+            Elf64ProgramHeader segment{};
+            segment.type = type;
+            segment.flags = Elf64ProgramHeader::Flags::Read;
+            segment.offset = offset;
+            segment.virtual_address = virtual_address;
+            segment.physical_address = physical_address;
+            segment.file_size = file_size;
+            segment.memory_size = memory_size;
+            segment.alignment = alignment;
+            segments.push_back(segment);
+
+            if (bytes.size() < offset + file_size)
+                bytes.resize(offset + file_size);
+        }
+
+        template <typename T>
+        void put(uint64_t offset, const T& value) {
+            if (bytes.size() < offset + sizeof(T))
+                bytes.resize(offset + sizeof(T));
+
+            std::memcpy(&bytes[offset], &value, sizeof(T));
+        }
+
+        /// The file, with the headers written in.
+        Test::MockFile getFile() {
+            header.program_header_count = static_cast<uint16_t>(segments.size());
+            put(0, header);
+            for (size_t i = 0; i < segments.size(); ++i)
+                put(header.program_header_offset + (i * sizeof(Elf64ProgramHeader)), segments[i]);
+
+            return Test::MockFile(bytes);
+        }
+    };
+
+    /// A position independent image linked at 0: one segment holding the code, the dynamic section, and
+    /// relocations which fill in words at 0x2000, and a bss.
+    Image makePositionIndependentImage(uint64_t alignment) {
+        Image image(ElfType::SharedObject);
+        image.header.entry = 0x40;
+        image.addSegment(Elf64ProgramHeader::Type::Load, 0, 0, 0, 0x3000, 0x5000, alignment);
+        image.addSegment(Elf64ProgramHeader::Type::Dynamic, 0x1000, 0x1000, 0x1000, 6 * sizeof(Elf64Dynamic), 6 * sizeof(Elf64Dynamic), 8);
+
+        const Elf64Dynamic dynamic[] = {
+            {Elf64Dynamic::Tag::Rela, 0x1100},      {Elf64Dynamic::Tag::RelaSize, 3 * sizeof(Elf64Rela)},
+            {Elf64Dynamic::Tag::RelaEntrySize, sizeof(Elf64Rela)}, {Elf64Dynamic::Tag::Relr, 0x1200},
+            {Elf64Dynamic::Tag::RelrSize, 2 * sizeof(uint64_t)},   {Elf64Dynamic::Tag::Null, 0},
+        };
+        image.put(0x1000, dynamic);
+
+        const Elf64Rela rela[] = {
+            {0x2000, elf_relocation_x86_64_relative, 0x1234},
+            {0, elf_relocation_none, 0},
+            {0x2008, elf_relocation_x86_64_relative, 0x10},
+        };
+        image.put(0x1100, rela);
+
+        // The word at 0x2010, then a bitmap of the next ones: 0x2018 and 0x2028.
+        const uint64_t relr[] = {0x2010, (0b101 << 1) | 1};
+        image.put(0x1200, relr);
+
+        const uint64_t words[] = {0, 0, 0x500, 0x600, 0x999, 0x700};
+        image.put(0x2000, words);
+        return image;
+    }
+
+    Status load(BootServices& boot_services, Image& image, ElfLoadReport& report, const ElfLoadOptions& options = {}) {
+        auto file = image.getFile();
+        auto local_options = options;
+        local_options.machine = ElfMachine::X86_64;
+        return loadElf(boot_services, file, report, local_options);
+    }
+} // namespace
+
+int main() {
+    Test::MockTable<BootServices> boot_services_table;
+    Test::MockPages::install(boot_services_table);
+    auto& boot_services = boot_services_table.get();
+    ElfLoadReport report;
+
+    // An executable is loaded at its physical addresses, its bss is zeroed, and each segment is one read.
+    {
+        const auto base = findFreeAddressSpace(0x5000, page);
+        constexpr uint64_t link_address = 0xFFFFFFFF80000000;
+        Image image(ElfType::Executable);
+        image.header.entry = link_address + 0x10;
+        image.addSegment(Elf64ProgramHeader::Type::Load, page, link_address, base, 0x1800, 0x1800);
+        image.addSegment(Elf64ProgramHeader::Type::Load, 3 * page, link_address + 0x2000, base + 0x2000, 0x100, 0x3000);
+        for (uint64_t i = 0; i < 0x1800; ++i)
+            image.bytes[page + i] = static_cast<uint8_t>(i * 3);
+
+        std::memset(&image.bytes[3 * page], 0x77, 0x100);
+
+        auto file = image.getFile();
+        CHECK(loadElf(boot_services, file, report, {MemoryType::LoaderCode, 0, ElfMachine::X86_64}) == Status::Success);
+        CHECK(report.base == base && report.page_count == 5 && report.load_bias == 0);
+        CHECK(report.entry_point == link_address + 0x10 && report.physical_entry_point == base + 0x10);
+        CHECK(report.segment_count == 2 && report.relocation_count == 0);
+        CHECK(report.bytes_read == 0x1900 && report.bytes_zeroed == 0x2F00);
+        CHECK(file.read_count == 3);
+
+        const auto* memory = reinterpret_cast<const uint8_t*>(static_cast<uintptr_t>(base));
+        CHECK(std::memcmp(memory, &image.bytes[page], 0x1800) == 0);
+        for (uint64_t i = 0x2000; i < 0x5000; ++i)
+            CHECK(memory[i] == (i < 0x2100 ? 0x77 : 0));
+
+        CHECK(boot_services.freePages(report.base, report.page_count) == Status::Success);
+        CHECK(Test::MockPages::getOutstandingCount() == 0);
+    }
+
+    // A position independent image is placed at its alignment, what was allocated around it is given back, and its
+    // relocations add the load bias.
+    {
+        auto image = makePositionIndependentImage(huge_page);
+        CHECK(load(boot_services, image, report) == Status::Success);
+        CHECK(report.base % huge_page == 0 && report.load_bias == report.base && report.page_count == 5);
+        CHECK(report.entry_point == report.base + 0x40 && report.physical_entry_point == report.base + 0x40);
+        CHECK(report.relocation_count == 5 && report.bytes_read == 0x3000 && report.bytes_zeroed == 0x2000);
+        CHECK(Test::MockPages::getOutstandingCount() == 1 && Test::MockPages::isAllocated(report.base, 5 * page));
+
+        const auto bias = report.load_bias;
+        CHECK(word(bias + 0x2000) == bias + 0x1234 && word(bias + 0x2008) == bias + 0x10);
+        CHECK(word(bias + 0x2010) == bias + 0x500 && word(bias + 0x2018) == bias + 0x600);
+        CHECK(word(bias + 0x2020) == 0x999 && word(bias + 0x2028) == bias + 0x700);
+        CHECK(word(bias + 0x4FF8) == 0);
+
+        CHECK(boot_services.freePages(report.base, report.page_count) == Status::Success);
+        CHECK(Test::MockPages::getOutstandingCount() == 0);
+    }
+
+    // At a base chosen by the caller, which must respect the alignment.
+    {
+        const auto base = findFreeAddressSpace(0x5000, huge_page);
+        auto image = makePositionIndependentImage(huge_page);
+        CHECK(load(boot_services, image, report, {MemoryType::LoaderData, base + page}) == Status::InvalidParameter);
+        CHECK(load(boot_services, image, report, {MemoryType::LoaderData, base}) == Status::Success);
+        CHECK(report.base == base && report.load_bias == base && word(base + 0x2000) == base + 0x1234);
+        CHECK(boot_services.freePages(report.base, report.page_count) == Status::Success);
+    }
+
+    // Program headers beyond the first read are read on their own.
+    {
+        auto image = makePositionIndependentImage(page);
+        image.header.program_header_offset = 0x8000;
+        CHECK(load(boot_services, image, report) == Status::Success);
+        CHECK(report.relocation_count == 5 && word(report.base + 0x2018) == report.base + 0x600);
+        CHECK(boot_services.freePages(report.base, report.page_count) == Status::Success);
+    }
+
+    // Invalid images are rejected before anything is allocated.
+    {
+        auto image = makePositionIndependentImage(page);
+        image.header.magic = 0;
+        CHECK(load(boot_services, image, report) == Status::LoadError);
+
+        image = makePositionIndependentImage(page);
+        image.header.machine = ElfMachine::AArch64;
+        CHECK(load(boot_services, image, report) == Status::Unsupported);
+
+        image = makePositionIndependentImage(page);
+        image.segments[0].file_size = 0x6000;
+        CHECK(load(boot_services, image, report) == Status::LoadError);
+
+        image = makePositionIndependentImage(3 * page);
+        CHECK(load(boot_services, image, report) == Status::LoadError);
+        CHECK(Test::MockPages::getOutstandingCount() == 0);
+    }
+
+    // Failures after the allocation give the pages back: a truncated file, relocations other than relative ones,
+    // and relocations outside the image.
+    {
+        auto image = makePositionIndependentImage(page);
+        auto file = image.getFile();
+        file.data.resize(0x2800);
+        CHECK(loadElf(boot_services, file, report, {MemoryType::LoaderData, 0, ElfMachine::X86_64}) == Status::LoadError);
+        CHECK(report.base == 0 && report.page_count == 0);
+
+        image = makePositionIndependentImage(page);
+        image.put(0x1100 + offsetof(Elf64Rela, info), uint64_t{1});
+        CHECK(load(boot_services, image, report) == Status::Unsupported);
+
+        image = makePositionIndependentImage(page);
+        image.put(0x1100, uint64_t{0x5000});
+        CHECK(load(boot_services, image, report) == Status::LoadError);
+
+        image = makePositionIndependentImage(page);
+        image.put(0x1000, Elf64Dynamic{Elf64Dynamic::Tag::Rel, 0x1100});
+        CHECK(load(boot_services, image, report) == Status::Unsupported);
+
+        Test::MockPages::failAllocations() = true;
+        image = makePositionIndependentImage(page);
+        CHECK(load(boot_services, image, report) == Status::OutOfResources);
+        Test::MockPages::failAllocations() = false;
+
+        CHECK(Test::MockPages::getOutstandingCount() == 0);
+    }
+
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include <cstdint>
+#include <string>
+
+#include "test.h"
+#include "uefi.h"
+
+using namespace Uefi;
+
+namespace {
+    /// Keeps what is printed, and the number of calls it took.
+    struct Capture {
+        std::u16string text;
+        size_t call_count = 0;
+        Status status = Status::Success;
+
+        Status outputString(const char16_t* string) {
+            text += string;
+            ++call_count;
+            return status;
+        }
+    };
+
+    enum class Color : uint8_t { Red = 3 };
+
+    /// What print() writes, in a single call.
+    template <typename Format, typename... Args>
+    std::u16string format(Format format_string, const Args&... args) {
+        Capture capture;
+        CHECK(print(capture, format_string, args...) == Status::Success && capture.call_count == 1);
+        return capture.text;
+    }
+} // namespace
+
+int main() {
+    // Literals and escaped braces.
+    CHECK(format(UEFI_FORMAT("hello\r\n")) == u"hello\r\n");
+    CHECK(format(UEFI_FORMAT("{{}} {{{}}}"), 5) == u"{} {5}");
+    CHECK(format(UEFI_FORMAT(u"{}{}{}"), 1, 2, 3) == u"123");
+
+    // Widths, padded with spaces or zeroes: numbers on the left, text on the right.
+    CHECK(format(UEFI_FORMAT("[{:5}] [{:05}] [{:1}]"), 42, 42, 12345) == u"[   42] [00042] [12345]");
+    CHECK(format(UEFI_FORMAT("[{:06}] [{:6}]"), -42, -42) == u"[-00042] [   -42]");
+    CHECK(format(UEFI_FORMAT("[{:5}] [{:3}]"), u"ab", "abcd") == u"[ab   ] [abcd]");
+    CHECK(format(UEFI_FORMAT("[{:#06x}] [{:#6x}]"), 255, 255) == u"[0x00ff] [  0xff]");
+
+    // Bases, with and without their prefix.
+    CHECK(format(UEFI_FORMAT("{:x} {:X} {:b} {:o} {:d}"), 255, 255u, 5, 8, Color::Red) == u"ff FF 101 10 3");
+    CHECK(format(UEFI_FORMAT("{:#x} {:#b} {:#o} {:#X}"), 0, 5, 8, uint64_t{0xABCDEF}) == u"0x0 0b101 010 0xABCDEF");
+    CHECK(format(UEFI_FORMAT("{} {}"), INT64_MIN, UINT64_MAX) == u"-9223372036854775808 18446744073709551615");
+    CHECK(format(UEFI_FORMAT("{:064b}"), uint64_t{1} << 63) == u"1" + std::u16string(63, u'0'));
+
+    // Characters, text, pointers, booleans and statuses.
+    const char16_t* null_text = nullptr;
+    CHECK(format(UEFI_FORMAT("{}{} {} {}"), 'A', u'é', null_text, "x") == u"Aé (null) x");
+    CHECK(format(UEFI_FORMAT("{} {:018}"), reinterpret_cast<void*>(0xABC0), reinterpret_cast<const int*>(0x10)) == u"0xABC0 0x0000000000000010");
+    CHECK(format(UEFI_FORMAT("{} {} {}"), true, false, Status::NotFound) == u"true false 14");
+
+    // Non-ASCII literals are Latin-1, like non-ASCII bytes of arguments, and UCS-2 literals are kept.
+    CHECK(format(UEFI_FORMAT("caf\xe9 {}"), "caf\xe9") == u"café café");
+    CHECK(format(UEFI_FORMAT(u"ω = {} ≤ {}"), u"ω", 2) == u"ω = ω ≤ 2");
+
+    // Longer than the buffer: several calls, in order.
+    const std::u16string long_text(300, u'x');
+    Capture capture;
+    CHECK(print(capture, UEFI_FORMAT("<{}> {:#x}"), long_text.c_str(), 0x1234) == Status::Success);
+    CHECK(capture.text == u"<" + long_text + u"> 0x1234" && capture.call_count == 2);
+
+    // The first error of the output is returned.
+    capture.status = Status::DeviceError;
+    CHECK(print(capture, UEFI_FORMAT("{}"), long_text.c_str()) == Status::DeviceError);
+
+#if __cplusplus >= 202002L
+    capture = {};
+    CHECK(print<"{} pages at {:#x}\r\n">(capture, 3, 0x1000u) == Status::Success && capture.text == u"3 pages at 0x1000\r\n");
+    capture = {};
+    CHECK(print<"caf\xe9 {{{:5}}}">(capture, u"ω") == Status::Success && capture.text == u"café {ω    }");
+    capture = {};
+    CHECK(print<u"{:04X}">(capture, 0xBEEF) == Status::Success && capture.text == u"BEEF" && capture.call_count == 1);
+#endif
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include <cstring>
+#include <vector>
+
+#include "test.h"
+#include "uefi.h"
+
+using namespace Uefi;
+
+namespace {
+    constexpr uint32_t width = 40;
+    constexpr uint32_t height = 32;
+    constexpr uint32_t pitch = 48;
+    constexpr uint32_t foreground = 0xAAAAAA;
+
+    uint32_t pixels[pitch * height];
+    FramebufferConsole console;
+
+    /// Whether the cell has any pixel in the foreground color.
+    bool isCellDrawn(size_t column, size_t row) {
+        for (size_t y = 0; y < FramebufferConsole::cell_height; ++y) {
+            for (size_t x = 0; x < FramebufferConsole::cell_width; ++x) {
+                if (pixels[((row * FramebufferConsole::cell_height) + y) * pitch + (column * FramebufferConsole::cell_width) + x] == foreground)
+                    return true;
+            }
+        }
+
+        return false;
+    }
+} // namespace
+
+int main() {
+    const Framebuffer framebuffer{pixels, width, height, pitch, {0xFF0000, 0xFF00, 0xFF, 0}};
+    CHECK(console.initialize(framebuffer) == Status::Success);
+
+    size_t columns, rows;
+    CHECK(console.queryMode(0, columns, rows) == Status::Success);
+    CHECK(columns == 5 && rows == 2);
+
+    CHECK(console.outputString(u"Hi") == Status::Success);
+    CHECK(isCellDrawn(0, 0) && isCellDrawn(1, 0) && !isCellDrawn(2, 0));
+    CHECK(console.getMode().cursor_column == 2 && console.getMode().cursor_row == 0);
+
+    // Wraps at the last column, then scrolls at the last row.
+    CHECK(console.outputString(u"abcdefgh") == Status::Success);
+    CHECK(console.getMode().cursor_column == 5 && console.getMode().cursor_row == 1);
+    CHECK(console.outputString(u"\r\n\r\nX") == Status::Success);
+    CHECK(!isCellDrawn(0, 0) && isCellDrawn(0, 1) && !isCellDrawn(1, 1));
+
+    CHECK(console.outputString(u"\x100") == Status::WarnUnknownGlyph);
+
+    // A framebuffer narrower than a cell: nothing is drawn, not even outside it.
+    std::memset(pixels, 0x5A, sizeof(pixels));
+    const Framebuffer narrow{pixels, FramebufferConsole::cell_width - 1, height, pitch, {0xFF0000, 0xFF00, 0xFF, 0}};
+    CHECK(console.initialize(narrow) == Status::Unsupported);
+    CHECK(console.getColumns() == 0 && console.getRows() == 0);
+    CHECK(console.outputString(u"Hi") == Status::DeviceError);
+    for (auto pixel : pixels)
+        CHECK(pixel == 0x5A5A5A5A);
+
+    const Framebuffer short_one{pixels, width, FramebufferConsole::cell_height - 1, pitch, {0xFF0000, 0xFF00, 0xFF, 0}};
+    CHECK(console.initialize(short_one) == Status::Unsupported);
+    CHECK(console.outputString(u"Hi") == Status::DeviceError);
+    CHECK(console.setCursorPosition(0, 0) != Status::Success);
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include <cstring>
+#include <vector>
+
+#include "mock_block_io.h"
+#include "test.h"
+
+using namespace Uefi;
+
+namespace {
+    constexpr uint32_t block_size = 512;
+    constexpr size_t disk_blocks = 20000;
+    constexpr Lba last_block = disk_blocks - 1;
+
+    Guid makeUniqueId(uint32_t entry) {
+        return {entry + 1, 2, 3, {1, 2, 3, 4, 5, 6, 7, 8}};
+    }
+
+    /// Writes a header and its entry array. Every `step`th entry is used, alternating between two types.
+    void writeGpt(Test::MockDisk& disk, Lba header_lba, Lba alternate_lba, Lba entries_lba, uint32_t entry_count, uint32_t step = 3) {
+        auto* entries = reinterpret_cast<GptPartitionEntry*>(disk.getBlock(entries_lba));
+        std::memset(static_cast<void*>(entries), 0, entry_count * sizeof(GptPartitionEntry));
+        for (uint32_t i = 0; i < entry_count; i += step) {
+            entries[i].partition_type_guid = (i % 2 != 0) ? efi_system_partition_guid : linux_filesystem_partition_guid;
+            entries[i].unique_partition_guid = makeUniqueId(i);
+            entries[i].starting_lba = i;
+        }
+
+        GptHeader header{};
+        header.signature = GptHeader::expected_signature;
+        header.revision = 0x10000;
+        header.header_size = 92;
+        header.my_lba = header_lba;
+        header.alternate_lba = alternate_lba;
+        header.partition_entry_lba = entries_lba;
+        header.number_of_partition_entries = entry_count;
+        header.size_of_partition_entry = sizeof(GptPartitionEntry);
+        header.partition_entry_array_crc32 = calculateCrc32(entries, entry_count * sizeof(GptPartitionEntry));
+        header.header_crc32 = calculateCrc32(&header, 92);
+        std::memcpy(disk.getBlock(header_lba), &header, 92);
+    }
+
+    size_t countByType(const GptTable& table, const Guid& type) {
+        size_t count = 0;
+        for (auto i = table.findByType(type); i != GptTable::none; i = table.findByType(type, i + 1))
+            ++count;
+
+        return count;
+    }
+} // namespace
+
+int main() {
+    Test::MockDisk disk(disk_blocks, block_size);
+    const auto buffer_size = GptTable::getBufferSize(block_size);
+    constexpr size_t guard_size = 4096;
+    std::vector<uint64_t> buffer((buffer_size + guard_size) / sizeof(uint64_t));
+    auto* guard = reinterpret_cast<uint8_t*>(buffer.data()) + buffer_size;
+    static GptTable table;
+
+    // The usual layout: a single read.
+    writeGpt(disk, 1, last_block, 2, 128);
+    writeGpt(disk, last_block, 1, last_block - 32, 128);
+    CHECK(table.read(disk.getProtocol(), buffer.data(), buffer_size) == Status::Success);
+    CHECK(!table.isBackup() && disk.read_count == 1 && table.getEntryCount() == 128);
+    for (uint32_t i = 0; i < 128; ++i)
+        CHECK(table.findByUniqueId(makeUniqueId(i)) == (i % 3 != 0 ? GptTable::none : i));
+
+    CHECK(countByType(table, efi_system_partition_guid) == 21 && countByType(table, linux_filesystem_partition_guid) == 22);
+    CHECK(table.getEntry(table.findByType(efi_system_partition_guid)).starting_lba == 3);
+
+    // A corrupted primary header: the backup is used.
+    disk.getBlock(1)[20] ^= 1;
+    CHECK(table.read(disk.getProtocol(), buffer.data(), buffer_size) == Status::Success);
+    CHECK(table.isBackup() && table.findByUniqueId(makeUniqueId(9)) == 9);
+
+    // More entries than the usual 16 KiB, elsewhere on the disk: they need a bigger buffer.
+    writeGpt(disk, 1, last_block, 100, 400);
+    CHECK(table.read(disk.getProtocol(), buffer.data(), buffer_size) == Status::BufferTooSmall);
+    std::vector<uint64_t> big_buffer(buffer_size);
+    CHECK(table.read(disk.getProtocol(), big_buffer.data(), big_buffer.size() * sizeof(uint64_t)) == Status::Success);
+    CHECK(!table.isBackup() && table.getEntryCount() == 400 && countByType(table, linux_filesystem_partition_guid) == 67);
+
+    // One block more than usual, right after the header: the entries are read after the header block, so a
+    // buffer of getBufferSize() is one block short, and nothing is written past it.
+    writeGpt(disk, 1, last_block, 2, 132);
+    std::memset(guard, 0xEE, guard_size);
+    CHECK(table.read(disk.getProtocol(), buffer.data(), buffer_size) == Status::BufferTooSmall);
+    for (size_t i = 0; i < guard_size; ++i)
+        CHECK(guard[i] == 0xEE);
+
+    CHECK(table.read(disk.getProtocol(), buffer.data(), buffer_size + block_size) == Status::Success);
+    CHECK(table.getEntryCount() == 132 && table.findByUniqueId(makeUniqueId(131)) == GptTable::none);
+    CHECK(table.findByUniqueId(makeUniqueId(129)) == 129);
+
+    // The backup's entries are read at the start of the buffer, so the same buffer is enough for them.
+    disk.getBlock(1)[20] ^= 1;
+    writeGpt(disk, last_block, 1, last_block - 33, 132);
+    std::memset(guard, 0xEE, guard_size);
+    CHECK(table.read(disk.getProtocol(), buffer.data(), buffer_size) == Status::Success);
+    CHECK(table.isBackup() && table.getEntryCount() == 132 && table.findByUniqueId(makeUniqueId(129)) == 129);
+    for (size_t i = 0; i < guard_size; ++i)
+        CHECK(guard[i] == 0xEE);
+
+    // The most entries the index can refer to, with the last one used.
+    constexpr uint32_t max_entries = 0xFFFF;
+    std::vector<uint64_t> huge_buffer((max_entries * sizeof(GptPartitionEntry) + buffer_size) / sizeof(uint64_t));
+    writeGpt(disk, 1, last_block, 2, max_entries, max_entries - 1);
+    CHECK(table.read(disk.getProtocol(), huge_buffer.data(), huge_buffer.size() * sizeof(uint64_t)) == Status::Success);
+    CHECK(!table.isBackup() && table.findByUniqueId(makeUniqueId(max_entries - 1)) == max_entries - 1);
+    CHECK(table.findByUniqueId(makeUniqueId(0)) == 0);
+
+    // One more does not fit in the index: the table is rejected.
+    writeGpt(disk, 1, last_block, 2, max_entries + 1, max_entries);
+    disk.getBlock(last_block)[20] ^= 1;
+    CHECK(table.read(disk.getProtocol(), huge_buffer.data(), huge_buffer.size() * sizeof(uint64_t)) == Status::VolumeCorrupted);
+
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mock_firmware.h"
+#include "test.h"
+
+using namespace Uefi;
+
+namespace {
+    /// A console which keeps what it is sent, as ASCII.
+    class MockConsole : public SimpleTextOutputProtocol {
+    public:
+        std::string output;
+
+        MockConsole() {
+            _outputString = [](SimpleTextOutputProtocol* protocol, const char16_t* string) {
+                for (; *string != 0; ++string)
+                    static_cast<MockConsole*>(protocol)->output += static_cast<char>(*string);
+
+                return Status::Success;
+            };
+        }
+    };
+
+    Status stall(size_t microseconds) {
+        std::this_thread::sleep_for(std::chrono::microseconds(microseconds));
+        return Status::Success;
+    }
+
+    size_t countOccurrences(const std::string& text, const std::string& pattern) {
+        size_t count = 0;
+        for (auto position = text.find(pattern); position != std::string::npos; position = text.find(pattern, position + 1))
+            ++count;
+
+        return count;
+    }
+
+    alignas(64) uint8_t memory[LogRing::getRequiredSize(100)];
+    LogRing ring;
+} // namespace
+
+int main() {
+    static MockConsole console;
+    TextOutputStream stream;
+    stream.initialize();
+    stream.setOutput(console);
+
+    CHECK(ring.initialize(memory, LogRing::getRequiredSize(2) - 1) == Status::BufferTooSmall);
+    CHECK(ring.initialize(memory, sizeof(memory)) == Status::Success && ring.getCapacity() == 64);
+
+    // Formatting, a message cut to the capacity of a record, and the records which did not fit.
+    CHECK(ring.write(LogSeverity::Warning, UEFI_FORMAT("hello {} {:#x}"), 42, 255u));
+    const std::u16string long_text(300, u'x');
+    CHECK(ring.write(LogSeverity::Error, UEFI_FORMAT("{}"), long_text.c_str()));
+    size_t written = 2;
+    for (int i = 0; i < 70; ++i)
+        written += ring.write(LogSeverity::Debug, UEFI_FORMAT("fill {}"), i);
+
+    CHECK(written == 64 && ring.getDroppedCount() == 8);
+    CHECK(ring.drain(stream) == 64 && ring.getDroppedCount() == 0);
+    CHECK(console.output.find("] W hello 42 0xff\r\n") != std::string::npos);
+    CHECK(console.output.find("] E " + std::string(LogRecord::text_capacity, 'x') + "\r\n") != std::string::npos);
+    CHECK(console.output.find("] D fill 61\r\n") != std::string::npos && console.output.find("fill 62") == std::string::npos);
+    const std::string dropped_line = "\r\n[log] 8 records dropped\r\n";
+    CHECK(console.output.compare(console.output.size() - dropped_line.size(), dropped_line.size(), dropped_line) == 0);
+
+    // An empty ring prints nothing.
+    console.output.clear();
+    CHECK(ring.drain(stream) == 0 && console.output.empty());
+
+    // A reserved record holds back the ones after it until it is committed.
+    auto* record = ring.reserve(LogSeverity::Info);
+    CHECK(record != nullptr && record->length == 0);
+    CHECK(ring.write(LogSeverity::Info, UEFI_FORMAT("second")));
+    CHECK(ring.drain(stream) == 0);
+    CHECK(record->outputString(u"first") == Status::Success);
+    ring.commit(record);
+    CHECK(ring.drain(stream) == 2 && console.output.find("first") < console.output.find("second"));
+
+    // With a clock, the time since it was initialized, in seconds.
+    Test::MockTable<BootServices> boot_services;
+    boot_services.set(Test::BootServicesOffset::stall, &stall);
+    Clock clock;
+    CHECK(clock.initialize(boot_services.get()) == Status::Success);
+    console.output.clear();
+    CHECK(ring.write(LogSeverity::Info, UEFI_FORMAT("timed")));
+    CHECK(ring.drain(stream, &clock) == 1 && console.output.rfind("[    0.", 0) == 0 && console.output.find("] I timed\r\n") == 13);
+
+    // Producers on 4 threads, which retry the records the full ring drops, and a consumer draining at the same time:
+    // no record is lost, duplicated or reordered, and every drop is reported.
+    console.output.clear();
+    constexpr int producer_count = 4;
+    constexpr int record_count = 20000;
+    std::atomic<int> finished{0};
+    std::atomic<size_t> failures{0};
+    std::vector<std::thread> producers;
+    for (int producer = 0; producer < producer_count; ++producer) {
+        producers.emplace_back([&, producer] {
+            for (int i = 0; i < record_count; ++i) {
+                while (!ring.write(LogSeverity::Info, UEFI_FORMAT("p{} {}"), producer, i)) {
+                    ++failures;
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                }
+            }
+
+            ++finished;
+        });
+    }
+
+    size_t drained = 0;
+    while (finished != producer_count)
+        drained += ring.drain(stream);
+
+    drained += ring.drain(stream);
+    for (auto& producer : producers)
+        producer.join();
+
+    std::vector<int> last(producer_count, -1);
+    size_t line_count = 0;
+    for (auto position = console.output.find("] I p"); position != std::string::npos; position = console.output.find("] I p", position + 1)) {
+        int producer = 0, i = 0;
+        CHECK(std::sscanf(console.output.c_str() + position + 5, "%d %d", &producer, &i) == 2);
+        CHECK(producer >= 0 && producer < producer_count && i > last[producer]);
+        last[producer] = i;
+        ++line_count;
+    }
+
+    size_t dropped = 0;
+    for (auto position = console.output.find("[log] "); position != std::string::npos; position = console.output.find("[log] ", position + 1))
+        dropped += std::strtoul(console.output.c_str() + position + 6, nullptr, 10);
+
+    std::printf("%zu records drained, %zu dropped and written again\n", drained, dropped);
+    CHECK(line_count == drained && drained == producer_count * record_count && dropped == failures);
+    CHECK(countOccurrences(console.output, "\r\n") == drained + countOccurrences(console.output, "[log] "));
+
+    // What a producer pays, with room in the ring.
+    const auto start = Test::getTime();
+    for (int i = 0; i < 64; ++i)
+        CHECK(ring.write(LogSeverity::Info, UEFI_FORMAT("event {} at {:#x}"), i, uint64_t{4096} * i));
+
+    std::printf("%.0f ns per write\n", (Test::getTime() - start) * 1e9 / 64);
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "lz4_frame_writer.h"
+#include "mock_file.h"
+#include "test.h"
+
+using namespace Uefi;
+
+namespace {
+    constexpr size_t data_size = 16 * 1024 * 1024;
+    constexpr int repeat_count = 5;
+
+    /// Megabytes of output per second, the best of a few runs.
+    template <typename Function>
+    double getMegabytesPerSecond(Function function) {
+        double best = 0;
+        for (int i = 0; i < repeat_count; ++i) {
+            const auto start = Test::getTime();
+            function();
+            const auto speed = static_cast<double>(data_size) / (Test::getTime() - start) / 1e6;
+            best = speed > best ? speed : best;
+        }
+
+        return best;
+    }
+
+    Lz4Decoder decoder;
+} // namespace
+
+int main() {
+    std::mt19937 random(7);
+    const struct {
+        int kind;
+        const char* name;
+    } kinds[] = {{2, "text"}, {1, "runs"}, {0, "random"}};
+
+    std::vector<uint8_t> output(data_size);
+    std::vector<uint8_t> buffer(64 * 1024);
+    for (const auto& kind : kinds) {
+        const auto data = Test::makeData(data_size, kind.kind, random);
+        const auto compressed = Test::compressFrame(data, {256 * 1024, false, true, true, false});
+
+        // A copy of the output, for scale.
+        const auto copy = getMegabytesPerSecond([&] { std::memcpy(output.data(), data.data(), data_size); });
+
+        // The whole frame in a single decode() call.
+        const auto whole = getMegabytesPerSecond([&] {
+            decoder.initialize(output.data(), output.size());
+            CHECK(decoder.decode(compressed.data(), compressed.size()) == Status::Success && decoder.isFinished());
+        });
+        CHECK(output == data);
+
+        // Through a file read in chunks of half the buffer, which split the sequences.
+        Test::MockFile file(compressed);
+        const auto from_file = getMegabytesPerSecond([&] {
+            decoder.initialize(output.data(), output.size());
+            CHECK(decompressFile(file, decoder, buffer.data(), buffer.size()) == Status::Success);
+        });
+        CHECK(output == data);
+
+        std::printf("%-6s ratio %5.2f | decode %7.0f MB/s | decompressFile %7.0f MB/s | memcpy %7.0f MB/s\n", kind.name,
+                    static_cast<double>(data.size()) / static_cast<double>(compressed.size()), whole, from_file, copy);
+    }
+
+    return 0;
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "uefi.h"
+
+namespace Test {
+    using Bytes = std::vector<uint8_t>;
+
+    /// What compressFrame() puts in a frame.
+    struct FrameOptions {
+        uint32_t block_size = 64 * 1024;
+        bool block_checksums = false;
+        bool content_checksum = false;
+        bool content_size = false;
+        /// Whether matches may reach into the previous blocks.
+        bool linked = false;
+    };
+
+    inline void put32(Bytes& bytes, uint32_t value) {
+        for (int i = 0; i < 4; ++i)
+            bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    inline void putLength(Bytes& bytes, size_t length) {
+        for (; length >= 255; length -= 255)
+            bytes.push_back(255);
+
+        bytes.push_back(static_cast<uint8_t>(length));
+    }
+
+    inline void putSequence(Bytes& bytes, const uint8_t* literals, size_t literal_length, size_t match_length, size_t offset) {
+        const auto match_code = match_length == 0 ? 0 : match_length - 4;
+        bytes.push_back(static_cast<uint8_t>(((literal_length < 15 ? literal_length : 15) << 4) | (match_code < 15 ? match_code : 15)));
+        if (literal_length >= 15)
+            putLength(bytes, literal_length - 15);
+
+        bytes.insert(bytes.end(), literals, literals + literal_length);
+        if (match_length == 0)
+            return;
+
+        bytes.push_back(static_cast<uint8_t>(offset));
+        bytes.push_back(static_cast<uint8_t>(offset >> 8));
+        if (match_code >= 15)
+            putLength(bytes, match_code - 15);
+    }
+
+    /// A greedy LZ4 block compressor, finding matches through a hash of 4 bytes. Matches start at `history` at the
+    /// earliest, and follow the end of block rules: the last 5 bytes are literals, and the last match starts 12
+    /// bytes before the end at the latest.
+    inline Bytes compressBlock(const Bytes& data, size_t history, size_t start, size_t end, std::vector<int64_t>& table) {
+        Bytes block;
+        const auto hash = [&](size_t position) {
+            uint32_t word;
+            std::memcpy(&word, &data[position], sizeof(word));
+            return (word * 2654435761u) >> 16;
+        };
+
+        size_t literals = start;
+        size_t position = start;
+        while (end - start >= 13 && position + 12 <= end) {
+            const auto candidate = table[hash(position)];
+            table[hash(position)] = static_cast<int64_t>(position);
+
+            if (candidate < static_cast<int64_t>(history) || position - candidate > 65535 || std::memcmp(&data[candidate], &data[position], 4) != 0) {
+                ++position;
+                continue;
+            }
+
+            size_t length = 4;
+            while (position + length < end - 5 && data[candidate + length] == data[position + length])
+                ++length;
+
+            putSequence(block, &data[literals], position - literals, length, position - candidate);
+            position += length;
+            literals = position;
+        }
+
+        putSequence(block, data.data() + literals, end - literals, 0, 0);
+        return block;
+    }
+
+    /// An LZ4 frame of the data, for the decoder tests and benchmarks.
+    inline Bytes compressFrame(const Bytes& data, const FrameOptions& options) {
+        Bytes frame;
+        put32(frame, 0x184D2204);
+
+        const uint8_t block_size_id = options.block_size == 64 * 1024 ? 4 : options.block_size == 256 * 1024 ? 5 : options.block_size == 1024 * 1024 ? 6 : 7;
+        const Bytes descriptor_start = {
+            static_cast<uint8_t>(0x40 | (options.linked ? 0 : 0x20) | (options.block_checksums ? 0x10 : 0) | (options.content_size ? 0x08 : 0) |
+                                 (options.content_checksum ? 0x04 : 0)),
+            static_cast<uint8_t>(block_size_id << 4)};
+        Bytes descriptor = descriptor_start;
+        if (options.content_size) {
+            const uint64_t size = data.size();
+            for (int i = 0; i < 8; ++i)
+                descriptor.push_back(static_cast<uint8_t>(size >> (8 * i)));
+        }
+
+        frame.insert(frame.end(), descriptor.begin(), descriptor.end());
+        frame.push_back(static_cast<uint8_t>(Uefi::Detail::Xxh32::calculate(descriptor.data(), descriptor.size()) >> 8));
+
+        std::vector<int64_t> table(1 << 16, -1);
+        for (size_t start = 0; start < data.size(); start += options.block_size) {
+            const auto end = std::min<size_t>(start + options.block_size, data.size());
+            auto block = compressBlock(data, options.linked ? 0 : start, start, end, table);
+            bool compressed = block.size() < end - start;
+            if (!compressed)
+                block.assign(data.begin() + static_cast<ptrdiff_t>(start), data.begin() + static_cast<ptrdiff_t>(end));
+
+            put32(frame, static_cast<uint32_t>(block.size()) | (compressed ? 0 : 0x80000000));
+            frame.insert(frame.end(), block.begin(), block.end());
+            if (options.block_checksums)
+                put32(frame, Uefi::Detail::Xxh32::calculate(block.data(), block.size()));
+        }
+
+        put32(frame, 0);
+        if (options.content_checksum)
+            put32(frame, Uefi::Detail::Xxh32::calculate(data.data(), data.size()));
+
+        return frame;
+    }
+
+    /// Random bytes (kind 0), runs of a single byte between bytes of 4 values (1), or words of text (2).
+    inline Bytes makeData(size_t size, int kind, std::mt19937& random) {
+        Bytes data(size);
+        if (kind == 0) {
+            for (auto& byte : data)
+                byte = static_cast<uint8_t>(random());
+        } else if (kind == 1) {
+            for (size_t i = 0; i < size; ++i)
+                data[i] = i % 1000 < 500 ? 'A' : static_cast<uint8_t>(random() % 4);
+        } else {
+            const char* words[] = {"kernel ", "boot ", "uefi ", "loader ", "memory ", "page ", "\n"};
+            for (size_t i = 0; i < size;) {
+                for (const auto* word = words[random() % 7]; *word != 0 && i < size; ++word)
+                    data[i++] = static_cast<uint8_t>(*word);
+            }
+        }
+
+        return data;
+    }
+} // namespace Test
@@ -0,0 +1,234 @@
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "lz4_frame_writer.h"
+#include "mock_file.h"
+#include "mock_firmware.h"
+#include "test.h"
+
+using namespace Uefi;
+
+namespace {
+    using Bytes = std::vector<uint8_t>;
+    using Test::compressFrame;
+    using Test::makeData;
+    using Test::put32;
+
+    /// Decodes in chunks of random sizes, some of a few bytes to split the headers and sequences.
+    Status decodeInChunks(Lz4Decoder& decoder, const Bytes& compressed, std::mt19937& random) {
+        for (size_t position = 0; position < compressed.size();) {
+            const auto chunk = std::min<size_t>(compressed.size() - position, random() % 4 == 0 ? random() % 8 + 1 : random() % 100000 + 1);
+            const auto status = decoder.decode(compressed.data() + position, chunk);
+            if (status != Status::Success)
+                return status;
+
+            position += chunk;
+        }
+
+        return Status::Success;
+    }
+
+    /// A FileProtocol2 whose asynchronous reads complete at once.
+    struct AsyncFile {
+        static inline const Bytes* data;
+        static inline uint64_t position;
+        static inline size_t read_count, read_ex_count;
+        static inline bool read_ex_unsupported;
+
+        static Status transfer(size_t& size, void* buffer) {
+            size = position >= data->size() ? 0 : std::min<size_t>(size, data->size() - position);
+            std::memcpy(buffer, data->data() + position, size);
+            position += size;
+            return Status::Success;
+        }
+
+        static Status read(FileProtocol*, size_t& size, void* buffer) {
+            ++read_count;
+            return transfer(size, buffer);
+        }
+
+        static Status setPosition(FileProtocol*, uint64_t new_position) {
+            position = new_position;
+            return Status::Success;
+        }
+
+        static Status readEx(FileProtocol2*, FileProtocol2::IoToken& token) {
+            if (read_ex_unsupported)
+                return Status::Unsupported;
+
+            ++read_ex_count;
+            token.status = transfer(token.buffer_size, token.buffer);
+            return Status::Success;
+        }
+    };
+} // namespace
+
+int main() {
+    std::mt19937 random(5);
+
+    // The checksums, against the reference values.
+    CHECK(Detail::Xxh32::calculate("", 0) == 0x02CC5D05 && Detail::Xxh32::calculate("a", 1) == 0x550D7456);
+    CHECK(Detail::Xxh32::calculate("abc", 3) == 0x32D153FF);
+    {
+        const auto data = makeData(1000, 0, random);
+        Detail::Xxh32 hash;
+        hash.initialize();
+        for (size_t i = 0; i < data.size(); i += 7)
+            hash.update(&data[i], std::min<size_t>(7, data.size() - i));
+
+        CHECK(hash.finish() == Detail::Xxh32::calculate(data.data(), data.size()));
+    }
+
+    // A block written by hand: a match overlapping its own output, a run with a long match length, and a long
+    // literal length.
+    Bytes hand_made = {0x04, 0x22, 0x4D, 0x18, 0x60, 0x40, 0};
+    hand_made[6] = static_cast<uint8_t>(Detail::Xxh32::calculate(&hand_made[4], 2) >> 8);
+    const Bytes hand_made_block = {0x26, 'a', 'b', 2, 0, 0x1F, 'z', 1, 0, 255, 1, 0xF0, 5};
+    put32(hand_made, static_cast<uint32_t>(hand_made_block.size() + 20));
+    hand_made.insert(hand_made.end(), hand_made_block.begin(), hand_made_block.end());
+    const std::string tail = "0123456789ABCDEFGHIJ";
+    hand_made.insert(hand_made.end(), tail.begin(), tail.end());
+    put32(hand_made, 0);
+    {
+        const auto expected = "abababababab" + std::string(276, 'z') + tail;
+        Bytes output(expected.size());
+        static Lz4Decoder decoder;
+        decoder.initialize(output.data(), output.size());
+        CHECK(decodeInChunks(decoder, hand_made, random) == Status::Success && decoder.isFinished());
+        CHECK(decoder.getOutputSize() == expected.size() && std::memcmp(output.data(), expected.data(), expected.size()) == 0);
+    }
+
+    // Every frame option and block size, fed in chunks of random sizes, and followed by a skippable frame and another
+    // frame.
+    for (int kind = 0; kind < 3; ++kind) {
+        for (const size_t size : {0, 1, 13, 1000, 65536, 65537, 300000}) {
+            for (const uint32_t block_size : {64 * 1024, 256 * 1024}) {
+                for (int flags = 0; flags < 16; ++flags) {
+                    auto data = makeData(size, kind, random);
+                    auto compressed = compressFrame(data, {block_size, (flags & 1) != 0, (flags & 2) != 0, (flags & 4) != 0, (flags & 8) != 0});
+
+                    if (flags % 3 == 0) {
+                        const uint8_t skippable[] = {0x5A, 0x2A, 0x4D, 0x18, 4, 0, 0, 0, 1, 2, 3, 4};
+                        compressed.insert(compressed.end(), skippable, skippable + sizeof(skippable));
+                        const auto second = compressFrame(data, {block_size, false, true, true, false});
+                        compressed.insert(compressed.end(), second.begin(), second.end());
+                        const auto copy = data;
+                        data.insert(data.end(), copy.begin(), copy.end());
+                    }
+
+                    // Room for the decoder to copy past the end of the output if it wanted to.
+                    Bytes output(data.size() + 16, 0xEE);
+                    static Lz4Decoder decoder;
+                    decoder.initialize(output.data(), data.size());
+                    CHECK(decodeInChunks(decoder, compressed, random) == Status::Success && decoder.isFinished());
+                    CHECK(decoder.getOutputSize() == data.size() && std::memcmp(output.data(), data.data(), data.size()) == 0);
+                    CHECK(output[data.size()] == 0xEE);
+                }
+            }
+        }
+    }
+
+    // Corrupted data, a checksum mismatch, and an output which is too small.
+    {
+        const auto data = makeData(100000, 2, random);
+        Bytes output(data.size());
+        static Lz4Decoder decoder;
+
+        auto compressed = compressFrame(data, {64 * 1024, true, false, false, false});
+        compressed[compressed.size() / 2] ^= 0x40;
+        decoder.initialize(output.data(), output.size());
+        CHECK(decoder.decode(compressed.data(), compressed.size()) == Status::CrcError);
+
+        compressed = compressFrame(data, {64 * 1024, false, true, false, true});
+        compressed.back() ^= 1;
+        decoder.initialize(output.data(), output.size());
+        CHECK(decoder.decode(compressed.data(), compressed.size()) == Status::CrcError);
+        decoder.initialize(output.data(), output.size(), false);
+        CHECK(decoder.decode(compressed.data(), compressed.size()) == Status::Success && decoder.isFinished());
+
+        compressed = compressFrame(data, {});
+        decoder.initialize(output.data(), output.size() - 1);
+        CHECK(decoder.decode(compressed.data(), compressed.size()) == Status::BufferTooSmall);
+
+        // A match reaching before the start of the output.
+        Bytes bad_offset(hand_made.begin(), hand_made.begin() + 11);
+        const Bytes bad_block = {0x14, 'a', 5, 0, 0x50, 'v', 'w', 'x', 'y', 'z'};
+        bad_offset.insert(bad_offset.end(), bad_block.begin(), bad_block.end());
+        put32(bad_offset, 0);
+        bad_offset[7] = static_cast<uint8_t>(bad_block.size());
+        decoder.initialize(output.data(), output.size());
+        CHECK(decoder.decode(bad_offset.data(), bad_offset.size()) == Status::InvalidParameter);
+
+        // A bad header checksum, a dictionary, and the legacy format.
+        compressed = compressFrame(data, {});
+        compressed[6] ^= 1;
+        decoder.initialize(output.data(), output.size());
+        CHECK(decoder.decode(compressed.data(), compressed.size()) != Status::Success);
+
+        compressed = compressFrame(data, {});
+        compressed[4] |= 0x01;
+        compressed[6] = static_cast<uint8_t>(Detail::Xxh32::calculate(&compressed[4], 2) >> 8);
+        decoder.initialize(output.data(), output.size());
+        CHECK(decoder.decode(compressed.data(), compressed.size()) == Status::Unsupported);
+
+        const uint8_t legacy[] = {0x02, 0x21, 0x4C, 0x18, 0, 0, 0, 0};
+        decoder.initialize(output.data(), output.size());
+        CHECK(decoder.decode(legacy, sizeof(legacy)) == Status::Unsupported);
+    }
+
+    // The content size, when the frame declares it.
+    {
+        uint64_t content_size = 0;
+        const auto data = makeData(12345, 1, random);
+        const auto with_size = compressFrame(data, {64 * 1024, false, false, true, false});
+        CHECK(Lz4Decoder::getContentSize(with_size.data(), with_size.size(), content_size) == Status::Success && content_size == 12345);
+        CHECK(Lz4Decoder::getContentSize(with_size.data(), 13, content_size) == Status::InvalidParameter);
+
+        const auto without_size = compressFrame(data, {});
+        CHECK(Lz4Decoder::getContentSize(without_size.data(), without_size.size(), content_size) == Status::NotFound);
+        CHECK(Lz4Decoder::getContentSize(data.data(), data.size(), content_size) == Status::InvalidParameter);
+    }
+
+    // Whole files, read in turn, or asynchronously while the previous chunk is decompressed.
+    {
+        const auto data = makeData(3000000, 2, random);
+        const auto compressed = compressFrame(data, {256 * 1024, false, true, true, false});
+        Bytes output(data.size());
+        Bytes buffer(65536);
+        static Lz4Decoder decoder;
+
+        Test::MockFile file(compressed);
+        decoder.initialize(output.data(), output.size());
+        CHECK(decompressFile(file, decoder, buffer.data(), buffer.size()) == Status::Success);
+        CHECK(output == data && file.read_count == ((compressed.size() + 32767) / 32768) + 1);
+
+        Test::MockTable<BootServices> boot_services_table;
+        Test::MockTable<MpServicesProtocol, 64> mp_services_table;
+        Test::MockMpServices::install(boot_services_table, mp_services_table);
+        Test::MockTable<FileProtocol2> async_file_table;
+        async_file_table.setValue(0, FileProtocol2::revision_2);
+        async_file_table.set(Test::FileProtocolOffset::read, &AsyncFile::read);
+        async_file_table.set(Test::FileProtocolOffset::set_position, &AsyncFile::setPosition);
+        async_file_table.set(Test::FileProtocolOffset::read_ex, &AsyncFile::readEx);
+        AsyncFile::data = &compressed;
+
+        for (const bool unsupported : {false, true}) {
+            AsyncFile::read_ex_unsupported = unsupported;
+            AsyncFile::read_count = AsyncFile::read_ex_count = 0;
+            output.assign(output.size(), 0);
+            decoder.initialize(output.data(), output.size());
+            CHECK(decompressFile(async_file_table.get(), decoder, buffer.data(), buffer.size(), &boot_services_table.get()) == Status::Success);
+            CHECK(output == data);
+            CHECK(unsupported ? AsyncFile::read_ex_count == 0 && AsyncFile::read_count != 0 : AsyncFile::read_ex_count != 0 && AsyncFile::read_count == 0);
+        }
+
+        // A file ending in the middle of a frame.
+        Test::MockFile truncated(Bytes(compressed.begin(), compressed.end() - 3));
+        decoder.initialize(output.data(), output.size());
+        CHECK(decompressFile(truncated, decoder, buffer.data(), buffer.size()) == Status::InvalidParameter);
+    }
+
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include <cstring>
+
+#include <sys/mman.h>
+
+#include "mock_firmware.h"
+#include "test.h"
+
+using namespace Uefi;
+
+namespace {
+    constexpr uint64_t size = uint64_t{1} << 30;
+
+    /// Free address space for a single free range, claimed by the mock with a fixed anonymous mapping.
+    uint64_t findFreeAddressSpace() {
+        auto* memory = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        CHECK(memory != MAP_FAILED);
+        munmap(memory, size);
+        return reinterpret_cast<uintptr_t>(memory);
+    }
+
+    template <typename Function>
+    double getGigabytesPerSecond(Function function) {
+        const auto start = Test::getTime();
+        function();
+        return static_cast<double>(size) / (Test::getTime() - start) / 1e9;
+    }
+} // namespace
+
+int main() {
+    Test::MockTable<BootServices> boot_services_table;
+    Test::MockPages::install(boot_services_table);
+    Test::MockTable<MpServicesProtocol, 64> mp_services_table;
+    Test::MockMpServices::install(boot_services_table, mp_services_table);
+    auto& boot_services = boot_services_table.get();
+
+    BootServices::MemoryDescriptor descriptor{};
+    descriptor.type = MemoryType::ConventionalMemory;
+    descriptor.physical_start = findFreeAddressSpace();
+    descriptor.pages_count = size / 0x1000;
+    const MemoryMap map{sizeof(descriptor), sizeof(descriptor), 0, &descriptor};
+
+    static MemoryScrubber scrubber;
+    CHECK(scrubber.initialize(boot_services, map, 0) == Status::Success && scrubber.getTotalSize() == size);
+
+    const struct {
+        ScrubPattern pattern;
+        const char* name;
+    } patterns[] = {
+        {ScrubPattern::Zero, "zero"},
+        {ScrubPattern::Checkerboard, "checkerboard"},
+        {ScrubPattern::WalkingOnes, "walking ones"},
+        {ScrubPattern::AddressInAddress, "address"},
+    };
+
+    std::printf("%zu APs as threads, on %u host CPUs\n", Test::MockMpServices::apCount(), std::thread::hardware_concurrency());
+    double zero_fill = 0;
+    for (const auto& pattern : patterns) {
+        for (auto* mp_services : {static_cast<MpServicesProtocol*>(nullptr), &mp_services_table.get()}) {
+            const auto fill = getGigabytesPerSecond([&] { CHECK(scrubber.fill(boot_services, pattern.pattern, mp_services) == Status::Success); });
+            const auto verify = getGigabytesPerSecond([&] { CHECK(scrubber.verify(boot_services, pattern.pattern, mp_services) == Status::Success); });
+            std::printf("%-13s %-8s fill %5.2f GB/s, verify %5.2f GB/s\n", pattern.name, mp_services != nullptr ? "with APs" : "BSP only", fill,
+                        verify);
+
+            if (pattern.pattern == ScrubPattern::Zero && mp_services == nullptr)
+                zero_fill = fill;
+        }
+    }
+
+    // What the firmware offers instead: setMem(), often a byte loop, and the C library's memset().
+    auto* memory = reinterpret_cast<uint8_t*>(static_cast<uintptr_t>(descriptor.physical_start));
+    const auto memset_rate = getGigabytesPerSecond([&] { std::memset(memory, 0, size); });
+    const auto byte_loop_rate = getGigabytesPerSecond([&] {
+        for (uint64_t i = 0; i < size; ++i)
+            reinterpret_cast<volatile uint8_t*>(memory)[i] = 0;
+    });
+
+    std::printf("memset %.2f GB/s, byte loop %.2f GB/s\n", memset_rate, byte_loop_rate);
+    CHECK(zero_fill > byte_loop_rate);
+
+    scrubber.release(boot_services);
+    CHECK(Test::MockPages::getOutstandingCount() == 0);
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include <sys/mman.h>
+
+#include "mock_firmware.h"
+#include "test.h"
+
+using namespace Uefi;
+
+namespace {
+    constexpr uint64_t mebibyte = 1 << 20;
+    constexpr uint64_t page = 0x1000;
+
+    /// Free address space, for the memory map to describe and the mock to claim at fixed addresses.
+    uint64_t findFreeAddressSpace(uint64_t size) {
+        auto* memory = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        CHECK(memory != MAP_FAILED);
+        munmap(memory, size);
+        return reinterpret_cast<uintptr_t>(memory);
+    }
+
+    uint64_t& word(uint64_t address) {
+        return *reinterpret_cast<uint64_t*>(static_cast<uintptr_t>(address));
+    }
+
+    uint64_t getExpectedWord(ScrubPattern pattern, uint64_t address) {
+        switch (pattern) {
+        case ScrubPattern::Zero:
+            return 0;
+        case ScrubPattern::Checkerboard:
+            return 0xAAAAAAAAAAAAAAAA;
+        case ScrubPattern::WalkingOnes:
+            return uint64_t{1} << ((address >> 3) & 63);
+        case ScrubPattern::AddressInAddress:
+            break;
+        }
+
+        return address;
+    }
+} // namespace
+
+int main() {
+    Test::MockTable<BootServices> boot_services_table;
+    Test::MockPages::install(boot_services_table);
+    Test::MockTable<MpServicesProtocol, 64> mp_services_table;
+    Test::MockMpServices::install(boot_services_table, mp_services_table);
+    auto& boot_services = boot_services_table.get();
+    auto* mp_services = &mp_services_table.get();
+
+    // Three free ranges around memory of other types. The first one spans two chunks.
+    const auto base = findFreeAddressSpace(256 * mebibyte);
+    BootServices::MemoryDescriptor descriptors[6] = {};
+    const auto set = [&](size_t i, MemoryType type, uint64_t offset, uint64_t size) {
+        descriptors[i].type = type;
+        descriptors[i].physical_start = base + offset;
+        descriptors[i].pages_count = size / page;
+    };
+
+    set(0, MemoryType::ConventionalMemory, 0, (100 * mebibyte) + (3 * page));
+    set(1, MemoryType::LoaderCode, (100 * mebibyte) + (3 * page), 10 * page);
+    set(2, MemoryType::ConventionalMemory, (100 * mebibyte) + (13 * page), 90 * mebibyte);
+    set(3, MemoryType::BootServicesData, (190 * mebibyte) + (13 * page), 5 * page);
+    set(4, MemoryType::ConventionalMemory, (190 * mebibyte) + (18 * page), 40 * mebibyte);
+    set(5, MemoryType::ACPIReclaimMemory, 240 * mebibyte, page);
+    const MemoryMap map{sizeof(descriptors), sizeof(descriptors[0]), 0, descriptors};
+
+    static MemoryScrubber scrubber;
+    CHECK(scrubber.initialize(boot_services, map, mebibyte) == Status::Success);
+    CHECK(Test::MockPages::getOutstandingCount() == 3);
+    CHECK(scrubber.getTotalSize() == (100 * mebibyte) + (3 * page) - mebibyte + (90 * mebibyte) + (40 * mebibyte));
+
+    const ScrubPattern patterns[] = {ScrubPattern::Zero, ScrubPattern::Checkerboard, ScrubPattern::WalkingOnes, ScrubPattern::AddressInAddress};
+    for (const auto pattern : patterns) {
+        CHECK(scrubber.fill(boot_services, pattern, mp_services) == Status::Success);
+        for (size_t i = 0; i < 5; i += 2) {
+            for (uint64_t address = descriptors[i].physical_start; address < descriptors[i].physical_start + (40 * mebibyte); address += (page * 97) + 8)
+                CHECK(word(address) == getExpectedWord(pattern, address));
+        }
+
+        CHECK(scrubber.verify(boot_services, pattern, mp_services) == Status::Success);
+    }
+
+    CHECK(scrubber.getBadRanges().getSize() == 0);
+
+    // A stuck bit is found by each pattern which expects it the other way, even once its range is known.
+    const auto stuck = base + (150 * mebibyte) + 0x1238;
+    CHECK(scrubber.fill(boot_services, ScrubPattern::Checkerboard, mp_services) == Status::Success);
+    word(stuck) ^= 0x8;
+    CHECK(scrubber.verify(boot_services, ScrubPattern::Checkerboard, mp_services) == Status::DeviceError);
+    CHECK(scrubber.getBadRanges().getSize() == 1);
+
+    CHECK(scrubber.fill(boot_services, ScrubPattern::WalkingOnes, mp_services) == Status::Success);
+    word(stuck) ^= 0x8;
+    CHECK(scrubber.verify(boot_services, ScrubPattern::WalkingOnes, mp_services) == Status::DeviceError);
+    CHECK(scrubber.getBadRanges().getSize() == 1);
+    CHECK(scrubber.getBadRanges()[0].address == stuck && scrubber.getBadRanges()[0].size == 8 && scrubber.getBadRanges()[0].failed_bits == 0x8);
+
+    // Without the fault, the next pass finds nothing new.
+    CHECK(scrubber.fill(boot_services, ScrubPattern::WalkingOnes, mp_services) == Status::Success);
+    CHECK(scrubber.verify(boot_services, ScrubPattern::WalkingOnes, mp_services) == Status::Success);
+
+    // A run of bad words across a chunk boundary is one range, and an aliased word is found by its address.
+    CHECK(scrubber.fill(boot_services, ScrubPattern::AddressInAddress, mp_services) == Status::Success);
+    const auto chunk_edge = base + MemoryScrubber::chunk_size;
+    word(chunk_edge - 16) ^= 1;
+    word(chunk_edge - 8) ^= 4;
+    word(chunk_edge) ^= 0x100;
+    const auto alias = base + (200 * mebibyte);
+    word(alias) = alias ^ (uint64_t{1} << 30);
+    CHECK(scrubber.verify(boot_services, ScrubPattern::AddressInAddress, mp_services) == Status::DeviceError);
+
+    const auto bad = scrubber.getBadRanges();
+    CHECK(bad.getSize() == 3);
+    CHECK(bad[0].address == chunk_edge - 16 && bad[0].size == 24 && bad[0].failed_bits == 0x105);
+    CHECK(bad[1].address == stuck);
+    CHECK(bad[2].address == alias && bad[2].size == 8 && bad[2].failed_bits == uint64_t{1} << 30);
+
+    // More ranges than fit: the rest are counted, and found again by the next pass.
+    CHECK(scrubber.fill(boot_services, ScrubPattern::Zero) == Status::Success);
+    for (uint64_t i = 0; i < 100; ++i)
+        word(base + (i * mebibyte / 2)) = 1;
+
+    CHECK(scrubber.verify(boot_services, ScrubPattern::Zero) == Status::DeviceError);
+    CHECK(scrubber.getBadRanges().getSize() == MemoryScrubber::max_bad_range_count && scrubber.getLostBadRangeCount() > 0);
+    const auto lost = scrubber.getLostBadRangeCount();
+    CHECK(scrubber.verify(boot_services, ScrubPattern::Zero) == Status::DeviceError);
+    CHECK(scrubber.getLostBadRangeCount() > lost);
+
+    scrubber.release(boot_services);
+    CHECK(Test::MockPages::getOutstandingCount() == 0);
+    return 0;
+}
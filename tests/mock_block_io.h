@@ -0,0 +1,234 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "mock_firmware.h"
+#include "uefi.h"
+
+namespace Test {
+    /// A disk kept in memory behind a BlockIoProtocol, which keeps the time a real device would have taken: a
+    /// fixed cost per request, for the command and the seek, plus the transfer at the device's bandwidth.
+    /// The BlockIo2Protocol reads the data when the request is queued, and signals its event only when the test
+    /// completes the request, or when the event is waited for.
+    class MockDisk {
+    public:
+        /// Roughly a USB 2 stick.
+        static constexpr double default_request_microseconds = 1000;
+        static constexpr double default_megabytes_per_second = 30;
+
+        std::vector<uint8_t> data;
+        Uefi::BlockIoMedia media;
+
+        double request_microseconds = default_request_microseconds;
+        double megabytes_per_second = default_megabytes_per_second;
+
+        size_t read_count = 0;
+        size_t async_read_count = 0;
+        size_t write_count = 0;
+        uint64_t blocks_transferred = 0;
+        double busy_microseconds = 0;
+
+        explicit MockDisk(size_t block_count, uint32_t block_size = 512) : data(block_count * block_size) {
+            media = {};
+            media.media_present = true;
+            media.block_size = block_size;
+            media.io_align = 8;
+            media.last_block = block_count - 1;
+
+            _protocol.setValue(0, uint64_t{0x00020001});
+            _protocol.setValue(8, &media);
+            _protocol.set(24, &MockDisk::_readBlocks);
+            _protocol.set(32, &MockDisk::_writeBlocks);
+            _protocol.set(40, &MockDisk::_flushBlocks);
+            _protocol2.setValue(0, &media);
+            _protocol2.set(16, &MockDisk::_readBlocksEx);
+            _owners().push_back({&_protocol.get(), this});
+            _owners().push_back({reinterpret_cast<Uefi::BlockIoProtocol*>(&_protocol2.get()), this});
+        }
+
+        ~MockDisk() {
+            auto& owners = _owners();
+            for (auto i = owners.begin(); i != owners.end();) {
+                if (i->second == this)
+                    i = owners.erase(i);
+                else
+                    ++i;
+            }
+        }
+
+        MockDisk(const MockDisk&) = delete;
+        MockDisk& operator=(const MockDisk&) = delete;
+
+        Uefi::BlockIoProtocol& getProtocol() noexcept {
+            return _protocol.get();
+        }
+
+        Uefi::BlockIo2Protocol& getProtocol2() noexcept {
+            return _protocol2.get();
+        }
+
+        /// The asynchronous reads queued and not completed yet.
+        size_t getPendingCount() const noexcept {
+            return _pending.size();
+        }
+
+        /// Completes the queued asynchronous reads: their events are signaled.
+        void completeReads() {
+            for (auto* token : _pending) {
+                token->transaction_status = Uefi::Status::Success;
+                _signaled().push_back(token->event);
+            }
+
+            _pending.clear();
+        }
+
+        /// Event functions of the boot services which work with the asynchronous reads: waiting for an event
+        /// completes the reads of every disk.
+        static void installEvents(MockTable<Uefi::BootServices>& boot_services) {
+            boot_services.set(BootServicesOffset::create_event, &_createEvent);
+            boot_services.set(BootServicesOffset::wait_for_event, &_waitForEvent);
+            boot_services.set(BootServicesOffset::close_event, &_closeEvent);
+            boot_services.set(BootServicesOffset::check_event, &_checkEvent);
+        }
+
+        uint8_t* getBlock(Uefi::Lba lba) noexcept {
+            return data.data() + (lba * media.block_size);
+        }
+
+        /// Fills the disk with a pattern where every byte depends on its offset.
+        void fillPattern() {
+            for (size_t i = 0; i < data.size(); ++i)
+                data[i] = static_cast<uint8_t>((i * 7) + (i / 512));
+        }
+
+        void resetCounters() noexcept {
+            read_count = 0;
+            write_count = 0;
+            blocks_transferred = 0;
+            busy_microseconds = 0;
+        }
+
+    private:
+        static MockDisk& _self(Uefi::BlockIoProtocol* protocol) {
+            for (const auto& owner : _owners()) {
+                if (owner.first == protocol)
+                    return *owner.second;
+            }
+
+            std::abort();
+        }
+
+        static std::vector<std::pair<Uefi::BlockIoProtocol*, MockDisk*>>& _owners() {
+            static std::vector<std::pair<Uefi::BlockIoProtocol*, MockDisk*>> owners;
+            return owners;
+        }
+
+        Uefi::Status _check(uint32_t media_id, Uefi::Lba lba, size_t size) const noexcept {
+            if (!media.media_present)
+                return Uefi::Status::NoMedia;
+
+            if (media_id != media.media_id)
+                return Uefi::Status::MediaChanged;
+
+            if (size % media.block_size != 0)
+                return Uefi::Status::BadBufferSize;
+
+            if (lba > media.last_block || (size / media.block_size) > media.last_block + 1 - lba)
+                return Uefi::Status::InvalidParameter;
+
+            return Uefi::Status::Success;
+        }
+
+        void _account(size_t size) noexcept {
+            blocks_transferred += size / media.block_size;
+            busy_microseconds += request_microseconds + (static_cast<double>(size) / megabytes_per_second);
+        }
+
+        static Uefi::Status _readBlocks(Uefi::BlockIoProtocol* protocol, uint32_t media_id, Uefi::Lba lba, size_t size, void* buffer) {
+            auto& self = _self(protocol);
+            const auto status = self._check(media_id, lba, size);
+            if (status != Uefi::Status::Success)
+                return status;
+
+            ++self.read_count;
+            self._account(size);
+            std::memcpy(buffer, self.getBlock(lba), size);
+            return Uefi::Status::Success;
+        }
+
+        static Uefi::Status _writeBlocks(Uefi::BlockIoProtocol* protocol, uint32_t media_id, Uefi::Lba lba, size_t size, const void* buffer) {
+            auto& self = _self(protocol);
+            const auto status = self._check(media_id, lba, size);
+            if (status != Uefi::Status::Success)
+                return status;
+
+            ++self.write_count;
+            self._account(size);
+            std::memcpy(self.getBlock(lba), buffer, size);
+            return Uefi::Status::Success;
+        }
+
+        static Uefi::Status _flushBlocks(Uefi::BlockIoProtocol*) {
+            return Uefi::Status::Success;
+        }
+
+        static Uefi::Status _readBlocksEx(Uefi::BlockIo2Protocol* protocol, uint32_t media_id, Uefi::Lba lba, Uefi::BlockIo2Protocol::Token* token,
+                                          size_t size, void* buffer) {
+            auto& self = _self(reinterpret_cast<Uefi::BlockIoProtocol*>(protocol));
+            const auto status = self._check(media_id, lba, size);
+            if (status != Uefi::Status::Success)
+                return status;
+
+            ++self.async_read_count;
+            self._account(size);
+            std::memcpy(buffer, self.getBlock(lba), size);
+            self._pending.push_back(token);
+            return Uefi::Status::Success;
+        }
+
+        /// The events signaled and not checked yet.
+        static std::vector<Uefi::Event>& _signaled() {
+            static std::vector<Uefi::Event> events;
+            return events;
+        }
+
+        static Uefi::Status _createEvent(Uefi::EventType, Uefi::Tpl, Uefi::EventNotify, void*, Uefi::Event& event) {
+            event = reinterpret_cast<Uefi::Event>(new int);
+            return Uefi::Status::Success;
+        }
+
+        static Uefi::Status _checkEvent(Uefi::Event event) {
+            auto& signaled = _signaled();
+            for (auto i = signaled.begin(); i != signaled.end(); ++i) {
+                if (*i == event) {
+                    signaled.erase(i);
+                    return Uefi::Status::Success;
+                }
+            }
+
+            return Uefi::Status::NotReady;
+        }
+
+        static Uefi::Status _waitForEvent(size_t, Uefi::Event* events, size_t& index) {
+            for (const auto& owner : _owners())
+                owner.second->completeReads();
+
+            index = 0;
+            return _checkEvent(events[0]) == Uefi::Status::Success ? Uefi::Status::Success : Uefi::Status::InvalidParameter;
+        }
+
+        static Uefi::Status _closeEvent(Uefi::Event event) {
+            delete reinterpret_cast<int*>(event);
+            return Uefi::Status::Success;
+        }
+
+        MockTable<Uefi::BlockIoProtocol, 48> _protocol;
+        MockTable<Uefi::BlockIo2Protocol, 40> _protocol2;
+        std::vector<Uefi::BlockIo2Protocol::Token*> _pending;
+    };
+} // namespace Test
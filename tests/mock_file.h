@@ -0,0 +1,229 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "uefi.h"
+
+namespace Test {
+    /// A file kept in memory, which counts the calls the firmware would have to serve.
+    class MockFile : public Uefi::FileProtocol {
+    public:
+        std::vector<uint8_t> data;
+        uint64_t position = 0;
+
+        size_t read_count = 0;
+        size_t write_count = 0;
+        size_t set_info_count = 0;
+        size_t flush_count = 0;
+        bool closed = false;
+
+        /// The most bytes a single write takes, to exercise short writes.
+        size_t max_write_size = SIZE_MAX;
+        /// Returned by write() once it took what it could.
+        Uefi::Status write_status = Uefi::Status::Success;
+        /// Reported in FileInfo instead of the size of `data` when not 0, e.g. to fake a truncated file.
+        uint64_t reported_size = 0;
+
+        explicit MockFile(std::vector<uint8_t> contents = {}) noexcept : data(std::move(contents)) {
+            revision = 0x00010000;
+            _open = nullptr;
+            _close = &MockFile::_closeThunk;
+            _read = &MockFile::_readThunk;
+            _write = &MockFile::_writeThunk;
+            _getPosition = &MockFile::_getPositionThunk;
+            _setPosition = &MockFile::_setPositionThunk;
+            _getInfo = &MockFile::_getInfoThunk;
+            _setInfo = &MockFile::_setInfoThunk;
+            _flush = &MockFile::_flushThunk;
+        }
+
+    private:
+        static MockFile& _self(Uefi::FileProtocol* file) noexcept {
+            return *static_cast<MockFile*>(file);
+        }
+
+        static Uefi::Status _closeThunk(Uefi::FileProtocol* file) {
+            _self(file).closed = true;
+            return Uefi::Status::Success;
+        }
+
+        static Uefi::Status _readThunk(Uefi::FileProtocol* file, size_t& size, void* buffer) {
+            auto& self = _self(file);
+            ++self.read_count;
+
+            const auto end = self.data.size();
+            size = self.position >= end ? 0 : static_cast<size_t>(std::min<uint64_t>(size, end - self.position));
+            std::memcpy(buffer, self.data.data() + self.position, size);
+            self.position += size;
+            return Uefi::Status::Success;
+        }
+
+        static Uefi::Status _writeThunk(Uefi::FileProtocol* file, size_t& size, const void* buffer) {
+            auto& self = _self(file);
+            ++self.write_count;
+
+            size = std::min(size, self.max_write_size);
+            if (self.data.size() < self.position + size)
+                self.data.resize(static_cast<size_t>(self.position + size));
+
+            std::memcpy(self.data.data() + self.position, buffer, size);
+            self.position += size;
+            return self.write_status;
+        }
+
+        static Uefi::Status _getPositionThunk(Uefi::FileProtocol* file, uint64_t& position) {
+            position = _self(file).position;
+            return Uefi::Status::Success;
+        }
+
+        static Uefi::Status _setPositionThunk(Uefi::FileProtocol* file, uint64_t position) {
+            auto& self = _self(file);
+            self.position = position == UINT64_MAX ? self.data.size() : position;
+            return Uefi::Status::Success;
+        }
+
+        static Uefi::Status _getInfoThunk(Uefi::FileProtocol* file, const Uefi::Guid& type, size_t& size, void* buffer) {
+            auto& self = _self(file);
+            if (type != Uefi::FileInfo::guid)
+                return Uefi::Status::Unsupported;
+
+            constexpr auto info_size = offsetof(Uefi::FileInfo, file_name) + sizeof(char16_t);
+            if (size < info_size) {
+                size = info_size;
+                return Uefi::Status::BufferTooSmall;
+            }
+
+            size = info_size;
+            std::memset(buffer, 0, info_size);
+            auto* info = static_cast<Uefi::FileInfo*>(buffer);
+            info->size = info_size;
+            info->file_size = self.reported_size != 0 ? self.reported_size : self.data.size();
+            info->physical_size = info->file_size;
+            return Uefi::Status::Success;
+        }
+
+        static Uefi::Status _setInfoThunk(Uefi::FileProtocol* file, const Uefi::Guid& type, size_t, const void* buffer) {
+            auto& self = _self(file);
+            if (type != Uefi::FileInfo::guid)
+                return Uefi::Status::Unsupported;
+
+            ++self.set_info_count;
+            self.data.resize(static_cast<size_t>(static_cast<const Uefi::FileInfo*>(buffer)->file_size));
+            return Uefi::Status::Success;
+        }
+
+        static Uefi::Status _flushThunk(Uefi::FileProtocol* file) {
+            ++_self(file).flush_count;
+            return Uefi::Status::Success;
+        }
+    };
+
+    /// A directory tree kept in memory. open() allocates the opened entry, and close() deletes it, except for the
+    /// root, which belongs to the caller.
+    class MockDirectory : public Uefi::FileProtocol {
+    public:
+        struct Node {
+            std::u16string name;
+            bool directory = false;
+            uint64_t size = 0;
+            std::vector<Node> children;
+        };
+
+        /// Shared by the root and everything opened under it.
+        struct Counters {
+            size_t open_count = 0;
+            size_t read_count = 0;
+            size_t open_handles = 0;
+        };
+
+        MockDirectory(const Node& node, Counters& counters) noexcept : _node(node), _counters(counters) {
+            revision = 0x00010000;
+            _open = &MockDirectory::_openThunk;
+            _close = &MockDirectory::_closeThunk;
+            _read = &MockDirectory::_readThunk;
+            _write = nullptr;
+            _getPosition = nullptr;
+            _setPosition = &MockDirectory::_setPositionThunk;
+            _getInfo = nullptr;
+            _setInfo = nullptr;
+            _flush = nullptr;
+        }
+
+    private:
+        static MockDirectory& _self(Uefi::FileProtocol* file) noexcept {
+            return *static_cast<MockDirectory*>(file);
+        }
+
+        static Uefi::Status _openThunk(Uefi::FileProtocol* file, Uefi::FileProtocol*& new_handle, const char16_t* name, Uefi::OpenMode,
+                                       Uefi::FileAttributes) {
+            auto& self = _self(file);
+            ++self._counters.open_count;
+
+            for (const auto& child : self._node.children) {
+                if (child.name == name) {
+                    ++self._counters.open_handles;
+                    new_handle = new MockDirectory(child, self._counters);
+                    static_cast<MockDirectory*>(new_handle)->_owned = true;
+                    return Uefi::Status::Success;
+                }
+            }
+
+            return Uefi::Status::NotFound;
+        }
+
+        static Uefi::Status _closeThunk(Uefi::FileProtocol* file) {
+            auto& self = _self(file);
+            if (self._owned) {
+                --self._counters.open_handles;
+                delete &self;
+            }
+
+            return Uefi::Status::Success;
+        }
+
+        /// One entry per read, "." and ".." first, like the firmware's FAT driver.
+        static Uefi::Status _readThunk(Uefi::FileProtocol* file, size_t& size, void* buffer) {
+            auto& self = _self(file);
+            ++self._counters.read_count;
+
+            if (!self._node.directory || self._position >= self._node.children.size() + 2) {
+                size = 0;
+                return Uefi::Status::Success;
+            }
+
+            const auto* node = self._position < 2 ? &self._node : &self._node.children[self._position - 2];
+            const std::u16string name = self._position == 0 ? u"." : (self._position == 1 ? u".." : node->name);
+
+            const auto info_size = offsetof(Uefi::FileInfo, file_name) + ((name.size() + 1) * sizeof(char16_t));
+            if (size < info_size) {
+                size = info_size;
+                return Uefi::Status::BufferTooSmall;
+            }
+
+            size = info_size;
+            auto* info = static_cast<Uefi::FileInfo*>(buffer);
+            std::memset(buffer, 0, offsetof(Uefi::FileInfo, file_name));
+            info->size = info_size;
+            info->file_size = node->size;
+            info->attributes = node->directory ? Uefi::FileAttributes::Directory : Uefi::FileAttributes::Archive;
+            std::memcpy(info->file_name, name.c_str(), (name.size() + 1) * sizeof(char16_t));
+            ++self._position;
+            return Uefi::Status::Success;
+        }
+
+        static Uefi::Status _setPositionThunk(Uefi::FileProtocol* file, uint64_t position) {
+            _self(file)._position = static_cast<size_t>(position);
+            return Uefi::Status::Success;
+        }
+
+        const Node& _node;
+        Counters& _counters;
+        size_t _position = 0;
+        bool _owned = false;
+    };
+} // namespace Test
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include <sys/mman.h>
+
+#include "uefi.h"
+
+namespace Test {
+    /// Byte offsets of the functions of the firmware tables, as the specification lays them out on 64-bit targets.
+    namespace BootServicesOffset {
+        constexpr size_t raise_tpl = 24;
+        constexpr size_t restore_tpl = 32;
+        constexpr size_t allocate_pages = 40;
+        constexpr size_t free_pages = 48;
+        constexpr size_t get_memory_map = 56;
+        constexpr size_t allocate_pool = 64;
+        constexpr size_t free_pool = 72;
+        constexpr size_t create_event = 80;
+        constexpr size_t set_timer = 88;
+        constexpr size_t wait_for_event = 96;
+        constexpr size_t signal_event = 104;
+        constexpr size_t close_event = 112;
+        constexpr size_t check_event = 120;
+        constexpr size_t handle_protocol = 152;
+        constexpr size_t locate_handle = 176;
+        constexpr size_t exit_boot_services = 232;
+        constexpr size_t stall = 248;
+        constexpr size_t locate_handle_buffer = 312;
+        constexpr size_t locate_protocol = 320;
+    } // namespace BootServicesOffset
+
+    namespace FileProtocolOffset {
+        constexpr size_t read = 32;
+        constexpr size_t set_position = 56;
+        constexpr size_t read_ex = 96;
+    } // namespace FileProtocolOffset
+
+    namespace MpServicesOffset {
+        constexpr size_t startup_all_aps = 16;
+    } // namespace MpServicesOffset
+
+    namespace PciRootBridgeIoOffset {
+        constexpr size_t pci_read = 56;
+        constexpr size_t configuration = 136;
+        constexpr size_t segment_number = 144;
+    } // namespace PciRootBridgeIoOffset
+
+    namespace RuntimeServicesOffset {
+        constexpr size_t get_time = 24;
+        constexpr size_t get_variable = 72;
+        constexpr size_t set_variable = 88;
+        constexpr size_t update_capsule = 112;
+        constexpr size_t query_capsule_capabilities = 120;
+    } // namespace RuntimeServicesOffset
+
+    /// A firmware table filled in by the test instead of the firmware: the wrappers only ever see it through a
+    /// reference, like the tables the firmware hands over.
+    template <typename Table, size_t table_size = sizeof(Table)>
+    class MockTable {
+    public:
+        MockTable() noexcept {
+            std::memset(_bytes, 0, sizeof(_bytes));
+        }
+
+        template <typename Function>
+        void set(size_t offset, Function* function) noexcept {
+            std::memcpy(_bytes + offset, &function, sizeof(function));
+        }
+
+        template <typename Value>
+        void setValue(size_t offset, const Value& value) noexcept {
+            std::memcpy(_bytes + offset, &value, sizeof(value));
+        }
+
+        Table& get() noexcept {
+            return *reinterpret_cast<Table*>(_bytes);
+        }
+
+    private:
+        alignas(16) uint8_t _bytes[table_size];
+    };
+
+    /// Page allocations backed by anonymous mappings, so that AllocateType::Address works on free address space,
+    /// and every allocation is tracked until it is freed.
+    class MockPages {
+    public:
+        static Uefi::Status allocatePages(Uefi::BootServices::AllocateType type, Uefi::MemoryType, size_t pages,
+                                          Uefi::BootServices::PhysicalAddress& memory) {
+            const auto at_address = type == Uefi::BootServices::AllocateType::Address;
+            if (failAllocations())
+                return Uefi::Status::OutOfResources;
+
+            void* hint = at_address ? reinterpret_cast<void*>(static_cast<uintptr_t>(memory)) : nullptr;
+            auto* address = mmap(hint, pages * page_size, PROT_READ | PROT_WRITE,
+                                 MAP_PRIVATE | MAP_ANONYMOUS | (at_address ? MAP_FIXED_NOREPLACE : 0), -1, 0);
+            if (address == MAP_FAILED)
+                return Uefi::Status::OutOfResources;
+
+            // Fresh firmware pages are not zeroed.
+            std::memset(address, 0xCC, pages * page_size);
+            memory = reinterpret_cast<uintptr_t>(address);
+            getAllocations()[memory] = pages;
+            return Uefi::Status::Success;
+        }
+
+        /// Like the firmware, frees any pages of an allocation: what is left around them stays allocated.
+        static Uefi::Status freePages(Uefi::BootServices::PhysicalAddress memory, size_t pages) {
+            auto& allocations = getAllocations();
+            if (pages == 0 || !isAllocated(memory, pages * page_size))
+                return Uefi::Status::NotFound;
+
+            auto allocation = std::prev(allocations.upper_bound(memory));
+            const auto start = allocation->first;
+            const auto end = start + (allocation->second * page_size);
+            allocations.erase(allocation);
+
+            if (memory != start)
+                allocations[start] = (memory - start) / page_size;
+
+            if (memory + (pages * page_size) != end)
+                allocations[memory + (pages * page_size)] = (end - memory) / page_size - pages;
+
+            munmap(reinterpret_cast<void*>(static_cast<uintptr_t>(memory)), pages * page_size);
+            return Uefi::Status::Success;
+        }
+
+        static Uefi::Status allocatePool(Uefi::MemoryType, size_t size, void** buffer) {
+            if (failAllocations())
+                return Uefi::Status::OutOfResources;
+
+            *buffer = std::malloc(size);
+            return Uefi::Status::Success;
+        }
+
+        static Uefi::Status freePool(void* buffer) {
+            std::free(buffer);
+            return Uefi::Status::Success;
+        }
+
+        /// Whether `size` bytes at `address` are inside a single allocation.
+        static bool isAllocated(uintptr_t address, size_t size) {
+            const auto& allocations = getAllocations();
+            auto allocation = allocations.upper_bound(address);
+            if (allocation == allocations.begin())
+                return false;
+
+            --allocation;
+            return address + size <= allocation->first + (allocation->second * page_size);
+        }
+
+        /// The number of page allocations not freed yet.
+        static size_t getOutstandingCount() {
+            return getAllocations().size();
+        }
+
+        /// Makes the next allocations fail with OutOfResources.
+        static bool& failAllocations() {
+            static bool fail = false;
+            return fail;
+        }
+
+        /// A boot services table with the allocation functions filled in.
+        static void install(MockTable<Uefi::BootServices>& boot_services) {
+            boot_services.set(BootServicesOffset::allocate_pages, &allocatePages);
+            boot_services.set(BootServicesOffset::free_pages, &freePages);
+            boot_services.set(BootServicesOffset::allocate_pool, &allocatePool);
+            boot_services.set(BootServicesOffset::free_pool, &freePool);
+        }
+
+    private:
+        static constexpr size_t page_size = 0x1000;
+
+        static std::map<Uefi::BootServices::PhysicalAddress, size_t>& getAllocations() {
+            static std::map<Uefi::BootServices::PhysicalAddress, size_t> allocations;
+            return allocations;
+        }
+    };
+
+    /// MP services whose APs are threads. The events only stand for the APs being done: waitForEvent() joins the
+    /// threads.
+    class MockMpServices {
+    public:
+        /// The number of APs that startupAllAps() starts.
+        static size_t& apCount() {
+            static size_t count = 3;
+            return count;
+        }
+
+        static Uefi::Status startupAllAps(Uefi::MpServicesProtocol*, Uefi::MpServicesProtocol::ApProcedure procedure, bool,
+                                          Uefi::Event wait_event, size_t, void* argument, size_t**) {
+            for (size_t i = 0; i < apCount(); ++i)
+                getThreads().emplace_back(procedure, argument);
+
+            // Without an event, the call blocks until every AP is done.
+            if (wait_event == nullptr)
+                _join();
+
+            return Uefi::Status::Success;
+        }
+
+        static Uefi::Status createEvent(Uefi::EventType, Uefi::Tpl, Uefi::EventNotify, void*, Uefi::Event& event) {
+            static int object;
+            event = reinterpret_cast<Uefi::Event>(&object);
+            return Uefi::Status::Success;
+        }
+
+        static Uefi::Status waitForEvent(size_t, Uefi::Event*, size_t& index) {
+            _join();
+            index = 0;
+            return Uefi::Status::Success;
+        }
+
+        static Uefi::Status closeEvent(Uefi::Event) {
+            return Uefi::Status::Success;
+        }
+
+        /// Fills in the event functions of the boot services, and startupAllAps() of the protocol.
+        static void install(MockTable<Uefi::BootServices>& boot_services, MockTable<Uefi::MpServicesProtocol, 64>& mp_services) {
+            boot_services.set(BootServicesOffset::create_event, &createEvent);
+            boot_services.set(BootServicesOffset::wait_for_event, &waitForEvent);
+            boot_services.set(BootServicesOffset::close_event, &closeEvent);
+            mp_services.set(MpServicesOffset::startup_all_aps, &startupAllAps);
+        }
+
+    private:
+        static std::vector<std::thread>& getThreads() {
+            static std::vector<std::thread> threads;
+            return threads;
+        }
+
+        static void _join() {
+            for (auto& thread : getThreads())
+                thread.join();
+
+            getThreads().clear();
+        }
+    };
+} // namespace Test
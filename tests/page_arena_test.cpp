@@ -0,0 +1,128 @@
+#include <cstring>
+#include <random>
+#include <unordered_map>
+
+#include "mock_firmware.h"
+#include "test.h"
+
+using namespace Uefi;
+
+namespace {
+    /// Allocates, checks that the memory is aligned and inside a chunk, and fills it.
+    void* allocateChecked(PageArena& arena, size_t size, size_t alignment) {
+        auto* memory = arena.allocate(size, alignment);
+        CHECK(memory != nullptr);
+        CHECK(reinterpret_cast<uintptr_t>(memory) % alignment == 0);
+        CHECK(Test::MockPages::isAllocated(reinterpret_cast<uintptr_t>(memory), size));
+        std::memset(memory, 0x5A, size);
+        return memory;
+    }
+} // namespace
+
+int main() {
+    Test::MockTable<BootServices> boot_services_table;
+    Test::MockPages::install(boot_services_table);
+    auto& boot_services = boot_services_table.get();
+
+    PageArena arena;
+
+    // A dedicated chunk has room for the alignment too.
+    arena.initialize(boot_services);
+    allocateChecked(arena, 100, 16);
+    allocateChecked(arena, 102401, PageArena::page_size);
+    allocateChecked(arena, (16 * PageArena::page_size) - 16, PageArena::page_size);
+    arena.release();
+    CHECK(Test::MockPages::getOutstandingCount() == 0);
+
+    // So does a shared chunk, even of a single page.
+    arena.initialize(boot_services, MemoryType::LoaderData, 1);
+    for (size_t size = 1; size < 3 * PageArena::page_size; size += 509)
+        allocateChecked(arena, size, PageArena::page_size);
+
+    arena.release();
+
+    std::mt19937_64 random(1);
+    for (const size_t chunk_pages : {1, 2, 16}) {
+        arena.initialize(boot_services, MemoryType::LoaderData, chunk_pages);
+        for (int i = 0; i < 20000; ++i) {
+            const auto alignment = size_t{1} << (random() % 13);
+            const auto size = random() % 4 == 0 ? random() % (3 * chunk_pages * PageArena::page_size) : random() % 256;
+            allocateChecked(arena, size + 1, alignment);
+        }
+
+        arena.release();
+        CHECK(Test::MockPages::getOutstandingCount() == 0);
+    }
+
+    // The latest allocation is given back, and only that one.
+    arena.initialize(boot_services);
+    auto* first = allocateChecked(arena, 64, 16);
+    auto* temporary = allocateChecked(arena, 256, 16);
+    arena.deallocate(first, 64);
+    arena.deallocate(temporary, 256);
+    CHECK(allocateChecked(arena, 128, 16) == temporary);
+
+    Test::MockPages::failAllocations() = true;
+    CHECK(arena.allocate(1 << 20, 16) == nullptr);
+    Test::MockPages::failAllocations() = false;
+
+    // The containers, against the standard ones.
+    FlatMap<uint64_t, uint64_t, PageArena> map;
+    CHECK(map.initialize(arena));
+    std::unordered_map<uint64_t, uint64_t> reference;
+    for (uint64_t i = 0; i < 200000; ++i) {
+        const auto key = random() % 5000;
+        if (random() % 3 < 2) {
+            CHECK(map.insert(key, i) != nullptr);
+            reference[key] = i;
+        } else {
+            CHECK(map.erase(key) == (reference.erase(key) == 1));
+        }
+
+        if (i % 997 == 0) {
+            CHECK(map.getSize() == reference.size());
+            for (const auto& [reference_key, value] : reference)
+                CHECK(map.find(reference_key) != nullptr && *map.find(reference_key) == value);
+
+            size_t count = 0;
+            for (const auto& entry : map) {
+                CHECK(reference.at(entry.key) == entry.value);
+                ++count;
+            }
+
+            CHECK(count == reference.size());
+        }
+    }
+
+    FlatMap<Guid, int, PageArena> guid_map;
+    CHECK(guid_map.initialize(arena, 100));
+    const Guid guid = {1, 2, 3, {1, 2, 3, 4, 5, 6, 7, 8}};
+    const Guid other_guid = {1, 2, 3, {1, 2, 3, 4, 5, 6, 7, 9}};
+    guid_map.insert(guid, 5);
+    CHECK(*guid_map.find(guid) == 5 && guid_map.find(other_guid) == nullptr);
+
+    Vector<uint32_t, PageArena> vector;
+    vector.initialize(arena);
+    for (uint32_t i = 0; i < 100000; ++i)
+        CHECK(vector.pushBack(i));
+
+    for (uint32_t i = 0; i < 100000; ++i)
+        CHECK(vector[i] == i);
+
+    StaticVector<int, 8> static_vector;
+    static_vector.clear();
+    for (int i = 0; i < 9; ++i)
+        CHECK(static_vector.pushBack(i) == (i < 8));
+
+    static_vector.swapRemove(0);
+    CHECK(static_vector[0] == 7 && static_vector.getSize() == 7);
+
+    StaticString<8> string;
+    string.clear();
+    CHECK(string.append(u"abc") && string.append("def") && !string.append(u"ghi"));
+    CHECK(string == u"abcdefgh" && string.getData()[8] == 0);
+
+    arena.release();
+    CHECK(Test::MockPages::getOutstandingCount() == 0);
+    return 0;
+}
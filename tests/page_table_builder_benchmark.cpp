@@ -0,0 +1,80 @@
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "test.h"
+#include "uefi.h"
+
+using namespace Uefi;
+using MemoryDescriptor = BootServices::MemoryDescriptor;
+
+namespace {
+    constexpr int repeat_count = 20;
+    constexpr uint64_t higher_half = 0xFFFF800000000000;
+} // namespace
+
+int main() {
+    // A large machine: 600 regions over several hundred GiB, big runs of RAM between small firmware and device
+    // regions, and a few holes.
+    std::mt19937_64 random(11);
+    std::vector<MemoryDescriptor> descriptors;
+    uint64_t address = 0x100000;
+    uint64_t mapped_pages = 0;
+    const auto ram = MemoryAttribute::WriteBack | MemoryAttribute::WriteThrough | MemoryAttribute::WriteCombining | MemoryAttribute::Uncacheable;
+    while (descriptors.size() < 600) {
+        const auto kind = random() % 10;
+        const auto pages = kind < 4 ? (random() % (3 << 19)) + 1 : (random() % 2048) + 1;
+        MemoryDescriptor descriptor{};
+        descriptor.type = kind == 8 ? MemoryType::ReservedMemory : (kind == 9 ? MemoryType::MemoryMappedIO : MemoryType::ConventionalMemory);
+        descriptor.physical_start = address;
+        descriptor.pages_count = pages;
+        descriptor.attribute = descriptor.type == MemoryType::MemoryMappedIO ? MemoryAttribute::Uncacheable | MemoryAttribute::Runtime : ram;
+        descriptors.push_back(descriptor);
+        mapped_pages += pages;
+        address += pages * 4096;
+        if (random() % 20 == 0)
+            address += (random() % 4096) * 4096;
+    }
+
+    const MemoryMap map{descriptors.size() * sizeof(MemoryDescriptor), sizeof(MemoryDescriptor), 0, descriptors.data()};
+    std::printf("%zu regions, %.0f GiB mapped twice: identity and higher half\n", descriptors.size(),
+                static_cast<double>(mapped_pages) / (1 << 18));
+
+    size_t used_counts[2] = {};
+    for (const bool gigabyte_pages : {true, false}) {
+        PageTableOptions options;
+        options.gigabyte_pages = gigabyte_pages;
+        const auto bound = 1 + PageTableBuilder::getMaxPageCount(map, 0, options) + PageTableBuilder::getMaxPageCount(map, higher_half, options);
+        auto* memory = std::aligned_alloc(4096, bound * 4096);
+        CHECK(memory != nullptr);
+
+        double best = 1e9;
+        size_t used = 0;
+        for (int i = 0; i < repeat_count; ++i) {
+            const auto start = Test::getTime();
+            PageTableBuilder builder;
+            CHECK(builder.initialize(reinterpret_cast<uintptr_t>(memory), bound, options) == Status::Success);
+            CHECK(builder.mapMemoryMap(map, 0) == Status::Success && builder.mapMemoryMap(map, higher_half) == Status::Success);
+            const auto time = Test::getTime() - start;
+            best = time < best ? time : best;
+            used = builder.getUsedPageCount();
+
+            const auto& last = descriptors.back();
+            BootServices::PhysicalAddress physical_address;
+            CHECK(builder.translate(higher_half + last.physical_start + 0x1234, physical_address) && physical_address == last.physical_start + 0x1234);
+        }
+
+        std::printf("%s: %6zu table pages (bound %6zu), built in %.2f ms\n", gigabyte_pages ? "1 GiB pages  " : "2 MiB at most", used,
+                    bound, best * 1000);
+        CHECK(used <= bound);
+        used_counts[gigabyte_pages ? 0 : 1] = used;
+        std::free(memory);
+    }
+
+    CHECK(used_counts[0] < used_counts[1]);
+
+    // 4 KiB pages only: a page table per 512 pages, and the directories above them.
+    const auto tables = 2 * ((mapped_pages / 512) + (mapped_pages / (512 * 512)));
+    std::printf("4 KiB only   : more than %zu table pages\n", static_cast<size_t>(tables));
+    return 0;
+}
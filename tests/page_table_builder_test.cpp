@@ -0,0 +1,185 @@
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "test.h"
+#include "uefi.h"
+
+using namespace Uefi;
+using MemoryDescriptor = BootServices::MemoryDescriptor;
+
+namespace {
+    constexpr uint64_t pat_bit = 0x80;
+    constexpr uint64_t huge_pat_bit = 0x1000;
+
+    /// PAT memory types.
+    enum : uint8_t { uc = 0, wc = 1, wt = 4, wp = 5, wb = 6, uc_minus = 7 };
+    constexpr uint64_t power_on_pat = 0x0007040600070406;
+
+    /// The leaf entry mapping an address, and its level: 1 for 4 KiB pages up to 3 for 1 GiB pages.
+    uint64_t getLeafEntry(const PageTableBuilder& builder, uint64_t virtual_address, size_t levels, size_t& level) {
+        const auto* table = reinterpret_cast<const uint64_t*>(static_cast<uintptr_t>(builder.getRoot()));
+        for (level = levels;; --level) {
+            const auto entry = table[(virtual_address >> (12 + (9 * (level - 1)))) & 511];
+            if ((entry & 1) == 0)
+                return 0;
+
+            if (level == 1 || (entry & 0x80) != 0)
+                return entry;
+
+            table = reinterpret_cast<const uint64_t*>(static_cast<uintptr_t>(entry & 0x000FFFFFFFFFF000));
+        }
+    }
+
+    /// The memory type that a leaf entry selects from a PAT.
+    uint8_t getMemoryType(uint64_t entry, size_t level, uint64_t pat) {
+        const auto pat_set = (entry & (level == 1 ? pat_bit : huge_pat_bit)) != 0;
+        const auto index = (pat_set ? 4 : 0) | ((entry & 0x10) != 0 ? 2 : 0) | ((entry & 0x8) != 0 ? 1 : 0);
+        return static_cast<uint8_t>(pat >> (index * 8));
+    }
+
+    struct Tables {
+        void* memory;
+        PageTableBuilder builder;
+
+        Tables(size_t page_count, const PageTableOptions& options = {}) : memory(std::aligned_alloc(4096, page_count * 4096)) {
+            CHECK(builder.initialize(reinterpret_cast<uintptr_t>(memory), page_count, options) == Status::Success);
+        }
+
+        ~Tables() {
+            std::free(memory);
+        }
+    };
+} // namespace
+
+int main() {
+    // A machine with a few hundred GiB in many regions, some of them device memory, and holes.
+    std::mt19937_64 random(5);
+    std::vector<MemoryDescriptor> descriptors;
+    uint64_t address = 0;
+    const auto ram = MemoryAttribute::WriteBack | MemoryAttribute::WriteThrough | MemoryAttribute::WriteCombining | MemoryAttribute::Uncacheable;
+    const auto add = [&](MemoryType type, uint64_t pages, MemoryAttribute attribute) {
+        MemoryDescriptor descriptor{};
+        descriptor.type = type;
+        descriptor.physical_start = address;
+        descriptor.pages_count = pages;
+        descriptor.attribute = attribute;
+        descriptors.push_back(descriptor);
+        address += pages * 4096;
+    };
+
+    add(MemoryType::BootServicesData, 0xA0, ram);
+    address = 0x100000;
+    for (int i = 0; i < 200; ++i) {
+        const auto kind = random() % 10;
+        const auto pages = kind < 7 ? (random() % (1 << 20)) + 1 : (random() % 512) + 1;
+        const auto type = kind == 8 ? MemoryType::ReservedMemory : (kind == 9 ? MemoryType::MemoryMappedIO : MemoryType::ConventionalMemory);
+        add(type, pages, type == MemoryType::MemoryMappedIO ? MemoryAttribute::Uncacheable | MemoryAttribute::Runtime : ram);
+        if (random() % 20 == 0)
+            address += (random() % 4096) * 4096;
+    }
+
+    const MemoryMap map{descriptors.size() * sizeof(MemoryDescriptor), sizeof(MemoryDescriptor), 0, descriptors.data()};
+
+    for (int five_level = 0; five_level < 2; ++five_level) {
+        for (int gigabyte_pages = 0; gigabyte_pages < 2; ++gigabyte_pages) {
+            PageTableOptions options;
+            options.five_level = five_level != 0;
+            options.gigabyte_pages = gigabyte_pages != 0;
+            const size_t levels = options.five_level ? 5 : 4;
+
+            // A higher half which isn't aligned like the physical addresses, so that fewer large pages fit.
+            const uint64_t higher_half = (options.five_level ? 0xFF00000000000000 : 0xFFFF800000000000) +
+                                         (options.gigabyte_pages ? 0x1000 : (3 * PageTableBuilder::huge_page_size) + PageTableBuilder::large_page_size);
+            const auto bound = 1 + PageTableBuilder::getMaxPageCount(map, 0, options) + PageTableBuilder::getMaxPageCount(map, higher_half, options);
+
+            Tables tables(bound, options);
+            auto& builder = tables.builder;
+            CHECK(builder.mapMemoryMap(map, 0) == Status::Success);
+            CHECK(builder.mapMemoryMap(map, higher_half) == Status::Success);
+            CHECK(builder.getUsedPageCount() <= bound);
+
+            for (const auto& descriptor : descriptors) {
+                for (int i = 0; i < 8; ++i) {
+                    const auto offset = random() % (descriptor.pages_count * 4096);
+                    for (const auto base : {uint64_t{0}, higher_half}) {
+                        BootServices::PhysicalAddress physical_address;
+                        CHECK(builder.translate(base + descriptor.physical_start + offset, physical_address));
+                        CHECK(physical_address == descriptor.physical_start + offset);
+
+                        size_t level;
+                        const auto entry = getLeafEntry(builder, base + descriptor.physical_start + offset, levels, level);
+                        const auto type = getMemoryType(entry, level, PageTableBuilder::pat_value);
+                        CHECK(type == (descriptor.type == MemoryType::MemoryMappedIO ? uc : wb));
+                        CHECK(options.gigabyte_pages || level < 3);
+                    }
+                }
+            }
+
+            BootServices::PhysicalAddress physical_address;
+            CHECK(!builder.translate(0xA0000, physical_address));
+            CHECK(!builder.translate(address + (3 * PageTableBuilder::huge_page_size), physical_address));
+        }
+    }
+
+    // Each cache policy selects the right type from pat_value, and what the power-on PAT turns it into.
+    {
+        Tables tables(64);
+        auto& builder = tables.builder;
+        const struct {
+            MemoryAttribute cache;
+            uint8_t type;
+            uint8_t power_on_type;
+        } policies[] = {
+            {MemoryAttribute::WriteBack, wb, wb},
+            {MemoryAttribute::WriteCombining, wc, wt},
+            {MemoryAttribute::Uncacheable, uc, uc},
+            {MemoryAttribute::WriteProtected, wp, wt},
+            {MemoryAttribute::WriteThrough, wt, uc},
+        };
+
+        uint64_t virtual_address = 0;
+        for (const auto& policy : policies) {
+            for (const auto size : {PageTableBuilder::small_page_size, PageTableBuilder::large_page_size}) {
+                virtual_address += PageTableBuilder::large_page_size;
+                CHECK(builder.map(virtual_address, 0x80000000, size, policy.cache) == Status::Success);
+
+                size_t level;
+                const auto entry = getLeafEntry(builder, virtual_address, 4, level);
+                CHECK(level == (size == PageTableBuilder::small_page_size ? 1 : 2));
+                CHECK(getMemoryType(entry, level, PageTableBuilder::pat_value) == policy.type);
+                CHECK(getMemoryType(entry, level, power_on_pat) == policy.power_on_type);
+            }
+        }
+
+        CHECK(static_cast<uint8_t>(PageTableBuilder::pat_value >> 56) == wt);
+        CHECK(static_cast<uint8_t>(PageTableBuilder::pat_value >> 48) == uc_minus);
+    }
+
+    // Mapping over part of a large page splits it, and keeps the rest.
+    {
+        Tables tables(64);
+        auto& builder = tables.builder;
+        CHECK(builder.map(0, 0, PageTableBuilder::huge_page_size, MemoryAttribute::WriteBack) == Status::Success);
+        size_t level;
+        getLeafEntry(builder, 0x12345000, 4, level);
+        CHECK(level == 3);
+
+        CHECK(builder.map(0x200000, 0x80000000, 0x1000, MemoryAttribute::WriteThrough, PageFlags::NoExecute) == Status::Success);
+        BootServices::PhysicalAddress physical_address;
+        CHECK(builder.translate(0x200123, physical_address) && physical_address == 0x80000123);
+        CHECK(builder.translate(0x201123, physical_address) && physical_address == 0x201123);
+        CHECK(builder.translate(0x3FFFF123, physical_address) && physical_address == 0x3FFFF123);
+
+        const auto entry = getLeafEntry(builder, 0x200000, 4, level);
+        CHECK(level == 1 && (entry >> 63) == 1 && (entry & 0x2) == 0);
+        getLeafEntry(builder, 0x400000, 4, level);
+        CHECK(level == 2);
+
+        CHECK(builder.map(0x1000, 0x1001, 0x1000, MemoryAttribute::WriteBack) == Status::InvalidParameter);
+        CHECK(builder.map(0x0000800000000000, 0, 0x1000, MemoryAttribute::WriteBack) == Status::InvalidParameter);
+        CHECK(builder.map(0x00007FFFFFFFF000, 0, 0x2000, MemoryAttribute::WriteBack) == Status::InvalidParameter);
+    }
+
+    return 0;
+}
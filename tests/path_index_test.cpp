@@ -0,0 +1,108 @@
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "mock_file.h"
+#include "test.h"
+
+using namespace Uefi;
+using Node = Test::MockDirectory::Node;
+
+namespace {
+    /// 10 directories of 10 subdirectories of 30 files, and a file with the longest name FAT allows.
+    Node makeTree() {
+        Node root{u"", true, 0, {}};
+        for (int a = 0; a < 10; ++a) {
+            Node directory{u"Dir" + std::u16string(1, static_cast<char16_t>(u'A' + a)), true, 0, {}};
+            for (int b = 0; b < 10; ++b) {
+                Node subdirectory{u"sub" + std::u16string(1, static_cast<char16_t>(u'0' + b)), true, 0, {}};
+                for (int c = 0; c < 30; ++c) {
+                    const auto name = u"file" + std::u16string(1, static_cast<char16_t>(u'a' + (c % 26))) +
+                                      std::u16string(1, static_cast<char16_t>(u'0' + (c / 26))) + u".efi";
+                    subdirectory.children.push_back({name, false, static_cast<uint64_t>((a * 1000) + (b * 100) + c), {}});
+                }
+
+                directory.children.push_back(subdirectory);
+            }
+
+            root.children.push_back(directory);
+        }
+
+        root.children.push_back({std::u16string(255, u'x'), false, 7, {}});
+        return root;
+    }
+} // namespace
+
+int main() {
+    const auto tree = makeTree();
+    Test::MockDirectory::Counters counters;
+    Test::MockDirectory root(tree, counters);
+
+    // The iterator skips "." and "..".
+    DirectoryIterator iterator;
+    CHECK(iterator.initialize(root) == Status::Success);
+    size_t count = 0;
+    for (auto entry = iterator.next(); entry && *entry != nullptr; entry = iterator.next())
+        ++count;
+
+    CHECK(count == 11 && counters.read_count == 14);
+
+    // Depth limit and skipped directories.
+    size_t visited = 0;
+    CHECK(walkDirectory(
+              root,
+              [&](const char16_t* path, size_t depth, const FileInfo&) {
+                  ++visited;
+                  return depth == 0 && path[4] == u'B' ? WalkAction::Skip : WalkAction::Continue;
+              },
+              1) == Status::Success);
+    CHECK(visited == 11 + (9 * 10) && counters.open_handles == 0);
+
+    visited = 0;
+    CHECK(walkDirectory(root, [&](const char16_t*, size_t, const FileInfo&) { return ++visited == 50 ? WalkAction::Stop : WalkAction::Continue; }) ==
+          Status::Success);
+    CHECK(visited == 50 && counters.open_handles == 0);
+
+    // The index: one read per entry to build it, none to look paths up.
+    std::vector<uint64_t> memory(1 << 17);
+    PathIndex index;
+    CHECK(index.initialize(memory.data(), memory.size() * sizeof(uint64_t)) == Status::Success);
+    counters = {};
+    CHECK(index.build(root) == Status::Success);
+    CHECK(index.getEntryCount() == 11 + 100 + 3000 && counters.open_handles == 0);
+    CHECK(counters.open_count == 110 && counters.read_count == index.getEntryCount() + (111 * 3));
+
+    const auto* entry = index.find(u"\\DirC\\sub4\\filec0.efi");
+    CHECK(entry != nullptr && entry->file_size == 2402 && !entry->isDirectory());
+    CHECK(index.find(u"dirc/SUB4/FILEC0.EFI") == entry);
+    CHECK(index.find(u"\\DirC\\sub4") != nullptr && index.find(u"\\DirC\\sub4")->isDirectory());
+    CHECK(index.find(u"\\DirC\\sub4\\nope.efi") == nullptr);
+    CHECK(index.find(u"\\DirJ\\sub9\\filed1.efi") != nullptr && index.find(u"\\DirJ\\sub9\\filed1.efi")->file_size == 9929);
+    CHECK(index.find((u"\\" + std::u16string(255, u'X')).c_str()) != nullptr);
+
+    // The latest of two entries for the same path wins.
+    CHECK(index.add(u"\\DIRC\\SUB4\\FILEC0.EFI", 5, FileAttributes::Archive) == Status::Success);
+    CHECK(index.find(u"\\DirC\\sub4\\filec0.efi")->file_size == 5);
+
+    // Not enough memory for every entry.
+    std::vector<uint64_t> small_memory(64);
+    CHECK(index.initialize(small_memory.data(), small_memory.size() * sizeof(uint64_t)) == Status::Success);
+    CHECK(index.build(root) == Status::OutOfResources);
+    CHECK(index.getEntryCount() > 0 && index.getEntryCount() < 10);
+
+    // Not even enough for the buckets: nothing is written, and the index stays empty.
+    alignas(8) uint8_t tiny_memory[PathIndex::min_size + 16];
+    std::memset(tiny_memory, 0xEE, sizeof(tiny_memory));
+    CHECK(index.initialize(tiny_memory, PathIndex::min_size - 8) == Status::BufferTooSmall);
+    for (const auto byte : tiny_memory)
+        CHECK(byte == 0xEE);
+
+    CHECK(index.getEntryCount() == 0 && index.find(u"\\DirA") == nullptr);
+    CHECK(index.add(u"\\DirA", 0, FileAttributes::Directory) == Status::OutOfResources);
+
+    CHECK(index.initialize(tiny_memory, PathIndex::min_size) == Status::Success);
+    CHECK(index.add(u"\\DirA", 0, FileAttributes::Directory) == Status::OutOfResources);
+    CHECK(index.find(u"\\DirA") == nullptr);
+
+    return 0;
+}
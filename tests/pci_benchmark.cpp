@@ -0,0 +1,131 @@
+#include <cstring>
+#include <vector>
+
+#include <sys/mman.h>
+
+#include "mock_firmware.h"
+#include "test.h"
+
+using namespace Uefi;
+
+namespace {
+    constexpr size_t bus_count = 256;
+    constexpr size_t bridge_count = 4;
+    constexpr int repeat_count = 5;
+
+    /// The configuration space of a whole segment, as an ECAM window maps it. Only the headers which are read are
+    /// written, so most of it is never touched.
+    uint8_t* config_space;
+
+    uint32_t* getHeader(size_t bus, size_t device, size_t function) {
+        return reinterpret_cast<uint32_t*>(config_space + (bus << 20) + (device << 15) + (function << 12));
+    }
+
+    size_t pci_read_count = 0;
+
+    Status pciRead(PciRootBridgeIoProtocol*, PciIoWidth width, uint64_t address, size_t count, void* buffer) {
+        ++pci_read_count;
+        const auto bus = (address >> 24) & 0xFF, device = (address >> 16) & 31, function = (address >> 8) & 7;
+        std::memcpy(buffer, reinterpret_cast<uint8_t*>(getHeader(bus, device, function)) + (address & 0xFF), count << static_cast<uint32_t>(width));
+        return Status::Success;
+    }
+
+    Test::MockTable<PciRootBridgeIoProtocol> bridges[bridge_count];
+
+    /// The bus range of a bridge: a quarter of the buses each.
+    Status configuration(PciRootBridgeIoProtocol* bridge, const void** resources) {
+        static uint8_t descriptors[bridge_count][46 + 2];
+        size_t index = 0;
+        while (&bridges[index].get() != bridge)
+            ++index;
+
+        const uint64_t first = index * (bus_count / bridge_count), last = first + (bus_count / bridge_count) - 1;
+        auto* descriptor = descriptors[index];
+        descriptor[0] = 0x8A;
+        descriptor[1] = 43;
+        descriptor[3] = 2;
+        std::memcpy(descriptor + 14, &first, sizeof(first));
+        std::memcpy(descriptor + 22, &last, sizeof(last));
+        descriptor[46] = 0x79;
+        *resources = descriptor;
+        return Status::Success;
+    }
+
+    /// Milliseconds of the best of a few scans, each into an empty table.
+    template <typename Scan>
+    double getMilliseconds(PciDeviceTable& table, void* memory, size_t size, Scan scan) {
+        double best = 1e9;
+        for (int i = 0; i < repeat_count; ++i) {
+            table.initialize(memory, size);
+            const auto start = Test::getTime();
+            CHECK(scan() == Status::Success);
+            const auto time = (Test::getTime() - start) * 1000;
+            best = time < best ? time : best;
+        }
+
+        return best;
+    }
+} // namespace
+
+int main() {
+    config_space = static_cast<uint8_t*>(mmap(nullptr, bus_count << 20, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    CHECK(config_space != MAP_FAILED);
+
+    // A big server: every bus has 8 devices, 6 with a single function and 2 with 8 functions, and 24 empty slots.
+    size_t function_count = 0;
+    for (size_t bus = 0; bus < bus_count; ++bus) {
+        for (size_t device = 0; device < 32; ++device) {
+            const bool present = device < 8, multi_function = device % 4 == 3;
+            for (size_t function = 0; function < (multi_function ? 8 : 1); ++function) {
+                auto* header = getHeader(bus, device, function);
+                header[0] = present ? 0x8086 | (static_cast<uint32_t>(0x1000 + device) << 16) : ~uint32_t{0};
+                header[2] = 0x01 | (uint32_t{0x0200} << 16);
+                header[3] = multi_function ? 0x800000 : 0;
+                function_count += present ? 1 : 0;
+            }
+        }
+    }
+
+    std::vector<uint32_t> memory(PciDeviceTable::getRequiredSize(function_count) / sizeof(uint32_t) + 1);
+    const auto size = memory.size() * sizeof(uint32_t);
+    PciDeviceTable table;
+
+    // Through an ECAM window: the registers are plain loads, one per function probed and two more per function found.
+    std::vector<uint64_t> mcfg_memory((sizeof(AcpiMcfg) + sizeof(McfgAllocation) + 7) / 8);
+    auto& mcfg = *reinterpret_cast<AcpiMcfg*>(mcfg_memory.data());
+    mcfg.header.signature = AcpiMcfg::expected_signature;
+    mcfg.header.length = sizeof(AcpiMcfg) + sizeof(McfgAllocation);
+    const McfgAllocation window{reinterpret_cast<uintptr_t>(config_space), 0, 0, bus_count - 1, 0};
+    std::memcpy(&mcfg + 1, &window, sizeof(window));
+
+    const auto ecam_time = getMilliseconds(table, memory.data(), size, [&] { return table.scanEcam(mcfg); });
+    CHECK(table.getDeviceCount() == function_count);
+
+    // Through the root bridges, with a pciRead() for every function probed.
+    for (auto& bridge : bridges) {
+        bridge.set(Test::PciRootBridgeIoOffset::pci_read, &pciRead);
+        bridge.set(Test::PciRootBridgeIoOffset::configuration, &configuration);
+    }
+
+    const auto bridge_time = getMilliseconds(table, memory.data(), size, [&] {
+        pci_read_count = 0;
+        auto status = Status::Success;
+        for (size_t i = 0; i < bridge_count && status == Status::Success; ++i)
+            status = table.scanRootBridge(bridges[i].get());
+
+        return status;
+    });
+    CHECK(table.getDeviceCount() == function_count);
+
+    // Every slot is probed, and every function of the multi-function devices.
+    const auto probe_count = bus_count * (32 + (2 * 8) - 2);
+    CHECK(pci_read_count == probe_count);
+    std::printf("%zu buses, %zu functions, %zu probes\n", bus_count, function_count, probe_count);
+    std::printf("ECAM         %6.2f ms | %5.1f ns per probe | %.2f loads per function found\n", ecam_time, ecam_time * 1e6 / probe_count,
+                static_cast<double>(probe_count + (2 * function_count)) / function_count);
+    std::printf("root bridges %6.2f ms | %5.1f ns per probe | %.2f pciRead() per function found\n", bridge_time,
+                bridge_time * 1e6 / probe_count, static_cast<double>(pci_read_count) / function_count);
+
+    munmap(config_space, bus_count << 20);
+    return 0;
+}
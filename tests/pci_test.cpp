@@ -0,0 +1,209 @@
+#include <cstring>
+#include <vector>
+
+#include <sys/mman.h>
+
+#include "mock_firmware.h"
+#include "test.h"
+
+using namespace Uefi;
+
+namespace {
+    constexpr size_t bus_count = 16;
+
+    /// The configuration space of the buses, 4 KiB per function, as an ECAM window maps it.
+    uint8_t* config_space;
+
+    uint32_t* getHeader(size_t bus, size_t device, size_t function) {
+        return reinterpret_cast<uint32_t*>(config_space + (bus << 20) + (device << 15) + (function << 12));
+    }
+
+    void addFunction(size_t bus, size_t device, size_t function, uint16_t vendor_id, uint16_t device_id, uint16_t class_code,
+                     uint8_t programming_interface, uint8_t header_type) {
+        auto* header = getHeader(bus, device, function);
+        header[0] = vendor_id | (uint32_t{device_id} << 16);
+        header[2] = 0x01 | (uint32_t{programming_interface} << 8) | (uint32_t{class_code} << 16);
+        header[3] = uint32_t{header_type} << 16;
+    }
+
+    Test::MockTable<PciRootBridgeIoProtocol> bridges[2];
+    size_t pci_read_count = 0;
+
+    Status pciRead(PciRootBridgeIoProtocol*, PciIoWidth width, uint64_t address, size_t count, void* buffer) {
+        ++pci_read_count;
+        const auto bus = (address >> 24) & 0xFF, device = (address >> 16) & 31, function = (address >> 8) & 7;
+        const auto size = count << static_cast<uint32_t>(width);
+        if (bus >= bus_count)
+            std::memset(buffer, 0xFF, size);
+        else
+            std::memcpy(buffer, reinterpret_cast<uint8_t*>(getHeader(bus, device, function)) + (address & 0xFF), size);
+
+        return Status::Success;
+    }
+
+    /// An I/O range, then the bus range: the first bridge has buses 8 to 15, the second 0 to 7.
+    Status configuration(PciRootBridgeIoProtocol* bridge, const void** resources) {
+        static uint8_t descriptors[2][(2 * 46) + 2];
+        const size_t index = bridge == &bridges[0].get() ? 0 : 1;
+        const uint64_t first = index == 0 ? 8 : 0, last = first + 7;
+
+        auto* descriptor = descriptors[index];
+        for (const uint8_t type : {1, 2}) {
+            descriptor[0] = 0x8A;
+            descriptor[1] = 43;
+            descriptor[3] = type;
+            std::memcpy(descriptor + 14, &first, sizeof(first));
+            std::memcpy(descriptor + 22, &last, sizeof(last));
+            descriptor += 46;
+        }
+
+        descriptor[0] = 0x79;
+        *resources = descriptors[index];
+        return Status::Success;
+    }
+
+    Status configurationUnsupported(PciRootBridgeIoProtocol*, const void**) {
+        return Status::Unsupported;
+    }
+
+    int handle_objects[2];
+    Handle handles[2] = {reinterpret_cast<Handle>(&handle_objects[0]), reinterpret_cast<Handle>(&handle_objects[1])};
+
+    /// A pool copy of the handles, which the caller frees.
+    Status locateHandleBuffer(BootServices::LocateSearchType, const Guid* guid, const void*, size_t& handle_count, Handle*& buffer) {
+        if (guid == nullptr || *guid != PciRootBridgeIoProtocol::guid)
+            return Status::NotFound;
+
+        void* pool;
+        CHECK(Test::MockPages::allocatePool(MemoryType::BootServicesData, sizeof(handles), &pool) == Status::Success);
+        std::memcpy(pool, handles, sizeof(handles));
+        handle_count = 2;
+        buffer = static_cast<Handle*>(pool);
+        return Status::Success;
+    }
+
+    Status handleProtocol(Handle handle, const Guid& guid, void** interface) {
+        if (guid != PciRootBridgeIoProtocol::guid)
+            return Status::Unsupported;
+
+        *interface = &bridges[handle == handles[0] ? 0 : 1].get();
+        return Status::Success;
+    }
+
+    /// An MCFG table with the given windows.
+    std::vector<uint64_t> makeMcfg(const std::vector<McfgAllocation>& allocations) {
+        std::vector<uint64_t> table((sizeof(AcpiMcfg) + (allocations.size() * sizeof(McfgAllocation)) + 7) / 8);
+        auto& mcfg = *reinterpret_cast<AcpiMcfg*>(table.data());
+        mcfg.header.signature = AcpiMcfg::expected_signature;
+        mcfg.header.length = static_cast<uint32_t>(sizeof(AcpiMcfg) + (allocations.size() * sizeof(McfgAllocation)));
+        std::memcpy(&mcfg + 1, allocations.data(), allocations.size() * sizeof(McfgAllocation));
+        return table;
+    }
+
+    alignas(4) uint8_t memory[PciDeviceTable::getRequiredSize(256)];
+    alignas(4) uint8_t other_memory[PciDeviceTable::getRequiredSize(256)];
+} // namespace
+
+int main() {
+    config_space = static_cast<uint8_t*>(mmap(nullptr, bus_count << 20, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    CHECK(config_space != MAP_FAILED);
+    for (size_t bus = 0; bus < bus_count; ++bus) {
+        for (size_t device = 0; device < 32; ++device) {
+            for (size_t function = 0; function < 8; ++function)
+                getHeader(bus, device, function)[0] = ~uint32_t{0};
+        }
+    }
+
+    // Bus 0: a host bridge, a multi-function chipset device with a gap between its functions, a network controller
+    // and 8 bridges. Buses 1 to 8: an NVMe controller each. Bus 9: a graphics card with its audio function.
+    addFunction(0, 0, 0, 0x8086, 0x1237, 0x0600, 0, 0);
+    addFunction(0, 1, 0, 0x8086, 0x7000, 0x0601, 0, 0x80);
+    addFunction(0, 1, 1, 0x8086, 0x7010, 0x0101, 0x80, 0);
+    addFunction(0, 1, 3, 0x8086, 0x7113, 0x0680, 0, 0);
+    addFunction(0, 3, 0, 0x8086, 0x100E, 0x0200, 0, 0);
+    for (size_t i = 0; i < 8; ++i)
+        addFunction(0, 8 + i, 0, 0x1B36, 0x000C, 0x0604, 0, 1);
+
+    for (size_t i = 0; i < 8; ++i)
+        addFunction(1 + i, 0, 0, 0x1B36, 0x0010, 0x0108, 2, 0);
+
+    addFunction(9, 0, 0, 0x10DE, 0x1234, 0x0300, 0, 0x80);
+    addFunction(9, 0, 1, 0x10DE, 0x1235, 0x0403, 0, 0);
+
+    // A function of a single-function device: some devices decode only the device number, and show the same header
+    // at every function, so it must not be read.
+    addFunction(0, 3, 2, 0xDEAD, 0xBEEF, 0xFF00, 0, 0);
+    constexpr size_t device_count = 4 + 1 + 8 + 8 + 2;
+
+    Test::MockTable<BootServices> boot_services_table;
+    Test::MockPages::install(boot_services_table);
+    boot_services_table.set(Test::BootServicesOffset::locate_handle_buffer, &locateHandleBuffer);
+    boot_services_table.set(Test::BootServicesOffset::handle_protocol, &handleProtocol);
+    auto& boot_services = boot_services_table.get();
+    for (auto& bridge : bridges) {
+        bridge.set(Test::PciRootBridgeIoOffset::pci_read, &pciRead);
+        bridge.set(Test::PciRootBridgeIoOffset::configuration, &configuration);
+    }
+
+    // Through the ECAM window of an MCFG table.
+    const auto mcfg = makeMcfg({{reinterpret_cast<uintptr_t>(config_space), 0, 0, bus_count - 1, 0}});
+    PciDeviceTable table;
+    table.initialize(memory, sizeof(memory));
+    CHECK(table.scan(boot_services, reinterpret_cast<const AcpiMcfg*>(mcfg.data())) == Status::Success);
+    CHECK(table.getDeviceCount() == device_count);
+    for (size_t i = 1; i < table.getDeviceCount(); ++i)
+        CHECK(table.getDevice(i - 1).getAddress() < table.getDevice(i).getAddress());
+
+    const auto* network = table.findByClass(0x0200);
+    CHECK(network != nullptr && network->bus == 0 && network->getDevice() == 3 && network->vendor_id == 0x8086);
+    CHECK(network->device_id == 0x100E && network->revision_id == 1 && network->header_type == 0);
+    for (size_t i = 0; i < 8; ++i) {
+        const auto* nvme = table.findByClass(0x0108, i);
+        CHECK(nvme != nullptr && nvme->bus == 1 + i && nvme->programming_interface == 2 && nvme->getClassCode() == 0x0108);
+    }
+
+    CHECK(table.findByClass(0x0108, 8) == nullptr && table.findByClass(0xFF00) == nullptr && table.findByClass(0x0100) == nullptr);
+    CHECK(table.find(0, 9, 0, 1)->getClassCode() == 0x0403 && table.find(0, 9, 0, 1)->getFunction() == 1);
+    CHECK(table.find(0, 0, 3, 0) != nullptr && table.find(0, 0, 3, 2) == nullptr);
+    CHECK(table.find(0, 0, 1, 0)->header_type == 0 && table.find(0, 0, 1, 3) != nullptr && table.find(0, 0, 1, 2) == nullptr);
+    CHECK(table.find(0, 0, 8, 0)->header_type == 1 && table.find(1, 0, 0, 0) == nullptr && table.find(0, 10, 0, 0) == nullptr);
+
+    // Through the two root bridges, listed in the reverse order of their buses: the same table, with one read per
+    // function probed.
+    PciDeviceTable bridge_table;
+    bridge_table.initialize(other_memory, sizeof(other_memory));
+    pci_read_count = 0;
+    CHECK(bridge_table.scan(boot_services, nullptr) == Status::Success);
+    CHECK(bridge_table.getDeviceCount() == device_count && std::memcmp(memory, other_memory, device_count * sizeof(PciDevice)) == 0);
+    CHECK(pci_read_count == (bus_count * 32) + 7 + 7 && Test::MockPages::getOutstandingCount() == 0);
+    for (size_t i = 0; i < 8; ++i)
+        CHECK(bridge_table.findByClass(0x0108, i) == bridge_table.find(0, static_cast<uint8_t>(1 + i), 0, 0));
+
+    // A root bridge which cannot tell its buses is scanned for all of them.
+    bridges[1].set(Test::PciRootBridgeIoOffset::configuration, &configurationUnsupported);
+    bridge_table.initialize(other_memory, sizeof(other_memory));
+    pci_read_count = 0;
+    CHECK(bridge_table.scanRootBridge(bridges[1].get()) == Status::Success);
+    CHECK(bridge_table.getDeviceCount() == device_count && pci_read_count == (256 * 32) + 7 + 7);
+
+    // Two windows, listed out of order, in different segments.
+    const auto segments = makeMcfg({{reinterpret_cast<uintptr_t>(config_space) + (8 << 20), 1, 0, 7, 0},
+                                    {reinterpret_cast<uintptr_t>(config_space), 0, 0, 7, 0}});
+    table.initialize(memory, sizeof(memory));
+    CHECK(table.scanEcam(*reinterpret_cast<const AcpiMcfg*>(segments.data())) == Status::Success);
+    CHECK(table.getDeviceCount() == device_count && table.getDevice(0).segment == 0);
+    CHECK(table.find(1, 1, 0, 1)->getClassCode() == 0x0403 && table.find(1, 0, 0, 0)->getClassCode() == 0x0108);
+    CHECK(table.findByClass(0x0108, 6)->segment == 0 && table.findByClass(0x0108, 7)->segment == 1 && table.find(0, 8, 0, 0) == nullptr);
+
+    // A table too small keeps the first devices.
+    alignas(4) uint8_t small_memory[PciDeviceTable::getRequiredSize(5)];
+    PciDeviceTable small_table;
+    small_table.initialize(small_memory, sizeof(small_memory));
+    CHECK(small_table.scanEcam(*reinterpret_cast<const AcpiMcfg*>(mcfg.data())) == Status::BufferTooSmall);
+    CHECK(small_table.getDeviceCount() == 5 && small_table.find(0, 0, 3, 0) != nullptr && small_table.findByClass(0x0200) != nullptr);
+
+    uint8_t first = 1, last = 1;
+    CHECK(!getPciBusRange(nullptr, first, last) && first == 1 && last == 1);
+    munmap(config_space, bus_count << 20);
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "mock_file.h"
+#include "mock_firmware.h"
+#include "test.h"
+
+using namespace Uefi;
+
+namespace {
+    // An end node alone: the smallest valid device path.
+    const uint8_t disk_path[] = {0x7F, 0xFF, 4, 0};
+
+    struct RegisteredDisk {
+        uint64_t base;
+        uint64_t size;
+        int count;
+        Status status;
+    } registered;
+
+    Status registerRamDisk(uint64_t base, uint64_t size, const Guid* type, const DevicePathProtocol*, const DevicePathProtocol** device_path) {
+        if (registered.status != Status::Success)
+            return registered.status;
+
+        CHECK(*type == virtual_disk_guid);
+        registered.base = base;
+        registered.size = size;
+        ++registered.count;
+        *device_path = reinterpret_cast<const DevicePathProtocol*>(disk_path);
+        return Status::Success;
+    }
+
+    Status unregisterRamDisk(const DevicePathProtocol* device_path) {
+        CHECK(device_path == reinterpret_cast<const DevicePathProtocol*>(disk_path));
+        --registered.count;
+        return Status::Success;
+    }
+
+    std::vector<uint8_t> makeImage(size_t size) {
+        std::vector<uint8_t> image(size);
+        for (size_t i = 0; i < size; ++i)
+            image[i] = static_cast<uint8_t>((i * 131) + 7);
+
+        return image;
+    }
+} // namespace
+
+int main() {
+    Test::MockTable<BootServices> boot_services_table;
+    Test::MockPages::install(boot_services_table);
+    auto& boot_services = boot_services_table.get();
+
+    Test::MockTable<RamDiskProtocol> protocol_table;
+    protocol_table.set(0, &registerRamDisk);
+    protocol_table.set(8, &unregisterRamDisk);
+    auto& protocol = protocol_table.get();
+
+    // A recovery image of 2000 files of 3000 bytes, with some metadata.
+    constexpr size_t file_count = 2000;
+    constexpr size_t file_size = 3000;
+    const auto image = makeImage((file_count * file_size) + 100);
+
+    RamDisk disk;
+    Test::MockFile file(image);
+    CHECK(disk.load(boot_services, protocol, file) == Status::Success);
+    CHECK(registered.count == 1);
+    CHECK(disk.getSize() % RamDisk::block_size == 0 && disk.getSize() >= image.size());
+    CHECK(registered.base == disk.getBase() && registered.size == disk.getSize());
+    CHECK(disk.getDevicePath()->getSize() == sizeof(disk_path));
+
+    const auto* memory = reinterpret_cast<const uint8_t*>(static_cast<uintptr_t>(disk.getBase()));
+    CHECK(std::memcmp(memory, image.data(), image.size()) == 0);
+    for (auto i = image.size(); i < disk.getSize(); ++i)
+        CHECK(memory[i] == 0);
+
+    // Without the disk, reading the files one by one from the device: a lookup in the directory, then a read of the
+    // file's data, for each of them.
+    Test::MockDirectory::Node directory{u"", true, 0, {}};
+    for (size_t i = 0; i < file_count; ++i) {
+        const auto name = std::to_string(i) + ".bin";
+        directory.children.push_back({std::u16string(name.begin(), name.end()), false, file_size, {}});
+    }
+
+    Test::MockDirectory::Counters counters;
+    Test::MockDirectory root(directory, counters);
+    Test::MockFile device(image);
+    std::vector<uint8_t> contents(file_size);
+    for (size_t i = 0; i < file_count; ++i) {
+        const auto opened = root.open(directory.children[i].name.c_str(), OpenMode::Read);
+        CHECK(opened.isSuccess() && (*opened)->close() == Status::Success);
+        CHECK(device.setPosition(i * file_size) == Status::Success);
+        const auto read = device.read(contents.data(), contents.size());
+        CHECK(read.isSuccess() && *read == file_size && std::memcmp(contents.data(), &image[i * file_size], file_size) == 0);
+    }
+
+    const auto per_file_requests = counters.open_count + device.read_count;
+    CHECK(counters.open_count == file_count && device.read_count == file_count && counters.open_handles == 0);
+    CHECK(disk.getReadCount() == 2 && file.read_count == 2);
+    CHECK(disk.getReadCount() * 1000 < per_file_requests);
+
+    // A loaded disk is not replaced behind the firmware's back.
+    Test::MockFile other(image);
+    CHECK(disk.load(boot_services, protocol, other) == Status::AlreadyStarted);
+    CHECK(other.read_count == 0 && registered.count == 1 && Test::MockPages::getOutstandingCount() == 1);
+
+    CHECK(disk.unload(boot_services) == Status::Success);
+    CHECK(registered.count == 0 && Test::MockPages::getOutstandingCount() == 0);
+    CHECK(disk.unload(boot_services) == Status::Success);
+
+    // A smaller read size only means more reads.
+    Test::MockFile chunked(image);
+    CHECK(disk.load(boot_services, protocol, chunked, virtual_disk_guid, MemoryType::ReservedMemory, 1024 * 1024) == Status::Success);
+    CHECK(disk.getReadCount() == 6);
+    CHECK(disk.unload(boot_services) == Status::Success);
+
+    // A file shorter than its size: the pages are freed.
+    Test::MockFile truncated(image);
+    truncated.reported_size = image.size() + 5000;
+    CHECK(disk.load(boot_services, protocol, truncated) == Status::VolumeCorrupted);
+    CHECK(Test::MockPages::getOutstandingCount() == 0 && disk.getDevicePath() == nullptr);
+
+    // The firmware refuses the disk: the pages are freed too.
+    registered.status = Status::Unsupported;
+    Test::MockFile refused(image);
+    CHECK(disk.load(boot_services, protocol, refused) == Status::Unsupported);
+    CHECK(Test::MockPages::getOutstandingCount() == 0);
+    CHECK(disk.unload(boot_services) == Status::Success);
+
+    return 0;
+}
@@ -0,0 +1,97 @@
+// Each firmware call twice: through its Result overload, and through its Status overload with an out-parameter,
+// used the same way. check_result_codegen.cmake compares the instructions of the pairs in the optimized object file.
+
+#include "uefi.h"
+
+using namespace Uefi;
+
+extern "C" {
+    Status result_allocate_pages(BootServices& boot_services, size_t pages, uint64_t* address) {
+        const auto memory = boot_services.allocatePages(MemoryType::LoaderData, pages);
+        if (!memory)
+            return memory.getStatus();
+
+        *address = *memory;
+        return Status::Success;
+    }
+
+    Status raw_allocate_pages(BootServices& boot_services, size_t pages, uint64_t* address) {
+        BootServices::PhysicalAddress memory = 0;
+        const auto status = boot_services.allocatePages(BootServices::AllocateType::AnyPages, MemoryType::LoaderData, pages, memory);
+        if (isErrorCode(status))
+            return status;
+
+        *address = memory;
+        return Status::Success;
+    }
+
+    Status result_create_event(BootServices& boot_services, Event* event) {
+        const auto created = boot_services.createEvent(EventType::Timer, Tpl::Callback);
+        if (!created)
+            return created.getStatus();
+
+        *event = *created;
+        return Status::Success;
+    }
+
+    Status raw_create_event(BootServices& boot_services, Event* event) {
+        Event created = nullptr;
+        const auto status = boot_services.createEvent(EventType::Timer, Tpl::Callback, nullptr, nullptr, created);
+        if (isErrorCode(status))
+            return status;
+
+        *event = created;
+        return Status::Success;
+    }
+
+    FileProtocol* result_open_volume(BootServices& boot_services, Handle handle) {
+        const auto file_system = boot_services.handleProtocol<SimpleFileSystemProtocol>(handle);
+        if (!file_system)
+            return nullptr;
+
+        return (*file_system)->openVolume().getValueOr(nullptr);
+    }
+
+    FileProtocol* raw_open_volume(BootServices& boot_services, Handle handle) {
+        void* interface = nullptr;
+        if (isErrorCode(boot_services.handleProtocol(handle, SimpleFileSystemProtocol::guid, &interface)))
+            return nullptr;
+
+        FileProtocol* root = nullptr;
+        if (isErrorCode(static_cast<SimpleFileSystemProtocol*>(interface)->openVolume(root)))
+            return nullptr;
+
+        return root;
+    }
+
+    size_t result_read_all(FileProtocol& file, void* buffer, size_t size) {
+        size_t total = 0;
+        for (;;) {
+            const auto read = file.read(static_cast<uint8_t*>(buffer) + total, size - total);
+            if (!read || *read == 0)
+                return total;
+
+            total += *read;
+        }
+    }
+
+    size_t raw_read_all(FileProtocol& file, void* buffer, size_t size) {
+        size_t total = 0;
+        for (;;) {
+            auto read = size - total;
+            if (isErrorCode(file.read(read, static_cast<uint8_t*>(buffer) + total)) || read == 0)
+                return total;
+
+            total += read;
+        }
+    }
+
+    uint64_t result_get_position(FileProtocol& file) {
+        return file.getPosition().getValueOr(0);
+    }
+
+    uint64_t raw_get_position(FileProtocol& file) {
+        uint64_t position = 0;
+        return isErrorCode(file.getPosition(position)) ? 0 : position;
+    }
+}
@@ -0,0 +1,170 @@
+#include <cstring>
+#include <string>
+
+#include "mock_file.h"
+#include "mock_firmware.h"
+#include "test.h"
+
+using namespace Uefi;
+
+namespace {
+    int handle_objects[3];
+    Handle handles[3] = {reinterpret_cast<Handle>(&handle_objects[0]), reinterpret_cast<Handle>(&handle_objects[1]),
+                         reinterpret_cast<Handle>(&handle_objects[2])};
+    Test::MockTable<SimpleFileSystemProtocol> file_system;
+
+    Status locateHandleBuffer(BootServices::LocateSearchType search_type, const Guid*, const void*, size_t& handle_count, Handle*& buffer) {
+        if (search_type != BootServices::LocateSearchType::AllHandles)
+            return Status::NotFound;
+
+        handle_count = 3;
+        buffer = handles;
+        return Status::Success;
+    }
+
+    /// Only the file system protocol is installed, on the second handle.
+    Status handleProtocol(Handle handle, const Guid& guid, void** interface) {
+        if (handle != handles[1] || guid != SimpleFileSystemProtocol::guid)
+            return Status::Unsupported;
+
+        *interface = &file_system.get();
+        return Status::Success;
+    }
+
+    Status locateProtocol(const Guid* guid, void*, void** interface) {
+        return handleProtocol(handles[1], *guid, interface);
+    }
+
+    Test::MockDirectory::Node volume = {u"", true, 0, {{u"kernel", false, 1234, {}}}};
+    Test::MockDirectory::Counters counters;
+    Test::MockDirectory root(volume, counters);
+
+    Status openVolume(SimpleFileSystemProtocol*, FileProtocol*& new_root) {
+        new_root = &root;
+        return Status::Success;
+    }
+
+    Status getTime(Time& time, TimeCapabilities*) {
+        time = {};
+        time.year = 2025;
+        time.month = 6;
+        return Status::Success;
+    }
+
+    /// A single variable, "Boot", holding 6 bytes.
+    Status getVariable(const char16_t* name, const Guid*, RuntimeServices::VariableAttributes*, size_t& size, void* data) {
+        if (std::u16string(name) != u"Boot")
+            return Status::NotFound;
+
+        const auto available = size;
+        size = 6;
+        if (available < 6)
+            return Status::BufferTooSmall;
+
+        std::memcpy(data, "abcdef", 6);
+        return Status::Success;
+    }
+} // namespace
+
+int main() {
+    // Warnings are successes, and the value of a failure is only a fallback.
+    static_assert(Result<int>(5).isSuccess() && *Result<int>(5) == 5);
+    static_assert(Result<int>(Status::WarnUnknownGlyph, 7).isSuccess());
+    static_assert(!Result<int>(Status::NotFound) && Result<int>(Status::NotFound).getValueOr(9) == 9);
+    static_assert(Result<int>(Status::NotFound).getStatus() == Status::NotFound && Result<int>(3).getStatus() == Status::Success);
+
+    Test::MockTable<BootServices> boot_services_table;
+    Test::MockPages::install(boot_services_table);
+    Test::MockTable<MpServicesProtocol, 64> mp_services_table;
+    Test::MockMpServices::install(boot_services_table, mp_services_table);
+    boot_services_table.set(Test::BootServicesOffset::locate_handle_buffer, &locateHandleBuffer);
+    boot_services_table.set(Test::BootServicesOffset::handle_protocol, &handleProtocol);
+    boot_services_table.set(Test::BootServicesOffset::locate_protocol, &locateProtocol);
+    file_system.set(8, &openVolume);
+    auto& boot_services = boot_services_table.get();
+
+    // Memory.
+    const auto pages = boot_services.allocatePages(MemoryType::LoaderData, 4);
+    CHECK(pages && Test::MockPages::isAllocated(*pages, 4 * 0x1000));
+    CHECK(boot_services.freePages(*pages + (3 * 0x1000), 1) == Status::Success);
+    const auto at_address = boot_services.allocatePages(MemoryType::LoaderData, 1, BootServices::AllocateType::Address, *pages + (3 * 0x1000));
+    CHECK(at_address.isSuccess() && at_address.getValue() == *pages + (3 * 0x1000));
+    CHECK(boot_services.freePages(*pages, 3) == Status::Success && boot_services.freePages(*at_address, 1) == Status::Success);
+
+    const auto pool = boot_services.allocatePool(MemoryType::LoaderData, 100);
+    CHECK(pool && *pool != nullptr);
+    CHECK(boot_services.freePool(*pool) == Status::Success);
+
+    Test::MockPages::failAllocations() = true;
+    const auto failed = boot_services.allocatePages(MemoryType::LoaderData, 1);
+    CHECK(!failed && failed.getStatus() == Status::OutOfResources && failed.getValueOr(42) == 42);
+    CHECK(boot_services.allocatePool(MemoryType::LoaderData, 1).getStatus() == Status::OutOfResources);
+    Test::MockPages::failAllocations() = false;
+    CHECK(Test::MockPages::getOutstandingCount() == 0);
+
+    // Events.
+    const auto event = boot_services.createEvent(EventType::None, Tpl::Callback);
+    CHECK(event && *event != nullptr);
+    Event events[] = {*event};
+    const auto index = boot_services.waitForEvent({events, 1});
+    CHECK(index && *index == 0);
+
+    // Handles and protocols.
+    const auto all = boot_services.locateHandleBuffer(BootServices::LocateSearchType::AllHandles);
+    CHECK(all && all->getSize() == 3 && (*all)[2] == handles[2]);
+    CHECK(boot_services.locateHandleBuffer(BootServices::LocateSearchType::ByProtocol, &SimpleFileSystemProtocol::guid).getStatus() == Status::NotFound);
+
+    size_t with_file_system = 0;
+    for (const auto handle : *all) {
+        const auto protocol = boot_services.handleProtocol<SimpleFileSystemProtocol>(handle);
+        if (protocol) {
+            CHECK(*protocol == &file_system.get());
+            ++with_file_system;
+        }
+    }
+
+    CHECK(with_file_system == 1);
+    const auto located = boot_services.locateProtocol<SimpleFileSystemProtocol>();
+    CHECK(located && located.getValue() == &file_system.get());
+
+    // Files.
+    const auto volume_root = (*located)->openVolume();
+    CHECK(volume_root && *volume_root == &root);
+    const auto missing = (*volume_root)->open(u"initrd", OpenMode::Read);
+    CHECK(!missing && missing.getStatus() == Status::NotFound && counters.open_count == 1);
+    const auto kernel = (*volume_root)->open(u"kernel", OpenMode::Read);
+    CHECK(kernel && counters.open_handles == 1);
+    CHECK((*kernel)->close() == Status::Success && counters.open_handles == 0);
+
+    Test::MockFile file(std::vector<uint8_t>{'h', 'e', 'l', 'l', 'o'});
+    char buffer[16] = {};
+    const auto read = file.read(buffer, sizeof(buffer));
+    CHECK(read && *read == 5 && std::memcmp(buffer, "hello", 5) == 0);
+    CHECK(file.read(buffer, sizeof(buffer)).getValueOr(1) == 0);
+
+    const auto position = file.getPosition();
+    CHECK(position && *position == 5);
+
+    file.max_write_size = 3;
+    file.write_status = Status::VolumeFull;
+    const auto written = file.write(" world", 6);
+    CHECK(!written && written.getStatus() == Status::VolumeFull && file.data.size() == 8);
+
+    // Runtime services.
+    Test::MockTable<RuntimeServices> runtime_services_table;
+    runtime_services_table.set(Test::RuntimeServicesOffset::get_time, &getTime);
+    runtime_services_table.set(Test::RuntimeServicesOffset::get_variable, &getVariable);
+    auto& runtime_services = runtime_services_table.get();
+
+    const auto time = runtime_services.getTime();
+    CHECK(time && time->year == 2025 && time->month == 6);
+
+    const Guid vendor = {1, 2, 3, {4, 5, 6, 7, 8, 9, 10, 11}};
+    char variable[8] = {};
+    const auto variable_size = runtime_services.getVariable(u"Boot", vendor, variable, sizeof(variable));
+    CHECK(variable_size && *variable_size == 6 && std::memcmp(variable, "abcdef", 6) == 0);
+    CHECK(runtime_services.getVariable(u"Boot", vendor, variable, 2).getStatus() == Status::BufferTooSmall);
+    CHECK(runtime_services.getVariable(u"Other", vendor, variable, sizeof(variable)).getStatus() == Status::NotFound);
+
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include <cstring>
+#include <string>
+
+#include "test.h"
+#include "uefi.h"
+
+using namespace Uefi;
+
+namespace {
+    /// Each write to the port costs a fixed overhead, the call into the firmware and the wait for the transmit
+    /// FIFO to drain, on top of the time on the wire.
+    constexpr double call_overhead_microseconds = 20;
+    constexpr double byte_microseconds = 1000000.0 / (115200 / 10);
+
+    struct MockPort {
+        std::string* output;
+        size_t* call_count;
+
+        Status write(const uint8_t* data, size_t size) {
+            ++*call_count;
+            output->append(reinterpret_cast<const char*>(data), size);
+            return Status::Success;
+        }
+    };
+
+    /// What a console without a buffer does: one port write per outputString().
+    class DirectConsole : public SimpleTextOutputProtocol {
+    public:
+        void initialize(const MockPort& port) {
+            _port = port;
+            _outputString = [](SimpleTextOutputProtocol* protocol, const char16_t* string) {
+                uint8_t bytes[512];
+                size_t size = 0;
+                for (; *string != 0 && size < sizeof(bytes); ++string)
+                    bytes[size++] = static_cast<uint8_t>(*string);
+
+                return static_cast<DirectConsole*>(protocol)->_port.write(bytes, size);
+            };
+        }
+
+    private:
+        MockPort _port;
+    };
+
+    SerialConsole<MockPort> console;
+    DirectConsole direct_console;
+    TextOutputStream stream;
+
+    /// Prints a boot log through the stream, and returns the time it took.
+    double printLog(size_t line_count) {
+        const auto start = Test::getTime();
+        for (size_t i = 0; i < line_count; ++i)
+            stream << u"[" << static_cast<uint64_t>(i) << u"] loaded driver " << "PciBus" << u" at " << static_cast<uint64_t>(i * 4096) << new_line;
+
+        return Test::getTime() - start;
+    }
+
+    double getModeledMilliseconds(size_t call_count, size_t byte_count) {
+        return ((static_cast<double>(call_count) * call_overhead_microseconds) + (static_cast<double>(byte_count) * byte_microseconds)) / 1000;
+    }
+} // namespace
+
+int main() {
+    // The encoding: UCS-2 is sent as UTF-8, surrogate pairs included, and lone surrogates as '?'.
+    {
+        std::string output;
+        size_t call_count = 0;
+        console.initialize({&output, &call_count});
+        output.clear();
+
+        CHECK(console.outputString(u"aé€\U0001F600\xD800z") == Status::Success);
+        CHECK(console.flush() == Status::Success);
+        CHECK(output == "a\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80?z");
+        CHECK(call_count == 1);
+    }
+
+    constexpr size_t line_count = 20000;
+
+    std::string buffered_output;
+    size_t buffered_calls = 0;
+    console.initialize({&buffered_output, &buffered_calls});
+    buffered_output.clear();
+    buffered_calls = 0;
+    stream.initialize();
+    stream.setOutput(console);
+    const auto buffered_time = printLog(line_count);
+    CHECK(console.flush() == Status::Success);
+
+    std::string direct_output;
+    size_t direct_calls = 0;
+    direct_console.initialize({&direct_output, &direct_calls});
+    stream.setOutput(direct_console);
+    const auto direct_time = printLog(line_count);
+
+    CHECK(buffered_output == direct_output);
+    CHECK(buffered_calls * 100 < direct_calls);
+
+    const auto megabytes = static_cast<double>(buffered_output.size()) / (1024 * 1024);
+    std::printf("%zu lines, %zu bytes\n", line_count, buffered_output.size());
+    std::printf("direct:   %7zu port writes, %9.1f ms modeled at 115200 baud, %6.1f MB/s of formatting\n", direct_calls,
+                getModeledMilliseconds(direct_calls, direct_output.size()), megabytes / direct_time);
+    std::printf("buffered: %7zu port writes, %9.1f ms modeled at 115200 baud, %6.1f MB/s of formatting\n", buffered_calls,
+                getModeledMilliseconds(buffered_calls, buffered_output.size()), megabytes / buffered_time);
+    return 0;
+}
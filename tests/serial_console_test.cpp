@@ -0,0 +1,71 @@
+#include <string>
+
+#include "mock_firmware.h"
+#include "test.h"
+
+using namespace Uefi;
+
+namespace {
+    /// How much the firmware takes from each write() call, then what it returns.
+    size_t take = 0;
+    Status write_status = Status::Success;
+    size_t write_count = 0;
+    std::string written;
+
+    Status write(SerialIoProtocol*, size_t& size, const void* buffer) {
+        ++write_count;
+        size = size < take ? size : take;
+        written.append(static_cast<const char*>(buffer), size);
+        return write_status;
+    }
+
+    /// The registers of a memory-mapped UART, with an empty transmit FIFO.
+    uint8_t registers[8];
+
+    /// The divisor the UART was programmed with.
+    uint32_t getDivisor() {
+        return registers[0] | (uint32_t{registers[1]} << 8);
+    }
+} // namespace
+
+int main() {
+    Test::MockTable<SerialIoProtocol, 64> protocol;
+    protocol.set(40, &write);
+    SerialIoPort port{&protocol.get()};
+    const auto* text = reinterpret_cast<const uint8_t*>("0123456789");
+
+    // Partial writes are retried, and so are timeouts after some progress.
+    take = 3;
+    CHECK(port.write(text, 10) == Status::Success && written == "0123456789" && write_count == 4);
+    write_status = Status::Timeout;
+    written.clear();
+    CHECK(port.write(text, 10) == Status::Success && written == "0123456789");
+
+    // A write which takes nothing fails, whether the firmware reports success or a timeout.
+    take = 0;
+    write_count = 0;
+    CHECK(port.write(text, 10) == Status::Timeout && write_count == 1);
+    write_status = Status::Success;
+    CHECK(port.write(text, 10) == Status::DeviceError && write_count == 2);
+    CHECK(port.write(text, 0) == Status::Success && write_count == 2);
+
+    // The divisor latch: 0 would mean 65536 to the UART, so the rates it cannot reach get the nearest divisor.
+    Uart16550 uart;
+    const auto base = reinterpret_cast<uintptr_t>(registers);
+    uart.initializeMmio(base, 1, 9600);
+    CHECK(getDivisor() == 12 && registers[3] == 0x03);
+    uart.initializeMmio(base, 1, 115200);
+    CHECK(getDivisor() == 1);
+    uart.initializeMmio(base, 1, 0);
+    CHECK(getDivisor() == 1);
+    uart.initializeMmio(base, 1, 1000000);
+    CHECK(getDivisor() == 1);
+    uart.initializeMmio(base, 1, 1);
+    CHECK(getDivisor() == 0xFFFF);
+    uart.initializeMmio(base, 1, 3000000, 48000000);
+    CHECK(getDivisor() == 1);
+
+    registers[5] = 0x20;
+    CHECK(uart.write(text, 10) == Status::Success && registers[0] == '9');
+    return 0;
+}
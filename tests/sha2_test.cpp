@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "mock_file.h"
+#include "test.h"
+
+using namespace Uefi;
+
+namespace {
+    template <typename Digest>
+    std::string toHex(const Digest& digest) {
+        std::string hex;
+        for (const auto byte : digest.bytes) {
+            hex += "0123456789abcdef"[byte >> 4];
+            hex += "0123456789abcdef"[byte & 15];
+        }
+
+        return hex;
+    }
+
+    /// Hashes in pieces of random sizes, to cross the block boundaries at every offset.
+    template <typename Hash, typename... Options>
+    typename Hash::Digest hashInPieces(const uint8_t* data, size_t size, std::mt19937& random, Options... options) {
+        Hash hash;
+        hash.initialize(options...);
+        for (size_t position = 0; position < size;) {
+            const auto piece = std::min<size_t>(size - position, random() % 300);
+            hash.update(data + position, piece);
+            position += piece;
+        }
+
+        typename Hash::Digest digest;
+        hash.finish(digest);
+        return digest;
+    }
+
+    /// Hashes of the start of `pattern`, around the padding boundaries of both block sizes.
+    const struct {
+        size_t size;
+        const char* sha256;
+        const char* sha384;
+    } pattern_hashes[] = {
+        {0, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+         "38b060a751ac96384cd9327eb1b1e36a21fdb71114be07434c0cc7bf63f6e1da274edebfe76f65fbd51ad2f14898b95b"},
+        {55, "5d05a4435b96f43e53e5a582bbb0b8d840a71c023e7468d6604d1c9ae6511c4c",
+         "e8f0596fa6674d1293b5e8d0eb6a0d3d05b80da3560dfb8842ad4b6e1289b726e2d74090ff0f1dbd033713c216899f39"},
+        {56, "0851bc0b733318bd14db8098dec9a591c02ee1e72295d3ba54560e56342430fb",
+         "30b4b257f34e0036896b1b0f8957cab9cbac3a79cd3bfbdc57d14b0ef819eadbdd264c52171220c5f46827821eac6bf9"},
+        {63, "3d825c09f5fe7358fe955248d4bfc207298e5e74c426ccba7c93ac3992d70143",
+         "3851e7876891127f0424f05350170cb3e0c8fc1f1ceee2bf4faf5c4be6a3bf7eea35d984ff8e833126c64b2aca01c964"},
+        {64, "949f78c7321c5fa8a90f3d236c471950df72d869abc1d36e985cfce9a3ac98b9",
+         "63fb5ddc60ead1be1afec1506279c39b904265568216162f512354d85bb514856b398c6898775def7c08f8afeb990493"},
+        {111, "2c5dbd770bece313b363f82a0ece312c41ae1ff185a825b6b432e12c8019f21f",
+         "bfb16149a82025141365011fd87543c65296a03b4a6c62b3b7cbb48e699f19451a6af6f89cf80707f2bc4e976172b0ed"},
+        {112, "3938d99f8d703e4326766dc81c4e3eb017342aa86d5d9867bcbd06a5be309a91",
+         "646850d033f800d27a2cdb6f4398138bb0761928940d955c2fd51bb122af7d2fa8d28c713468f0df5a7f657476013da1"},
+        {119, "f1ae96dacae36aee55d875c7d523334473a78b3e2381a3e7cc7fde2bef3f1938",
+         "842574b7ccc9d8c9f0ec09c5145ff9fdddcd5bbdcd8ea76aad4203e597e3f4991834bc6362d7e7c52b65546a200671c7"},
+        {120, "7f8c9999be4063260ab4477a8fb27a81bb475cdd1c8e1f3b301e928ecbc272fd",
+         "5283c2538f545ab550653945c40148446ffd8e64d4ac1f60115b58b027abcf91e32f6736c9c0f0c36711d81f8f3b40e9"},
+        {127, "fe65c2f6bd8f9c9e3dd366f136a8c84ccb4727b9e1e0604ed5d95a5d47099bce",
+         "1a6e061bfca76db54a6ced84b2a2eba51ad1b8d4825256d74950c74649b8f631e159091201a2248614ca0e8e504223f8"},
+        {128, "ad10550a200b2dd5eef8de5edb1fbb508ecdd446aa02d574f73aa2e2c6188c7e",
+         "d277df61952bc8851596ca617972cd24829481e97adeec4ac37e58e2b1fc23978705dc16ebaaae9c414629a625ebb841"},
+        {1000, "ce4866fe66ae964af5e434c0b2b1bcaa5f122adc7089cf66a7c2a69c69545d9f",
+         "241814a43d63b7ad2dfa553ac3473df10467eb01b41a69c90f6a02042e4e4af72993cee856a2aa13da972ec48910c80a"},
+        {100001, "b25f38c2edd91bb2be7f551aa5952fc3203213ac51d6bf2728f2735a287edff6",
+         "f839147f9fbc51c84c2cab1b4666a6354b8f92a640eb79ac6adce7b0823792c1d7a16df9dab5731cc5e2d78e09a67872"},
+    };
+} // namespace
+
+int main() {
+    std::mt19937 random(1);
+    std::vector<uint8_t> pattern(100001);
+    for (size_t i = 0; i < pattern.size(); ++i)
+        pattern[i] = static_cast<uint8_t>((i * 131) + (i >> 8));
+
+    // The test vectors of FIPS 180-2.
+    Sha256::Digest sha256;
+    Sha384::Digest sha384;
+    const char* message_448 = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    const char* message_896 = "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu";
+    const std::string million_a(1000000, 'a');
+
+    Sha256::calculate("abc", 3, sha256);
+    CHECK(toHex(sha256) == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    Sha256::calculate(message_448, std::strlen(message_448), sha256);
+    CHECK(toHex(sha256) == "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    Sha256::calculate(million_a.data(), million_a.size(), sha256);
+    CHECK(toHex(sha256) == "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+
+    Sha384::calculate("abc", 3, sha384);
+    CHECK(toHex(sha384) == "cb00753f45a35e8bb5a03d699ac65007272c32ab0eded1631a8b605a43ff5bed8086072ba1e7cc2358baeca134c825a7");
+    Sha384::calculate(message_896, std::strlen(message_896), sha384);
+    CHECK(toHex(sha384) == "09330c33f71147e83d192fc782cd1b4753111b173b3b05d22fa08086e3b0f712fcc7c71a557e2db966c3e9fa91746039");
+    Sha384::calculate(million_a.data(), million_a.size(), sha384);
+    CHECK(toHex(sha384) == "9d0e1809716474cb086e834e310a4a1ced149e9c00f248527972cec5704c2a5b07b8b3dc38ecc4ebae97ddd87f3d8985");
+
+    // Around the padding boundaries, fed in pieces, with and without the CPU's SHA instructions.
+    std::printf("SHA instructions %s\n", Sha256::isAccelerated() ? "used" : "not available");
+    for (const auto& expected : pattern_hashes) {
+        for (const bool use_cpu_extensions : {false, true})
+            CHECK(toHex(hashInPieces<Sha256>(pattern.data(), expected.size, random, use_cpu_extensions)) == expected.sha256);
+
+        CHECK(toHex(hashInPieces<Sha384>(pattern.data(), expected.size, random)) == expected.sha384);
+    }
+
+    // Both implementations agree on every length up to a few blocks.
+    for (size_t size = 0; size < 600; ++size)
+        CHECK(hashInPieces<Sha256>(pattern.data(), size, random, false) == hashInPieces<Sha256>(pattern.data(), size, random, true));
+
+    // A file read out of order, with gaps, rereads and a read past its end, is hashed from its start, in order.
+    {
+        Test::MockFile file(std::vector<uint8_t>(pattern.begin(), pattern.begin() + 30000));
+        Sha256 hash;
+        hash.initialize();
+        uint8_t scratch[777];
+        HashingFile<Sha256> tap;
+        tap.initialize(file, hash, scratch, sizeof(scratch));
+
+        std::vector<uint8_t> buffer(30000);
+        const struct {
+            uint64_t position;
+            size_t size;
+        } reads[] = {{0, 64}, {10000, 5000}, {100, 5000}, {25000, 10000}, {40000, 10}};
+        for (const auto& read : reads) {
+            size_t size = read.size;
+            CHECK(tap.setPosition(read.position) == Status::Success && tap.read(size, buffer.data()) == Status::Success);
+            const auto expected = read.position >= file.data.size() ? 0 : std::min<size_t>(read.size, file.data.size() - read.position);
+            CHECK(size == expected && std::memcmp(buffer.data(), &file.data[read.position < file.data.size() ? read.position : 0], size) == 0);
+        }
+
+        CHECK(tap.getHashedSize() == 30000);
+        CHECK(tap.complete() == Status::Success && tap.getHashedSize() == 30000);
+        hash.finish(sha256);
+        CHECK(toHex(sha256) == toHex(hashInPieces<Sha256>(file.data.data(), file.data.size(), random)));
+
+        // complete() hashes what was never read.
+        Test::MockFile unread_file(std::vector<uint8_t>(pattern.begin(), pattern.begin() + 1000));
+        hash.initialize();
+        tap.initialize(unread_file, hash, scratch, sizeof(scratch));
+        size_t size = 10;
+        CHECK(tap.read(size, buffer.data()) == Status::Success && tap.getHashedSize() == 10);
+        CHECK(tap.complete() == Status::Success && tap.getHashedSize() == 1000);
+        hash.finish(sha256);
+        CHECK(toHex(sha256) == pattern_hashes[11].sha256);
+
+        // Nothing may change the hashed bytes.
+        size = 4;
+        CHECK(tap.write(size, "abcd") == Status::WriteProtected && size == 0 && unread_file.write_count == 0);
+    }
+
+    return 0;
+}
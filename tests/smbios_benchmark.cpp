@@ -0,0 +1,88 @@
+#include <vector>
+
+#include "smbios_table_writer.h"
+#include "test.h"
+
+using namespace Uefi;
+
+namespace {
+    constexpr int repeat_count = 5;
+
+    /// Nanoseconds per lookup, the best of a few runs.
+    template <typename Function>
+    double getNanoseconds(size_t lookup_count, Function function) {
+        double best = 1e9;
+        for (int i = 0; i < repeat_count; ++i) {
+            const auto start = Test::getTime();
+            function();
+            const auto time = (Test::getTime() - start) / static_cast<double>(lookup_count) * 1e9;
+            best = time < best ? time : best;
+        }
+
+        return best;
+    }
+
+    /// Keeps the results of the lookups, so that they are not optimized away.
+    volatile uintptr_t sink;
+} // namespace
+
+int main() {
+    Test::SmbiosTableWriter writer;
+    Test::writeServerTable(writer);
+    const auto entry_point = Test::makeEntryPoint(writer.table.data(), static_cast<uint32_t>(writer.table.size()));
+    const auto structure_count = writer.next_handle;
+
+    const auto index_size = SmbiosTable::getIndexSize(&entry_point);
+    std::vector<uint32_t> memory(index_size / sizeof(uint32_t));
+    SmbiosTable smbios;
+    const auto index_time = getNanoseconds(1, [&] { CHECK(smbios.initialize(&entry_point, memory.data(), index_size) == Status::Success); });
+    std::printf("%u structures, %zu bytes: indexed in %.0f us, into %zu bytes\n", structure_count, writer.table.size(), index_time / 1000,
+                index_size);
+
+    // Every handle, and every DIMM: what a walk of the table finds is what the index finds.
+    uintptr_t sum = 0;
+    const auto by_handle = getNanoseconds(structure_count, [&] {
+        for (uint16_t handle = 0; handle < structure_count; ++handle)
+            sum += reinterpret_cast<uintptr_t>(smbios.findByHandle(handle));
+    });
+    const auto by_handle_walking = getNanoseconds(structure_count, [&] {
+        for (uint16_t handle = 0; handle < structure_count; ++handle)
+            sum -= reinterpret_cast<uintptr_t>(writer.findHandleByWalking(handle));
+    });
+    CHECK(sum == 0);
+    std::printf("findByHandle  %8.1f ns | walk %10.1f ns | %.0fx\n", by_handle, by_handle_walking, by_handle_walking / by_handle);
+
+    const auto dimm_count = smbios.getStructures(SmbiosMemoryDevice::structure_type).getSize();
+    const auto by_type = getNanoseconds(dimm_count, [&] {
+        for (size_t instance = 0; instance < dimm_count; ++instance)
+            sum += reinterpret_cast<uintptr_t>(smbios.find(SmbiosMemoryDevice::structure_type, instance));
+    });
+    const auto by_type_walking = getNanoseconds(dimm_count, [&] {
+        for (size_t instance = 0; instance < dimm_count; ++instance)
+            sum -= reinterpret_cast<uintptr_t>(writer.findByWalking(SmbiosMemoryDevice::structure_type, instance));
+    });
+    CHECK(sum == 0);
+    std::printf("find          %8.1f ns | walk %10.1f ns | %.0fx\n", by_type, by_type_walking, by_type_walking / by_type);
+
+    // All the DIMMs at once: one walk of the table against the structures of the type.
+    const auto structures = getNanoseconds(1, [&] {
+        for (const auto& structure : smbios.getStructures(SmbiosMemoryDevice::structure_type))
+            sum += reinterpret_cast<uintptr_t>(&structure);
+    });
+    const auto structures_walking = getNanoseconds(1, [&] {
+        for (size_t offset = 0;; offset = writer.getNextOffset(offset)) {
+            const auto* structure = reinterpret_cast<const SmbiosStructure*>(&writer.table[offset]);
+            if (structure->type == SmbiosMemoryDevice::structure_type)
+                sum -= reinterpret_cast<uintptr_t>(structure);
+
+            if (structure->type == SmbiosStructure::end_of_table)
+                break;
+        }
+    });
+    CHECK(sum == 0);
+    std::printf("getStructures %8.1f ns | walk %10.1f ns | %.0fx\n", structures, structures_walking, structures_walking / structures);
+
+    CHECK(by_handle < by_handle_walking && by_type < by_type_walking && structures < structures_walking);
+    sink = sum;
+    return 0;
+}
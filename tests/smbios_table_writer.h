@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "uefi.h"
+
+namespace Test {
+    /// Writes an SMBIOS structure table, and finds its structures the way SmbiosTable replaces: by walking it from
+    /// the start.
+    struct SmbiosTableWriter {
+        std::vector<uint8_t> table;
+        uint16_t next_handle = 0;
+
+        /// Appends a structure: its header, the rest of its formatted area, and its strings.
+        uint16_t addStructure(uint8_t type, const std::vector<uint8_t>& body, const std::vector<std::string>& strings) {
+            const auto handle = next_handle++;
+            table.push_back(type);
+            table.push_back(static_cast<uint8_t>(sizeof(Uefi::SmbiosStructure) + body.size()));
+            table.push_back(static_cast<uint8_t>(handle));
+            table.push_back(static_cast<uint8_t>(handle >> 8));
+            table.insert(table.end(), body.begin(), body.end());
+
+            for (const auto& string : strings)
+                table.insert(table.end(), string.c_str(), string.c_str() + string.size() + 1);
+
+            if (strings.empty())
+                table.push_back(0);
+
+            table.push_back(0);
+            return handle;
+        }
+
+        [[nodiscard]] size_t getNextOffset(size_t offset) const {
+            auto strings = offset + table[offset + 1];
+            while (table[strings] != 0 || table[strings + 1] != 0)
+                ++strings;
+
+            return strings + 2;
+        }
+
+        [[nodiscard]] const Uefi::SmbiosStructure* findByWalking(uint8_t type, size_t instance) const {
+            for (size_t offset = 0;; offset = getNextOffset(offset)) {
+                const auto* structure = reinterpret_cast<const Uefi::SmbiosStructure*>(&table[offset]);
+                if (structure->type == type && instance-- == 0)
+                    return structure;
+
+                if (structure->type == Uefi::SmbiosStructure::end_of_table)
+                    return nullptr;
+            }
+        }
+
+        [[nodiscard]] const Uefi::SmbiosStructure* findHandleByWalking(uint16_t handle) const {
+            for (size_t offset = 0;; offset = getNextOffset(offset)) {
+                const auto* structure = reinterpret_cast<const Uefi::SmbiosStructure*>(&table[offset]);
+                if (structure->handle == handle)
+                    return structure;
+
+                if (structure->type == Uefi::SmbiosStructure::end_of_table)
+                    return nullptr;
+            }
+        }
+    };
+
+    template <typename T>
+    std::vector<uint8_t> getBody(const T& structure) {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(&structure);
+        return {bytes + sizeof(Uefi::SmbiosStructure), bytes + sizeof(T)};
+    }
+
+    template <typename EntryPoint>
+    void setChecksum(EntryPoint& entry_point, uint8_t& checksum, size_t size) {
+        checksum = 0;
+        uint8_t sum = 0;
+        for (size_t i = 0; i < size; ++i)
+            sum = static_cast<uint8_t>(sum + reinterpret_cast<const uint8_t*>(&entry_point)[i]);
+
+        checksum = static_cast<uint8_t>(-sum);
+    }
+
+    inline Uefi::Smbios3EntryPoint makeEntryPoint(const void* data, uint32_t max_size) {
+        Uefi::Smbios3EntryPoint entry_point{};
+        std::memcpy(&entry_point, "_SM3_", 5);
+        entry_point.length = sizeof(entry_point);
+        entry_point.major_version = 3;
+        entry_point.minor_version = 4;
+        entry_point.table_max_size = max_size;
+        entry_point.table_address = reinterpret_cast<uintptr_t>(data);
+        setChecksum(entry_point, entry_point.checksum, sizeof(entry_point));
+        return entry_point;
+    }
+
+    /// What writeServerTable() wrote.
+    struct ServerTable {
+        /// The caches of both sockets: L1, L2 and L3 of the first one, then of the second one.
+        std::vector<uint16_t> caches;
+        /// The memory of the populated DIMMs.
+        uint64_t total_memory = 0;
+    };
+
+    /// A server: firmware and system information, two sockets with three caches each, 1500 slots and other
+    /// structures, and 48 DIMM slots, a third empty and a third too large for the 15-bit size. The last one is a
+    /// memory device from before SMBIOS 2.8, without the voltages.
+    inline ServerTable writeServerTable(SmbiosTableWriter& writer) {
+        ServerTable server;
+        writer.addStructure(0, std::vector<uint8_t>(20, 0), {"Vendor", "1.0", "01/01/2026"});
+        writer.addStructure(1, std::vector<uint8_t>(23, 0), {"Maker", "Server"});
+        for (int i = 0; i < 6; ++i)
+            server.caches.push_back(writer.addStructure(7, std::vector<uint8_t>(23, 0), {"L" + std::to_string((i % 3) + 1)}));
+
+        for (int socket = 0; socket < 2; ++socket) {
+            Uefi::SmbiosProcessor processor{};
+            processor.socket_designation = 1;
+            processor.processor_manufacturer = 2;
+            processor.processor_version = 3;
+            processor.status = 0x41;
+            processor.core_count = 32;
+            processor.thread_count = 64;
+            processor.l1_cache_handle = server.caches[socket * 3];
+            processor.l2_cache_handle = server.caches[(socket * 3) + 1];
+            processor.l3_cache_handle = server.caches[(socket * 3) + 2];
+            writer.addStructure(Uefi::SmbiosProcessor::structure_type, getBody(processor),
+                                {"CPU" + std::to_string(socket), "GenuineVendor", "Model X"});
+        }
+
+        std::mt19937 random(3);
+        const uint8_t other_types[] = {9, 41, 8, 11, 12, 13, 40, 42, 43, 126};
+        for (int i = 0; i < 1500; ++i)
+            writer.addStructure(other_types[i % 10], std::vector<uint8_t>(4 + (random() % 20), 1), {"Slot " + std::to_string(i)});
+
+        for (int i = 0; i < 48; ++i) {
+            Uefi::SmbiosMemoryDevice dimm{};
+            dimm.device_locator = 1;
+            dimm.bank_locator = 2;
+            dimm.manufacturer = 3;
+            dimm.part_number = 4;
+            dimm.size = i % 3 == 0 ? 0 : (i % 3 == 1 ? 16384 : 0x7FFF);
+            dimm.extended_size = 65536;
+            server.total_memory += i % 3 == 0 ? 0 : (i % 3 == 1 ? uint64_t{16} << 30 : uint64_t{64} << 30);
+            writer.addStructure(Uefi::SmbiosMemoryDevice::structure_type, getBody(dimm),
+                                {"DIMM" + std::to_string(i), "BANK", "Samsung", "M393"});
+        }
+
+        writer.addStructure(Uefi::SmbiosMemoryDevice::structure_type, std::vector<uint8_t>(0x22 - sizeof(Uefi::SmbiosStructure), 0), {});
+        writer.addStructure(Uefi::SmbiosStructure::end_of_table, {}, {});
+        return server;
+    }
+} // namespace Test
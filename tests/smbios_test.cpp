@@ -0,0 +1,119 @@
+#include <cstring>
+#include <vector>
+
+#include <sys/mman.h>
+
+#include "smbios_table_writer.h"
+#include "test.h"
+
+using namespace Uefi;
+
+namespace {
+    Test::SmbiosTableWriter writer;
+    auto& table = writer.table;
+} // namespace
+
+int main() {
+    const auto server = Test::writeServerTable(writer);
+    const auto next_handle = writer.next_handle;
+
+    // The maximum size is only a bound: a structure after the end of the table is not read.
+    const auto table_size = table.size();
+    const uint8_t after_end[] = {1, sizeof(SmbiosStructure), 0xEF, 0xBE, 'x', 0, 0};
+    table.insert(table.end(), after_end, after_end + sizeof(after_end));
+    table.resize(table_size + 100, 0xAA);
+    const auto entry_point = Test::makeEntryPoint(table.data(), static_cast<uint32_t>(table.size()));
+
+    const auto index_size = SmbiosTable::getIndexSize(&entry_point);
+    CHECK(index_size > 0 && index_size < table_size);
+    std::vector<uint32_t> memory(index_size / sizeof(uint32_t));
+    SmbiosTable smbios;
+    CHECK(smbios.initialize(&entry_point, memory.data(), index_size) == Status::Success);
+    CHECK(smbios.getMajorVersion() == 3 && smbios.getMinorVersion() == 4);
+    CHECK(smbios.getStructureCount() == next_handle);
+
+    uint64_t total_memory = 0;
+    size_t dimm_count = 0;
+    for (const auto& structure : smbios.getStructures(SmbiosMemoryDevice::structure_type)) {
+        if (const auto* dimm = structure.as<SmbiosMemoryDevice>()) {
+            total_memory += dimm->getSize();
+            ++dimm_count;
+        }
+    }
+
+    CHECK(dimm_count == 48 && total_memory == server.total_memory);
+    CHECK(smbios.getStructures(SmbiosMemoryDevice::structure_type).getSize() == 49);
+    CHECK(smbios.find<SmbiosMemoryDevice>(48) == nullptr && smbios.find(SmbiosMemoryDevice::structure_type, 48) != nullptr);
+
+    const auto* processor = smbios.find<SmbiosProcessor>(1);
+    CHECK(processor != nullptr && processor->isPopulated() && processor->core_count == 32);
+    CHECK(std::strcmp(processor->getString(processor->socket_designation), "CPU1") == 0);
+    CHECK(std::strcmp(processor->getString(processor->processor_version), "Model X") == 0);
+    CHECK(processor->getString(4) == nullptr && processor->getString(0) == nullptr);
+    CHECK(smbios.findByHandle(processor->l3_cache_handle)->type == 7);
+    CHECK(std::strcmp(smbios.findByHandle(processor->l3_cache_handle)->getString(1), "L3") == 0);
+
+    CHECK(smbios.find(SmbiosStructure::end_of_table) != nullptr && smbios.find(SmbiosStructure::end_of_table)->getString(1) == nullptr);
+    CHECK(smbios.findByHandle(0xBEEF) == nullptr && smbios.getStructures(200).getSize() == 0);
+
+    // Every handle and every instance of every type, against a walk of the table.
+    for (uint16_t handle = 0; handle < next_handle + 10; ++handle)
+        CHECK(smbios.findByHandle(handle) == writer.findHandleByWalking(handle));
+
+    for (size_t type = 0; type < 256; ++type) {
+        const auto count = smbios.getStructures(static_cast<uint8_t>(type)).getSize();
+        for (size_t instance = 0; instance <= count; ++instance)
+            CHECK(smbios.find(static_cast<uint8_t>(type), instance) == writer.findByWalking(static_cast<uint8_t>(type), instance));
+    }
+
+    // A bad checksum or anchor.
+    auto bad_entry_point = entry_point;
+    ++bad_entry_point.checksum;
+    CHECK(SmbiosTable::getIndexSize(&bad_entry_point) == 0 && SmbiosTable::getIndexSize(nullptr) == 0);
+    CHECK(smbios.initialize(&bad_entry_point, memory.data(), index_size) == Status::CrcError);
+
+    // A table cut in the middle of a structure: the structures before it are indexed.
+    const auto truncated_entry_point = Test::makeEntryPoint(table.data(), 300);
+    CHECK(smbios.initialize(&truncated_entry_point, memory.data(), index_size) == Status::Success);
+    size_t whole_structures = 0;
+    for (size_t offset = 0; writer.getNextOffset(offset) <= 300; offset = writer.getNextOffset(offset))
+        ++whole_structures;
+
+    CHECK(smbios.getStructureCount() == whole_structures && smbios.find(SmbiosStructure::end_of_table) == nullptr);
+
+    // An index too small for the table indexes the first structures.
+    CHECK(smbios.initialize(&entry_point, memory.data(), 8000) == Status::BufferTooSmall);
+    CHECK(smbios.getStructureCount() > 100 && smbios.getStructureCount() < next_handle);
+    CHECK(smbios.find(0) == writer.findByWalking(0, 0) && smbios.find(SmbiosMemoryDevice::structure_type) == nullptr);
+
+#ifdef MAP_32BIT
+    // The 32-bit entry point, with its table below 4 GiB.
+    auto* low_memory = static_cast<uint8_t*>(mmap(nullptr, table_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0));
+    CHECK(low_memory != MAP_FAILED);
+    std::memcpy(low_memory, table.data(), table_size);
+
+    SmbiosEntryPoint entry_point_32{};
+    std::memcpy(&entry_point_32, "_SM_", 4);
+    entry_point_32.length = sizeof(entry_point_32);
+    entry_point_32.major_version = 2;
+    entry_point_32.minor_version = 8;
+    std::memcpy(entry_point_32.intermediate_anchor, "_DMI_", 5);
+    entry_point_32.table_length = static_cast<uint16_t>(table_size);
+    entry_point_32.table_address = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(low_memory));
+    entry_point_32.structure_count = next_handle;
+    Test::setChecksum(entry_point_32.intermediate_anchor, entry_point_32.intermediate_checksum, 15);
+    Test::setChecksum(entry_point_32, entry_point_32.checksum, sizeof(entry_point_32));
+
+    CHECK(SmbiosTable::getIndexSize(&entry_point_32) == index_size);
+    CHECK(smbios.initialize(&entry_point_32, memory.data(), index_size) == Status::Success);
+    CHECK(smbios.getMajorVersion() == 2 && smbios.getStructureCount() == next_handle);
+    CHECK(smbios.find<SmbiosProcessor>(1)->l3_cache_handle == server.caches[5]);
+
+    ++entry_point_32.intermediate_checksum;
+    Test::setChecksum(entry_point_32, entry_point_32.checksum, sizeof(entry_point_32));
+    CHECK(SmbiosTable::getIndexSize(&entry_point_32) == 0);
+    munmap(low_memory, table_size);
+#endif
+
+    return 0;
+}
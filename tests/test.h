@@ -0,0 +1,21 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+/// Stops the test at the first failed check.
+#define CHECK(condition)                                                                    \
+    do {                                                                                    \
+        if (!(condition)) {                                                                 \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            std::exit(1);                                                                   \
+        }                                                                                   \
+    } while (false)
+
+namespace Test {
+    /// Seconds since an arbitrary point, for the benchmarks.
+    inline double getTime() {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+} // namespace Test
@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "test.h"
+#include "uefi.h"
+
+using namespace Uefi;
+
+namespace {
+    constexpr size_t columns = 80;
+    constexpr size_t rows = 25;
+
+    uint32_t makeCell(char16_t character, TextColor color) {
+        return static_cast<uint32_t>(character < u' ' ? u' ' : character) | (static_cast<uint32_t>(color.getValue()) << 16);
+    }
+
+    /// A console which keeps what is shown in a grid, and fails the test if it would scroll.
+    class MockConsole : public SimpleTextOutputProtocol {
+    public:
+        std::vector<uint32_t> grid = std::vector<uint32_t>(columns * rows, 0);
+        size_t column = 0, row = 0;
+        TextColor color = default_color;
+        size_t call_count = 0;
+        /// The number of outputString() calls before one fails.
+        size_t failures_after = SIZE_MAX;
+
+        MockConsole() {
+            _reset = nullptr;
+            _testString = nullptr;
+            _setMode = nullptr;
+            _mode = &_modeData;
+
+            _outputString = [](SimpleTextOutputProtocol* protocol, const char16_t* string) {
+                auto& self = _self(protocol);
+                ++self.call_count;
+                if (self.failures_after-- == 0)
+                    return Status::DeviceError;
+
+                for (; *string != 0; ++string) {
+                    CHECK(self.row < rows && self.column < columns);
+                    CHECK(self.row != rows - 1 || self.column != columns - 1);
+                    self.grid[(self.row * columns) + self.column] = makeCell(*string, self.color);
+                    if (++self.column == columns) {
+                        self.column = 0;
+                        ++self.row;
+                    }
+                }
+
+                return Status::Success;
+            };
+            _queryMode = [](SimpleTextOutputProtocol*, size_t, size_t& mode_columns, size_t& mode_rows) {
+                mode_columns = columns;
+                mode_rows = rows;
+                return Status::Success;
+            };
+            _setAttribute = [](SimpleTextOutputProtocol* protocol, Attribute attribute) {
+                ++_self(protocol).call_count;
+                _self(protocol).color = attribute;
+                return Status::Success;
+            };
+            _clearScreen = [](SimpleTextOutputProtocol* protocol) {
+                auto& self = _self(protocol);
+                ++self.call_count;
+                self.grid.assign(self.grid.size(), makeCell(u' ', self.color));
+                self.column = self.row = 0;
+                return Status::Success;
+            };
+            _setCursorPosition = [](SimpleTextOutputProtocol* protocol, size_t new_column, size_t new_row) {
+                auto& self = _self(protocol);
+                ++self.call_count;
+                self.column = new_column;
+                self.row = new_row;
+                return Status::Success;
+            };
+            _enableCursor = [](SimpleTextOutputProtocol*, bool) {
+                return Status::Unsupported;
+            };
+        }
+
+    private:
+        static MockConsole& _self(SimpleTextOutputProtocol* protocol) {
+            return *static_cast<MockConsole*>(protocol);
+        }
+
+        Mode _modeData = {1, 0, default_color.getValue(), 0, 0, true};
+    };
+
+    /// Whether the console shows `expected`, except for the bottom right cell, which is never sent.
+    bool shows(const MockConsole& console, const std::vector<uint32_t>& expected) {
+        for (size_t i = 0; i + 1 < columns * rows; ++i) {
+            if (console.grid[i] != expected[i])
+                return false;
+        }
+
+        return true;
+    }
+
+    struct CountingPort {
+        size_t* byte_count;
+
+        Status write(const uint8_t*, size_t size) {
+            *byte_count += size;
+            return Status::Success;
+        }
+    };
+
+    alignas(4) uint8_t memory[TextScreen::getRequiredSize(columns, rows)];
+} // namespace
+
+int main() {
+    static MockConsole console;
+    TextScreen screen;
+    CHECK(screen.initialize(console, memory, sizeof(memory) - 1) == Status::BufferTooSmall);
+    CHECK(screen.initialize(console, memory, sizeof(memory)) == Status::Success);
+    CHECK(screen.getColumns() == columns && screen.getRows() == rows);
+
+    // Random drawing, against a model of the screen: what is presented is what the console shows.
+    std::vector<uint32_t> expected(columns * rows, makeCell(u' ', default_color));
+    std::mt19937 random(1);
+    for (int i = 0; i < 3000; ++i) {
+        const TextColor color = {static_cast<ForegroundColor>(random() % 16), static_cast<BackgroundColor>(random() % 8)};
+        const size_t column = random() % (columns + 2), row = random() % (rows + 1);
+        switch (random() % 4) {
+        case 0: {
+            const auto character = static_cast<char16_t>(random() % 4 == 0 ? random() % 32 : u'A' + (random() % 26));
+            screen.put(column, row, character, color);
+            if (column < columns && row < rows)
+                expected[(row * columns) + column] = makeCell(character, color);
+            break;
+        }
+        case 1: {
+            const char16_t* text = u"Hello, world";
+            const auto end = screen.write(column, row, text, color);
+            for (size_t j = 0; text[j] != 0 && column + j < columns && row < rows; ++j)
+                expected[(row * columns) + column + j] = makeCell(text[j], color);
+
+            CHECK(end == (row < rows ? std::min(column + 12, std::max(column, columns)) : column));
+            break;
+        }
+        case 2: {
+            const size_t width = random() % 20, height = random() % 5;
+            screen.fill(column, row, width, height, u'#', color);
+            for (size_t y = row; y < row + height && y < rows && column < columns; ++y) {
+                for (size_t x = column; x < column + width && x < columns; ++x)
+                    expected[(y * columns) + x] = makeCell(u'#', color);
+            }
+            break;
+        }
+        default:
+            if (random() % 50 == 0) {
+                screen.clear(color);
+                expected.assign(expected.size(), makeCell(u' ', color));
+            }
+        }
+
+        if (random() % 3 == 0) {
+            CHECK(screen.present() == Status::Success);
+            CHECK(shows(console, expected));
+        }
+    }
+
+    // Presenting again sends nothing.
+    CHECK(screen.present() == Status::Success);
+    console.call_count = 0;
+    CHECK(screen.present() == Status::Success && console.call_count == 0);
+
+    // After something else wrote to the console, invalidate() sends everything again.
+    console.grid.assign(console.grid.size(), 0);
+    screen.invalidate();
+    CHECK(screen.present() == Status::Success && shows(console, expected));
+
+    // A failure keeps the cells which were not sent for the next present().
+    const TextColor yellow = {ForegroundColor::Yellow, BackgroundColor::Blue}, white = {ForegroundColor::White, BackgroundColor::Red};
+    screen.fill(0, 0, columns, rows, u'x', yellow);
+    screen.fill(0, 10, columns, 1, u'y', white);
+    expected.assign(expected.size(), makeCell(u'x', yellow));
+    for (size_t x = 0; x < columns; ++x)
+        expected[(10 * columns) + x] = makeCell(u'y', white);
+
+    console.failures_after = 1;
+    CHECK(screen.present() == Status::DeviceError && !shows(console, expected));
+    console.failures_after = SIZE_MAX;
+    CHECK(screen.present() == Status::Success && shows(console, expected));
+
+    // Moving a menu's selection on a serial console costs a small part of a full redraw.
+    {
+        size_t byte_count = 0;
+        static SerialConsole<CountingPort> serial_console;
+        serial_console.initialize(CountingPort{&byte_count});
+        TextScreen menu;
+        CHECK(menu.initialize(serial_console, memory, sizeof(memory)) == Status::Success);
+
+        const TextColor normal = default_color, highlight = {ForegroundColor::Black, BackgroundColor::LightGray};
+        const auto draw = [&](size_t selected) {
+            menu.clear();
+            menu.write(2, 0, u"Boot Manager", normal);
+            for (size_t i = 0; i < 10; ++i) {
+                const auto color = i == selected ? highlight : normal;
+                menu.fill(4, 3 + i, 60, 1, u' ', color);
+                menu.write(4, 3 + i, u"Entry: Some Operating System (disk 0, partition 2)", color);
+            }
+        };
+
+        draw(0);
+        CHECK(menu.present() == Status::Success && serial_console.flush() == Status::Success);
+        byte_count = 0;
+        draw(1);
+        CHECK(menu.present() == Status::Success && serial_console.flush() == Status::Success);
+        const auto change_bytes = byte_count;
+
+        byte_count = 0;
+        menu.invalidate();
+        CHECK(menu.present() == Status::Success && serial_console.flush() == Status::Success);
+        std::printf("selection change: %zu bytes, full redraw: %zu bytes\n", change_bytes, byte_count);
+        CHECK(change_bytes > 0 && change_bytes * 10 < byte_count);
+    }
+
+    return 0;
+}
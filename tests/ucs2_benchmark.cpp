@@ -0,0 +1,77 @@
+#include <vector>
+
+#include "test.h"
+#include "uefi.h"
+
+using namespace Uefi;
+
+namespace {
+    volatile size_t sink;
+
+    /// The loops the vector paths replace, through a volatile pointer so that the compiler keeps them as loops.
+    /// @{
+    size_t getLengthByLoop(const volatile char16_t* string) {
+        size_t length = 0;
+        while (string[length] != 0)
+            ++length;
+
+        return length;
+    }
+
+    const volatile char16_t* findByLoop(const volatile char16_t* string, char16_t character) {
+        for (;; ++string) {
+            if (*string == character)
+                return string;
+
+            if (*string == 0)
+                return nullptr;
+        }
+    }
+
+    int compareIgnoreCaseByLoop(const volatile char16_t* a, const volatile char16_t* b) {
+        for (;; ++a, ++b) {
+            const int character_a = toUpperAscii(*a);
+            const int character_b = toUpperAscii(*b);
+            if (character_a != character_b || character_a == 0)
+                return character_a - character_b;
+        }
+    }
+    /// @}
+
+    /// Nanoseconds per call.
+    template <typename Function>
+    double measure(size_t repeat_count, Function function) {
+        const auto start = Test::getTime();
+        for (size_t i = 0; i < repeat_count; ++i)
+            function();
+
+        return (Test::getTime() - start) * 1e9 / static_cast<double>(repeat_count);
+    }
+} // namespace
+
+int main() {
+    // Strings of 'x', and a copy which differs only in the case of its last character.
+    for (const size_t length : {8, 32, 128, 512}) {
+        std::vector<char16_t> a(length + 1, u'x'), b(length + 1, u'x');
+        a[length] = b[length] = 0;
+        b[length - 1] = u'X';
+
+        const auto repeat_count = 16000000 / length;
+        const auto length_vector = measure(repeat_count, [&] { sink = getStringLength(a.data()); });
+        const auto length_loop = measure(repeat_count, [&] { sink = getLengthByLoop(a.data()); });
+        const auto find_vector = measure(repeat_count, [&] { sink = findCharacter(a.data(), u'\\') == nullptr; });
+        const auto find_loop = measure(repeat_count, [&] { sink = findByLoop(a.data(), u'\\') == nullptr; });
+        const auto compare_vector = measure(repeat_count, [&] { sink = static_cast<size_t>(compareStringsIgnoreCase(a.data(), b.data())); });
+        const auto compare_loop = measure(repeat_count, [&] { sink = static_cast<size_t>(compareIgnoreCaseByLoop(a.data(), b.data())); });
+
+        std::printf("%3zu characters: length %6.1f/%6.1f ns, find %6.1f/%6.1f ns, compare ignoring case %6.1f/%6.1f ns (helper/loop)\n",
+                    length, length_vector, length_loop, find_vector, find_loop, compare_vector, compare_loop);
+
+#if defined(UEFI_UCS2_VECTORS)
+        if (length == 512)
+            CHECK(length_vector < length_loop && find_vector < find_loop && compare_vector < compare_loop);
+#endif
+    }
+
+    return 0;
+}
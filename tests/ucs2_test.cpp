@@ -0,0 +1,181 @@
+#include <cstring>
+#include <initializer_list>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/mman.h>
+
+#include "test.h"
+#include "uefi.h"
+
+using namespace Uefi;
+
+namespace {
+    /// The loops the vector paths replace.
+    /// @{
+    const char16_t* findByLoop(const char16_t* string, char16_t character) {
+        for (;; ++string) {
+            if (*string == character)
+                return string;
+
+            if (*string == 0)
+                return nullptr;
+        }
+    }
+
+    int compareByLoop(const char16_t* a, const char16_t* b, bool ignore_case) {
+        for (;; ++a, ++b) {
+            const int character_a = ignore_case ? toUpperAscii(*a) : *a;
+            const int character_b = ignore_case ? toUpperAscii(*b) : *b;
+            if (character_a != character_b || character_a == 0)
+                return character_a - character_b;
+        }
+    }
+    /// @}
+
+    int getSign(int value) {
+        return (value > 0) - (value < 0);
+    }
+
+    /// Normalizes a path through a list of its components.
+    std::u16string normalizeByComponents(const std::u16string& path) {
+        const bool is_absolute = !path.empty() && isPathSeparator(path[0]);
+        std::vector<std::u16string> components;
+        std::u16string component;
+        const auto flush = [&] {
+            if (component == u"..") {
+                if (!components.empty() && components.back() != u"..")
+                    components.pop_back();
+                else if (!is_absolute)
+                    components.push_back(component);
+            } else if (!component.empty() && component != u".") {
+                components.push_back(component);
+            }
+
+            component.clear();
+        };
+
+        for (const auto character : path) {
+            if (isPathSeparator(character))
+                flush();
+            else
+                component += character;
+        }
+
+        flush();
+        std::u16string result = is_absolute ? u"\\" : u"";
+        for (size_t i = 0; i < components.size(); ++i)
+            result += (i == 0 ? u"" : u"\\") + components[i];
+
+        return result;
+    }
+} // namespace
+
+int main() {
+    // Strings ending right before an inaccessible page: reading past the terminator into it would fault.
+    auto* memory = static_cast<uint8_t*>(mmap(nullptr, 0x2000, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    CHECK(memory != MAP_FAILED && mprotect(memory + 0x1000, 0x1000, PROT_NONE) == 0);
+
+    std::mt19937 random(7);
+    const char16_t alphabet[] = {u'a', u'z', u'A', u'Z', u'`', u'{', u'@', u'[', u'0', 0x8061, 0xFF41, 0x00E1, u'\\', u'/'};
+    constexpr size_t alphabet_size = sizeof(alphabet) / sizeof(alphabet[0]);
+
+    for (size_t length = 0; length <= 80; ++length) {
+        for (size_t gap = 0; gap <= 34; gap += 2) {
+            auto* string = reinterpret_cast<char16_t*>(memory + 0x1000 - gap - ((length + 1) * sizeof(char16_t)));
+            for (int repeat = 0; repeat < 4; ++repeat) {
+                for (size_t i = 0; i < length; ++i)
+                    string[i] = alphabet[random() % alphabet_size];
+
+                string[length] = 0;
+                CHECK(getStringLength(string) == length);
+                for (const auto character : alphabet)
+                    CHECK(findCharacter(string, character) == findByLoop(string, character));
+
+                CHECK(findCharacter(string, 0) == string + length);
+
+                // Against a copy with a case change, a cut or another character, which also ends near the guard.
+                std::vector<char16_t> other(string, string + length + 1);
+                const auto original = other;
+                const auto change = random() % 4;
+                if (length != 0 && change == 1) {
+                    other[random() % length] ^= 0x20;
+                } else if (length != 0 && change == 2) {
+                    other.resize(random() % length);
+                    other.push_back(0);
+                } else if (length != 0 && change == 3) {
+                    other[random() % length] = alphabet[random() % alphabet_size];
+                }
+
+                auto* placed = reinterpret_cast<char16_t*>(memory + 0x1000 - (other.size() * sizeof(char16_t)) - ((random() % 20) * 2));
+                std::memmove(placed, other.data(), other.size() * sizeof(char16_t));
+
+                for (const bool ignore_case : {false, true}) {
+                    const auto compare = ignore_case ? compareStringsIgnoreCase : compareStrings;
+                    CHECK(getSign(compare(original.data(), placed)) == getSign(compareByLoop(original.data(), placed, ignore_case)));
+                    CHECK(getSign(compare(placed, original.data())) == getSign(compareByLoop(placed, original.data(), ignore_case)));
+                }
+            }
+        }
+    }
+
+    munmap(memory, 0x2000);
+
+    // The exact difference for characters at each position of a block, including those above U+7FFF.
+    for (size_t position = 0; position < 9; ++position) {
+        for (int x = 0; x < 0x10000; x += 97) {
+            for (const int y : {0, 1, int{'A'}, int{'a'}, int{'Z'}, int{'z'}, 0x7FFF, 0x8000, 0xFFFF}) {
+                char16_t a[12] = {}, b[12] = {};
+                for (size_t i = 0; i < position; ++i)
+                    a[i] = b[i] = u'q';
+
+                a[position] = static_cast<char16_t>(x);
+                b[position] = static_cast<char16_t>(y);
+                CHECK(compareStrings(a, b) == compareByLoop(a, b, false));
+                CHECK(compareStringsIgnoreCase(a, b) == compareByLoop(a, b, true));
+            }
+        }
+    }
+
+    // Paths.
+    const struct {
+        const char16_t* path;
+        const char16_t* normalized;
+    } paths[] = {
+        {u"/EFI//Boot/./../BOOT/", u"\\EFI\\BOOT"}, {u"\\", u"\\"},     {u"", u""},      {u"\\..\\..", u"\\"},
+        {u"..\\a\\..\\..\\b", u"..\\..\\b"},       {u"a\\..", u""}, {u".\\x\\.", u"x"}, {u"//a//b//", u"\\a\\b"},
+    };
+
+    for (const auto& path : paths) {
+        char16_t buffer[64];
+        std::memcpy(buffer, path.path, (getStringLength(path.path) + 1) * sizeof(char16_t));
+        CHECK(normalizePath(buffer) == getStringLength(path.normalized) && compareStrings(buffer, path.normalized) == 0);
+    }
+
+    // Random paths, against a list of components. Normalizing twice changes nothing.
+    const char16_t* parts[] = {u"a", u"bc", u".", u"..", u"\\", u"/", u"EFI", u"x.y"};
+    for (int i = 0; i < 100000; ++i) {
+        std::u16string path;
+        for (auto count = random() % 10; count != 0; --count)
+            path += parts[random() % 8];
+
+        char16_t buffer[128];
+        std::memcpy(buffer, path.c_str(), (path.size() + 1) * sizeof(char16_t));
+        const auto length = normalizePath(buffer);
+        const auto expected = normalizeByComponents(path);
+        CHECK(buffer == expected && length == expected.size());
+        CHECK(normalizePath(buffer) == length && buffer == expected);
+    }
+
+    char16_t path[16] = u"\\EFI";
+    CHECK(joinPath(path, 16, u"BOOT/x.efi") && compareStrings(path, u"\\EFI\\BOOT\\x.efi") == 0);
+    CHECK(!joinPath(path, 16, u"toolong") && compareStrings(path, u"\\EFI\\BOOT\\x.efi") == 0);
+
+    auto split = splitPath(path);
+    CHECK(split.directory_length == 9 && compareStrings(split.file_name, u"x.efi") == 0);
+    split = splitPath(u"\\EFI");
+    CHECK(split.directory_length == 1 && compareStrings(split.file_name, u"EFI") == 0);
+    CHECK(splitPath(u"EFI").directory_length == 0);
+    return 0;
+}